@@ -0,0 +1,146 @@
+// Andrew Davies
+
+#include "pch.h"
+#include "Dav/memory/memory.h"
+#include <atomic>
+#include <stdlib.h>
+
+namespace Dav
+{
+
+namespace
+{
+
+std::atomic< uint64_t > s_frame( 0 );
+
+uint8_t* alignUp( uint8_t* const pointer, const size_t alignment )
+{
+    return ( uint8_t* )( ( ( uintptr_t )pointer + alignment - 1 ) & ~( ( uintptr_t )alignment - 1 ) );
+}
+
+}
+
+FrameArena::FrameArena()
+    : m_current( 0 )
+    , m_frame( s_frame.load( std::memory_order_relaxed ) )
+{
+    for( int i = 0; i != 2; ++i )
+    {
+        Buffer& buffer = m_buffers[ i ];
+        buffer.m_data = ( uint8_t* )malloc( kInitialCapacity );
+        buffer.m_capacity = kInitialCapacity;
+        buffer.m_used = 0;
+        buffer.m_overflow = nullptr;
+        buffer.m_overflowTop = nullptr;
+        buffer.m_overflowEnd = nullptr;
+        buffer.m_overflowBytes = 0;
+    }
+}
+
+FrameArena::~FrameArena()
+{
+    for( int i = 0; i != 2; ++i )
+    {
+        Buffer& buffer = m_buffers[ i ];
+        while( buffer.m_overflow )
+        {
+            Overflow* const block = buffer.m_overflow;
+            buffer.m_overflow = block->m_next;
+            free( block );
+        }
+        free( buffer.m_data );
+    }
+}
+
+void FrameArena::nextFrame()
+{
+    s_frame.fetch_add( 1, std::memory_order_relaxed );
+}
+
+FrameArena& FrameArena::thread()
+{
+    static thread_local FrameArena s_arena;
+    return s_arena;
+}
+
+void* FrameArena::allocate( const size_t size, const size_t alignment )
+{
+    const uint64_t frame = s_frame.load( std::memory_order_relaxed );
+    if( frame != m_frame )
+    {
+        // If this thread skipped a frame, the buffer it's leaving is two frames old as well
+        if( frame - m_frame > 1 )
+        {
+            reset( m_buffers[ m_current ] );
+        }
+        m_current ^= 1;
+        reset( m_buffers[ m_current ] );
+        m_frame = frame;
+    }
+
+    Buffer& buffer = m_buffers[ m_current ];
+    uint8_t* const pointer = alignUp( buffer.m_data + buffer.m_used, alignment );
+    if( pointer + size <= buffer.m_data + buffer.m_capacity )
+    {
+        buffer.m_used = ( pointer + size ) - buffer.m_data;
+        return pointer;
+    }
+
+    return allocateOverflow( buffer, size, alignment );
+}
+
+size_t FrameArena::used() const
+{
+    const Buffer& buffer = m_buffers[ m_current ];
+    return buffer.m_used + buffer.m_overflowBytes;
+}
+
+void* FrameArena::allocateOverflow( Buffer& buffer, const size_t size, const size_t alignment )
+{
+    buffer.m_overflowBytes += size + alignment;
+
+    uint8_t* pointer = alignUp( buffer.m_overflowTop, alignment );
+    if( !buffer.m_overflow || pointer + size > buffer.m_overflowEnd )
+    {
+        const size_t blockSize = sizeof( Overflow ) + ( size + alignment > buffer.m_capacity ? size + alignment : buffer.m_capacity );
+        Overflow* const block = ( Overflow* )malloc( blockSize );
+        if( !block )
+        {
+            throw std::bad_alloc();
+        }
+        block->m_next = buffer.m_overflow;
+        buffer.m_overflow = block;
+        buffer.m_overflowTop = ( uint8_t* )( block + 1 );
+        buffer.m_overflowEnd = ( uint8_t* )block + blockSize;
+        pointer = alignUp( buffer.m_overflowTop, alignment );
+    }
+
+    buffer.m_overflowTop = pointer + size;
+    return pointer;
+}
+
+void FrameArena::reset( Buffer& buffer )
+{
+    if( buffer.m_overflow )
+    {
+        while( buffer.m_overflow )
+        {
+            Overflow* const block = buffer.m_overflow;
+            buffer.m_overflow = block->m_next;
+            free( block );
+        }
+
+        // Grow so a frame like the one that overflowed fits without borrowing
+        const size_t capacity = buffer.m_capacity + buffer.m_overflowBytes;
+        free( buffer.m_data );
+        buffer.m_data = ( uint8_t* )malloc( capacity );
+        buffer.m_capacity = buffer.m_data ? capacity : 0;
+        buffer.m_overflowTop = nullptr;
+        buffer.m_overflowEnd = nullptr;
+        buffer.m_overflowBytes = 0;
+    }
+
+    buffer.m_used = 0;
+}
+
+}
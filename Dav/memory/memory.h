@@ -0,0 +1,205 @@
+// Andrew Davies
+
+#if !defined( DAV_MEMORY_H )
+#define DAV_MEMORY_H
+
+#include "Dav/memory/memoryFwd.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <new>
+
+namespace Dav
+{
+
+// Bump allocator for data that only lives for the frame it was made in and the one after, so it can be handed
+// from update to render. Each thread has its own arena with two buffers, one per frame, and nextFrame() lets
+// every thread empty its older buffer the next time it allocates. Freeing is a no-op.
+//
+// A buffer that runs out borrows overflow blocks from the heap for the rest of the frame, and grows to fit
+// everything next time it's emptied, so once frames settle down the arena stops calling malloc altogether.
+class FrameArena
+{
+private:
+    struct Overflow
+    {
+        Overflow* m_next;
+    };
+
+    struct Buffer
+    {
+        uint8_t* m_data;
+        size_t m_capacity;
+        size_t m_used;
+
+        // Blocks borrowed when m_data was full, and how many bytes were asked of them
+        Overflow* m_overflow;
+        uint8_t* m_overflowTop;
+        uint8_t* m_overflowEnd;
+        size_t m_overflowBytes;
+    };
+
+    Buffer m_buffers[ 2 ];
+    int m_current;
+    uint64_t m_frame;
+
+    void reset( Buffer& buffer );
+    void* allocateOverflow( Buffer& buffer, size_t size, size_t alignment );
+
+    FrameArena();
+    ~FrameArena();
+    FrameArena( const FrameArena& );
+    FrameArena& operator=( const FrameArena& );
+
+public:
+    static const size_t kInitialCapacity = 64 * 1024;
+
+    // Call once per frame, from one thread, before any of the frame's allocations
+    static void nextFrame();
+
+    // The calling thread's arena
+    static FrameArena& thread();
+
+    void* allocate( size_t size, size_t alignment );
+
+    // Bytes in use by this thread's current frame
+    size_t used() const;
+};
+
+// Standard allocator over the calling thread's FrameArena, for containers that don't outlive the next frame
+template< typename Type >
+class FrameAllocator
+{
+public:
+    typedef Type value_type;
+
+    FrameAllocator()
+    {
+    }
+
+    template< typename Other >
+    FrameAllocator( const FrameAllocator< Other >& )
+    {
+    }
+
+    Type* allocate( size_t count )
+    {
+        return static_cast< Type* >( FrameArena::thread().allocate( count * sizeof( Type ), alignof( Type ) ) );
+    }
+
+    void deallocate( Type*, size_t )
+    {
+    }
+};
+
+template< typename TypeA, typename TypeB >
+bool operator==( const FrameAllocator< TypeA >&, const FrameAllocator< TypeB >& )
+{
+    return true;
+}
+
+template< typename TypeA, typename TypeB >
+bool operator!=( const FrameAllocator< TypeA >&, const FrameAllocator< TypeB >& )
+{
+    return false;
+}
+
+// Standard allocator that recycles single objects through one free list per type, shared by every thread, for
+// node based containers that insert and erase every frame but last longer than one. Nodes are carved from
+// chunks that are never given back, so once a container reaches its largest size it stops calling malloc.
+// The pool lives for the whole process and is never destroyed, so containers that are statics themselves can
+// still free into it while they're destroyed at exit.
+template< typename Type >
+class PoolAllocator
+{
+private:
+    union Node
+    {
+        Node* m_next;
+        alignas( Type ) unsigned char m_storage[ sizeof( Type ) ];
+    };
+
+    struct Pool
+    {
+        std::mutex m_mutex;
+        Node* m_head;
+        size_t m_chunkSize;
+    };
+
+    static const size_t kFirstChunkSize = 64;
+
+    static Pool& pool()
+    {
+        static Pool* const s_pool = new Pool{ {}, nullptr, kFirstChunkSize };
+        return *s_pool;
+    }
+
+public:
+    typedef Type value_type;
+
+    PoolAllocator()
+    {
+    }
+
+    template< typename Other >
+    PoolAllocator( const PoolAllocator< Other >& )
+    {
+    }
+
+    Type* allocate( size_t count )
+    {
+        if( count != 1 )
+        {
+            return static_cast< Type* >( ::operator new( count * sizeof( Type ) ) );
+        }
+
+        Pool& thePool = pool();
+        std::lock_guard< std::mutex > lock( thePool.m_mutex );
+        if( !thePool.m_head )
+        {
+            // Each chunk is twice the size of the last, so a growing container reaches its size in a few mallocs
+            Node* const chunk = static_cast< Node* >( ::operator new( thePool.m_chunkSize * sizeof( Node ) ) );
+            for( size_t index = 0; index != thePool.m_chunkSize; ++index )
+            {
+                chunk[ index ].m_next = ( index + 1 != thePool.m_chunkSize ) ? &chunk[ index + 1 ] : nullptr;
+            }
+            thePool.m_head = chunk;
+            thePool.m_chunkSize *= 2;
+        }
+
+        Node* const node = thePool.m_head;
+        thePool.m_head = node->m_next;
+        return reinterpret_cast< Type* >( node );
+    }
+
+    void deallocate( Type* const pointer, const size_t count )
+    {
+        if( count != 1 )
+        {
+            ::operator delete( pointer );
+            return;
+        }
+
+        Pool& thePool = pool();
+        std::lock_guard< std::mutex > lock( thePool.m_mutex );
+        Node* const node = reinterpret_cast< Node* >( pointer );
+        node->m_next = thePool.m_head;
+        thePool.m_head = node;
+    }
+};
+
+template< typename TypeA, typename TypeB >
+bool operator==( const PoolAllocator< TypeA >&, const PoolAllocator< TypeB >& )
+{
+    return true;
+}
+
+template< typename TypeA, typename TypeB >
+bool operator!=( const PoolAllocator< TypeA >&, const PoolAllocator< TypeB >& )
+{
+    return false;
+}
+
+}
+
+#endif
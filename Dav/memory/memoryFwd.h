@@ -0,0 +1,15 @@
+// Andrew Davies
+
+#if !defined( DAV_MEMORY_FWD_H )
+#define DAV_MEMORY_FWD_H
+
+namespace Dav
+{
+
+class FrameArena;
+template< typename Type > class FrameAllocator;
+template< typename Type > class PoolAllocator;
+
+}
+
+#endif
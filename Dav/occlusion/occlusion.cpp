@@ -0,0 +1,330 @@
+// Andrew Davies
+
+#include "pch.h"
+#include "Dav/occlusion/occlusion.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace Dav
+{
+
+OcclusionBuffer::OcclusionBuffer( const int width, const int height )
+    : m_width( width )
+    , m_height( height )
+    , m_tilesX( width / kTileWidth )
+    , m_tilesY( height / kTileHeight )
+    , m_nearW( 0.0f )
+    , m_depth( ( size_t )width * height, 0.0f )
+    , m_farthest( ( size_t )( width / kBlockSize ) * ( height / kBlockSize ), 0.0f )
+    , m_bins( ( size_t )( width / kTileWidth ) * ( height / kTileHeight ) )
+{
+    assert( ( width % kTileWidth == 0 ) && ( height % kTileHeight == 0 ) );
+}
+
+void OcclusionBuffer::begin( const float nearW )
+{
+    m_nearW = nearW;
+    m_triangles.clear();
+    for( std::vector< uint32_t >& bin : m_bins )
+    {
+        bin.clear();
+    }
+}
+
+void OcclusionBuffer::addOccluder( FXMMATRIX modelToClip, const XMFLOAT3* const positions, const size_t positionCount, const uint32_t* const indices, const size_t indexCount )
+{
+    m_clip.resize( positionCount );
+    for( size_t i = 0; i != positionCount; ++i )
+    {
+        XMStoreFloat4( &m_clip[ i ], XMVector3Transform( XMLoadFloat3( &positions[ i ] ), modelToClip ) );
+    }
+
+    for( size_t i = 0; i + 2 < indexCount; i += 3 )
+    {
+        const XMFLOAT4& a = m_clip[ indices[ i ] ];
+        const XMFLOAT4& b = m_clip[ indices[ i + 1 ] ];
+        const XMFLOAT4& c = m_clip[ indices[ i + 2 ] ];
+
+        const int inFront = ( a.w >= m_nearW ) + ( b.w >= m_nearW ) + ( c.w >= m_nearW );
+        if( inFront == 3 )
+        {
+            addTriangle( a, b, c );
+        }
+        else if( inFront )
+        {
+            addClipped( a, b, c );
+        }
+    }
+}
+
+void OcclusionBuffer::addClipped( const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c )
+{
+    // Clipping a triangle against one plane leaves three or four corners
+    const XMFLOAT4* const corners[ 3 ] = { &a, &b, &c };
+    XMFLOAT4 clipped[ 4 ];
+    int count = 0;
+    for( int i = 0; i != 3; ++i )
+    {
+        const XMFLOAT4& from = *corners[ i ];
+        const XMFLOAT4& to = *corners[ ( i + 1 ) % 3 ];
+        const bool fromInFront = from.w >= m_nearW;
+        if( fromInFront )
+        {
+            clipped[ count++ ] = from;
+        }
+        if( fromInFront != ( to.w >= m_nearW ) )
+        {
+            const float t = ( m_nearW - from.w ) / ( to.w - from.w );
+            XMStoreFloat4( &clipped[ count++ ], XMVectorLerp( XMLoadFloat4( &from ), XMLoadFloat4( &to ), t ) );
+        }
+    }
+
+    addTriangle( clipped[ 0 ], clipped[ 1 ], clipped[ 2 ] );
+    if( count == 4 )
+    {
+        addTriangle( clipped[ 0 ], clipped[ 2 ], clipped[ 3 ] );
+    }
+}
+
+void OcclusionBuffer::addTriangle( const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c )
+{
+    // To pixels, with y down the screen
+    const XMFLOAT4* const corners[ 3 ] = { &a, &b, &c };
+    float x[ 3 ];
+    float y[ 3 ];
+    float inverseW[ 3 ];
+    for( int i = 0; i != 3; ++i )
+    {
+        inverseW[ i ] = 1.0f / corners[ i ]->w;
+        x[ i ] = ( corners[ i ]->x * inverseW[ i ] * 0.5f + 0.5f ) * m_width;
+        y[ i ] = ( 0.5f - corners[ i ]->y * inverseW[ i ] * 0.5f ) * m_height;
+    }
+
+    // Either winding is fine, occluders are solid from both sides
+    float area = ( x[ 1 ] - x[ 0 ] ) * ( y[ 2 ] - y[ 0 ] ) - ( x[ 2 ] - x[ 0 ] ) * ( y[ 1 ] - y[ 0 ] );
+    if( fabsf( area ) < 1.0e-6f )
+    {
+        return;
+    }
+    if( area < 0.0f )
+    {
+        std::swap( x[ 1 ], x[ 2 ] );
+        std::swap( y[ 1 ], y[ 2 ] );
+        std::swap( inverseW[ 1 ], inverseW[ 2 ] );
+        area = -area;
+    }
+
+    // Pixels whose centres are in the triangle's bounds
+    const float minX = ( std::max )( ( std::min )( ( std::min )( x[ 0 ], x[ 1 ] ), x[ 2 ] ), 0.0f );
+    const float minY = ( std::max )( ( std::min )( ( std::min )( y[ 0 ], y[ 1 ] ), y[ 2 ] ), 0.0f );
+    const float maxX = ( std::min )( ( std::max )( ( std::max )( x[ 0 ], x[ 1 ] ), x[ 2 ] ), ( float )m_width );
+    const float maxY = ( std::min )( ( std::max )( ( std::max )( y[ 0 ], y[ 1 ] ), y[ 2 ] ), ( float )m_height );
+
+    Triangle triangle;
+    triangle.m_minX = ( int )ceilf( minX - 0.5f );
+    triangle.m_minY = ( int )ceilf( minY - 0.5f );
+    triangle.m_maxX = ( int )floorf( maxX - 0.5f ) + 1;
+    triangle.m_maxY = ( int )floorf( maxY - 0.5f ) + 1;
+    if( ( triangle.m_minX >= triangle.m_maxX ) || ( triangle.m_minY >= triangle.m_maxY ) )
+    {
+        return;
+    }
+
+    // Edge i is opposite corner i, so dividing it by the area gives that corner's barycentric weight
+    float depth[ 3 ] = { 0.0f, 0.0f, 0.0f };
+    for( int i = 0; i != 3; ++i )
+    {
+        const int from = ( i + 1 ) % 3;
+        const int to = ( i + 2 ) % 3;
+        float* const edge = triangle.m_edge[ i ];
+        edge[ 0 ] = y[ from ] - y[ to ];
+        edge[ 1 ] = x[ to ] - x[ from ];
+        edge[ 2 ] = -( edge[ 0 ] * x[ from ] + edge[ 1 ] * y[ from ] );
+
+        const float weight = inverseW[ i ] / area;
+        depth[ 0 ] += edge[ 0 ] * weight;
+        depth[ 1 ] += edge[ 1 ] * weight;
+        depth[ 2 ] += edge[ 2 ] * weight;
+    }
+    triangle.m_depth[ 0 ] = depth[ 0 ];
+    triangle.m_depth[ 1 ] = depth[ 1 ];
+    triangle.m_depth[ 2 ] = depth[ 2 ];
+
+    const uint32_t index = ( uint32_t )m_triangles.size();
+    m_triangles.push_back( triangle );
+
+    const int lastTileX = ( triangle.m_maxX - 1 ) / kTileWidth;
+    const int lastTileY = ( triangle.m_maxY - 1 ) / kTileHeight;
+    for( int tileY = triangle.m_minY / kTileHeight; tileY <= lastTileY; ++tileY )
+    {
+        for( int tileX = triangle.m_minX / kTileWidth; tileX <= lastTileX; ++tileX )
+        {
+            m_bins[ tileY * m_tilesX + tileX ].push_back( index );
+        }
+    }
+}
+
+void OcclusionBuffer::rasterizeTile( const int tile )
+{
+    const int tileX = ( tile % m_tilesX ) * kTileWidth;
+    const int tileY = ( tile / m_tilesX ) * kTileHeight;
+
+    for( int y = tileY; y != tileY + kTileHeight; ++y )
+    {
+        float* const row = &m_depth[ ( size_t )y * m_width + tileX ];
+        std::fill( row, row + kTileWidth, 0.0f );
+    }
+
+    const XMVECTOR laneX = XMVectorSet( 0.5f, 1.5f, 2.5f, 3.5f );
+    const XMVECTOR zero = XMVectorZero();
+
+    for( const uint32_t index : m_bins[ tile ] )
+    {
+        const Triangle& triangle = m_triangles[ index ];
+        const int minX = ( std::max )( triangle.m_minX, tileX ) & ~3;
+        const int maxX = ( std::min )( triangle.m_maxX, tileX + kTileWidth );
+        const int minY = ( std::max )( triangle.m_minY, tileY );
+        const int maxY = ( std::min )( triangle.m_maxY, tileY + kTileHeight );
+
+        XMVECTOR edgeA[ 3 ];
+        XMVECTOR edgeB[ 3 ];
+        XMVECTOR edgeC[ 3 ];
+        for( int i = 0; i != 3; ++i )
+        {
+            edgeA[ i ] = XMVectorReplicate( triangle.m_edge[ i ][ 0 ] );
+            edgeB[ i ] = XMVectorReplicate( triangle.m_edge[ i ][ 1 ] );
+            edgeC[ i ] = XMVectorReplicate( triangle.m_edge[ i ][ 2 ] );
+        }
+        const XMVECTOR depthA = XMVectorReplicate( triangle.m_depth[ 0 ] );
+        const XMVECTOR depthB = XMVectorReplicate( triangle.m_depth[ 1 ] );
+        const XMVECTOR depthC = XMVectorReplicate( triangle.m_depth[ 2 ] );
+
+        for( int y = minY; y < maxY; ++y )
+        {
+            const XMVECTOR pixelY = XMVectorReplicate( y + 0.5f );
+            const XMVECTOR rowEdge0 = XMVectorMultiplyAdd( edgeB[ 0 ], pixelY, edgeC[ 0 ] );
+            const XMVECTOR rowEdge1 = XMVectorMultiplyAdd( edgeB[ 1 ], pixelY, edgeC[ 1 ] );
+            const XMVECTOR rowEdge2 = XMVectorMultiplyAdd( edgeB[ 2 ], pixelY, edgeC[ 2 ] );
+            const XMVECTOR rowDepth = XMVectorMultiplyAdd( depthB, pixelY, depthC );
+            float* const row = &m_depth[ ( size_t )y * m_width ];
+
+            // Lanes past the triangle's bounds are outside one of its edges
+            for( int x = minX; x < maxX; x += 4 )
+            {
+                const XMVECTOR pixelX = XMVectorAdd( XMVectorReplicate( ( float )x ), laneX );
+                XMVECTOR inside = XMVectorGreaterOrEqual( XMVectorMultiplyAdd( edgeA[ 0 ], pixelX, rowEdge0 ), zero );
+                inside = XMVectorAndInt( inside, XMVectorGreaterOrEqual( XMVectorMultiplyAdd( edgeA[ 1 ], pixelX, rowEdge1 ), zero ) );
+                inside = XMVectorAndInt( inside, XMVectorGreaterOrEqual( XMVectorMultiplyAdd( edgeA[ 2 ], pixelX, rowEdge2 ), zero ) );
+
+                const XMVECTOR depth = XMVectorMultiplyAdd( depthA, pixelX, rowDepth );
+                const XMVECTOR current = XMLoadFloat4( ( const XMFLOAT4* )&row[ x ] );
+                XMStoreFloat4( ( XMFLOAT4* )&row[ x ], XMVectorSelect( current, XMVectorMax( current, depth ), inside ) );
+            }
+        }
+    }
+
+    // The farthest depth in each block, so boxes can skip whole blocks that are nearer
+    const int blocksX = m_width / kBlockSize;
+    for( int blockY = tileY / kBlockSize; blockY != ( tileY + kTileHeight ) / kBlockSize; ++blockY )
+    {
+        for( int blockX = tileX / kBlockSize; blockX != ( tileX + kTileWidth ) / kBlockSize; ++blockX )
+        {
+            XMVECTOR farthest = XMVectorReplicate( FLT_MAX );
+            for( int y = blockY * kBlockSize; y != ( blockY + 1 ) * kBlockSize; ++y )
+            {
+                const float* const row = &m_depth[ ( size_t )y * m_width + blockX * kBlockSize ];
+                for( int x = 0; x != kBlockSize; x += 4 )
+                {
+                    farthest = XMVectorMin( farthest, XMLoadFloat4( ( const XMFLOAT4* )&row[ x ] ) );
+                }
+            }
+            XMFLOAT4 lanes;
+            XMStoreFloat4( &lanes, farthest );
+            m_farthest[ blockY * blocksX + blockX ] = ( std::min )( ( std::min )( lanes.x, lanes.y ), ( std::min )( lanes.z, lanes.w ) );
+        }
+    }
+}
+
+void OcclusionBuffer::rasterize()
+{
+    for( int tile = 0; tile != tileCount(); ++tile )
+    {
+        rasterizeTile( tile );
+    }
+}
+
+bool OcclusionBuffer::isVisible( FXMMATRIX modelToClip, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax ) const
+{
+    // The box's nearest point is one of its corners, as w is linear
+    float minX = FLT_MAX;
+    float minY = FLT_MAX;
+    float maxX = -FLT_MAX;
+    float maxY = -FLT_MAX;
+    float nearest = 0.0f;
+    for( int i = 0; i != 8; ++i )
+    {
+        const XMVECTOR corner = XMVectorSet( ( i & 1 ) ? boxMax.x : boxMin.x, ( i & 2 ) ? boxMax.y : boxMin.y, ( i & 4 ) ? boxMax.z : boxMin.z, 1.0f );
+        XMFLOAT4 clip;
+        XMStoreFloat4( &clip, XMVector4Transform( corner, modelToClip ) );
+        if( clip.w < m_nearW )
+        {
+            return true;
+        }
+
+        const float inverseW = 1.0f / clip.w;
+        const float x = ( clip.x * inverseW * 0.5f + 0.5f ) * m_width;
+        const float y = ( 0.5f - clip.y * inverseW * 0.5f ) * m_height;
+        minX = ( std::min )( minX, x );
+        minY = ( std::min )( minY, y );
+        maxX = ( std::max )( maxX, x );
+        maxY = ( std::max )( maxY, y );
+        nearest = ( std::max )( nearest, inverseW );
+    }
+
+    // Every pixel the box touches at all
+    const int firstX = ( int )floorf( ( std::max )( minX, 0.0f ) );
+    const int firstY = ( int )floorf( ( std::max )( minY, 0.0f ) );
+    const int endX = ( int )ceilf( ( std::min )( maxX, ( float )m_width ) );
+    const int endY = ( int )ceilf( ( std::min )( maxY, ( float )m_height ) );
+    if( ( firstX >= endX ) || ( firstY >= endY ) )
+    {
+        return false;
+    }
+
+    const int blocksX = m_width / kBlockSize;
+    for( int blockY = firstY / kBlockSize; blockY <= ( endY - 1 ) / kBlockSize; ++blockY )
+    {
+        for( int blockX = firstX / kBlockSize; blockX <= ( endX - 1 ) / kBlockSize; ++blockX )
+        {
+            if( m_farthest[ blockY * blocksX + blockX ] > nearest )
+            {
+                continue;
+            }
+
+            // Some of the block is no nearer than the box, so look at the pixels the box covers
+            const int fromY = ( std::max )( firstY, blockY * kBlockSize );
+            const int toY = ( std::min )( endY, ( blockY + 1 ) * kBlockSize );
+            const int fromX = ( std::max )( firstX, blockX * kBlockSize );
+            const int toX = ( std::min )( endX, ( blockX + 1 ) * kBlockSize );
+            for( int y = fromY; y != toY; ++y )
+            {
+                const float* const row = &m_depth[ ( size_t )y * m_width ];
+                for( int x = fromX; x != toX; ++x )
+                {
+                    if( row[ x ] <= nearest )
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,97 @@
+// Andrew Davies
+
+#if !defined( DAV_OCCLUSION_H )
+#define DAV_OCCLUSION_H
+
+#include "Dav/occlusion/occlusionFwd.h"
+#include <DirectXMath.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace Dav
+{
+
+// Small depth buffer rasterized on the cpu from a few simplified occluders, for skipping draws hidden behind
+// them. Depth is stored as 1/w, bigger being nearer, so it's linear across a triangle and works the same with
+// any depth convention; orthographic projections have no depth to give and can't use it.
+//
+// Triangles are binned by screen tile when they're added, then each tile is rasterized four pixels at a time
+// and summarised as the farthest depth in each block of pixels. Tiles don't share anything, so they can be
+// rasterized on different threads. Nothing here needs a gpu, so it runs anywhere DirectXMath does.
+class OcclusionBuffer
+{
+private:
+    struct Triangle
+    {
+        float m_edge[ 3 ][ 3 ];    // a * x + b * y + c, not negative inside
+        float m_depth[ 3 ];        // 1/w as a * x + b * y + c
+        int m_minX;
+        int m_minY;
+        int m_maxX;                // one past the last pixel
+        int m_maxY;
+    };
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    float m_nearW;
+
+    std::vector< float > m_depth;
+    std::vector< float > m_farthest;    // per block, the smallest 1/w in it
+    std::vector< Triangle > m_triangles;
+    std::vector< std::vector< uint32_t > > m_bins;    // triangles overlapping each tile
+    std::vector< DirectX::XMFLOAT4 > m_clip;
+
+    void addTriangle( const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c );
+    void addClipped( const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c );
+
+public:
+    static const int kTileWidth = 64;
+    static const int kTileHeight = 32;
+    static const int kBlockSize = 8;
+
+    // The size must be a whole number of tiles
+    OcclusionBuffer( int width, int height );
+
+    int width() const
+    {
+        return m_width;
+    }
+
+    int height() const
+    {
+        return m_height;
+    }
+
+    int tileCount() const
+    {
+        return m_tilesX * m_tilesY;
+    }
+
+    // Starts a frame. Anything nearer than nearW, usually the camera's near clip, is clipped away.
+    void begin( float nearW );
+
+    // Clips and bins triangles, three indices each into positions, which are transformed by modelToClip
+    void addOccluder( DirectX::FXMMATRIX modelToClip, const DirectX::XMFLOAT3* positions, size_t positionCount, const uint32_t* indices, size_t indexCount );
+
+    // Rasterizes one tile's triangles. Different tiles can be rasterized at the same time.
+    void rasterizeTile( int tile );
+
+    // Every tile, one after the other
+    void rasterize();
+
+    // False only when every pixel the box covers has an occluder in front of all of it
+    bool isVisible( DirectX::FXMMATRIX modelToClip, const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax ) const;
+
+    // 1/w for each pixel, zero where no occluder was drawn
+    const float* depth() const
+    {
+        return m_depth.data();
+    }
+};
+
+}
+
+#endif
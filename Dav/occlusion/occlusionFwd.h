@@ -0,0 +1,13 @@
+// Andrew Davies
+
+#if !defined( DAV_OCCLUSION_FWD_H )
+#define DAV_OCCLUSION_FWD_H
+
+namespace Dav
+{
+
+class OcclusionBuffer;
+
+}
+
+#endif
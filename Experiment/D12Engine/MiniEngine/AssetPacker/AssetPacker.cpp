@@ -0,0 +1,317 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "AssetPackFormat.h"
+#include "../3rdParty/zlib-win64/zlib.h"
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct InputFile
+	{
+		std::string sourcePath;
+		std::string path; // normalized, as the engine will ask for it
+		bool gzipped;
+		AssetPack::Entry entry;
+	};
+
+	void PrintHelp()
+	{
+		printf("asset_packer\n");
+
+		printf("usage:\n");
+		printf("asset_packer [-store] output_file input_path [input_path ...]\n");
+		printf("input paths are files or directories, packed under the path they're given by, so run this\n");
+		printf("from the directory the engine runs in. -store leaves every file uncompressed.\n");
+	}
+
+	bool IsDirectory(const std::string &path)
+	{
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+	}
+
+	void AddInputs(const std::string &path, std::vector<InputFile> &inputs)
+	{
+		if (!IsDirectory(path))
+		{
+			InputFile input = {};
+			input.sourcePath = path;
+			inputs.push_back(input);
+			return;
+		}
+
+		// sorted, so the payloads of a directory end up next to each other and in a stable order
+		std::vector<std::string> children;
+		WIN32_FIND_DATAA findData;
+		HANDLE find = FindFirstFileA((path + "\\*").c_str(), &findData);
+		if (find == INVALID_HANDLE_VALUE)
+			return;
+		do
+		{
+			if (strcmp(findData.cFileName, ".") != 0 && strcmp(findData.cFileName, "..") != 0)
+				children.push_back(path + "/" + findData.cFileName);
+		} while (FindNextFileA(find, &findData));
+		FindClose(find);
+
+		std::sort(children.begin(), children.end());
+		for (const std::string &child : children)
+			AddInputs(child, inputs);
+	}
+
+	bool ReadWholeFile(const std::string &path, std::vector<unsigned char> &data)
+	{
+		FILE *file = nullptr;
+		if (0 != fopen_s(&file, path.c_str(), "rb"))
+			return false;
+
+		bool ok = false;
+		long long fileSize = 0;
+
+		if (0 != _fseeki64(file, 0, SEEK_END)) goto read_fail;
+		fileSize = _ftelli64(file);
+		if (fileSize < 0 || 0 != _fseeki64(file, 0, SEEK_SET)) goto read_fail;
+
+		data.resize((size_t)fileSize);
+		if (fileSize > 0)
+			if (1 != fread(data.data(), data.size(), 1, file)) goto read_fail;
+
+		ok = true;
+
+	read_fail:
+
+		fclose(file);
+		return ok;
+	}
+
+	// the engine reads "foo" from "foo.gz" when that's all there is, so the pack stores it inflated under "foo"
+	bool Gunzip(const std::vector<unsigned char> &compressed, std::vector<unsigned char> &data)
+	{
+		z_stream strm = {};
+		if (Z_OK != inflateInit2(&strm, 15 + 16))
+			return false;
+
+		strm.next_in = (Bytef *)compressed.data();
+		strm.avail_in = (uInt)compressed.size();
+		data.resize(compressed.size() * 4 + 4096);
+
+		int err = Z_OK;
+		while (err == Z_OK || err == Z_BUF_ERROR)
+		{
+			strm.next_out = data.data() + strm.total_out;
+			strm.avail_out = (uInt)(data.size() - strm.total_out);
+			err = inflate(&strm, Z_NO_FLUSH);
+			if (err == Z_BUF_ERROR && strm.avail_in == 0)
+				break;
+			if (strm.avail_out == 0)
+				data.resize(data.size() * 2);
+		}
+		data.resize(strm.total_out);
+		inflateEnd(&strm);
+
+		return err == Z_STREAM_END;
+	}
+
+	bool EndsWith(const std::string &s, const char *suffix)
+	{
+		size_t length = strlen(suffix);
+		return s.size() >= length && 0 == s.compare(s.size() - length, length, suffix);
+	}
+
+	bool WritePadding(FILE *file, long long &offset, long long alignedOffset)
+	{
+		static const unsigned char zeros[AssetPack::kDataAlignment] = {};
+		size_t padding = (size_t)(alignedOffset - offset);
+		offset = alignedOffset;
+		return padding == 0 || 1 == fwrite(zeros, padding, 1, file);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool compress = true;
+	int firstArg = 1;
+	if (argc > 1 && 0 == strcmp(argv[1], "-store"))
+	{
+		compress = false;
+		firstArg++;
+	}
+
+	if (argc - firstArg < 2)
+	{
+		PrintHelp();
+		return -1;
+	}
+
+	const char *output_file = argv[firstArg];
+	printf("output file %s\n", output_file);
+
+	std::vector<InputFile> inputs;
+	for (int arg = firstArg + 1; arg < argc; arg++)
+		AddInputs(argv[arg], inputs);
+
+	for (InputFile &input : inputs)
+	{
+		input.path = AssetPack::NormalizePath(input.sourcePath.c_str());
+		input.gzipped = EndsWith(input.path, ".gz");
+		if (input.gzipped)
+			input.path.resize(input.path.size() - 3);
+	}
+
+	// "foo" and "foo.gz", or two spellings of one path, can't both be packed
+	{
+		std::vector<InputFile *> byPath;
+		for (InputFile &input : inputs)
+			byPath.push_back(&input);
+		std::stable_sort(byPath.begin(), byPath.end(), [](const InputFile *a, const InputFile *b)
+		{
+			return a->path < b->path;
+		});
+		for (size_t n = 1; n < byPath.size(); n++)
+		{
+			if (byPath[n]->path == byPath[n - 1]->path)
+			{
+				printf("warning: %s and %s are both packed as %s, keeping the first\n",
+					byPath[n - 1]->sourcePath.c_str(), byPath[n]->sourcePath.c_str(), byPath[n]->path.c_str());
+				byPath[n]->path.clear();
+			}
+		}
+		inputs.erase(std::remove_if(inputs.begin(), inputs.end(), [](const InputFile &input)
+		{
+			return input.path.empty();
+		}), inputs.end());
+	}
+
+	std::string pathTable;
+	for (InputFile &input : inputs)
+	{
+		input.entry.pathHash = AssetPack::HashPath(input.path);
+		input.entry.pathOffset = (uint32_t)pathTable.size();
+		pathTable.append(input.path.c_str(), input.path.size() + 1);
+	}
+
+	AssetPack::FileHeader header = {};
+	header.magic = AssetPack::kMagic;
+	header.version = AssetPack::kVersion;
+	header.entryCount = (uint32_t)inputs.size();
+	header.pathTableByteSize = (uint32_t)pathTable.size();
+
+	FILE *file = nullptr;
+	if (0 != fopen_s(&file, output_file, "wb"))
+	{
+		printf("failed to open output file: %s\n", output_file);
+		return -1;
+	}
+
+	bool ok = false;
+	uint64_t totalSize = 0;
+	uint64_t totalStoredSize = 0;
+	uint32_t compressedCount = 0;
+	std::vector<AssetPack::Entry> entries;
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> compressed;
+
+	// the index is written last, once every payload's offset is known
+	long long offset = (long long)(sizeof(header) + sizeof(AssetPack::Entry) * inputs.size() + pathTable.size());
+	if (0 != _fseeki64(file, offset, SEEK_SET)) goto pack_fail;
+
+	for (InputFile &input : inputs)
+	{
+		if (!ReadWholeFile(input.sourcePath, data))
+		{
+			printf("failed to read %s\n", input.sourcePath.c_str());
+			goto pack_fail;
+		}
+		if (input.gzipped)
+		{
+			compressed.swap(data);
+			if (!Gunzip(compressed, data))
+			{
+				printf("failed to unzip %s\n", input.sourcePath.c_str());
+				goto pack_fail;
+			}
+		}
+		if (EndsWith(input.path, ".h3d") && (data.size() < 4 || 0 != memcmp(data.data(), "H3D2", 4)))
+			printf("warning: %s is an h3d v1 file, which can't be loaded from a pack. Convert it again.\n", input.sourcePath.c_str());
+
+		const unsigned char *payload = data.data();
+		input.entry.size = data.size();
+		input.entry.storedSize = data.size();
+		input.entry.flags = 0;
+
+		// only worth inflating at load time if it saves an eighth, block compressed textures rarely do
+		if (compress && data.size() > 0 && data.size() <= 0xFFFFFFFFull)
+		{
+			uLongf compressedSize = compressBound((uLong)data.size());
+			compressed.resize(compressedSize);
+			if (Z_OK == compress2(compressed.data(), &compressedSize, data.data(), (uLong)data.size(), Z_BEST_COMPRESSION) &&
+				compressedSize < data.size() - data.size() / 8)
+			{
+				payload = compressed.data();
+				input.entry.storedSize = compressedSize;
+				input.entry.flags |= AssetPack::kEntryCompressed;
+				compressedCount++;
+			}
+		}
+
+		if (!WritePadding(file, offset, (long long)AssetPack::AlignData(offset))) goto pack_fail;
+		input.entry.dataOffset = (uint64_t)offset;
+		if (input.entry.storedSize > 0)
+			if (1 != fwrite(payload, (size_t)input.entry.storedSize, 1, file)) goto pack_fail;
+		offset += (long long)input.entry.storedSize;
+
+		totalSize += input.entry.size;
+		totalStoredSize += input.entry.storedSize;
+		printf("%s %llu -> %llu\n", input.path.c_str(), input.entry.size, input.entry.storedSize);
+	}
+
+	// a payload ending mid-page would still map, but padding the tail keeps every payload whole pages
+	if (!WritePadding(file, offset, (long long)AssetPack::AlignData(offset))) goto pack_fail;
+	header.fileSize = (uint64_t)offset;
+
+	for (const InputFile &input : inputs)
+		entries.push_back(input.entry);
+	std::stable_sort(entries.begin(), entries.end(), [](const AssetPack::Entry &a, const AssetPack::Entry &b)
+	{
+		return a.pathHash < b.pathHash;
+	});
+
+	if (0 != _fseeki64(file, 0, SEEK_SET)) goto pack_fail;
+	if (1 != fwrite(&header, sizeof(header), 1, file)) goto pack_fail;
+	if (!entries.empty())
+		if (1 != fwrite(entries.data(), sizeof(AssetPack::Entry) * entries.size(), 1, file)) goto pack_fail;
+	if (!pathTable.empty())
+		if (1 != fwrite(pathTable.data(), pathTable.size(), 1, file)) goto pack_fail;
+
+	ok = true;
+
+pack_fail:
+
+	if (EOF == fclose(file))
+		ok = false;
+
+	if (!ok)
+	{
+		printf("failed to write asset pack: %s\n", output_file);
+		remove(output_file);
+		return -1;
+	}
+
+	printf("done\n");
+	printf("%u files, %u compressed, %llu bytes stored as %llu, pack size %llu\n",
+		header.entryCount, compressedCount, totalSize, totalStoredSize, header.fileSize);
+
+	return 0;
+}
@@ -0,0 +1,215 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "AssetPack.h"
+#include "AssetPackFormat.h"
+#include <mutex>
+#include <algorithm>
+#include "../3rdParty/zlib-win64/zlib.h"
+
+using namespace std;
+using namespace Utility;
+
+namespace
+{
+	class MountedPack
+	{
+	public:
+		MountedPack() : m_View(nullptr), m_ViewSize(0), m_Entries(nullptr), m_EntryCount(0), m_Paths(nullptr)
+		{
+		}
+
+		~MountedPack()
+		{
+			if (m_View != nullptr)
+				UnmapViewOfFile(m_View);
+		}
+
+		bool Map( const wstring& packFileName )
+		{
+			HANDLE file = CreateFileW(packFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER fileSize = {};
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(AssetPack::FileHeader))
+			{
+				HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping != nullptr)
+				{
+					m_View = (const byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+
+			if (m_View == nullptr)
+				return false;
+
+			m_ViewSize = (uint64_t)fileSize.QuadPart;
+			if (!Validate())
+			{
+				Utility::Printf(L"%s is not a valid asset pack\n", packFileName.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		const AssetPack::Entry* Find( const string& normalizedPath ) const
+		{
+			const uint64_t hash = AssetPack::HashPath(normalizedPath);
+			const AssetPack::Entry* end = m_Entries + m_EntryCount;
+			const AssetPack::Entry* entry = lower_bound(m_Entries, end, hash,
+				[]( const AssetPack::Entry& e, uint64_t h ) { return e.pathHash < h; });
+
+			for (; entry != end && entry->pathHash == hash; ++entry)
+			{
+				if (normalizedPath == m_Paths + entry->pathOffset)
+					return entry;
+			}
+			return nullptr;
+		}
+
+		const byte* GetData( const AssetPack::Entry& entry ) const
+		{
+			return m_View + entry.dataOffset;
+		}
+
+	private:
+		// everything Find and GetData rely on, so a damaged pack is refused when it's mounted
+		bool Validate( void )
+		{
+			AssetPack::FileHeader header;
+			memcpy(&header, m_View, sizeof(header));
+			if (header.magic != AssetPack::kMagic || header.version != AssetPack::kVersion || header.fileSize != m_ViewSize)
+				return false;
+
+			const uint64_t indexSize = sizeof(AssetPack::Entry) * (uint64_t)header.entryCount + header.pathTableByteSize;
+			if (indexSize > m_ViewSize - sizeof(header))
+				return false;
+
+			m_Entries = (const AssetPack::Entry*)(m_View + sizeof(header));
+			m_EntryCount = header.entryCount;
+			m_Paths = (const char*)(m_Entries + m_EntryCount);
+
+			if (header.pathTableByteSize == 0 || m_Paths[header.pathTableByteSize - 1] != 0)
+				return m_EntryCount == 0;
+
+			for (uint32_t i = 0; i < m_EntryCount; ++i)
+			{
+				const AssetPack::Entry& entry = m_Entries[i];
+				if (i > 0 && entry.pathHash < m_Entries[i - 1].pathHash)
+					return false;
+				if (entry.pathOffset >= header.pathTableByteSize)
+					return false;
+				if (entry.dataOffset % AssetPack::kDataAlignment != 0 || entry.dataOffset > m_ViewSize || entry.storedSize > m_ViewSize - entry.dataOffset)
+					return false;
+				if ((entry.flags & AssetPack::kEntryCompressed) == 0 && entry.storedSize != entry.size)
+					return false;
+				if ((entry.flags & AssetPack::kEntryCompressed) != 0 && entry.size > 0xFFFFFFFFull)
+					return false;
+			}
+			return true;
+		}
+
+		const byte* m_View;
+		uint64_t m_ViewSize;
+		const AssetPack::Entry* m_Entries;
+		uint32_t m_EntryCount;
+		const char* m_Paths;
+	};
+
+	mutex s_PackMutex;
+	vector< unique_ptr<MountedPack> > s_Packs; // oldest first
+	bool s_LooseFiles = true;
+}
+
+bool Utility::MountAssetPack( const wstring& packFileName, bool looseFiles )
+{
+	unique_ptr<MountedPack> Pack(new MountedPack);
+	if (!Pack->Map(packFileName))
+		return false;
+
+	lock_guard<mutex> Guard(s_PackMutex);
+	s_Packs.push_back(move(Pack));
+	s_LooseFiles = s_LooseFiles && looseFiles;
+	return true;
+}
+
+void Utility::UnmountAssetPacks( void )
+{
+	lock_guard<mutex> Guard(s_PackMutex);
+	s_Packs.clear();
+	s_LooseFiles = true;
+}
+
+bool Utility::LooseFilesEnabled( void )
+{
+	lock_guard<mutex> Guard(s_PackMutex);
+	return s_LooseFiles;
+}
+
+namespace
+{
+	const AssetPack::Entry* FindEntry( const wstring& fileName, const byte*& data )
+	{
+		lock_guard<mutex> Guard(s_PackMutex);
+		if (s_Packs.empty())
+			return nullptr;
+
+		const string Path = AssetPack::NormalizePath(fileName.c_str());
+		for (auto Pack = s_Packs.rbegin(); Pack != s_Packs.rend(); ++Pack)
+		{
+			const AssetPack::Entry* Entry = (*Pack)->Find(Path);
+			if (Entry != nullptr)
+			{
+				data = (*Pack)->GetData(*Entry);
+				return Entry;
+			}
+		}
+		return nullptr;
+	}
+}
+
+bool Utility::IsFilePacked( const wstring& fileName )
+{
+	const byte* Data;
+	return FindEntry(fileName, Data) != nullptr;
+}
+
+bool Utility::FindPackedFile( const wstring& fileName, PackedFile& file )
+{
+	const byte* Data = nullptr;
+	const AssetPack::Entry* Entry = FindEntry(fileName, Data);
+	if (Entry == nullptr)
+		return false;
+
+	if ((Entry->flags & AssetPack::kEntryCompressed) == 0)
+	{
+		file.Data = Data;
+		file.Size = (size_t)Entry->size;
+		file.Inflated = nullptr;
+		return true;
+	}
+
+	file.Inflated = make_shared<vector<byte> >( (size_t)Entry->size );
+	uLongf InflatedSize = (uLongf)Entry->size;
+	int error = uncompress(file.Inflated->data(), &InflatedSize, Data, (uLong)Entry->storedSize);
+	if (error != Z_OK || InflatedSize != Entry->size)
+	{
+		Utility::Printf(L"Couldn't unpack file %s:  Error = %d\n", fileName.c_str(), error);
+		file.Inflated = nullptr;
+		return false;
+	}
+
+	file.Data = file.Inflated->data();
+	file.Size = file.Inflated->size();
+	return true;
+}
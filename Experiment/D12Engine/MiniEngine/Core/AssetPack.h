@@ -0,0 +1,41 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "FileUtility.h"
+
+namespace Utility
+{
+	// A file found in a mounted pack. Stored files point straight into the pack's mapped view, which stays
+	// valid until the packs are unmounted. Compressed files are inflated into Inflated.
+	struct PackedFile
+	{
+		const byte* Data;
+		size_t Size;
+		ByteArray Inflated;
+	};
+
+	// Maps a pack written by AssetPacker. Packs are searched newest first, ahead of the file system, by
+	// ReadFileSync, ReadFileAsync and Model::Load. With looseFiles false, a file missing from every pack is
+	// treated as missing rather than looked for on disk, so probing for optional files never touches the disk.
+	bool MountAssetPack( const wstring& packFileName, bool looseFiles = true );
+
+	// Nothing may be using PackedFile::Data from a pack once it's unmounted
+	void UnmountAssetPacks( void );
+
+	bool FindPackedFile( const wstring& fileName, PackedFile& file );
+
+	// Only looks the file up, without touching or inflating its data
+	bool IsFilePacked( const wstring& fileName );
+
+	// False when a pack mounted with looseFiles false is in use
+	bool LooseFilesEnabled( void );
+
+} // namespace Utility
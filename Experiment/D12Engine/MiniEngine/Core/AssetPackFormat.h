@@ -0,0 +1,93 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// The on-disk layout of an asset pack, shared by the engine and the AssetPacker tool.
+//
+// A pack is the file header, the index entries sorted by path hash, the path table, and then every file's
+// payload, each starting on a 4KB boundary. Everything the engine needs to find a file is in the first few
+// pages, and the payloads can be used straight from a mapped view of the pack.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+namespace AssetPack
+{
+	const uint32_t kMagic = 'A' | ('P' << 8) | ('A' << 16) | ('K' << 24);
+	const uint32_t kVersion = 1;
+	const uint32_t kDataAlignment = 4096;
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t pathTableByteSize;
+		uint64_t fileSize; // catches truncated packs before anything reads past the end
+	};
+
+	enum
+	{
+		kEntryCompressed = (1 << 0), // the payload is a zlib stream
+	};
+
+	struct Entry
+	{
+		uint64_t pathHash;
+		uint64_t dataOffset; // from the start of the pack, a multiple of kDataAlignment
+		uint64_t storedSize; // the payload's size in the pack
+		uint64_t size; // the file's size once decompressed
+		uint32_t pathOffset; // a null-terminated normalized path in the path table
+		uint32_t flags;
+	};
+
+	static_assert(sizeof(FileHeader) == 24, "asset pack header layout changed");
+	static_assert(sizeof(Entry) == 40, "asset pack entry layout changed");
+
+	// Lower case, forward slashes, no "./" or repeated separators, so the engine finds "Textures\\Foo.dds"
+	// under whatever spelling the packer was given. Paths are ASCII, like everything MakeWStr widens.
+	template <typename CharType>
+	std::string NormalizePath( const CharType* path )
+	{
+		std::string normalized;
+		for (; *path != 0; ++path)
+		{
+			char c = (char)*path;
+			if (c == '\\')
+				c = '/';
+			else if (c >= 'A' && c <= 'Z')
+				c = c - 'A' + 'a';
+
+			if (c == '/' && (normalized.empty() || normalized.back() == '/'))
+				continue;
+			if (c == '/' && normalized == ".")
+			{
+				normalized.clear();
+				continue;
+			}
+			normalized += c;
+		}
+		return normalized;
+	}
+
+	// 64-bit FNV-1a of a normalized path
+	inline uint64_t HashPath( const std::string& normalizedPath )
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : normalizedPath)
+			hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+		return hash;
+	}
+
+	inline uint64_t AlignData( uint64_t offset )
+	{
+		return (offset + kDataAlignment - 1) & ~(uint64_t)(kDataAlignment - 1);
+	}
+}
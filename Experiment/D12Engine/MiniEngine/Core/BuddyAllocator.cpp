@@ -71,7 +71,7 @@ BuddyAllocator::BuddyAllocator(kBuddyAllocationStrategy allocationStrategy, D3D1
 
 	m_maxOrder = UnitSizeToOrder(SizeToUnitSize(maxBlockSize));
 
-	Reset();
+	m_freeBlocks.Create(m_maxOrder);
 }
 
 void BuddyAllocator::Initialize()
@@ -106,106 +106,44 @@ void BuddyAllocator::Destroy()
 	}
 }
 
-size_t BuddyAllocator::AllocateBlock(UINT order)
+BuddyBlock* BuddyAllocator::Allocate(uint32_t numElements, uint32_t elementSize, const void* initialData)
 {
-	size_t offset;
-
-	if (order > m_maxOrder)
-	{
-		throw(std::bad_alloc()); // Can't allocate a block that large  
-	}
-
-	auto it = m_freeBlocks[order].begin();
-
-	if (it == m_freeBlocks[order].end())
-	{
-		// No free nodes in the requested pool.  Try to find a higher-order block and split it.  
-		size_t left = AllocateBlock(order + 1);
-
-		size_t size = OrderToUnitSize(order);
-
-		size_t right = left + size;
-
-		m_freeBlocks[order].insert(right); // Add the right block to the free pool  
-
-		offset = left; // Return the left block  
-	}
+	size_t size = numElements * elementSize;
+	size_t unitSize = SizeToUnitSize(size);
+	UINT order = UnitSizeToOrder(unitSize);
 
-	else
+	size_t offset = m_freeBlocks.Allocate(order);
+	if (offset == BuddyRange::kInvalidOffset)
 	{
-		offset = *it;
-
-		// Remove the block from the free list  
-		m_freeBlocks[order].erase(it);
+		// There are no blocks available for the requested size so  
+		// return the NULL block type  
+		return new BuddyBlock();
 	}
 
-	return offset;
-}
-
-void BuddyAllocator::DeallocateBlock(size_t offset, UINT order)
-{
-	// See if the buddy block is free  
-	size_t size = OrderToUnitSize(order);
+	uint32_t paddedSize = uint32_t(OrderToUnitSize(order) * m_minBlockSize);
 
-	size_t buddy = GetBuddyOffset(offset, size);
+	uint32_t blockOffset = uint32_t(m_baseOffset + (offset * m_minBlockSize));
 
-	auto it = m_freeBlocks[order].find(buddy);
+	INCREASE_BUDDY_COUNTER(m_SpaceUsed, paddedSize);
+	INCREASE_BUDDY_COUNTER(m_InternalFragmentation, (paddedSize - size));
 
-	if (it != m_freeBlocks[order].end())
+	BuddyBlock* pBlock = new BuddyBlock(blockOffset, //offset
+		paddedSize, //total size (padded to fit a block)
+		numElements * elementSize);
+		
+	if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
 	{
-		// Deallocate merged blocks  
-		DeallocateBlock(min(offset, buddy), order + 1);
-		// Remove the buddy from the free list  
-		m_freeBlocks[order].erase(it);
+		pBlock->InitPlaced(m_pBackingHeap, numElements, elementSize, initialData);
 	}
 	else
 	{
-		// Add the block to the free list  
-		m_freeBlocks[order].insert(offset); // throw(std::bad_alloc) 
-	}
-}
-
-BuddyBlock* BuddyAllocator::Allocate(uint32_t numElements, uint32_t elementSize, const void* initialData)
-{
-	size_t size = numElements * elementSize;
-	size_t unitSize = SizeToUnitSize(size);
-	UINT order = UnitSizeToOrder(unitSize);
-
-	try
-	{
-		size_t offset = AllocateBlock(order);
-		uint32_t paddedSize = uint32_t(OrderToUnitSize(order) * m_minBlockSize);
-
-		uint32_t blockOffset = uint32_t(m_baseOffset + (offset * m_minBlockSize));
-
-		INCREASE_BUDDY_COUNTER(m_SpaceUsed, paddedSize);
-		INCREASE_BUDDY_COUNTER(m_InternalFragmentation, (paddedSize - size));
-
-		BuddyBlock* pBlock = new BuddyBlock(blockOffset, //offset
-			paddedSize, //total size (padded to fit a block)
-			numElements * elementSize);
-			
-		if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
-		{
-			pBlock->InitPlaced(m_pBackingHeap, numElements, elementSize, initialData);
-		}
-		else
-		{
-			//TODO: To be truely thread-safe this operation should be atomic to guard against
-			//      the case in which blocks from this allocator are used on multiple threads 
-			//      (because it's really only 1 resource underneath)
-			pBlock->InitFromResource(&m_BackingResource, numElements, elementSize, initialData);
-		}
-
-		return pBlock;
+		//TODO: To be truely thread-safe this operation should be atomic to guard against
+		//      the case in which blocks from this allocator are used on multiple threads 
+		//      (because it's really only 1 resource underneath)
+		pBlock->InitFromResource(&m_BackingResource, numElements, elementSize, initialData);
 	}
 
-	catch (std::bad_alloc&)
-	{
-		// There are no blocks available for the requested size so  
-		// return the NULL block type  
-		return new BuddyBlock();
-	}
+	return pBlock;
 }
 
 /*
@@ -226,28 +164,17 @@ void BuddyAllocator::DeallocateInternal(BuddyBlock* pBlock)
 
 	UINT order = UnitSizeToOrder(size);
 
-	try
-	{
-		DeallocateBlock(offset, order); // throw(std::bad_alloc)
+	m_freeBlocks.Free(offset, order);
 
-		DECREASE_BUDDY_COUNTER(m_SpaceUsed, size);
-		DECREASE_BUDDY_COUNTER(m_InternalFragmentation, (size - pBlock->m_unpaddedSize));
-		
-		if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
-		{
-			// Release the resource
-			pBlock->Destroy();
-		}
-		delete(pBlock);
-	}
+	DECREASE_BUDDY_COUNTER(m_SpaceUsed, pBlock->GetSize());
+	DECREASE_BUDDY_COUNTER(m_InternalFragmentation, (pBlock->GetSize() - pBlock->m_unpaddedSize));
 
-	catch (std::bad_alloc&)
+	if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
 	{
-		// Deallocate failed trying to add the free block to the pool  
-		// resulting in a leak.  Unfortunately there is not much we can do.  
-		// Fortunately this is expected to be extremely rare as the storage  
-		// needed for each deallocate is very small.  
+		// Release the resource
+		pBlock->Destroy();
 	}
+	delete(pBlock);
 };
 
 /*
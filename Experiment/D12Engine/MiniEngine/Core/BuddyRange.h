@@ -0,0 +1,199 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The range bookkeeping behind BuddyAllocator, with no knowledge of heaps or buffers. Offsets and sizes
+// are in units of the smallest block, and a block of order k is 2^k units at a multiple of 2^k.
+//
+// Each order has a bitmap of its free blocks, with summary bitmaps over it (a bit per nonzero word of the
+// level below) up to a single word, and one more word says which orders have any free block at all. Finding
+// a free block is a bit scan per level, so allocating and freeing take a few bit scans per order they split
+// or merge through, and never allocate memory. All storage is allocated by Create.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+class BuddyRange
+{
+public:
+	static const size_t kInvalidOffset = ~(size_t)0;
+	static const uint32_t kMaxOrder = 35; // fits the summary levels below
+
+	BuddyRange() : m_MaxOrder(0), m_NonEmptyOrders(0) {}
+
+	// Sizes the bitmaps for a range of 2^maxOrder units, all of it free
+	void Create( uint32_t maxOrder )
+	{
+		assert(maxOrder <= kMaxOrder);
+		m_MaxOrder = maxOrder;
+
+		size_t WordCount = 0;
+		for (uint32_t Order = 0; Order <= m_MaxOrder; ++Order)
+		{
+			OrderBits& Bits = m_Orders[Order];
+			size_t BitCount = (size_t)1 << (m_MaxOrder - Order);
+			Bits.LevelCount = 0;
+			do
+			{
+				size_t Words = (BitCount + 63) / 64;
+				Bits.LevelStart[Bits.LevelCount++] = WordCount;
+				WordCount += Words;
+				BitCount = Words;
+			} while (BitCount > 1);
+		}
+		m_Words.assign(WordCount, 0);
+		Reset();
+	}
+
+	// Frees the whole range as one block of the largest order
+	void Reset( void )
+	{
+		std::fill(m_Words.begin(), m_Words.end(), 0ull);
+		m_NonEmptyOrders = 0;
+		if (!m_Words.empty())
+			Set(m_MaxOrder, 0);
+	}
+
+	uint32_t GetMaxOrder( void ) const { return m_MaxOrder; }
+
+	// The smallest order that holds unitSize units
+	static uint32_t UnitSizeToOrder( size_t unitSize )
+	{
+		return unitSize <= 1 ? 0 : 1 + HighBit(unitSize - 1);
+	}
+
+	// Returns the unit offset of a free block of the given order, or kInvalidOffset. Like a free list kept
+	// sorted by offset, it splits the smallest free block that's big enough and takes the lowest offset.
+	size_t Allocate( uint32_t order )
+	{
+		if (order > m_MaxOrder || (m_NonEmptyOrders >> order) == 0)
+			return kInvalidOffset;
+
+		uint32_t Order = order + LowBit(m_NonEmptyOrders >> order);
+		size_t Offset = FindFirst(Order) << Order;
+		Clear(Order, Offset >> Order);
+
+		// Keep the left half of each split and free the right
+		while (Order > order)
+		{
+			--Order;
+			Set(Order, (Offset >> Order) + 1);
+		}
+		return Offset;
+	}
+
+	// Frees a block from Allocate, merging it with its buddy for as long as the buddy is free too
+	void Free( size_t offset, uint32_t order )
+	{
+		while (order < m_MaxOrder)
+		{
+			size_t Buddy = (offset >> order) ^ 1;
+			if (!Test(order, Buddy))
+				break;
+			Clear(order, Buddy);
+			offset &= ~((size_t)1 << order);
+			++order;
+		}
+		Set(order, offset >> order);
+	}
+
+	bool IsFree( size_t offset, uint32_t order ) const
+	{
+		return Test(order, offset >> order);
+	}
+
+private:
+	static const uint32_t kMaxLevels = 6;
+
+	struct OrderBits
+	{
+		uint32_t LevelCount;
+		size_t LevelStart[kMaxLevels]; // the first word of each level, from the full bitmap up to its single summary word
+	};
+
+	static uint32_t LowBit( uint64_t bits )
+	{
+#if defined(_MSC_VER)
+		unsigned long Index;
+		_BitScanForward64(&Index, bits);
+		return Index;
+#else
+		return (uint32_t)__builtin_ctzll(bits);
+#endif
+	}
+
+	static uint32_t HighBit( uint64_t bits )
+	{
+#if defined(_MSC_VER)
+		unsigned long Index;
+		_BitScanReverse64(&Index, bits);
+		return Index;
+#else
+		return 63 - (uint32_t)__builtin_clzll(bits);
+#endif
+	}
+
+	bool Test( uint32_t order, size_t index ) const
+	{
+		return (m_Words[m_Orders[order].LevelStart[0] + index / 64] >> (index % 64) & 1) != 0;
+	}
+
+	// Setting a bit in an empty word sets that word's bit in the level above
+	void Set( uint32_t order, size_t index )
+	{
+		const OrderBits& Bits = m_Orders[order];
+		for (uint32_t Level = 0; Level < Bits.LevelCount; ++Level)
+		{
+			uint64_t& Word = m_Words[Bits.LevelStart[Level] + index / 64];
+			bool WasEmpty = Word == 0;
+			Word |= 1ull << (index % 64);
+			if (!WasEmpty)
+				return;
+			index /= 64;
+		}
+		m_NonEmptyOrders |= 1ull << order;
+	}
+
+	// Clearing the last bit of a word clears that word's bit in the level above
+	void Clear( uint32_t order, size_t index )
+	{
+		const OrderBits& Bits = m_Orders[order];
+		for (uint32_t Level = 0; Level < Bits.LevelCount; ++Level)
+		{
+			uint64_t& Word = m_Words[Bits.LevelStart[Level] + index / 64];
+			Word &= ~(1ull << (index % 64));
+			if (Word != 0)
+				return;
+			index /= 64;
+		}
+		m_NonEmptyOrders &= ~(1ull << order);
+	}
+
+	// The lowest free block of an order that has one, found by walking down from the summary word
+	size_t FindFirst( uint32_t order ) const
+	{
+		const OrderBits& Bits = m_Orders[order];
+		size_t Index = 0;
+		for (uint32_t Level = Bits.LevelCount; Level-- > 0; )
+			Index = Index * 64 + LowBit(m_Words[Bits.LevelStart[Level] + Index]);
+		return Index;
+	}
+
+	uint32_t m_MaxOrder;
+	uint64_t m_NonEmptyOrders;
+	OrderBits m_Orders[kMaxOrder + 1];
+	std::vector<uint64_t> m_Words;
+};
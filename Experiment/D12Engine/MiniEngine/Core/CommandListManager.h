@@ -18,6 +18,7 @@
 #include <mutex>
 #include <stdint.h>
 #include "CommandAllocatorPool.h"
+#include "FencedRecycler.h"
 
 class CommandQueue
 {
@@ -69,7 +70,7 @@ private:
 
 };
 
-class CommandListManager
+class CommandListManager : public FenceQuery
 {
 	friend class CommandContext;
 
@@ -105,7 +106,7 @@ public:
 		ID3D12CommandAllocator** Allocator);
 
 	// Test to see if a fence has already been reached
-	bool IsFenceComplete(uint64_t FenceValue)
+	bool IsFenceComplete(uint64_t FenceValue) override
 	{
 		return GetQueue(D3D12_COMMAND_LIST_TYPE(FenceValue >> 56)).IsFenceComplete(FenceValue);
 	}
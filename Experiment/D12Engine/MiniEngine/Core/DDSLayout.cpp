@@ -0,0 +1,794 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Doesn't use the precompiled header, which would pull in Windows and D3D12
+
+#include "DDSLayout.h"
+#include "dds.h"
+#include <string.h>
+#include <algorithm>
+
+using namespace DirectX;
+using namespace DDS;
+
+namespace
+{
+	// D3D12_REQ_* limits, which aren't worth including d3d12.h for. For security we don't trust DDS file
+	// metadata that's larger than what the hardware has to support.
+	const uint32_t kMaxMipLevels = 15;
+	const uint32_t kMaxTexture1DSize = 16384;
+	const uint32_t kMaxTexture2DSize = 16384;
+	const uint32_t kMaxTextureCubeSize = 16384;
+	const uint32_t kMaxTexture3DSize = 2048;
+	const uint32_t kMaxArraySize = 2048;
+
+	enum SurfaceKind
+	{
+		kLinear,
+		kBlockCompressed,
+		kPacked,
+		kPlanar,
+		kNV11,
+	};
+
+	// What GetSurfaceInfo needs to know about a format, worked out once per texture rather than per mip
+	struct SurfaceFormat
+	{
+		SurfaceKind Kind;
+		size_t Bpe; // bytes per block or element, and bits per pixel for kLinear
+	};
+
+	SurfaceFormat GetSurfaceFormat( DXGI_FORMAT fmt )
+	{
+		switch (fmt)
+		{
+		case DXGI_FORMAT_BC1_TYPELESS:
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_TYPELESS:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			return { kBlockCompressed, 8 };
+
+		case DXGI_FORMAT_BC2_TYPELESS:
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_TYPELESS:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_TYPELESS:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC6H_TYPELESS:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC6H_SF16:
+		case DXGI_FORMAT_BC7_TYPELESS:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return { kBlockCompressed, 16 };
+
+		case DXGI_FORMAT_R8G8_B8G8_UNORM:
+		case DXGI_FORMAT_G8R8_G8B8_UNORM:
+		case DXGI_FORMAT_YUY2:
+			return { kPacked, 4 };
+
+		case DXGI_FORMAT_Y210:
+		case DXGI_FORMAT_Y216:
+			return { kPacked, 8 };
+
+		case DXGI_FORMAT_NV12:
+		case DXGI_FORMAT_420_OPAQUE:
+			return { kPlanar, 2 };
+
+		case DXGI_FORMAT_P010:
+		case DXGI_FORMAT_P016:
+			return { kPlanar, 4 };
+
+		case DXGI_FORMAT_NV11:
+			return { kNV11, 0 };
+
+		default:
+			return { kLinear, DDS::BitsPerPixel(fmt) };
+		}
+	}
+
+	void GetSurfaceInfo( size_t width, size_t height, const SurfaceFormat& format, size_t& numBytes, size_t& rowBytes, size_t& numRows )
+	{
+		switch (format.Kind)
+		{
+		case kBlockCompressed:
+		{
+			size_t numBlocksWide = width > 0 ? std::max<size_t>(1, (width + 3) / 4) : 0;
+			size_t numBlocksHigh = height > 0 ? std::max<size_t>(1, (height + 3) / 4) : 0;
+			rowBytes = numBlocksWide * format.Bpe;
+			numRows = numBlocksHigh;
+			numBytes = rowBytes * numBlocksHigh;
+			break;
+		}
+
+		case kPacked:
+			rowBytes = ((width + 1) >> 1) * format.Bpe;
+			numRows = height;
+			numBytes = rowBytes * height;
+			break;
+
+		case kNV11:
+			rowBytes = ((width + 3) >> 2) * 4;
+			numRows = height * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+			numBytes = rowBytes * numRows;
+			break;
+
+		case kPlanar:
+			rowBytes = ((width + 1) >> 1) * format.Bpe;
+			numBytes = (rowBytes * height) + ((rowBytes * height + 1) >> 1);
+			numRows = height + ((height + 1) >> 1);
+			break;
+
+		default:
+			rowBytes = (width * format.Bpe + 7) / 8; // round up to nearest byte
+			numRows = height;
+			numBytes = rowBytes * height;
+			break;
+		}
+	}
+
+	DDS_ALPHA_MODE GetAlphaMode( const DDS_HEADER* header, const DDS_HEADER_DXT10* d3d10ext )
+	{
+		if (d3d10ext != nullptr)
+		{
+			auto mode = static_cast<DDS_ALPHA_MODE>(d3d10ext->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK);
+			switch (mode)
+			{
+			case DDS_ALPHA_MODE_STRAIGHT:
+			case DDS_ALPHA_MODE_PREMULTIPLIED:
+			case DDS_ALPHA_MODE_OPAQUE:
+			case DDS_ALPHA_MODE_CUSTOM:
+				return mode;
+			default:
+				return DDS_ALPHA_MODE_UNKNOWN;
+			}
+		}
+
+		if ((header->ddspf.flags & DDS_FOURCC) &&
+			(MAKEFOURCC('D', 'X', 'T', '2') == header->ddspf.fourCC || MAKEFOURCC('D', 'X', 'T', '4') == header->ddspf.fourCC))
+		{
+			return DDS_ALPHA_MODE_PREMULTIPLIED;
+		}
+
+		return DDS_ALPHA_MODE_UNKNOWN;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Return the BPP for a particular format
+//--------------------------------------------------------------------------------------
+size_t DDS::BitsPerPixel( DXGI_FORMAT fmt )
+{
+	switch( fmt )
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+	case DXGI_FORMAT_Y416:
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		return 64;
+
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+	case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_AYUV:
+	case DXGI_FORMAT_Y410:
+	case DXGI_FORMAT_YUY2:
+		return 32;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+		return 24;
+
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_A8P8:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return 16;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+	case DXGI_FORMAT_NV11:
+		return 12;
+
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_AI44:
+	case DXGI_FORMAT_IA44:
+	case DXGI_FORMAT_P8:
+		return 8;
+
+	case DXGI_FORMAT_R1_UNORM:
+		return 1;
+
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+void DDS::GetSurfaceInfo( size_t width, size_t height, DXGI_FORMAT fmt, size_t* outNumBytes, size_t* outRowBytes, size_t* outNumRows )
+{
+	size_t numBytes, rowBytes, numRows;
+	::GetSurfaceInfo(width, height, GetSurfaceFormat(fmt), numBytes, rowBytes, numRows);
+
+	if (outNumBytes)
+		*outNumBytes = numBytes;
+	if (outRowBytes)
+		*outRowBytes = rowBytes;
+	if (outNumRows)
+		*outNumRows = numRows;
+}
+
+
+//--------------------------------------------------------------------------------------
+#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
+
+static DXGI_FORMAT GetDXGIFormat( const DDS_PIXELFORMAT& ddpf )
+{
+	if (ddpf.flags & DDS_RGB)
+	{
+		// Note that sRGB formats are written using the "DX10" extended header
+
+		switch (ddpf.RGBBitCount)
+		{
+		case 32:
+			if (ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0xff000000))
+			{
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0xff000000))
+			{
+				return DXGI_FORMAT_B8G8R8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0x00000000))
+			{
+				return DXGI_FORMAT_B8G8R8X8_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
+
+			// Note that many common DDS reader/writers (including D3DX) swap the
+			// the RED/BLUE masks for 10:10:10:2 formats. We assumme
+			// below that the 'backwards' header mask is being used since it is most
+			// likely written by D3DX. The more robust solution is to use the 'DX10'
+			// header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
+
+			// For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
+			if (ISBITMASK(0x3ff00000,0x000ffc00,0x000003ff,0xc0000000))
+			{
+				return DXGI_FORMAT_R10G10B10A2_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
+
+			if (ISBITMASK(0x0000ffff,0xffff0000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R16G16_UNORM;
+			}
+
+			if (ISBITMASK(0xffffffff,0x00000000,0x00000000,0x00000000))
+			{
+				// Only 32-bit color channel format in D3D9 was R32F
+				return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+			}
+			break;
+
+		case 24:
+			// No 24bpp DXGI formats aka D3DFMT_R8G8B8
+			break;
+
+		case 16:
+			if (ISBITMASK(0x7c00,0x03e0,0x001f,0x8000))
+			{
+				return DXGI_FORMAT_B5G5R5A1_UNORM;
+			}
+			if (ISBITMASK(0xf800,0x07e0,0x001f,0x0000))
+			{
+				return DXGI_FORMAT_B5G6R5_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
+
+			if (ISBITMASK(0x0f00,0x00f0,0x000f,0xf000))
+			{
+				return DXGI_FORMAT_B4G4R4A4_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
+
+			// No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+			break;
+		}
+	}
+	else if (ddpf.flags & DDS_LUMINANCE)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+		}
+
+		if (16 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x0000ffff,0x00000000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+			if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x0000ff00))
+			{
+				return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+		}
+	}
+	else if (ddpf.flags & DDS_ALPHA)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			return DXGI_FORMAT_A8_UNORM;
+		}
+	}
+	else if (ddpf.flags & DDS_FOURCC)
+	{
+		if (MAKEFOURCC( 'D', 'X', 'T', '1' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC1_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '3' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '5' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		// While pre-mulitplied alpha isn't directly supported by the DXGI formats,
+		// they are basically the same as these BC formats so they can be mapped
+		if (MAKEFOURCC( 'D', 'X', 'T', '2' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '4' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		if (MAKEFOURCC( 'A', 'T', 'I', '1' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '4', 'U' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '4', 'S' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_SNORM;
+		}
+
+		if (MAKEFOURCC( 'A', 'T', 'I', '2' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '5', 'U' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '5', 'S' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_SNORM;
+		}
+
+		// BC6H and BC7 are written using the "DX10" extended header
+
+		if (MAKEFOURCC( 'R', 'G', 'B', 'G' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_R8G8_B8G8_UNORM;
+		}
+		if (MAKEFOURCC( 'G', 'R', 'G', 'B' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_G8R8_G8B8_UNORM;
+		}
+
+		if (MAKEFOURCC('Y','U','Y','2') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_YUY2;
+		}
+
+		// Check for D3DFORMAT enums being set here
+		switch( ddpf.fourCC )
+		{
+		case 36: // D3DFMT_A16B16G16R16
+			return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+		case 110: // D3DFMT_Q16W16V16U16
+			return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+		case 111: // D3DFMT_R16F
+			return DXGI_FORMAT_R16_FLOAT;
+
+		case 112: // D3DFMT_G16R16F
+			return DXGI_FORMAT_R16G16_FLOAT;
+
+		case 113: // D3DFMT_A16B16G16R16F
+			return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+		case 114: // D3DFMT_R32F
+			return DXGI_FORMAT_R32_FLOAT;
+
+		case 115: // D3DFMT_G32R32F
+			return DXGI_FORMAT_R32G32_FLOAT;
+
+		case 116: // D3DFMT_A32B32G32R32F
+			return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		}
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+
+//--------------------------------------------------------------------------------------
+DXGI_FORMAT DDS::MakeSRGB( DXGI_FORMAT format )
+{
+	switch( format )
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+		return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC1_UNORM:
+		return DXGI_FORMAT_BC1_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC2_UNORM:
+		return DXGI_FORMAT_BC2_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC3_UNORM:
+		return DXGI_FORMAT_BC3_UNORM_SRGB;
+
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+		return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+		return DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC7_UNORM:
+		return DXGI_FORMAT_BC7_UNORM_SRGB;
+
+	default:
+		return format;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+DDS::Result DDS::ParseDDS( const void* data, size_t size, TextureLayout& layout )
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	if (bytes == nullptr || size < sizeof(uint32_t) + sizeof(DDS_HEADER))
+		return Result::NotDDS;
+
+	// DDS files always start with the same magic number ("DDS ")
+	uint32_t magic;
+	memcpy(&magic, bytes, sizeof(magic));
+	auto header = reinterpret_cast<const DDS_HEADER*>(bytes + sizeof(uint32_t));
+	if (magic != DDS_MAGIC || header->size != sizeof(DDS_HEADER) || header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+		return Result::NotDDS;
+
+	size_t dataOffset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+	const DDS_HEADER_DXT10* d3d10ext = nullptr;
+	if ((header->ddspf.flags & DDS_FOURCC) && MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC)
+	{
+		if (size < dataOffset + sizeof(DDS_HEADER_DXT10))
+			return Result::NotDDS;
+		d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>(bytes + dataOffset);
+		dataOffset += sizeof(DDS_HEADER_DXT10);
+	}
+
+	uint32_t width = header->width;
+	uint32_t height = header->height;
+	uint32_t depth = header->depth;
+	uint32_t mipCount = header->mipMapCount == 0 ? 1 : header->mipMapCount;
+	uint32_t arraySize = 1;
+	bool isCubeMap = false;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	Dimension resDim;
+
+	if (d3d10ext != nullptr)
+	{
+		arraySize = d3d10ext->arraySize;
+		if (arraySize == 0)
+			return Result::InvalidData;
+
+		switch (d3d10ext->dxgiFormat)
+		{
+		case DXGI_FORMAT_AI44:
+		case DXGI_FORMAT_IA44:
+		case DXGI_FORMAT_P8:
+		case DXGI_FORMAT_A8P8:
+			return Result::NotSupported;
+
+		default:
+			if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
+				return Result::NotSupported;
+		}
+
+		format = d3d10ext->dxgiFormat;
+		resDim = static_cast<Dimension>(d3d10ext->resourceDimension);
+
+		switch (resDim)
+		{
+		case Dimension::Texture1D:
+			// D3DX writes 1D textures with a fixed Height of 1
+			if ((header->flags & DDS_HEIGHT) && height != 1)
+				return Result::InvalidData;
+			height = depth = 1;
+			break;
+
+		case Dimension::Texture2D:
+			if (d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+			{
+				// Checked here so the count of faces can't wrap around
+				if (arraySize > kMaxArraySize / 6)
+					return Result::NotSupported;
+				arraySize *= 6;
+				isCubeMap = true;
+			}
+			depth = 1;
+			break;
+
+		case Dimension::Texture3D:
+			if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
+				return Result::InvalidData;
+			if (arraySize > 1)
+				return Result::NotSupported;
+			break;
+
+		default:
+			return Result::NotSupported;
+		}
+	}
+	else
+	{
+		format = GetDXGIFormat(header->ddspf);
+		if (format == DXGI_FORMAT_UNKNOWN)
+			return Result::NotSupported;
+
+		if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+		{
+			resDim = Dimension::Texture3D;
+		}
+		else
+		{
+			if (header->caps2 & DDS_CUBEMAP)
+			{
+				// We require all six faces to be defined
+				if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+					return Result::NotSupported;
+
+				arraySize = 6;
+				isCubeMap = true;
+			}
+
+			depth = 1;
+			resDim = Dimension::Texture2D;
+
+			// Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
+		}
+	}
+
+	if (mipCount > kMaxMipLevels)
+		return Result::NotSupported;
+
+	switch (resDim)
+	{
+	case Dimension::Texture1D:
+		if (arraySize > kMaxArraySize || width > kMaxTexture1DSize)
+			return Result::NotSupported;
+		break;
+
+	case Dimension::Texture2D:
+		if (arraySize > kMaxArraySize || width > (isCubeMap ? kMaxTextureCubeSize : kMaxTexture2DSize) ||
+			height > (isCubeMap ? kMaxTextureCubeSize : kMaxTexture2DSize))
+			return Result::NotSupported;
+		break;
+
+	default:
+		if (arraySize > 1 || width > kMaxTexture3DSize || height > kMaxTexture3DSize || depth > kMaxTexture3DSize)
+			return Result::NotSupported;
+		break;
+	}
+
+	layout.ResourceDimension = resDim;
+	layout.Format = format;
+	layout.Width = width;
+	layout.Height = height;
+	layout.Depth = depth;
+	layout.MipCount = mipCount;
+	layout.ArraySize = arraySize;
+	layout.IsCubeMap = isCubeMap;
+	layout.AlphaMode = GetAlphaMode(header, d3d10ext);
+	layout.DataOffset = dataOffset;
+
+	layout.Subresources.resize((size_t)mipCount * arraySize);
+	Subresource* table = layout.Subresources.data();
+
+	// Every array slice has the same mip chain, so it's only worked out for the first
+	const SurfaceFormat surfaceFormat = GetSurfaceFormat(format);
+	uint64_t sliceSize = 0;
+	uint32_t w = width;
+	uint32_t h = height;
+	uint32_t d = depth;
+	for (uint32_t i = 0; i < mipCount; ++i)
+	{
+		size_t numBytes, rowBytes, numRows;
+		::GetSurfaceInfo(w, h, surfaceFormat, numBytes, rowBytes, numRows);
+
+		Subresource& mip = table[i];
+		mip.Offset = dataOffset + sliceSize;
+		mip.SlicePitch = numBytes;
+		mip.RowPitch = static_cast<uint32_t>(rowBytes);
+		mip.NumRows = static_cast<uint32_t>(numRows);
+		mip.Width = w;
+		mip.Height = h;
+		mip.Depth = d;
+
+		sliceSize += (uint64_t)numBytes * d;
+		w = std::max<uint32_t>(w >> 1, 1);
+		h = std::max<uint32_t>(h >> 1, 1);
+		d = std::max<uint32_t>(d >> 1, 1);
+	}
+
+	// The limits above keep this well inside 64 bits
+	layout.DataSize = sliceSize * arraySize;
+	if (layout.DataSize > size - dataOffset)
+		return Result::Truncated;
+
+	for (uint32_t j = 1; j < arraySize; ++j)
+	{
+		Subresource* slice = table + (size_t)j * mipCount;
+		const uint64_t sliceOffset = sliceSize * j;
+		for (uint32_t i = 0; i < mipCount; ++i)
+		{
+			slice[i] = table[i];
+			slice[i].Offset += sliceOffset;
+		}
+	}
+
+	return Result::Ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t DDS::GetSkippedMips( const TextureLayout& layout, size_t maxSize )
+{
+	if (layout.MipCount <= 1 || maxSize == 0)
+		return 0;
+
+	// Mips only get smaller, so the ones to skip are all at the start of the chain
+	uint32_t skipped = 0;
+	for (; skipped < layout.MipCount; ++skipped)
+	{
+		const Subresource& mip = layout.Subresources[skipped];
+		if (mip.Width <= maxSize && mip.Height <= maxSize && mip.Depth <= maxSize)
+			break;
+	}
+	return skipped;
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Parses DDS headers and plans where every subresource of the texture is in the file. Nothing here needs a
+// device or Windows, and the pixel data is never read or copied, so a layout can be planned straight from a
+// mapped view of the file. DDSTextureLoader creates the D3D12 resource from the layout.
+
+#pragma once
+
+#include <dxgiformat.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+enum DDS_ALPHA_MODE
+{
+	DDS_ALPHA_MODE_UNKNOWN       = 0,
+	DDS_ALPHA_MODE_STRAIGHT      = 1,
+	DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+	DDS_ALPHA_MODE_OPAQUE        = 3,
+	DDS_ALPHA_MODE_CUSTOM        = 4,
+};
+
+namespace DDS
+{
+	enum class Result
+	{
+		Ok,
+		NotDDS,        // no magic number, a bad header size, or too short to hold the headers
+		InvalidData,   // the headers contradict themselves
+		NotSupported,  // a format, dimension or size D3D12 can't create
+		Truncated,     // the file ends before the last subresource does
+	};
+
+	// Same values as D3D12_RESOURCE_DIMENSION
+	enum class Dimension : uint32_t
+	{
+		Texture1D = 2,
+		Texture2D = 3,
+		Texture3D = 4,
+	};
+
+	struct Subresource
+	{
+		uint64_t Offset; // of the first texel block, from the start of the file
+		uint64_t SlicePitch;
+		uint32_t RowPitch;
+		uint32_t NumRows;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;
+	};
+
+	struct TextureLayout
+	{
+		Dimension ResourceDimension;
+		DXGI_FORMAT Format;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;
+		uint32_t MipCount;
+		uint32_t ArraySize; // six per cube for cube maps
+		bool IsCubeMap;
+		DDS_ALPHA_MODE AlphaMode;
+		uint64_t DataOffset; // where the pixel data starts, after the headers
+		uint64_t DataSize; // what the subresources cover, which can be less than the rest of the file
+
+		// Every mip of array slice 0, then every mip of slice 1, and so on, which is D3D12's subresource order
+		std::vector<Subresource> Subresources;
+	};
+
+	// Parses the DDS file in [data, data + size) and fills in layout. A layout reused across calls keeps
+	// its table's storage, so parsing many files doesn't allocate once the table has grown.
+	Result ParseDDS( const void* data, size_t size, TextureLayout& layout );
+
+	// How many of the largest mips to leave out so that no dimension is over maxSize, where 0 is no limit.
+	// MipCount when even the smallest mip is too big.
+	uint32_t GetSkippedMips( const TextureLayout& layout, size_t maxSize );
+
+	size_t BitsPerPixel( DXGI_FORMAT fmt );
+
+	void GetSurfaceInfo( size_t width, size_t height, DXGI_FORMAT fmt, size_t* outNumBytes, size_t* outRowBytes, size_t* outNumRows );
+
+	DXGI_FORMAT MakeSRGB( DXGI_FORMAT format );
+}
@@ -26,25 +26,15 @@ using namespace Graphics;
 
 std::mutex DynamicDescriptorHeap::sm_Mutex;
 std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> DynamicDescriptorHeap::sm_DescriptorHeapPool;
-std::queue<std::pair<uint64_t, ID3D12DescriptorHeap*>> DynamicDescriptorHeap::sm_RetiredDescriptorHeaps;
-std::queue<ID3D12DescriptorHeap*> DynamicDescriptorHeap::sm_AvailableDescriptorHeaps;
+FencedRecycler<ID3D12DescriptorHeap> DynamicDescriptorHeap::sm_HeapRecycler(g_CommandManager);
 uint32_t DynamicDescriptorHeap::sm_DescriptorSize = 0;
 
 ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(void)
 {
-	std::lock_guard<std::mutex> LockGuard(sm_Mutex);
-
-	while (!sm_RetiredDescriptorHeaps.empty() && g_CommandManager.IsFenceComplete(sm_RetiredDescriptorHeaps.front().first))
-	{
-		sm_AvailableDescriptorHeaps.push(sm_RetiredDescriptorHeaps.front().second);
-		sm_RetiredDescriptorHeaps.pop();
-	}
-
-	if (!sm_AvailableDescriptorHeaps.empty())
+	ID3D12DescriptorHeap* RecycledHeap = sm_HeapRecycler.Request();
+	if (RecycledHeap != nullptr)
 	{
-		ID3D12DescriptorHeap* HeapPtr = sm_AvailableDescriptorHeaps.front();
-		sm_AvailableDescriptorHeaps.pop();
-		return HeapPtr;
+		return RecycledHeap;
 	}
 	else
 	{
@@ -55,6 +45,8 @@ ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(void)
 		HeapDesc.NodeMask = 1;
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> HeapPtr;
 		ASSERT_SUCCEEDED(g_Device->CreateDescriptorHeap(&HeapDesc, MY_IID_PPV_ARGS(&HeapPtr)));
+
+		std::lock_guard<std::mutex> LockGuard(sm_Mutex);
 		sm_DescriptorHeapPool.emplace_back(HeapPtr);
 		return HeapPtr.Get();
 	}
@@ -62,9 +54,10 @@ ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(void)
 
 void DynamicDescriptorHeap::DiscardDescriptorHeaps( uint64_t FenceValue, const std::vector<ID3D12DescriptorHeap*>& UsedHeaps )
 {
-	std::lock_guard<std::mutex> LockGuard(sm_Mutex);
 	for (auto iter = UsedHeaps.begin(); iter != UsedHeaps.end(); ++iter)
-		sm_RetiredDescriptorHeaps.push(std::make_pair(FenceValue, *iter));
+	{
+		sm_HeapRecycler.Retire(FenceValue, *iter);
+	}
 }
 
 void DynamicDescriptorHeap::RetireCurrentHeap( void )
@@ -16,7 +16,7 @@
 #include "DescriptorHeap.h"
 #include "RootSignature.h"
 #include <vector>
-#include <queue>
+#include "FencedRecycler.h"
 
 namespace Graphics
 {
@@ -32,7 +32,11 @@ public:
 	DynamicDescriptorHeap(CommandContext& OwningContext);
 	~DynamicDescriptorHeap();
 
-	static void DestroyAll(void) { sm_DescriptorHeapPool.clear(); }
+	static void DestroyAll(void)
+	{
+		sm_HeapRecycler.ReleaseAll();
+		sm_DescriptorHeapPool.clear();
+	}
 
 	void CleanupUsedHeaps( uint64_t fenceValue );
 
@@ -85,10 +89,9 @@ private:
 
 	// Static members
 	static const uint32_t kNumDescriptorsPerHeap = 1024;
-	static std::mutex sm_Mutex;
+	static std::mutex sm_Mutex; // guards sm_DescriptorHeapPool
 	static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool;
-	static std::queue<std::pair<uint64_t, ID3D12DescriptorHeap*>> sm_RetiredDescriptorHeaps;
-	static std::queue<ID3D12DescriptorHeap*> sm_AvailableDescriptorHeaps;
+	static FencedRecycler<ID3D12DescriptorHeap> sm_HeapRecycler;
 	static uint32_t sm_DescriptorSize;
 
 	// Static methods
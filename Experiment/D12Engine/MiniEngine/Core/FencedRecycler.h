@@ -0,0 +1,223 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Recycles pooled objects, like allocator pages and descriptor heaps, once the GPU is done
+// with them, without taking a lock.  Retired objects go into a bounded multi-producer multi-consumer ring
+// in the order they were retired, and a request takes the oldest one if its fence has completed.  Each
+// thread also keeps a few already-completed objects to itself, so back-to-back requests from one thread
+// don't touch the shared ring at all.  If the ring fills up, say because a thread was preempted halfway through
+// retiring and holds up everything behind it, further objects wait in a locked overflow queue instead of being lost.
+//
+// The recycler only asks a FenceQuery about fences, so it doesn't depend on D3D12 and can be driven by a
+// fake fence.  Creating objects and owning them stays with the caller, for when a request comes back empty.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <queue>
+
+class FenceQuery
+{
+public:
+	virtual bool IsFenceComplete( uint64_t FenceValue ) = 0;
+
+protected:
+	~FenceQuery() {}
+};
+
+template <typename T>
+class FencedRecycler
+{
+public:
+	// More objects than this in flight at once spill into the overflow queue, see Retire()
+	static const uint32_t kCapacity = 4096;
+	static const uint32_t kThreadCacheSize = 4;
+	static const uint32_t kMaxRecyclersPerType = 4;
+
+	explicit FencedRecycler( FenceQuery& Fences ) : m_Fences(Fences), m_Index(sm_Count++), m_Generation(1), m_OverflowCount(0)
+	{
+		ReleaseAll();
+	}
+
+	// Returns an object whose fence has completed, or nullptr when there isn't one yet
+	T* Request( void )
+	{
+		ThreadCache* Cache = GetThreadCache();
+		if (Cache == nullptr)
+			return Pop();
+
+		if (Cache->Count > 0)
+			return Cache->Items[--Cache->Count];
+
+		T* Item = Pop();
+		if (Item == nullptr)
+			return nullptr;
+
+		// Take what else has completed while we're here, so the next few requests stay on this thread
+		while (Cache->Count < kThreadCacheSize)
+		{
+			T* Extra = Pop();
+			if (Extra == nullptr)
+				break;
+			Cache->Items[Cache->Count++] = Extra;
+		}
+		return Item;
+	}
+
+	// Makes an object available once FenceValue completes
+	void Retire( uint64_t FenceValue, T* Item )
+	{
+		uint64_t Pos = m_Tail.load(std::memory_order_relaxed);
+		Slot* S;
+		for (;;)
+		{
+			S = &m_Slots[Pos % kCapacity];
+			int64_t Diff = (int64_t)(S->Sequence.load(std::memory_order_acquire) - Pos);
+			if (Diff == 0)
+			{
+				if (m_Tail.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (Diff < 0)
+			{
+				std::lock_guard<std::mutex> LockGuard(m_OverflowMutex);
+				m_Overflow.push(std::make_pair(FenceValue, Item));
+				m_OverflowCount.fetch_add(1, std::memory_order_release);
+				return;
+			}
+			else
+				Pos = m_Tail.load(std::memory_order_relaxed);
+		}
+
+		S->FenceValue.store(FenceValue, std::memory_order_relaxed);
+		S->Item.store(Item, std::memory_order_relaxed);
+		S->Sequence.store(Pos + 1, std::memory_order_release);
+	}
+
+	// Forgets every retired and cached object.  Only for when no other thread is using the recycler, like
+	// when the objects are about to be destroyed.
+	void ReleaseAll( void )
+	{
+		for (uint32_t i = 0; i < kCapacity; ++i)
+			m_Slots[i].Sequence.store(i, std::memory_order_relaxed);
+		m_Head.store(0, std::memory_order_relaxed);
+		m_Tail.store(0, std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> LockGuard(m_OverflowMutex);
+			m_Overflow = std::queue<std::pair<uint64_t, T*>>();
+			m_OverflowCount.store(0, std::memory_order_relaxed);
+		}
+
+		// Per-thread caches notice the new generation and drop what they hold the next time they're used
+		m_Generation.fetch_add(1, std::memory_order_release);
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<uint64_t> Sequence;
+		std::atomic<uint64_t> FenceValue;
+		std::atomic<T*> Item;
+	};
+
+	struct ThreadCache
+	{
+		uint64_t Generation;
+		uint32_t Count;
+		T* Items[kThreadCacheSize];
+	};
+
+	// Takes the oldest retired object if its fence is done.  Fences are retired roughly in order, so when the
+	// oldest isn't done, nothing newer is worth checking.
+	T* Pop( void )
+	{
+		T* Item = PopRing();
+		if (Item == nullptr && m_OverflowCount.load(std::memory_order_acquire) > 0)
+			Item = PopOverflow();
+		return Item;
+	}
+
+	T* PopOverflow( void )
+	{
+		std::lock_guard<std::mutex> LockGuard(m_OverflowMutex);
+		if (m_Overflow.empty() || !m_Fences.IsFenceComplete(m_Overflow.front().first))
+			return nullptr;
+
+		T* Item = m_Overflow.front().second;
+		m_Overflow.pop();
+		m_OverflowCount.fetch_sub(1, std::memory_order_relaxed);
+		return Item;
+	}
+
+	T* PopRing( void )
+	{
+		uint64_t Pos = m_Head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Slot& S = m_Slots[Pos % kCapacity];
+			int64_t Diff = (int64_t)(S.Sequence.load(std::memory_order_acquire) - (Pos + 1));
+			if (Diff == 0)
+			{
+				// If another thread takes this slot first, the CAS fails and this value isn't used
+				if (!m_Fences.IsFenceComplete(S.FenceValue.load(std::memory_order_relaxed)))
+					return nullptr;
+
+				if (m_Head.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+				{
+					T* Item = S.Item.load(std::memory_order_relaxed);
+					S.Sequence.store(Pos + kCapacity, std::memory_order_release);
+					return Item;
+				}
+			}
+			else if (Diff < 0)
+				return nullptr;
+			else
+				Pos = m_Head.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Recyclers past the first few of a type go without
+	ThreadCache* GetThreadCache( void )
+	{
+		static thread_local ThreadCache tls_Caches[kMaxRecyclersPerType];
+
+		if (m_Index >= kMaxRecyclersPerType)
+			return nullptr;
+
+		ThreadCache& Cache = tls_Caches[m_Index];
+		uint64_t Generation = m_Generation.load(std::memory_order_acquire);
+		if (Cache.Generation != Generation)
+		{
+			Cache.Generation = Generation;
+			Cache.Count = 0;
+		}
+		return &Cache;
+	}
+
+	static std::atomic<uint32_t> sm_Count;
+
+	FenceQuery& m_Fences;
+	const uint32_t m_Index;
+	std::atomic<uint64_t> m_Generation;
+
+	// Producers and consumers each get their own cache line
+	alignas(64) std::atomic<uint64_t> m_Head;
+	alignas(64) std::atomic<uint64_t> m_Tail;
+	alignas(64) Slot m_Slots[kCapacity];
+
+	// Only touched when the ring is full, or empty while this is not
+	std::mutex m_OverflowMutex;
+	std::queue<std::pair<uint64_t, T*>> m_Overflow;
+	std::atomic<uint32_t> m_OverflowCount;
+};
+
+template <typename T>
+std::atomic<uint32_t> FencedRecycler<T>::sm_Count(0);
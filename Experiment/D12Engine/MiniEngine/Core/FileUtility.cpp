@@ -13,8 +13,14 @@
 
 #include "pch.h"
 #include "FileUtility.h"
+#include "AssetPack.h"
 #include <fstream>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 #include "../3rdParty/zlib-win64/zlib.h"
 
 using namespace std;
@@ -25,8 +31,6 @@ namespace Utility
 	ByteArray NullFile = make_shared<vector<byte> > (vector<byte>() );
 }
 
-ByteArray DecompressZippedFile( wstring& fileName );
-
 ByteArray ReadFileHelper(const wstring& fileName)
 {
 	struct _stat64 fileStat;
@@ -47,75 +51,147 @@ ByteArray ReadFileHelper(const wstring& fileName)
 	return byteArray;
 }
 
-ByteArray ReadFileHelperEx( shared_ptr<wstring> fileName)
+namespace
 {
-	ByteArray firstTry = DecompressZippedFile(*fileName + L".gz");
-	if (firstTry != NullFile)
-		return firstTry;
-
-	return ReadFileHelper(*fileName);
-}
+	// .gz variants known not to exist, so looking for one costs a stat only the first time
+	class MissingFileCache
+	{
+	public:
+		bool IsMissing( const wstring& fileName )
+		{
+			lock_guard<mutex> Lock(m_Mutex);
+			return m_Missing.count(fileName) != 0;
+		}
 
-ByteArray Inflate(ByteArray CompressedSource, int& err, uint32_t ChunkSize = 0x100000 ) 
-{
-	// Create a dynamic buffer to hold compressed blocks
-	vector<unique_ptr<byte> > blocks;
+		void SetMissing( const wstring& fileName )
+		{
+			lock_guard<mutex> Lock(m_Mutex);
+			m_Missing.insert(fileName);
+		}
 
-	z_stream strm  = {};
-	strm.data_type = Z_BINARY;
-	strm.total_in  = strm.avail_in  = (uInt)CompressedSource->size();
-	strm.next_in   = CompressedSource->data();
+	private:
+		mutex m_Mutex;
+		unordered_set<wstring> m_Missing;
+	};
 
-	err = inflateInit2(&strm, (15 + 32)); //15 window bits, and the +32 tells zlib to to detect if using gzip or zlib
+	MissingFileCache s_MissingZippedFiles;
 
-	while (err == Z_OK || err == Z_BUF_ERROR)
+	size_t GzipSizeHint( const byte* Header, uint32_t ISize )
 	{
-		strm.avail_out = ChunkSize;
-		strm.next_out = (byte*)malloc(ChunkSize);
-		blocks.emplace_back(strm.next_out);
-		err = inflate(&strm, Z_NO_FLUSH);
+		return (Header[0] == 0x1f && Header[1] == 0x8b) ? ISize : 0;
 	}
 
-	if (err != Z_STREAM_END) 
+	// Inflates a gzip or zlib stream straight into one buffer. ReadMore refills strm.next_in and strm.avail_in,
+	// returning false once there's no input left. OutputSize is a hint, the buffer grows if it's short.
+	template <typename ReadFunc>
+	ByteArray InflateStream( ReadFunc ReadMore, size_t OutputSize, int& err, uint32_t ChunkSize )
 	{
-		inflateEnd(&strm);
-		return NullFile;
-	}
+		Utility::ByteArray byteArray = make_shared<vector<byte> >( OutputSize );
+		bool InputDone = false;
 
-	ASSERT(strm.total_out > 0, "Nothing to decompress");
+		z_stream strm  = {};
+		strm.data_type = Z_BINARY;
+		strm.next_out  = byteArray->data();
+		strm.avail_out = (uInt)byteArray->size();
 
-	Utility::ByteArray byteArray = make_shared<vector<byte> >( strm.total_out );
+		err = inflateInit2(&strm, (15 + 32)); //15 window bits, and the +32 tells zlib to to detect if using gzip or zlib
 
-	// Allocate actual memory for this.
-	// copy the bits into that RAM.
-	// Free everything else up!!
-	void* curDest = byteArray->data();
-	size_t remaining = byteArray->size();
+		while (err == Z_OK || err == Z_BUF_ERROR)
+		{
+			if (strm.avail_in == 0 && !InputDone)
+				InputDone = !ReadMore(strm);
 
-	for (size_t i = 0; i < blocks.size(); ++i)
-	{
-		ASSERT(remaining > 0);
+			err = inflate(&strm, Z_NO_FLUSH);
+			if (err == Z_STREAM_END)
+				break;
+
+			if (strm.avail_out == 0 && (strm.avail_in > 0 || InputDone))
+			{
+				// the size hint was short (a zlib stream, or a gzip file over 4GB)
+				size_t Written = byteArray->size();
+				byteArray->resize( Written + max(Written / 2, (size_t)ChunkSize) );
+				strm.next_out = byteArray->data() + Written;
+				strm.avail_out = (uInt)(byteArray->size() - Written);
+			}
+			else if (strm.avail_in == 0 && InputDone)
+			{
+				// truncated
+				err = Z_DATA_ERROR;
+			}
+		}
+
+		if (err != Z_STREAM_END)
+		{
+			inflateEnd(&strm);
+			return NullFile;
+		}
+
+		ASSERT(strm.total_out > 0, "Nothing to decompress");
+
+		inflateEnd(&strm);
 
-		size_t CopySize = min(remaining, (size_t)ChunkSize);
+		// a zlib stream's output was sized by guesswork, so give back what it didn't use. A gzip size hint
+		// is exact and leaves nothing to shrink.
+		byteArray->resize( strm.total_out );
+		byteArray->shrink_to_fit();
 
-		memcpy(curDest, blocks[i].get(), CopySize);
-		curDest = (byte*)curDest + CopySize;
-		remaining -= CopySize;
+		return byteArray;
 	}
+}
 
-	inflateEnd(&strm);
+// Reads the compressed file a chunk at a time, so only the output has to fit in memory.
+// Gzip files end with the uncompressed size (mod 4GB), which is used to size the output up front.
+ByteArray Inflate(ifstream& CompressedFile, uint64_t CompressedSize, int& err, uint32_t ChunkSize = 0x100000 )
+{
+	size_t OutputSize = 0;
+	if (CompressedSize >= 18)
+	{
+		byte Header[2];
+		uint32_t ISize = 0;
+		CompressedFile.seekg(0, ios::beg).read( (char*)Header, sizeof(Header) );
+		CompressedFile.seekg(-4, ios::end).read( (char*)&ISize, sizeof(ISize) );
+		if (CompressedFile)
+			OutputSize = GzipSizeHint(Header, ISize);
+		CompressedFile.clear();
+	}
+	if (OutputSize == 0)
+		OutputSize = (size_t)min<uint64_t>(CompressedSize * 4, 0x40000000ull) + ChunkSize;
+	CompressedFile.seekg(0, ios::beg);
 
-	return byteArray;
+	vector<byte> InputChunk( ChunkSize );
+	uint64_t CompressedRemaining = CompressedSize;
+
+	return InflateStream( [&]( z_stream& strm )
+	{
+		if (CompressedRemaining == 0)
+			return false;
+
+		uInt ReadSize = (uInt)min<uint64_t>(CompressedRemaining, ChunkSize);
+		if (!CompressedFile.read( (char*)InputChunk.data(), ReadSize ))
+			return false;
+
+		strm.next_in = InputChunk.data();
+		strm.avail_in = ReadSize;
+		CompressedRemaining -= ReadSize;
+		return true;
+	}, OutputSize, err, ChunkSize );
 }
 
-ByteArray DecompressZippedFile( wstring& fileName )
+ByteArray DecompressZippedFile( const wstring& fileName )
 {
-	ByteArray CompressedFile = ReadFileHelper(fileName);
-	if (CompressedFile == NullFile)
+	struct _stat64 fileStat;
+	if (_wstat64(fileName.c_str(), &fileStat) == -1)
+	{
+		s_MissingZippedFiles.SetMissing(fileName);
+		return NullFile;
+	}
+
+	ifstream file( fileName, ios::in | ios::binary );
+	if (!file)
 		return NullFile;
 
 	int error;
-	ByteArray DecompressedFile = Inflate(CompressedFile, error);
+	ByteArray DecompressedFile = Inflate(file, fileStat.st_size, error);
 	if (DecompressedFile->size() == 0)
 	{
 		Utility::Printf(L"Couldn't unzip file %s:  Error = %d\n", fileName.c_str(), error);
@@ -125,13 +201,230 @@ ByteArray DecompressZippedFile( wstring& fileName )
 	return DecompressedFile;
 }
 
+ByteArray ReadFileHelperEx( shared_ptr<wstring> fileName)
+{
+	const wstring zippedName = *fileName + L".gz";
+	if (!s_MissingZippedFiles.IsMissing(zippedName))
+	{
+		ByteArray firstTry = DecompressZippedFile(zippedName);
+		if (firstTry != NullFile)
+			return firstTry;
+	}
+
+	return ReadFileHelper(*fileName);
+}
+
+namespace
+{
+	// A small pool of threads that only read files, so many outstanding requests keep the disk busy without
+	// tying up the task scheduler. Requests for a file that's already queued or being read share its result.
+	// A .gz file is left to the task scheduler to stream in and inflate, so the I/O threads can move on.
+	class FileReadService
+	{
+	public:
+		FileReadService() : m_Shutdown(false), m_NextSequence(0)
+		{
+			uint32_t ThreadCount = thread::hardware_concurrency() / 2;
+			ThreadCount = ThreadCount < 2 ? 2 : (ThreadCount > 4 ? 4 : ThreadCount);
+			for (uint32_t i = 0; i < ThreadCount; ++i)
+				m_Threads.emplace_back( [this] { WorkerThread(); } );
+		}
+
+		~FileReadService()
+		{
+			{
+				lock_guard<mutex> Lock(m_Mutex);
+				m_Shutdown = true;
+			}
+			m_WorkAvailable.notify_all();
+			for (auto& Thread : m_Threads)
+				Thread.join();
+		}
+
+		task<ByteArray> Read( const wstring& fileName, ReadFilePriority priority )
+		{
+			lock_guard<mutex> Lock(m_Mutex);
+
+			auto Pending = m_Pending.find(fileName);
+			if (Pending != m_Pending.end())
+			{
+				Raise(Pending->second, priority);
+				return create_task(Pending->second->Completion);
+			}
+
+			shared_ptr<Request> NewRequest = make_shared<Request>();
+			NewRequest->FileName = fileName;
+			NewRequest->Priority = priority;
+			NewRequest->Started = false;
+			m_Pending.emplace(fileName, NewRequest);
+			Push(NewRequest);
+
+			return create_task(NewRequest->Completion);
+		}
+
+		// A read of the file that's already queued or in progress, raised to the top of the queue
+		bool Join( const wstring& fileName, task<ByteArray>& result )
+		{
+			lock_guard<mutex> Lock(m_Mutex);
+
+			auto Pending = m_Pending.find(fileName);
+			if (Pending == m_Pending.end())
+				return false;
+
+			Raise(Pending->second, kReadFileHigh);
+			result = create_task(Pending->second->Completion);
+			return true;
+		}
+
+	private:
+		struct Request
+		{
+			wstring FileName;
+			task_completion_event<ByteArray> Completion;
+			ReadFilePriority Priority;
+			bool Started;
+		};
+
+		struct QueueEntry
+		{
+			ReadFilePriority Priority;
+			uint64_t Sequence;
+			shared_ptr<Request> Req;
+
+			// highest priority first, then first come first served
+			bool operator<( const QueueEntry& rhs ) const
+			{
+				if (Priority != rhs.Priority)
+					return Priority < rhs.Priority;
+				return Sequence > rhs.Sequence;
+			}
+		};
+
+		void Push( const shared_ptr<Request>& Req )
+		{
+			QueueEntry Entry = { Req->Priority, m_NextSequence++, Req };
+			m_Queue.push(Entry);
+			m_WorkAvailable.notify_one();
+		}
+
+		// queues the request again at the higher priority, the old entry is skipped when it comes up
+		void Raise( const shared_ptr<Request>& Req, ReadFilePriority priority )
+		{
+			if (Req->Started || priority <= Req->Priority)
+				return;
+			Req->Priority = priority;
+			Push(Req);
+		}
+
+		void Finish( const shared_ptr<Request>& Req, ByteArray Data )
+		{
+			// later requests read the file again rather than seeing a stale copy
+			{
+				lock_guard<mutex> Lock(m_Mutex);
+				m_Pending.erase(Req->FileName);
+			}
+			Req->Completion.set(Data);
+		}
+
+		void WorkerThread( void )
+		{
+			for (;;)
+			{
+				shared_ptr<Request> Req;
+				{
+					unique_lock<mutex> Lock(m_Mutex);
+					m_WorkAvailable.wait(Lock, [this] { return m_Shutdown || !m_Queue.empty(); });
+					if (m_Shutdown)
+						return;
+
+					QueueEntry Entry = m_Queue.top();
+					m_Queue.pop();
+					if (Entry.Req->Started || Entry.Priority != Entry.Req->Priority)
+						continue;
+					Entry.Req->Started = true;
+					Req = Entry.Req;
+				}
+
+				// only look for the .gz here, the decompression worker streams it in while it inflates
+				const wstring zippedName = Req->FileName + L".gz";
+				bool Zipped = false;
+				if (!s_MissingZippedFiles.IsMissing(zippedName))
+				{
+					struct _stat64 fileStat;
+					Zipped = _wstat64(zippedName.c_str(), &fileStat) != -1;
+					if (!Zipped)
+						s_MissingZippedFiles.SetMissing(zippedName);
+				}
+
+				if (!Zipped)
+				{
+					Finish(Req, ReadFileHelper(Req->FileName));
+					continue;
+				}
+
+				create_task( [this, Req, zippedName]
+				{
+					ByteArray Decompressed = DecompressZippedFile(zippedName);
+					if (Decompressed == NullFile)
+						Decompressed = ReadFileHelper(Req->FileName);
+					Finish(Req, Decompressed);
+				} );
+			}
+		}
+
+		mutex m_Mutex;
+		condition_variable m_WorkAvailable;
+		priority_queue<QueueEntry> m_Queue;
+		unordered_map<wstring, shared_ptr<Request> > m_Pending;
+		vector<thread> m_Threads;
+		bool m_Shutdown;
+		uint64_t m_NextSequence;
+	};
+
+	FileReadService& GetFileReadService( void )
+	{
+		static FileReadService s_Service;
+		return s_Service;
+	}
+}
+
+namespace
+{
+	ByteArray ReadPackedFile( const PackedFile& file )
+	{
+		if (file.Inflated != nullptr)
+			return file.Inflated;
+		return make_shared<vector<byte> >( file.Data, file.Data + file.Size );
+	}
+}
+
 ByteArray Utility::ReadFileSync( const wstring& fileName)
 {
+	PackedFile Packed;
+	if (FindPackedFile(fileName, Packed))
+		return ReadPackedFile(Packed);
+	if (!LooseFilesEnabled())
+		return NullFile;
+
+	// don't read a file twice when it's already on its way
+	task<ByteArray> InFlight;
+	if (GetFileReadService().Join(fileName, InFlight))
+		return InFlight.get();
+
 	return ReadFileHelperEx(make_shared<wstring>(fileName));
 }
 
-task<ByteArray> Utility::ReadFileAsync(const wstring& fileName)
+task<ByteArray> Utility::ReadFileAsync(const wstring& fileName, ReadFilePriority priority)
 {
-	shared_ptr<wstring> SharedPtr = make_shared<wstring>(fileName);
-	return create_task( [=] { return ReadFileHelperEx(SharedPtr); } );
+	// packed files are already mapped, so they skip the I/O threads and fault in on the worker that inflates them
+	if (!LooseFilesEnabled() || IsFilePacked(fileName))
+	{
+		return create_task( [fileName]
+		{
+			PackedFile Packed;
+			return FindPackedFile(fileName, Packed) ? ReadPackedFile(Packed) : NullFile;
+		} );
+	}
+
+	return GetFileReadService().Read(fileName, priority);
 }
@@ -31,7 +31,16 @@ namespace Utility
 	// This operation blocks until the entire file is read.
 	ByteArray ReadFileSync(const wstring& fileName);
 
-	// Same as previous except that it does not block but instead returns a task.
-	task<ByteArray> ReadFileAsync(const wstring& fileName);
+	enum ReadFilePriority
+	{
+		kReadFileLow,		// prefetching
+		kReadFileNormal,
+		kReadFileHigh,		// something is waiting on it
+	};
+
+	// Same as previous except that it does not block but instead returns a task.  Reads happen on a small
+	// pool of I/O threads in priority order, and asking for a file that's already queued or being read
+	// shares that read.  ReadFileSync also joins a read that's in flight rather than starting another.
+	task<ByteArray> ReadFileAsync(const wstring& fileName, ReadFilePriority priority = kReadFileNormal);
 
 } // namespace Utility
@@ -23,7 +23,7 @@ using namespace std;
 
 LinearAllocatorType LinearAllocatorPageManager::sm_AutoType = kGpuExclusive;
 
-LinearAllocatorPageManager::LinearAllocatorPageManager()
+LinearAllocatorPageManager::LinearAllocatorPageManager() : m_Recycler(g_CommandManager)
 {
 	m_AllocationType = sm_AutoType;
 	sm_AutoType = (LinearAllocatorType)(sm_AutoType + 1);
@@ -34,24 +34,13 @@ LinearAllocatorPageManager LinearAllocator::sm_PageManager[2];
 
 LinearAllocationPage* LinearAllocatorPageManager::RequestPage()
 {
-	lock_guard<mutex> LockGuard(m_Mutex);
+	LinearAllocationPage* PagePtr = m_Recycler.Request();
 
-	while (!m_RetiredPages.empty() && g_CommandManager.IsFenceComplete(m_RetiredPages.front().first))
-	{
-		m_AvailablePages.push(m_RetiredPages.front().second);
-		m_RetiredPages.pop();
-	}
-
-	LinearAllocationPage* PagePtr = nullptr;
-
-	if (!m_AvailablePages.empty())
-	{
-		PagePtr = m_AvailablePages.front();
-		m_AvailablePages.pop();
-	}
-	else
+	if (PagePtr == nullptr)
 	{
 		PagePtr = CreateNewPage();
+
+		lock_guard<mutex> LockGuard(m_Mutex);
 		m_PagePool.emplace_back(PagePtr);
 	}
 
@@ -60,9 +49,10 @@ LinearAllocationPage* LinearAllocatorPageManager::RequestPage()
 
 void LinearAllocatorPageManager::DiscardPages( uint64_t FenceValue, const vector<LinearAllocationPage*>& UsedPages )
 {
-	lock_guard<mutex> LockGuard(m_Mutex);
 	for (auto iter = UsedPages.begin(); iter != UsedPages.end(); ++iter)
-		m_RetiredPages.push(make_pair(FenceValue, *iter));
+	{
+		m_Recycler.Retire(FenceValue, *iter);
+	}
 }
 
 LinearAllocationPage* LinearAllocatorPageManager::CreateNewPage( void )
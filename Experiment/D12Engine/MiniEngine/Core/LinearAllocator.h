@@ -13,8 +13,8 @@
 // Description:  This is a dynamic graphics memory allocator for DX12.  It's designed to work in concert
 // with the CommandContext class and to do so in a thread-safe manner.  There may be many command contexts,
 // each with its own linear allocators.  They act as windows into a global memory pool by reserving a
-// context-local memory page.  Requesting a new page is done in a thread-safe manner by guarding accesses
-// with a mutex lock.
+// context-local memory page.  Requesting a new page is thread-safe and recycles retired pages without
+// taking a lock.  Only creating a new page does.
 //
 // When a command context is finished, it will receive a fence ID that indicates when it's safe to reclaim
 // used resources.  The CleanupUsedPages() method must be invoked at this time so that the used pages can be
@@ -23,8 +23,8 @@
 #pragma once
 
 #include "GpuResource.h"
+#include "FencedRecycler.h"
 #include <vector>
-#include <queue>
 #include <mutex>
 
 // Constant blocks must be multiples of 16 constants @ 16 bytes each
@@ -87,7 +87,7 @@ public:
 	LinearAllocationPage* RequestPage( void );
 	void DiscardPages( uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages );
 
-	void Destroy( void ) { m_PagePool.clear(); }
+	void Destroy( void ) { m_Recycler.ReleaseAll(); m_PagePool.clear(); }
 
 private:
 
@@ -97,9 +97,8 @@ private:
 
 	LinearAllocatorType m_AllocationType;
 	std::vector<std::unique_ptr<LinearAllocationPage> > m_PagePool;
-	std::queue<std::pair<uint64_t, LinearAllocationPage*> > m_RetiredPages;
-	std::queue<LinearAllocationPage*> m_AvailablePages;
-	std::mutex m_Mutex;
+	FencedRecycler<LinearAllocationPage> m_Recycler;
+	std::mutex m_Mutex; // guards m_PagePool
 };
 
 class LinearAllocator
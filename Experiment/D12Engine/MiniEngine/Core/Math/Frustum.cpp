@@ -114,3 +114,57 @@ Frustum::Frustum( const Matrix4& ProjMat )
 		ConstructPerspectiveFrustum( RcpXX, RcpYY, NearClip, FarClip );
 	}
 }
+
+uint32_t Frustum::IntersectSpheres( const float* X, const float* Y, const float* Z, const float* Radius, uint32_t Count, uint32_t* Visible ) const
+{
+	// Each plane's coefficients splatted across a vector, so four spheres are tested against one plane at a time
+	XMVECTOR PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6];
+	for (int i = 0; i < 6; ++i)
+	{
+		const XMVECTOR Plane = Vector4(m_FrustumPlanes[i]);
+		PlaneX[i] = XMVectorSplatX(Plane);
+		PlaneY[i] = XMVectorSplatY(Plane);
+		PlaneZ[i] = XMVectorSplatZ(Plane);
+		PlaneW[i] = XMVectorSplatW(Plane);
+	}
+
+	const XMVECTOR Zero = XMVectorZero();
+	uint32_t VisibleCount = 0;
+
+	for (uint32_t Base = 0; Base < Count; Base += kSphereBatch)
+	{
+		// Two groups of four per pass, so the two dependency chains overlap
+		const XMVECTOR X0 = XMLoadFloat4((const XMFLOAT4*)(X + Base)), X1 = XMLoadFloat4((const XMFLOAT4*)(X + Base + 4));
+		const XMVECTOR Y0 = XMLoadFloat4((const XMFLOAT4*)(Y + Base)), Y1 = XMLoadFloat4((const XMFLOAT4*)(Y + Base + 4));
+		const XMVECTOR Z0 = XMLoadFloat4((const XMFLOAT4*)(Z + Base)), Z1 = XMLoadFloat4((const XMFLOAT4*)(Z + Base + 4));
+		const XMVECTOR R0 = XMLoadFloat4((const XMFLOAT4*)(Radius + Base)), R1 = XMLoadFloat4((const XMFLOAT4*)(Radius + Base + 4));
+
+		XMVECTOR Outside0 = XMVectorFalseInt();
+		XMVECTOR Outside1 = XMVectorFalseInt();
+		for (int i = 0; i < 6; ++i)
+		{
+			XMVECTOR Distance0 = XMVectorMultiplyAdd(X0, PlaneX[i], XMVectorAdd(PlaneW[i], R0));
+			XMVECTOR Distance1 = XMVectorMultiplyAdd(X1, PlaneX[i], XMVectorAdd(PlaneW[i], R1));
+			Distance0 = XMVectorMultiplyAdd(Y0, PlaneY[i], Distance0);
+			Distance1 = XMVectorMultiplyAdd(Y1, PlaneY[i], Distance1);
+			Distance0 = XMVectorMultiplyAdd(Z0, PlaneZ[i], Distance0);
+			Distance1 = XMVectorMultiplyAdd(Z1, PlaneZ[i], Distance1);
+			Outside0 = XMVectorOrInt(Outside0, XMVectorLess(Distance0, Zero));
+			Outside1 = XMVectorOrInt(Outside1, XMVectorLess(Distance1, Zero));
+		}
+
+		// Write every index and only advance past the visible ones, which keeps the list compact without branches
+		XMUINT4 Mask[2];
+		XMStoreUInt4(&Mask[0], Outside0);
+		XMStoreUInt4(&Mask[1], Outside1);
+		const uint32_t* Lanes = &Mask[0].x;
+		const uint32_t BatchCount = Count - Base < kSphereBatch ? Count - Base : kSphereBatch;
+		for (uint32_t i = 0; i < BatchCount; ++i)
+		{
+			Visible[VisibleCount] = Base + i;
+			VisibleCount += Lanes[i] == 0;
+		}
+	}
+
+	return VisibleCount;
+}
@@ -41,7 +41,13 @@ namespace Math
 
 		// Test whether the bounding sphere intersects the frustum.  Intersection is defined as either being
 		// fully contained in the frustum, or by intersecting one or more of the planes.
-		bool IntersectSphere( BoundingSphere sphere );
+		bool IntersectSphere( BoundingSphere sphere ) const;
+
+		// The same test for many spheres, given as separate arrays of center X, Y, Z and radius that are padded
+		// to a multiple of kSphereBatch.  The indices of the spheres that intersect go to Visible
+		// in order, and the number of them is returned.
+		enum { kSphereBatch = 8 };
+		uint32_t IntersectSpheres( const float* X, const float* Y, const float* Z, const float* Radius, uint32_t Count, uint32_t* Visible ) const;
 
 		friend Frustum  operator* ( const OrthogonalTransform& xform, const Frustum& frustum );	// Fast
 		friend Frustum  operator* ( const AffineTransform& xform, const Frustum& frustum );		// Slow
@@ -63,7 +69,7 @@ namespace Math
 	// Inline implementations
 	//
 
-	inline bool Frustum::IntersectSphere( BoundingSphere sphere )
+	inline bool Frustum::IntersectSphere( BoundingSphere sphere ) const
 	{
 		float radius = sphere.GetRadius();
 		for (int i = 0; i < 6; ++i)
@@ -13,8 +13,175 @@
 
 #include "pch.h"
 #include "Random.h"
+#include <atomic>
+#include <random>
 
 namespace Math
 {
 	RandomNumberGenerator g_RNG;
+
+	namespace
+	{
+		uint64_t SplitMix64( uint64_t& State )
+		{
+			uint64_t z = (State += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		uint64_t NondeterministicSeed( void )
+		{
+			std::random_device rd;
+			return ((uint64_t)rd() << 32) | rd();
+		}
+
+		std::atomic<uint64_t> s_ThreadSeed(NondeterministicSeed());
+		std::atomic<uint32_t> s_ThreadSeedGeneration(0);
+		std::atomic<uint32_t> s_NextThreadStream(0);
+	}
+
+	RandomNumberGenerator::RandomNumberGenerator()
+	{
+		SetSeed(NondeterministicSeed(), 0);
+	}
+
+	void RandomNumberGenerator::SetSeed( uint64_t Seed, uint32_t Stream )
+	{
+		// Each stream starts from its own point in the SplitMix64 sequence, as the xoshiro authors suggest
+		uint64_t Mix = Seed ^ ((uint64_t)Stream * 0xD1B54A32D192ED03ull);
+		for (int i = 0; i < 4; i += 2)
+		{
+			const uint64_t Word = SplitMix64(Mix);
+			m_State[i] = (uint32_t)Word;
+			m_State[i + 1] = (uint32_t)(Word >> 32);
+		}
+		for (int Lane = 0; Lane < 4; ++Lane)
+		{
+			for (int i = 0; i < 4; i += 2)
+			{
+				const uint64_t Word = SplitMix64(Mix);
+				m_Lanes[i][Lane] = (uint32_t)Word;
+				m_Lanes[i + 1][Lane] = (uint32_t)(Word >> 32);
+			}
+		}
+	}
+
+	XMVECTOR RandomNumberGenerator::NextFloat4( void )
+	{
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+		__m128i s0 = _mm_loadu_si128((const __m128i*)m_Lanes[0]);
+		__m128i s1 = _mm_loadu_si128((const __m128i*)m_Lanes[1]);
+		__m128i s2 = _mm_loadu_si128((const __m128i*)m_Lanes[2]);
+		__m128i s3 = _mm_loadu_si128((const __m128i*)m_Lanes[3]);
+
+		const __m128i Result = _mm_add_epi32(s0, s3);
+		const __m128i T = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, T);
+		s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+		_mm_storeu_si128((__m128i*)m_Lanes[0], s0);
+		_mm_storeu_si128((__m128i*)m_Lanes[1], s1);
+		_mm_storeu_si128((__m128i*)m_Lanes[2], s2);
+		_mm_storeu_si128((__m128i*)m_Lanes[3], s3);
+
+		// The top 24 bits are exact as floats
+		return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(Result, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+#else
+		XMFLOAT4 Result;
+		float* const Lane = &Result.x;
+		for (int i = 0; i < 4; ++i)
+		{
+			const uint32_t Sum = m_Lanes[0][i] + m_Lanes[3][i];
+			const uint32_t T = m_Lanes[1][i] << 9;
+			m_Lanes[2][i] ^= m_Lanes[0][i];
+			m_Lanes[3][i] ^= m_Lanes[1][i];
+			m_Lanes[1][i] ^= m_Lanes[2][i];
+			m_Lanes[0][i] ^= m_Lanes[3][i];
+			m_Lanes[2][i] ^= T;
+			m_Lanes[3][i] = Rotl(m_Lanes[3][i], 11);
+			Lane[i] = (float)(Sum >> 8) * (1.0f / 16777216.0f);
+		}
+		return XMLoadFloat4(&Result);
+#endif
+	}
+
+	void RandomNumberGenerator::FillFloat( float* Dest, size_t Count )
+	{
+		FillFloat(Dest, Count, 0.0f, 1.0f);
+	}
+
+	void RandomNumberGenerator::FillFloat( float* Dest, size_t Count, float MinVal, float MaxVal )
+	{
+		const XMVECTOR Min = XMVectorReplicate(MinVal);
+		const XMVECTOR Range = XMVectorReplicate(MaxVal - MinVal);
+
+		size_t i = 0;
+		for (; i + 4 <= Count; i += 4)
+			XMStoreFloat4((XMFLOAT4*)(Dest + i), XMVectorMultiplyAdd(NextFloat4(), Range, Min));
+
+		if (i < Count)
+		{
+			XMFLOAT4 Tail;
+			XMStoreFloat4(&Tail, XMVectorMultiplyAdd(NextFloat4(), Range, Min));
+			for (size_t j = 0; i < Count; ++i, ++j)
+				Dest[i] = (&Tail.x)[j];
+		}
+	}
+
+	void RandomNumberGenerator::FillUnitVector( XMFLOAT3* Dest, size_t Count )
+	{
+		// Uniform height and angle around the Y axis give a uniform spread over the sphere
+		const XMVECTOR One = XMVectorSplatOne();
+		const XMVECTOR Two = XMVectorReplicate(2.0f);
+		const XMVECTOR TwoPi = XMVectorReplicate(XM_2PI);
+
+		for (size_t i = 0; i < Count; i += 4)
+		{
+			const XMVECTOR Y = XMVectorSubtract(XMVectorMultiply(NextFloat4(), Two), One);
+			const XMVECTOR Radius = XMVectorSqrt(XMVectorMax(XMVectorSubtract(One, XMVectorMultiply(Y, Y)), XMVectorZero()));
+			XMVECTOR Sin, Cos;
+			XMVectorSinCos(&Sin, &Cos, XMVectorMultiply(NextFloat4(), TwoPi));
+
+			XMFLOAT4 X4, Y4, Z4;
+			XMStoreFloat4(&X4, XMVectorMultiply(Radius, Cos));
+			XMStoreFloat4(&Y4, Y);
+			XMStoreFloat4(&Z4, XMVectorMultiply(Radius, Sin));
+
+			const size_t Lanes = Count - i < 4 ? Count - i : 4;
+			for (size_t j = 0; j < Lanes; ++j)
+				Dest[i + j] = XMFLOAT3((&X4.x)[j], (&Y4.x)[j], (&Z4.x)[j]);
+		}
+	}
+
+	RandomNumberGenerator& RandomNumberGenerator::ThreadLocal( void )
+	{
+		struct ThreadState
+		{
+			RandomNumberGenerator Generator;
+			uint32_t Stream;
+			uint32_t Generation;
+
+			ThreadState() : Generator(0, 0), Stream(s_NextThreadStream++), Generation(~0u) {}
+		};
+		static thread_local ThreadState s_State;
+
+		const uint32_t Generation = s_ThreadSeedGeneration.load(std::memory_order_acquire);
+		if (s_State.Generation != Generation)
+		{
+			s_State.Generator.SetSeed(s_ThreadSeed.load(std::memory_order_relaxed), s_State.Stream);
+			s_State.Generation = Generation;
+		}
+		return s_State.Generator;
+	}
+
+	void RandomNumberGenerator::SeedThreads( uint64_t Seed )
+	{
+		s_ThreadSeed.store(Seed, std::memory_order_relaxed);
+		s_ThreadSeedGeneration.fetch_add(1, std::memory_order_release);
+	}
 }
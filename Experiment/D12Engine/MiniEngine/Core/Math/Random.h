@@ -14,53 +14,107 @@
 #pragma once
 
 #include "Common.h"
-#include <random>
 
 namespace Math
 {
+	// xoshiro128** generator.  Seeding is cheap and deterministic: the same seed and stream always give the
+	// same sequence, and different streams of one seed are independent.  The Fill functions generate four
+	// numbers at a time from a second set of four xoshiro128+ states.
 	class RandomNumberGenerator
 	{
 	public:
-		RandomNumberGenerator() : m_gen(m_rd())
+		// Seeded from std::random_device
+		RandomNumberGenerator();
+
+		RandomNumberGenerator( uint64_t Seed, uint32_t Stream )
+		{
+			SetSeed(Seed, Stream);
+		}
+
+		uint32_t NextUInt( void )
 		{
+			const uint32_t Result = Rotl(m_State[1] * 5, 7) * 9;
+			const uint32_t T = m_State[1] << 9;
+			m_State[2] ^= m_State[0];
+			m_State[3] ^= m_State[1];
+			m_State[1] ^= m_State[2];
+			m_State[0] ^= m_State[3];
+			m_State[2] ^= T;
+			m_State[3] = Rotl(m_State[3], 11);
+			return Result;
 		}
 
 		// Default int range is [MIN_INT, MAX_INT].  Max value is included.
 		int32_t NextInt( void )
 		{
-			return std::uniform_int_distribution<int32_t>(0x80000000, 0x7FFFFFFF)(m_gen);
+			return (int32_t)NextUInt();
 		}
 
 		int32_t NextInt( int32_t MaxVal )
 		{
-			return std::uniform_int_distribution<int32_t>(0, MaxVal)(m_gen);
+			return NextInt(0, MaxVal);
 		}
 
 		int32_t NextInt( int32_t MinVal, int32_t MaxVal )
 		{
-			return std::uniform_int_distribution<int32_t>(MinVal, MaxVal)(m_gen);
+			const uint32_t Range = (uint32_t)MaxVal - (uint32_t)MinVal + 1;
+			return Range == 0 ? (int32_t)NextUInt() : (int32_t)((uint32_t)MinVal + NextBelow(Range));
 		}
 
 		// Default float range is [0.0f, 1.0f).  Max value is excluded.
 		float NextFloat( float MaxVal = 1.0f )
 		{
-			return std::uniform_real_distribution<float>(0.0f, MaxVal)(m_gen);
+			return (float)(NextUInt() >> 8) * (1.0f / 16777216.0f) * MaxVal;
 		}
 
 		float NextFloat( float MinVal, float MaxVal )
 		{
-			return std::uniform_real_distribution<float>(MinVal, MaxVal)(m_gen);
+			return MinVal + NextFloat(MaxVal - MinVal);
 		}
 
 		void SetSeed( UINT s )
 		{
-			m_gen.seed(s);
+			SetSeed(s, 0);
 		}
 
+		void SetSeed( uint64_t Seed, uint32_t Stream );
+
+		// Fills Dest with floats in [0.0f, 1.0f), or [MinVal, MaxVal)
+		void FillFloat( float* Dest, size_t Count );
+		void FillFloat( float* Dest, size_t Count, float MinVal, float MaxVal );
+
+		// Fills Dest with directions spread evenly over the unit sphere
+		void FillUnitVector( XMFLOAT3* Dest, size_t Count );
+
+		// The calling thread's generator.  Each thread gets its own stream of the seed given to SeedThreads(),
+		// numbered in the order threads first ask for one, and picks up a new seed the next time it asks.
+		static RandomNumberGenerator& ThreadLocal( void );
+		static void SeedThreads( uint64_t Seed );
+
 	private:
 
-		std::random_device m_rd;
-		std::minstd_rand m_gen;
+		static uint32_t Rotl( uint32_t x, int k )
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+		// Unbiased value in [0, Range)
+		uint32_t NextBelow( uint32_t Range )
+		{
+			const uint32_t Threshold = (0u - Range) % Range;
+			for (;;)
+			{
+				const uint64_t Product = (uint64_t)NextUInt() * Range;
+				if ((uint32_t)Product >= Threshold)
+					return (uint32_t)(Product >> 32);
+			}
+		}
+
+		// Four floats in [0.0f, 1.0f) from the lane states
+		XMVECTOR NextFloat4( void );
+
+		uint32_t m_State[4];
+		uint32_t m_Lanes[4][4];    // [word][lane]
 	};
 
 	extern RandomNumberGenerator g_RNG;
@@ -191,10 +191,11 @@ namespace
 		UINT TextureID = (UINT)(TextureNameArray.size() - 1);
 		effectProperties->EmitProperties.TextureID = TextureID;
 
-		const ManagedTexture* managedTex = TextureManager::LoadDDSFromFile(name.c_str(), true);
+		TextureManager::TextureRef managedTex = TextureManager::LoadDDSFromFile(name.c_str(), true);
 		managedTex->WaitForLoad();
 
-		GpuResource& ParticleTexture = *const_cast<ManagedTexture*>(managedTex);
+		// the slice is a copy, so the texture can be evicted once this reference goes
+		GpuResource& ParticleTexture = *const_cast<ManagedTexture*>(managedTex.Get());
 		CommandContext::InitializeTextureArraySlice(TextureArray, TextureID, ParticleTexture);
 	}
 
@@ -18,15 +18,20 @@
 #include "DDSTextureLoader.h"
 #include "GraphicsCore.h"
 #include "CommandContext.h"
+#include "CommandListManager.h"
 #include <map>
-#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <queue>
+#include <atomic>
 
 using namespace std;
 using namespace Graphics;
 
 static UINT BytesPerPixel( DXGI_FORMAT Format )
 {
-	return (UINT)BitsPerPixel(Format) / 8;
+	return (UINT)DDS::BitsPerPixel(Format) / 8;
 };
 
 void Texture::Create( size_t Width, size_t Height, DXGI_FORMAT Format, const void* InitialData )
@@ -135,7 +140,355 @@ bool Texture::CreateDDSFromMemory( const void* filePtr, size_t fileSize, bool sR
 namespace TextureManager
 {
 	wstring s_RootPath = L"";
-	map< wstring, unique_ptr<ManagedTexture> > s_TextureCache;
+
+	// reads started by PrefetchFromFile, held until the texture is loaded.  Lock order is a shard, then this.
+	mutex s_PrefetchMutex;
+	map< wstring, concurrency::task<Utility::ByteArray> > s_Prefetches;
+
+	// Textures are spread over shards by a hash of their path, each shard with its own lock, so loaders
+	// working on different textures rarely wait on each other.  A lookup hashes the path once and only
+	// compares it against textures with the same hash.
+	class TextureCache
+	{
+	public:
+		TextureCache() : m_Budget(kDefaultBudget), m_ResidentBytes(0), m_ReleaseClock(0) {}
+
+		static TextureRef Adopt( ManagedTexture* Tex ) { return TextureRef(Tex); }
+
+		// Returns the texture with a reference added for the caller, and whether the caller has to load it
+		pair<ManagedTexture*, bool> FindOrCreate( const wstring& fileName )
+		{
+			const uint64_t Hash = HashPath(fileName);
+			Shard& S = GetShard(Hash);
+			lock_guard<mutex> Guard(S.Mutex);
+
+			// If it's found, it has already been loaded or the load process has begun
+			ManagedTexture* Tex = Find(S, fileName, Hash);
+			if (Tex != nullptr)
+			{
+				if (Tex->m_RefCount++ == 0)
+					LruRemove(S, Tex);
+				return make_pair(Tex, false);
+			}
+
+			Tex = new ManagedTexture(fileName);
+			Tex->m_KeyHash = Hash;
+			Tex->m_IsLoading = true;
+			Tex->m_RefCount = 1;
+			Tex->m_hCpuDescriptorHandle = PopFreeDescriptor();
+			S.Textures.emplace(Hash, unique_ptr<ManagedTexture>(Tex));
+
+			// This was the first time it was requested, so indicate that the caller must read the file
+			return make_pair(Tex, true);
+		}
+
+		// Calls Fn under the shard lock if the texture isn't cached.  A load creates its texture under the same
+		// lock before it looks for a prefetch, so it can't miss whatever Fn leaves for it.
+		template <typename Fn>
+		void IfNotCached( const wstring& fileName, Fn fn )
+		{
+			const uint64_t Hash = HashPath(fileName);
+			Shard& S = GetShard(Hash);
+			lock_guard<mutex> Guard(S.Mutex);
+			if (Find(S, fileName, Hash) == nullptr)
+				fn();
+		}
+
+		void FinishLoad( ManagedTexture* Tex )
+		{
+			size_t ResidentSize = 0;
+			if (Tex->IsValid() && Tex->GetResource() != nullptr)
+			{
+				D3D12_RESOURCE_DESC Desc = Tex->GetResource()->GetDesc();
+				ResidentSize = (size_t)g_Device->GetResourceAllocationInfo(1, 1, &Desc).SizeInBytes;
+			}
+
+			Shard& S = GetShard(Tex->m_KeyHash);
+			{
+				lock_guard<mutex> Guard(S.Mutex);
+				Tex->m_ResidentSize = ResidentSize;
+				Tex->m_IsLoading = false;
+			}
+			S.Loaded.notify_all();
+
+			m_ResidentBytes += ResidentSize;
+			EvictToBudget();
+		}
+
+		void Wait( const ManagedTexture* Tex )
+		{
+			Shard& S = GetShard(Tex->m_KeyHash);
+			unique_lock<mutex> Lock(S.Mutex);
+			S.Loaded.wait(Lock, [Tex] { return !Tex->m_IsLoading; });
+		}
+
+		void AddRef( ManagedTexture* Tex )
+		{
+			Shard& S = GetShard(Tex->m_KeyHash);
+			lock_guard<mutex> Guard(S.Mutex);
+			ASSERT(Tex->m_RefCount > 0, "Only a referenced texture can be referenced again");
+			++Tex->m_RefCount;
+		}
+
+		void Release( ManagedTexture* Tex )
+		{
+			Shard& S = GetShard(Tex->m_KeyHash);
+			unique_ptr<ManagedTexture> Evicted;
+			{
+				lock_guard<mutex> Guard(S.Mutex);
+				ASSERT(Tex->m_RefCount > 0);
+				if (--Tex->m_RefCount > 0)
+					return;
+
+				if (Tex->m_UnloadWhenUnused)
+					Evicted = Remove(S, Tex);
+				else
+					LruPushBack(S, Tex);
+			}
+
+			if (Evicted)
+				Retire(move(Evicted));
+			else
+				EvictToBudget();
+		}
+
+		void Unload( ManagedTexture* Tex )
+		{
+			Shard& S = GetShard(Tex->m_KeyHash);
+			unique_ptr<ManagedTexture> Evicted;
+			{
+				lock_guard<mutex> Guard(S.Mutex);
+				Tex->m_UnloadWhenUnused = true;
+				if (Tex->m_RefCount == 0)
+				{
+					LruRemove(S, Tex);
+					Evicted = Remove(S, Tex);
+				}
+			}
+			if (Evicted)
+				Retire(move(Evicted));
+		}
+
+		// descriptors of textures that failed to load, or were destroyed, are handed to the next new texture
+		void RecycleDescriptor( D3D12_CPU_DESCRIPTOR_HANDLE Handle )
+		{
+			lock_guard<mutex> Guard(m_RetireMutex);
+			m_FreeDescriptors.push_back(Handle);
+		}
+
+		void SetBudget( size_t Bytes )
+		{
+			m_Budget = Bytes;
+			EvictToBudget();
+		}
+
+		size_t GetResidentBytes( void ) const
+		{
+			return m_ResidentBytes;
+		}
+
+		// Nothing may be referencing a texture by now, and the GPU must be idle
+		void Clear( void )
+		{
+			for (Shard& S : m_Shards)
+			{
+				lock_guard<mutex> Guard(S.Mutex);
+				S.Textures.clear();
+				S.LruHead = S.LruTail = nullptr;
+			}
+
+			lock_guard<mutex> Guard(m_RetireMutex);
+			while (!m_Retired.empty())
+				m_Retired.pop();
+			m_FreeDescriptors.clear();
+			m_ResidentBytes = 0;
+		}
+
+	private:
+		static const uint32_t kShardCount = 16;
+		static const size_t kDefaultBudget = (size_t)1 << 30;
+
+		struct alignas(64) Shard
+		{
+			Shard() : LruHead(nullptr), LruTail(nullptr) {}
+
+			mutex Mutex;
+			condition_variable Loaded;
+			unordered_multimap< uint64_t, unique_ptr<ManagedTexture> > Textures;
+			ManagedTexture* LruHead;
+			ManagedTexture* LruTail;
+		};
+
+		static uint64_t HashPath( const wstring& fileName )
+		{
+			uint64_t Hash = 14695981039346656037ull;
+			for (wchar_t c : fileName)
+				Hash = (Hash ^ (uint64_t)c) * 1099511628211ull;
+			return Hash;
+		}
+
+		Shard& GetShard( uint64_t Hash )
+		{
+			return m_Shards[(Hash >> 32) % kShardCount];
+		}
+
+		static ManagedTexture* Find( Shard& S, const wstring& fileName, uint64_t Hash )
+		{
+			auto Range = S.Textures.equal_range(Hash);
+			for (auto Iter = Range.first; Iter != Range.second; ++Iter)
+			{
+				if (Iter->second->m_MapKey == fileName)
+					return Iter->second.get();
+			}
+			return nullptr;
+		}
+
+		void LruPushBack( Shard& S, ManagedTexture* Tex )
+		{
+			Tex->m_LastRelease = ++m_ReleaseClock;
+			Tex->m_LruPrev = S.LruTail;
+			Tex->m_LruNext = nullptr;
+			if (S.LruTail != nullptr)
+				S.LruTail->m_LruNext = Tex;
+			else
+				S.LruHead = Tex;
+			S.LruTail = Tex;
+		}
+
+		static void LruRemove( Shard& S, ManagedTexture* Tex )
+		{
+			if (Tex->m_LruPrev != nullptr)
+				Tex->m_LruPrev->m_LruNext = Tex->m_LruNext;
+			else
+				S.LruHead = Tex->m_LruNext;
+			if (Tex->m_LruNext != nullptr)
+				Tex->m_LruNext->m_LruPrev = Tex->m_LruPrev;
+			else
+				S.LruTail = Tex->m_LruPrev;
+			Tex->m_LruPrev = Tex->m_LruNext = nullptr;
+		}
+
+		// takes an unreferenced texture, already off the LRU list, out of the shard
+		unique_ptr<ManagedTexture> Remove( Shard& S, ManagedTexture* Tex )
+		{
+			unique_ptr<ManagedTexture> Removed;
+			auto Range = S.Textures.equal_range(Tex->m_KeyHash);
+			for (auto Iter = Range.first; Iter != Range.second; ++Iter)
+			{
+				if (Iter->second.get() == Tex)
+				{
+					Removed = move(Iter->second);
+					S.Textures.erase(Iter);
+					break;
+				}
+			}
+			m_ResidentBytes -= Tex->m_ResidentSize;
+			return Removed;
+		}
+
+		// Evicts the least recently released textures of all the shards until they fit.  Only one thread evicts
+		// at a time, and any other finds the work already being done rather than waiting for it.
+		void EvictToBudget( void )
+		{
+			unique_lock<mutex> EvictLock(m_EvictMutex, try_to_lock);
+			if (!EvictLock.owns_lock())
+				return;
+
+			FreeRetired();
+
+			while (m_ResidentBytes > m_Budget)
+			{
+				Shard* Oldest = nullptr;
+				uint64_t OldestRelease = UINT64_MAX;
+				for (Shard& S : m_Shards)
+				{
+					lock_guard<mutex> Guard(S.Mutex);
+					if (S.LruHead != nullptr && S.LruHead->m_LastRelease < OldestRelease)
+					{
+						Oldest = &S;
+						OldestRelease = S.LruHead->m_LastRelease;
+					}
+				}
+				if (Oldest == nullptr)
+					break;
+
+				unique_ptr<ManagedTexture> Evicted;
+				{
+					lock_guard<mutex> Guard(Oldest->Mutex);
+					ManagedTexture* Tex = Oldest->LruHead;
+					if (Tex != nullptr)
+					{
+						LruRemove(*Oldest, Tex);
+						Evicted = Remove(*Oldest, Tex);
+					}
+				}
+				if (Evicted)
+					Retire(move(Evicted));
+			}
+		}
+
+		// the GPU may still be reading the texture, so it's destroyed once the work submitted so far is done
+		void Retire( unique_ptr<ManagedTexture> Tex )
+		{
+			lock_guard<mutex> Guard(m_RetireMutex);
+			m_Retired.push(make_pair(g_CommandManager.GetGraphicsQueue().GetNextFenceValue(), move(Tex)));
+		}
+
+		void FreeRetired( void )
+		{
+			lock_guard<mutex> Guard(m_RetireMutex);
+			while (!m_Retired.empty() && g_CommandManager.IsFenceComplete(m_Retired.front().first))
+			{
+				ManagedTexture* Tex = m_Retired.front().second.get();
+				if (Tex->IsValid() && Tex->GetSRV().ptr != D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+					m_FreeDescriptors.push_back(Tex->GetSRV());
+				m_Retired.pop();
+			}
+		}
+
+		D3D12_CPU_DESCRIPTOR_HANDLE PopFreeDescriptor( void )
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE Handle;
+			Handle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+
+			lock_guard<mutex> Guard(m_RetireMutex);
+			if (!m_FreeDescriptors.empty())
+			{
+				Handle = m_FreeDescriptors.back();
+				m_FreeDescriptors.pop_back();
+			}
+			return Handle;
+		}
+
+		Shard m_Shards[kShardCount];
+
+		atomic<size_t> m_Budget;
+		atomic<size_t> m_ResidentBytes;
+		atomic<uint64_t> m_ReleaseClock;
+		mutex m_EvictMutex;
+
+		// lock order is a shard, then this
+		mutex m_RetireMutex;
+		queue< pair< uint64_t, unique_ptr<ManagedTexture> > > m_Retired;
+		vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_FreeDescriptors;
+	};
+
+	TextureCache s_Cache;
+
+	Utility::ByteArray ReadTextureFile( const wstring& fileName )
+	{
+		concurrency::task<Utility::ByteArray> Prefetch;
+		{
+			lock_guard<mutex> Guard(s_PrefetchMutex);
+			auto iter = s_Prefetches.find(fileName);
+			if (iter == s_Prefetches.end())
+				return Utility::ReadFileSync( s_RootPath + fileName );
+
+			Prefetch = iter->second;
+			s_Prefetches.erase(iter);
+		}
+		return Prefetch.get();
+	}
 
 	void Initialize( const std::wstring& TextureLibRoot )
 	{
@@ -144,30 +497,40 @@ namespace TextureManager
 
 	void Shutdown( void )
 	{
-		s_TextureCache.clear();
+		s_Cache.Clear();
+
+		lock_guard<mutex> Guard(s_PrefetchMutex);
+		s_Prefetches.clear();
 	}
 
-	pair<ManagedTexture*, bool> FindOrLoadTexture( const wstring& fileName )
+	void SetMemoryBudget( size_t Bytes )
 	{
-		static mutex s_Mutex;
-		lock_guard<mutex> Guard(s_Mutex);
-
-		auto iter = s_TextureCache.find(fileName);
+		s_Cache.SetBudget(Bytes);
+	}
 
-		// If it's found, it has already been loaded or the load process has begun
-		if (iter != s_TextureCache.end())
-			return make_pair(iter->second.get(), false);
+	size_t GetResidentBytes( void )
+	{
+		return s_Cache.GetResidentBytes();
+	}
 
-		ManagedTexture* NewTexture = new ManagedTexture(fileName);
-		s_TextureCache[fileName].reset( NewTexture );
+	void PrefetchFromFile( const wstring& fileName )
+	{
+		if (fileName.empty())
+			return;
 
-		// This was the first time it was requested, so indicate that the caller must read the file
-		return make_pair(NewTexture, true);
+		const wstring DDSFileName = fileName + L".dds";
+		s_Cache.IfNotCached(DDSFileName, [&DDSFileName]
+		{
+			lock_guard<mutex> Guard(s_PrefetchMutex);
+			if (s_Prefetches.find(DDSFileName) == s_Prefetches.end())
+				s_Prefetches.emplace(DDSFileName, Utility::ReadFileAsync( s_RootPath + DDSFileName, Utility::kReadFileLow ));
+		});
 	}
 
-	const Texture& GetBlackTex2D(void)
+	// The defaults keep the reference from their first lookup forever, so they're never evicted
+	const Texture& GetDefaultTexture( const wstring& Name, uint32_t Pixel )
 	{
-		auto ManagedTex = FindOrLoadTexture(L"DefaultBlackTexture");
+		auto ManagedTex = s_Cache.FindOrCreate(Name);
 
 		ManagedTexture* ManTex = ManagedTex.first;
 		const bool RequestsLoad = ManagedTex.second;
@@ -175,80 +538,84 @@ namespace TextureManager
 		if (!RequestsLoad)
 		{
 			ManTex->WaitForLoad();
+			s_Cache.Release(ManTex);
 			return *ManTex;
 		}
 
-		uint32_t BlackPixel = 0;
-		ManTex->Create(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &BlackPixel);
+		ManTex->Create(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &Pixel);
+		s_Cache.FinishLoad(ManTex);
 		return *ManTex;
 	}
 
-	const Texture& GetWhiteTex2D(void)
+	const Texture& GetBlackTex2D(void)
 	{
-		auto ManagedTex = FindOrLoadTexture(L"DefaultWhiteTexture");
-
-		ManagedTexture* ManTex = ManagedTex.first;
-		const bool RequestsLoad = ManagedTex.second;
-
-		if (!RequestsLoad)
-		{
-			ManTex->WaitForLoad();
-			return *ManTex;
-		}
+		return GetDefaultTexture(L"DefaultBlackTexture", 0);
+	}
 
-		uint32_t WhitePixel = ~0;
-		ManTex->Create(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &WhitePixel);
-		return *ManTex;
+	const Texture& GetWhiteTex2D(void)
+	{
+		return GetDefaultTexture(L"DefaultWhiteTexture", ~0u);
 	}
 
 	const Texture& GetMagentaTex2D(void)
 	{
-		auto ManagedTex = FindOrLoadTexture(L"DefaultMagentaTexture");
-
-		ManagedTexture* ManTex = ManagedTex.first;
-		const bool RequestsLoad = ManagedTex.second;
+		return GetDefaultTexture(L"DefaultMagentaTexture", 0x00FF00FF);
+	}
 
-		if (!RequestsLoad)
-		{
-			ManTex->WaitForLoad();
-			return *ManTex;
-		}
+	TextureRef::TextureRef( const TextureRef& Ref ) : m_Texture(Ref.m_Texture)
+	{
+		if (m_Texture != nullptr)
+			s_Cache.AddRef(m_Texture);
+	}
 
-		uint32_t MagentaPixel = 0x00FF00FF;
-		ManTex->Create(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &MagentaPixel);
-		return *ManTex;
+	TextureRef::~TextureRef()
+	{
+		if (m_Texture != nullptr)
+			s_Cache.Release(m_Texture);
 	}
 
 } // namespace TextureManager
 
+ManagedTexture::ManagedTexture( const std::wstring& FileName )
+	: m_MapKey(FileName), m_KeyHash(0), m_IsValid(true), m_IsLoading(false), m_UnloadWhenUnused(false)
+	, m_RefCount(0), m_ResidentSize(0), m_LastRelease(0), m_LruPrev(nullptr), m_LruNext(nullptr)
+{
+}
+
 void ManagedTexture::WaitForLoad( void ) const
 {
-	volatile D3D12_CPU_DESCRIPTOR_HANDLE& VolHandle = (volatile D3D12_CPU_DESCRIPTOR_HANDLE&)m_hCpuDescriptorHandle;
-	volatile bool& VolValid = (volatile bool&)m_IsValid;
-	while (VolHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN && VolValid)
-		this_thread::yield();
+	TextureManager::s_Cache.Wait(this);
+}
+
+void ManagedTexture::Unload( void )
+{
+	TextureManager::s_Cache.Unload(this);
 }
 
 void ManagedTexture::SetToInvalidTexture( void )
 {
+	// the load may have allocated a descriptor before it failed
+	if (m_IsValid && m_hCpuDescriptorHandle.ptr != D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+		TextureManager::s_Cache.RecycleDescriptor(m_hCpuDescriptorHandle);
+
 	m_hCpuDescriptorHandle = TextureManager::GetMagentaTex2D().GetSRV();
 	m_IsValid = false;
 }
 
-const ManagedTexture* TextureManager::LoadFromFile( const std::wstring& fileName, bool sRGB )
+TextureManager::TextureRef TextureManager::LoadFromFile( const std::wstring& fileName, bool sRGB )
 {
 	std::wstring CatPath = fileName;
 
-	const ManagedTexture* Tex = LoadDDSFromFile( CatPath + L".dds", sRGB );
+	TextureRef Tex = LoadDDSFromFile( CatPath + L".dds", sRGB );
 	if (!Tex->IsValid())
 		Tex = LoadTGAFromFile( CatPath + L".tga", sRGB );
 
 	return Tex;
 }
 
-const ManagedTexture* TextureManager::LoadDDSFromFile( const std::wstring& fileName, bool sRGB )
+TextureManager::TextureRef TextureManager::LoadDDSFromFile( const std::wstring& fileName, bool sRGB )
 {
-	auto ManagedTex = FindOrLoadTexture(fileName);
+	auto ManagedTex = s_Cache.FindOrCreate(fileName);
 
 	ManagedTexture* ManTex = ManagedTex.first;
 	const bool RequestsLoad = ManagedTex.second;
@@ -256,21 +623,22 @@ const ManagedTexture* TextureManager::LoadDDSFromFile( const std::wstring& fileN
 	if (!RequestsLoad)
 	{
 		ManTex->WaitForLoad();
-		return ManTex;
+		return TextureCache::Adopt(ManTex);
 	}
 
-	Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
+	Utility::ByteArray ba = ReadTextureFile( fileName );
 	if (ba->size() == 0 || !ManTex->CreateDDSFromMemory( ba->data(), ba->size(), sRGB ))
 		ManTex->SetToInvalidTexture();
 	else
 		ManTex->GetResource()->SetName(fileName.c_str());
 
-	return ManTex;
+	s_Cache.FinishLoad(ManTex);
+	return TextureCache::Adopt(ManTex);
 }
 
-const ManagedTexture* TextureManager::LoadTGAFromFile( const std::wstring& fileName, bool sRGB )
+TextureManager::TextureRef TextureManager::LoadTGAFromFile( const std::wstring& fileName, bool sRGB )
 {
-	auto ManagedTex = FindOrLoadTexture(fileName);
+	auto ManagedTex = s_Cache.FindOrCreate(fileName);
 
 	ManagedTexture* ManTex = ManagedTex.first;
 	const bool RequestsLoad = ManagedTex.second;
@@ -278,10 +646,10 @@ const ManagedTexture* TextureManager::LoadTGAFromFile( const std::wstring& fileN
 	if (!RequestsLoad)
 	{
 		ManTex->WaitForLoad();
-		return ManTex;
+		return TextureCache::Adopt(ManTex);
 	}
 
-	Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
+	Utility::ByteArray ba = ReadTextureFile( fileName );
 	if (ba->size() > 0)
 	{
 		ManTex->CreateTGAFromMemory( ba->data(), ba->size(), sRGB );
@@ -290,5 +658,6 @@ const ManagedTexture* TextureManager::LoadTGAFromFile( const std::wstring& fileN
 	else
 		ManTex->SetToInvalidTexture();
 
-	return ManTex;
+	s_Cache.FinishLoad(ManTex);
+	return TextureCache::Adopt(ManTex);
 }
@@ -48,14 +48,24 @@ protected:
 	D3D12_CPU_DESCRIPTOR_HANDLE m_hCpuDescriptorHandle;
 };
 
+namespace TextureManager
+{
+	class TextureCache;
+}
+
 class ManagedTexture : public Texture
 {
+	friend class TextureManager::TextureCache;
+
 public:
-	ManagedTexture( const std::wstring& FileName ) : m_MapKey(FileName), m_IsValid(true) {}
+	ManagedTexture( const std::wstring& FileName );
 
 	void operator= ( const Texture& Texture );
 
+	// Blocks until whoever is loading the texture has finished
 	void WaitForLoad(void) const;
+
+	// Evicts the texture as soon as nothing references it, rather than when it's the least recently used
 	void Unload(void);
 
 	void SetToInvalidTexture(void);
@@ -63,29 +73,81 @@ public:
 
 private:
 	std::wstring m_MapKey;		// For deleting from the map later
+	uint64_t m_KeyHash;
 	bool m_IsValid;
+
+	// the rest belong to the texture's cache shard and are only touched under its lock
+	bool m_IsLoading;
+	bool m_UnloadWhenUnused;
+	uint32_t m_RefCount;
+	size_t m_ResidentSize;		// bytes of video memory, counted once the load finishes
+	uint64_t m_LastRelease;		// when the last reference went, to compare textures in different shards
+	ManagedTexture* m_LruPrev;	// unreferenced textures, least recently released first
+	ManagedTexture* m_LruNext;
 };
 
 namespace TextureManager
 {
+	// Keeps a texture from being evicted for as long as any copy of it exists
+	class TextureRef
+	{
+	public:
+		TextureRef() : m_Texture(nullptr) {}
+		TextureRef( const TextureRef& Ref );
+		TextureRef( TextureRef&& Ref ) : m_Texture(Ref.m_Texture) { Ref.m_Texture = nullptr; }
+		~TextureRef();
+
+		TextureRef& operator=( TextureRef Ref )
+		{
+			std::swap(m_Texture, Ref.m_Texture);
+			return *this;
+		}
+
+		const ManagedTexture* Get(void) const { return m_Texture; }
+		const ManagedTexture* operator->(void) const { return m_Texture; }
+		bool IsValid(void) const { return m_Texture != nullptr && m_Texture->IsValid(); }
+
+	private:
+		friend class TextureCache;
+
+		// takes over a reference the cache already added
+		explicit TextureRef( ManagedTexture* Texture ) : m_Texture(Texture) {}
+
+		ManagedTexture* m_Texture;
+	};
+
 	void Initialize( const std::wstring& TextureLibRoot );
 	void Shutdown(void);
 
-	const ManagedTexture* LoadFromFile( const std::wstring& fileName, bool sRGB = false );
-	const ManagedTexture* LoadDDSFromFile( const std::wstring& fileName, bool sRGB = false );
-	const ManagedTexture* LoadTGAFromFile( const std::wstring& fileName, bool sRGB = false );
+	// Unreferenced textures are evicted, least recently released first, while the textures in video memory
+	// add up to more than the budget.  Referenced textures are never evicted, whatever the budget.
+	void SetMemoryBudget( size_t Bytes );
+	size_t GetResidentBytes(void);
+
+	TextureRef LoadFromFile( const std::wstring& fileName, bool sRGB = false );
+	TextureRef LoadDDSFromFile( const std::wstring& fileName, bool sRGB = false );
+	TextureRef LoadTGAFromFile( const std::wstring& fileName, bool sRGB = false );
+
+	// Starts reading the file LoadFromFile would try first, so a batch of textures can be read in parallel
+	// ahead of loading them one by one.
+	void PrefetchFromFile( const std::wstring& fileName );
+
+	inline void PrefetchFromFile( const std::string& fileName )
+	{
+		PrefetchFromFile(MakeWStr(fileName));
+	}
 
-	inline const ManagedTexture* LoadFromFile( const std::string& fileName, bool sRGB = false )
+	inline TextureRef LoadFromFile( const std::string& fileName, bool sRGB = false )
 	{
 		return LoadFromFile(MakeWStr(fileName), sRGB);
 	}
 
-	inline const ManagedTexture* LoadDDSFromFile( const std::string& fileName, bool sRGB = false )
+	inline TextureRef LoadDDSFromFile( const std::string& fileName, bool sRGB = false )
 	{
 		return LoadDDSFromFile(MakeWStr(fileName), sRGB);
 	}
 
-	inline const ManagedTexture* LoadTGAFromFile( const std::string& fileName, bool sRGB = false )
+	inline TextureRef LoadTGAFromFile( const std::string& fileName, bool sRGB = false )
 	{
 		return LoadTGAFromFile(MakeWStr(fileName), sRGB);
 	}
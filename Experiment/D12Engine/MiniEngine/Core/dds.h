@@ -29,6 +29,11 @@
 #include <stdint.h>
 #pragma warning(pop)
 
+// DDSLayout builds off Windows too, where a weak symbol is what keeps one copy of each constant below
+#if !defined(_MSC_VER) && !defined(__declspec)
+#define __declspec(spec) __attribute__((weak))
+#endif
+
 namespace DirectX
 {
 
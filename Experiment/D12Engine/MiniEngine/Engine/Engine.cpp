@@ -17,9 +17,16 @@
 #include "ShadowCamera.h"
 #include "ParticleEffectManager.h"
 #include "GameInput.h"
+#include "AssetPack.h"
 #include "Physics/Engine/physicsEngine.h"
+#include "Physics/Hull/physicsHull.h"
+#include "Physics/Mesh/physicsMesh.h"
+#include "Dav/memory/memory.h"
+#include "Dav/occlusion/occlusion.h"
+#include <algorithm>
 #include <array>
 #include <vector>
+#include <ppl.h>
 
 #include "CompiledShaders/DepthViewerVS.h"
 #include "CompiledShaders/DepthViewerPS.h"
@@ -37,6 +44,7 @@ class Engine : public GameCore::IGameApp
 public:
     Engine()
         : m_pCameraController( nullptr )
+        , m_OcclusionBuffer( kOcclusionWidth, kOcclusionHeight )
         , m_OriginalModel( Matrix4( Vector3( 1.0f, 0.0f, 0.0f ), Vector3( 0.0f, 1.0f, 0.0f ), Vector3( 0.0f, 0.0f, 1.0f ), Vector3( 1000.0f, 0.0f, 2000.0f ) ) )
         , m_NewModel( Matrix4( kIdentity ) )
         , m_newPhysicsObjectUID( PHYSICS_OBJECT_NULL_UID )
@@ -54,12 +62,13 @@ public:
     virtual void RenderScene( void ) override;
 
 private:
-    void RenderObjects( const Model& model, GraphicsContext& gfxContext, const Matrix4& ViewProjMat );
+    void CullObjects( const Model& model, const BaseCamera& camera, std::vector<uint32_t>& visibleMeshes );
+    void OccludeObjects( const Model* const models[] );
+    void RenderObjects( const Model& model, const std::vector<uint32_t>& visibleMeshes, GraphicsContext& gfxContext, const BaseCamera& camera, bool cullBackFacing );
 
     void CreateParticleEffects();
     Camera m_Camera;
     CameraController* m_pCameraController;
-    Matrix4 m_ViewProjMatrix;
     D3D12_VIEWPORT m_MainViewport;
     D3D12_RECT m_MainScissor;
 
@@ -70,6 +79,16 @@ private:
     GraphicsPSO m_PhysicsPSO;
 
     D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[2];
+    enum { kModelCount = 4 };
+
+    // the meshes of each model that pass the frustum cull, culled once per camera and shared by its passes
+    std::vector<uint32_t> m_MainVisibleMeshes[kModelCount];
+    std::vector<uint32_t> m_ShadowVisibleMeshes[kModelCount];
+
+    // the models' occluders drawn from the main camera, to take meshes hidden behind them out of m_MainVisibleMeshes
+    enum { kOcclusionWidth = 320, kOcclusionHeight = 192 };
+    Dav::OcclusionBuffer m_OcclusionBuffer;
+
     Model m_OriginalModel;
     Model m_NewModel;
     int m_newPhysicsObjectUID;
@@ -81,7 +100,7 @@ private:
     Vector3 m_SunDirection;
     ShadowCamera m_SunShadow;
 
-    int createPhysicsObject( const Model& model, bool infiniteMass );
+    int createPhysicsObject( const Model& model, const char* hullFilename, bool infiniteMass );
     Physics::EngineClass m_physicsEngine;
 };
 
@@ -94,6 +113,8 @@ NumVar m_SunInclination("Application/Sun Inclination", 0.75f, 0.0f, 1.0f, 0.01f
 NumVar ShadowDimX("Application/Shadow Dim X", 5000, 1000, 10000, 100 );
 NumVar ShadowDimY("Application/Shadow Dim Y", 3000, 1000, 10000, 100 );
 NumVar ShadowDimZ("Application/Shadow Dim Z", 3000, 1000, 10000, 100 );
+NumVar LodErrorPixels("Application/LOD Error Pixels", 1.0f, 0.0f, 16.0f, 0.25f );
+BoolVar OcclusionCulling("Application/Occlusion Culling", true);
 
 const Vector4 g_accelerationDueToGravity( 0.0f, -9.8f, 0.0f, 0.0f );
 bool g_applyGravity = true;
@@ -104,7 +125,7 @@ const Vector4  g_force0ApplicationPositionLocalSpace( -4.0f, 1.0f, 0.0, 1.0f );
 const Vector4 g_force1LocalSpace( 0.0f, -80.0f, 0.0f, 0.0f );
 const Vector4 g_force1ApplicationPositionLocalSpace( 4.0f, 1.0f, 0.0, 1.0f );
 
-int Engine::createPhysicsObject( const Model& model, const bool infiniteMass )
+int Engine::createPhysicsObject( const Model& model, const char* const hullFilename, const bool infiniteMass )
 {
     const float mass = 1.0f;
 
@@ -129,244 +150,46 @@ int Engine::createPhysicsObject( const Model& model, const bool infiniteMass )
     Physics::Object::Edges edges;
     Physics::Object::Triangles triangles;
 
-    if( model.m_pVertexData && model.m_pIndexData )
+    // Objects are a single convex shape, so use the whole model's hull when the model converter has cached one.
+    // The engine has no compound bodies yet, and separate objects for the decomposition's pieces would neither stay
+    // together nor keep out of each other, so the pieces aren't used until it does.
+    Physics::ConvexDecomposition decomposition;
+    if( hullFilename && decomposition.load( hullFilename ) && !decomposition.hull().empty() )
     {
-        const int numVertices = model.m_Header.vertexDataByteSize / model.m_VertexStride;
-        const int numIndices = model.m_Header.indexDataByteSize / sizeof( uint16_t );
-
-        std::vector< Vector4 > optimisedVertices;
-        const uint8_t *p = ( uint8_t* )( model.m_pVertexData );
-        for( int iVert = 0; iVert != numVertices; ++iVert, p += model.m_VertexStride )
-        {
-            struct Position { float posX, posY, posZ; };
-            const Position* pPos = ( const Position* )p;
-
-            optimisedVertices.push_back( Vector4( pPos->posX, pPos->posY, pPos->posZ, 1.0f ) );
-        }
+        const Physics::ConvexHull& hull = decomposition.hull();
 
-        std::vector< uint16_t > optimisedIndices;
-        for( int iIndex = 0; iIndex != numIndices; ++iIndex, p += model.m_VertexStride )
-        {
-            const uint16_t index = ( ( const uint16_t* )( model.m_pIndexData ) )[ iIndex ];
-            assert( index < numVertices );
-            optimisedIndices.push_back( index );
-        }
+        Physics::MeshBuilder meshBuilder( 0.001f );
+        meshBuilder.addMesh(
+            ( const uint8_t* )hull.positions().data(),
+            sizeof( DirectX::XMFLOAT3 ),
+            ( uint32_t )hull.positions().size(),
+            hull.triangleVertexIndices().data(),
+            ( uint32_t )hull.triangleVertexIndices().size() );
 
-        // Find and remove duplicates
-        if( optimisedVertices.size() > 1 )
-        {
-            for( int iVertA = 0; iVertA < ( optimisedVertices.size() - 1 ); ++iVertA )
-            {
-                const Vector4& vertA = optimisedVertices[ iVertA ];
-
-                int iVertB = iVertA + 1;
-                while( iVertB < optimisedVertices.size() )
-                {
-                    const Vector4& vertB = optimisedVertices[ iVertB ];
-                    const Vector4 diff = vertB - vertA;
-
-                    const float maxDiff = 0.001f;
-                    if( ( fabsf( diff.GetX() ) < maxDiff ) &&
-                        ( fabsf( diff.GetY() ) < maxDiff ) &&
-                        ( fabsf( diff.GetZ() ) < maxDiff ) &&
-                        ( fabsf( diff.GetW() ) < maxDiff ) )
-                    {
-                        auto itr = optimisedVertices.begin();
-                        std::advance( itr, iVertB );
-                        optimisedVertices.erase( itr );
-
-                        for( uint16_t& index : optimisedIndices )
-                        {
-                            if( index == iVertB )
-                            {
-                                index = iVertA;
-                            }
-                            else if( index > iVertB )
-                            {
-                                --index;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        ++iVertB;
-                    }
-                }
-            }
-        }
+        meshBuilder.build( vertices, edges, triangles );
+    }
+    else if( model.m_pVertexData && model.m_pIndexData )
+    {
+        // Welds the split vertices of the render meshes back together so the physics mesh is closed
+        Physics::MeshBuilder meshBuilder( 0.001f );
 
-        for( uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+        for( uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++ )
         {
-            assert( meshIndex == 0 ); // We don't handle models with more than one mesh. We've optimized the set of vertices so we need to handle each mesh's vertex index start.
-            const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+            const Model::Mesh& mesh = model.m_pMesh[ meshIndex ];
 
-            for( const Vector4& vertex : optimisedVertices )
+            const uint8_t* positionData = model.m_pVertexData + mesh.vertexDataByteOffset + mesh.attrib[ Model::attrib_position ].offset;
+            const unsigned char* indexData = model.m_pIndexData + mesh.indexDataByteOffset;
+            if( mesh.indexStride == sizeof( uint32_t ) )
             {
-                vertices.push_back( Physics::Vertex( vertex, DirectX::XMVECTOR{ 0.0f, 1.0f, 0.0f, 0.0f } ) );
+                meshBuilder.addMesh( positionData, mesh.vertexStride, mesh.vertexCount, ( const uint32_t* )indexData, mesh.indexCount );
             }
-            
-            const uint16_t* const pMeshVertexIndex = ( const uint16_t* )( &optimisedIndices[ mesh.indexDataByteOffset / sizeof( uint16_t ) ] );
-            for( uint32_t iTriangleMeshVertexIndex = 0; iTriangleMeshVertexIndex < mesh.indexCount; iTriangleMeshVertexIndex += 3 )
+            else
             {
-                std::array< Vector3, 3 > edgeDirs;
-                std::array< int, 3 > edgeIndices;
-
-                for( int iEdge = 0; iEdge != 3; ++iEdge )
-                {
-                    const int fromVertexIndex = pMeshVertexIndex[ iTriangleMeshVertexIndex + iEdge ];
-                    const int toVertexIndex = pMeshVertexIndex[ iTriangleMeshVertexIndex + ( ( iEdge == 2 ) ? 0 : ( iEdge + 1 ) ) ];
-                    assert( fromVertexIndex < vertices.size() );
-                    assert( toVertexIndex < vertices.size() );
-
-                    edgeDirs[ iEdge ] = Vector3( vertices[ toVertexIndex ].position() - vertices[ fromVertexIndex ].position() );
-
-                    // Search existing edges in case this one already exists
-                    const Physics::Object::Edges::iterator edgeItr = find_if( edges.begin(), edges.end(),
-                        [&]( const Physics::Edge& edge )
-                        {
-                            assert( edge.vertexIndices().size() == 2 );
-                            return ( ( fromVertexIndex == edge.vertexIndices()[ 0 ] ) && ( toVertexIndex == edge.vertexIndices()[ 1 ] ) ) ||
-                                   ( ( fromVertexIndex == edge.vertexIndices()[ 1 ] ) && ( toVertexIndex == edge.vertexIndices()[ 0 ] ) );
-                        } );
-                    if( edgeItr != edges.end() )
-                    {
-                        edgeIndices[ iEdge ] = ( int )( edgeItr - edges.begin() );
-                        edgeItr->addTriangleIndex( ( int )triangles.size() );
-                    }
-                    else
-                    {
-                        edges.push_back( Physics::Edge( DirectX::XMVECTOR{ 0.0f, 1.0f, 0.0f, 0.0f } ) );
-                        edges.back().addVertexIndex( fromVertexIndex );
-                        edges.back().addVertexIndex( toVertexIndex );
-                        edges.back().addTriangleIndex( ( int )triangles.size() );
-
-                        const int edgeIndex = ( int )( edges.size() - 1 );
-                        vertices[ toVertexIndex ].addEdgeIndex( edgeIndex );
-                        vertices[ fromVertexIndex ].addEdgeIndex( edgeIndex );
-                        edgeIndices[ iEdge ] = edgeIndex;
-                    }
-                }
-
-                const Vector3 triangleNorm = Normalize( Cross( edgeDirs[ 0 ], edgeDirs[ 1 ] ) );
-                triangles.push_back( Physics::Triangle( DirectX::XMVECTOR{ triangleNorm.GetX(), triangleNorm.GetY(), triangleNorm.GetZ(), 0.0f } ) );
-
-                triangles.back().addVertexIndex( ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 0 ] );
-                vertices[ ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 0 ] ].addTriangleIndex( ( int )( triangles.size() - 1 ) );
-                triangles.back().addVertexIndex( ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 1 ] );
-                vertices[ ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 1 ] ].addTriangleIndex( ( int )( triangles.size() - 1 ) );
-                triangles.back().addVertexIndex( ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 2 ] );
-                vertices[ ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 2 ] ].addTriangleIndex( ( int )( triangles.size() - 1 ) );
-
-                for( const int edgeIndex : edgeIndices )
-                {
-                    triangles.back().addEdgeIndex( edgeIndex );
-                }
-            }
-
-            // loop over all edges and average normals of tris
-            for( Physics::Edge& edge : edges )
-            {
-                assert( edge.triangleIndices().size() == 2 );
-                assert( edge.triangleIndices()[ 0 ] < triangles.size() );
-                assert( edge.triangleIndices()[ 1 ] < triangles.size() );
-                
-                Vector4 averageNormal = 
-                    Vector4( triangles[ edge.triangleIndices()[ 0 ] ].normal() ) +
-                    Vector4( triangles[ edge.triangleIndices()[ 1 ] ].normal() );
-                averageNormal /= 2.0f;
-                averageNormal = Vector4( DirectX::XMVector4Normalize( averageNormal ) );
-                edge.setNormal( averageNormal );
-            }
-
-            // loop over all verts and average all norms of tris
-            for( Physics::Vertex& vertex : vertices )
-            {
-                assert( vertex.triangleIndices().size() >= 3 );
-
-                Dav::Vector< DirectX::XMVECTOR, 8 > normals;
-                for( const int triangleIndex : vertex.triangleIndices() )
-                {
-                    assert( triangleIndex < ( int )triangles.size() );
-                    normals.push_back( triangles[ triangleIndex ].normal() );
-                }
-
-                normals.erase( unique( normals.begin(), normals.end(), []( const DirectX::XMVECTOR& lhs, const DirectX::XMVECTOR& rhs )
-                {
-                    return DirectX::XMVector4NearEqual( lhs, rhs, DirectX::XMVECTOR{ FLT_EPSILON, FLT_EPSILON, FLT_EPSILON, FLT_EPSILON } );
-                } ), normals.end() );
-                assert( !normals.empty() );
-
-                Vector4 averageNormal( 0.0f, 0.0f, 0.0f, 0.0f );
-                for( const DirectX::XMVECTOR& normal : normals )
-                {
-                    averageNormal = Vector4( DirectX::XMVectorAdd( averageNormal, normal ) );
-                }
-
-                averageNormal /= ( float )normals.size();
-                averageNormal = Vector4( DirectX::XMVector4Normalize( averageNormal ) );
-                vertex.setNormal( averageNormal );
+                meshBuilder.addMesh( positionData, mesh.vertexStride, mesh.vertexCount, ( const uint16_t* )indexData, mesh.indexCount );
             }
         }
 
-        
-
-        //for( uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
-        //{
-        //    const Model::Mesh& mesh = model.m_pMesh[meshIndex];
-
-        //    const uint8_t *p = (uint8_t*)( model.m_pVertexData + mesh.vertexDataByteOffset + mesh.attrib[ Model::attrib_position ].offset );
-        //    const uint8_t *n = (uint8_t*)( model.m_pVertexData + mesh.vertexDataByteOffset + mesh.attrib[ Model::attrib_normal ].offset );
-        //    for( uint32_t vertexIndex = 0; vertexIndex != mesh.vertexCount; ++vertexIndex, p += model.m_VertexStride, n += model.m_VertexStride )
-        //    {
-        //        struct Position { float posX, posY, posZ; };
-        //        struct Normal { float normX, normY, normZ; };
-        //        const Position* pPos = ( const Position* )p;
-        //        const Normal* pNorm = ( const Normal* )n;
-
-        //        vertices.push_back( Physics::Vertex(
-        //            DirectX::XMVECTOR{ pPos->posX, pPos->posY, pPos->posZ, 1.0f },
-        //            DirectX::XMVECTOR{ pNorm->normX, pNorm->normY, pNorm->normZ, 0.0f } ) );
-        //    }
-
-        //    const uint16_t* const pMeshVertexIndex = ( const uint16_t* )( model.m_pIndexData + mesh.indexDataByteOffset );
-        //    for( uint32_t iTriangleMeshVertexIndex = 0; iTriangleMeshVertexIndex < mesh.indexCount; iTriangleMeshVertexIndex += 3 )
-        //    {
-        //        std::array< Vector3, 3 > edgeDirs;
-
-        //        for( int iEdge = 0; iEdge != 3; ++iEdge )
-        //        {
-        //            const int fromVertexIndex = pMeshVertexIndex[ iTriangleMeshVertexIndex + iEdge ];
-        //            const int toVertexIndex = pMeshVertexIndex[ iTriangleMeshVertexIndex + ( ( iEdge == 2 ) ? 0 : ( iEdge + 1 ) ) ];
-        //            assert( fromVertexIndex < vertices.size() );
-        //            assert( toVertexIndex < vertices.size() );
-
-        //            edgeDirs[ iEdge ] = Vector3(
-        //                vertices[ toVertexIndex ].position() - 
-        //                vertices[ fromVertexIndex ].position() );
-        //            
-        //            const Vector3 norm = 
-        //                Vector3( vertices[ fromVertexIndex ].normal() ) +
-        //                ( ( Vector3( vertices[ toVertexIndex ].normal() ) - Vector3( vertices[ fromVertexIndex ].normal() ) ) / 2.0f );
-
-        //            edges.push_back( Physics::Edge( DirectX::XMVECTOR{ norm.GetX(), norm.GetY(), norm.GetZ(), 0.0f } ) );
-        //            edges.back().addVertexIndex( fromVertexIndex );
-        //            edges.back().addVertexIndex( toVertexIndex );
-        //            edges.back().addTriangleIndex( ( int )triangles.size() );
-
-        //        }
-
-        //        const Vector3 triangleNorm = Normalize( Cross( edgeDirs[ 0 ], edgeDirs[ 1 ] ) );
-        //        triangles.push_back( Physics::Triangle( DirectX::XMVECTOR{ triangleNorm.GetX(), triangleNorm.GetY(), triangleNorm.GetZ(), 0.0f } ) );
-
-        //        triangles.back().addVertexIndex( ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 0 ] );
-        //        triangles.back().addVertexIndex( ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 1 ] );
-        //        triangles.back().addVertexIndex( ( int )pMeshVertexIndex[ iTriangleMeshVertexIndex + 2 ] );
-
-        //        triangles.back().addEdgeIndex( ( int )edges.size() - 1 );
-        //        triangles.back().addEdgeIndex( ( int )edges.size() - 2 );
-        //        triangles.back().addEdgeIndex( ( int )edges.size() - 3 );
-        //    }
-        //}
+        meshBuilder.build( vertices, edges, triangles );
     }
 
     return m_physicsEngine.createObject( mass, infiniteMass, centerOfMassLocalPosition,
@@ -444,6 +267,9 @@ void Engine::Startup( void )
     m_ExtraTextures[0] = g_SSAOFullScreen.GetSRV();
     m_ExtraTextures[1] = g_ShadowBuffer.GetSRV();
 
+    // a pack built with "AssetPacker Assets.pak Models Textures Fonts" replaces the loose files entirely
+    Utility::MountAssetPack( L"Assets.pak", false );
+
     TextureManager::Initialize(L"Textures/");
     ASSERT(m_OriginalModel.Load("Models/sponza.h3d"), "Failed to load model");
     ASSERT(m_OriginalModel.m_Header.meshCount > 0, "Model contains no meshes");
@@ -461,9 +287,9 @@ void Engine::Startup( void )
     const Matrix4 cylinderTransformation( OrthogonalTransform( Vector3( 500.0f, 1000.0f, 500.0f ) ) );
     m_CylinderModel.setTransformation( cylinderTransformation );
 
-    m_newPhysicsObjectUID = createPhysicsObject( m_NewModel, false );
-    m_floorPhysicsObjectUID = createPhysicsObject( m_FloorModel, true );
-    m_cylinderPhysicsObjectUID = createPhysicsObject( m_CylinderModel, false );
+    m_newPhysicsObjectUID = createPhysicsObject( m_NewModel, "Models/torus.hull", false );
+    m_floorPhysicsObjectUID = createPhysicsObject( m_FloorModel, "Models/floor.hull", true );
+    m_cylinderPhysicsObjectUID = createPhysicsObject( m_CylinderModel, "Models/cylinder.hull", false );
 
     CreateParticleEffects();
 
@@ -497,6 +323,8 @@ void Engine::Cleanup( void )
     m_NewModel.Clear();
     m_OriginalModel.Clear();
 
+    Utility::UnmountAssetPacks();
+
     delete m_pCameraController;
     m_pCameraController = nullptr;
 
@@ -512,13 +340,15 @@ void Engine::Update( float deltaT )
 {
     ScopedTimer _prof(L"Update State");
 
+    // Anything allocated from the frame arena two frames ago is free again
+    Dav::FrameArena::nextFrame();
+
     if (GameInput::IsFirstPressed(GameInput::kLShoulder))
         DebugZoom.Decrement();
     else if (GameInput::IsFirstPressed(GameInput::kRShoulder))
         DebugZoom.Increment();
 
     m_pCameraController->Update(deltaT);
-    m_ViewProjMatrix = m_Camera.GetViewProjMatrix();
 
     float costheta = cosf(m_SunOrientation);
     float sintheta = sinf(m_SunOrientation);
@@ -615,7 +445,62 @@ void Engine::Update( float deltaT )
 
 }
 
-void Engine::RenderObjects( const Model& model, GraphicsContext& gfxContext, const Matrix4& ViewProjMat )
+void Engine::CullObjects( const Model& model, const BaseCamera& camera, std::vector<uint32_t>& visibleMeshes )
+{
+    const Frustum frustum = Invert( model.transformation() ) * camera.GetWorldSpaceFrustum();
+    visibleMeshes.resize( model.m_Header.meshCount );
+    visibleMeshes.resize( model.CullMeshes( frustum, visibleMeshes.data() ) );
+}
+
+void Engine::OccludeObjects( const Model* const models[] )
+{
+    m_OcclusionBuffer.begin( m_Camera.GetNearClip() );
+
+    // an occluder is only worth drawing if its own mesh is in view
+    XMMATRIX modelToClip[kModelCount];
+    bool anyOccluders = false;
+    for (int i = 0; i < kModelCount; ++i)
+    {
+        const Model& model = *models[i];
+        const std::vector<uint32_t>& visibleMeshes = m_MainVisibleMeshes[i];
+        modelToClip[i] = m_Camera.GetViewProjMatrix() * model.transformation();
+
+        for (uint32_t occluderIndex = 0; occluderIndex < model.m_OccluderCount; ++occluderIndex)
+        {
+            if (!std::binary_search( visibleMeshes.begin(), visibleMeshes.end(), model.m_pOccluder[occluderIndex].meshIndex ))
+                continue;
+
+            const Model::OccluderGeometry& geometry = model.m_pOccluderGeometry[occluderIndex];
+            m_OcclusionBuffer.addOccluder( modelToClip[i], model.m_pOccluderPositions + geometry.firstPosition, geometry.positionCount,
+                model.m_pOccluderIndices + geometry.firstIndex, geometry.indexCount );
+            anyOccluders = true;
+        }
+    }
+
+    if (!anyOccluders)
+        return;
+
+    concurrency::parallel_for( 0, m_OcclusionBuffer.tileCount(), [&]( int tile )
+    {
+        m_OcclusionBuffer.rasterizeTile( tile );
+    } );
+
+    // every pass that draws from the main camera shares the lists, so hidden meshes cost neither submission nor vertex work
+    for (int i = 0; i < kModelCount; ++i)
+    {
+        const Model& model = *models[i];
+        std::vector<uint32_t>& visibleMeshes = m_MainVisibleMeshes[i];
+        visibleMeshes.erase( std::remove_if( visibleMeshes.begin(), visibleMeshes.end(), [&]( uint32_t meshIndex )
+        {
+            XMFLOAT3 boxMin, boxMax;
+            XMStoreFloat3( &boxMin, model.m_pMesh[meshIndex].boundingBox.min );
+            XMStoreFloat3( &boxMax, model.m_pMesh[meshIndex].boundingBox.max );
+            return !m_OcclusionBuffer.isVisible( modelToClip[i], boxMin, boxMax );
+        } ), visibleMeshes.end() );
+    }
+}
+
+void Engine::RenderObjects( const Model& model, const std::vector<uint32_t>& visibleMeshes, GraphicsContext& gfxContext, const BaseCamera& camera, bool cullBackFacing )
 {
     struct VSConstants
     {
@@ -624,7 +509,7 @@ void Engine::RenderObjects( const Model& model, GraphicsContext& gfxContext, con
         XMFLOAT3 viewerPos;
     } vsConstants;
 
-    vsConstants.modelToProjection = ViewProjMat * model.transformation();
+    vsConstants.modelToProjection = camera.GetViewProjMatrix() * model.transformation();
 
     vsConstants.modelToShadow = m_SunShadow.GetShadowMatrix() * model.transformation();
     XMStoreFloat3(&vsConstants.viewerPos, m_Camera.GetPosition());
@@ -634,16 +519,26 @@ void Engine::RenderObjects( const Model& model, GraphicsContext& gfxContext, con
     gfxContext.SetIndexBuffer(model.m_IndexBuffer.IndexBufferView());
     gfxContext.SetVertexBuffer(0, model.m_VertexBuffer.VertexBufferView());
 
+    // cull meshlets in model space, the model transforms are rigid so the planes stay normalized
+    const Matrix4 worldToModel = Invert( model.transformation() );
+    const Frustum frustum = worldToModel * camera.GetWorldSpaceFrustum();
+    const Vector3 viewerPosition = Vector3( worldToModel * camera.GetPosition() );
+
+    // lods are picked from the main camera in every pass, the color pass has to match the depth prepass exactly
+    const Vector3 lodViewerPosition = Vector3( worldToModel * m_Camera.GetPosition() );
+    const float pixelsPerUnitAtUnitDistance = m_MainViewport.Height * 0.5f / tanf( m_Camera.GetFOV() * 0.5f );
+
     uint32_t materialIdx = 0xFFFFFFFFul;
 
     uint32_t VertexStride = model.m_VertexStride;
 
-    for (unsigned int meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+    for (uint32_t meshIndex : visibleMeshes)
     {
         const Model::Mesh& mesh = model.m_pMesh[meshIndex];
 
-        uint32_t indexCount = mesh.indexCount;
-        uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
+        const BoundingSphere& meshSphere = model.m_pMeshBoundingSphere[meshIndex];
+
+        uint32_t startIndex = mesh.indexDataByteOffset / mesh.indexStride;
         uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
 
         if (mesh.materialIndex != materialIdx)
@@ -652,7 +547,46 @@ void Engine::RenderObjects( const Model& model, GraphicsContext& gfxContext, con
             gfxContext.SetDynamicDescriptors(3, 0, 6, model.GetSRVs(materialIdx) );
         }
 
-        gfxContext.DrawIndexed(indexCount, startIndex, baseVertex);
+        // the bounding sphere's projected radius in pixels, and how much of that an lod may get wrong
+        const float meshRadius = meshSphere.GetRadius();
+        const float lodDistance = (float)Length( lodViewerPosition - meshSphere.GetCenter() ) - meshRadius;
+        if (lodDistance > 0.0f && meshRadius > 0.0f)
+        {
+            const float projectedRadius = meshRadius * pixelsPerUnitAtUnitDistance / lodDistance;
+            const Model::MeshLod* lod = model.SelectLod( meshIndex, LodErrorPixels * meshRadius / projectedRadius );
+            if (lod != nullptr)
+            {
+                gfxContext.DrawIndexed(lod->indexCount, lod->indexDataByteOffset / mesh.indexStride, baseVertex);
+                continue;
+            }
+        }
+
+        if (model.m_MeshletCount == 0)
+        {
+            gfxContext.DrawIndexed(mesh.indexCount, startIndex, baseVertex);
+            continue;
+        }
+
+        // meshlets are consecutive runs of the mesh's indices, so visible neighbours go out in one draw
+        uint32_t drawStart = 0;
+        uint32_t drawCount = 0;
+        for (uint32_t meshletIndex = model.m_pMeshFirstMeshlet[meshIndex]; meshletIndex < model.m_pMeshFirstMeshlet[meshIndex + 1]; meshletIndex++)
+        {
+            const Model::Meshlet& meshlet = model.m_pMeshlet[meshletIndex];
+            if (!Model::IsMeshletVisible( meshlet, frustum, cullBackFacing ? &viewerPosition : nullptr ))
+                continue;
+
+            if (drawCount > 0 && drawStart + drawCount != meshlet.indexOffset)
+            {
+                gfxContext.DrawIndexed(drawCount, startIndex + drawStart, baseVertex);
+                drawCount = 0;
+            }
+            if (drawCount == 0)
+                drawStart = meshlet.indexOffset;
+            drawCount += meshlet.indexCount;
+        }
+        if (drawCount > 0)
+            gfxContext.DrawIndexed(drawCount, startIndex + drawStart, baseVertex);
     }
 }
 
@@ -660,6 +594,12 @@ void Engine::RenderScene( void )
 {
     GraphicsContext& gfxContext = GraphicsContext::Begin(L"Scene Render");
 
+    const Model* const models[kModelCount] = { &m_OriginalModel, &m_NewModel, &m_FloorModel, &m_CylinderModel };
+    for (int i = 0; i < kModelCount; ++i)
+        CullObjects( *models[i], m_Camera, m_MainVisibleMeshes[i] );
+    if (OcclusionCulling)
+        OccludeObjects( models );
+
     ParticleEffects::Update(gfxContext.GetComputeContext(), Graphics::GetFrameTime());
 
     __declspec(align(16)) struct
@@ -688,10 +628,8 @@ void Engine::RenderScene( void )
         gfxContext.SetPipelineState(m_DepthPSO);
         gfxContext.SetDepthStencilTarget(g_SceneDepthBuffer.GetDSV());
         gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-        RenderObjects( m_OriginalModel, gfxContext, m_ViewProjMatrix );
-        RenderObjects( m_NewModel, gfxContext, m_ViewProjMatrix );
-        RenderObjects( m_FloorModel, gfxContext, m_ViewProjMatrix );
-        RenderObjects( m_CylinderModel, gfxContext, m_ViewProjMatrix );
+        for (int i = 0; i < kModelCount; ++i)
+            RenderObjects( *models[i], m_MainVisibleMeshes[i], gfxContext, m_Camera, true );
     }
 
     SSAO::Render(gfxContext, m_Camera);
@@ -719,13 +657,13 @@ void Engine::RenderScene( void )
 
             m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
                 (uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), 16);
+            for (int i = 0; i < kModelCount; ++i)
+                CullObjects( *models[i], m_SunShadow, m_ShadowVisibleMeshes[i] );
 
             gfxContext.SetPipelineState(m_ShadowPSO);
             g_ShadowBuffer.BeginRendering(gfxContext);
-            RenderObjects( m_OriginalModel, gfxContext, m_SunShadow.GetViewProjMatrix() );
-            RenderObjects( m_NewModel, gfxContext, m_SunShadow.GetViewProjMatrix() );
-            RenderObjects( m_FloorModel, gfxContext, m_SunShadow.GetViewProjMatrix() );
-            RenderObjects( m_CylinderModel, gfxContext, m_SunShadow.GetViewProjMatrix() );
+            for (int i = 0; i < kModelCount; ++i)
+                RenderObjects( *models[i], m_ShadowVisibleMeshes[i], gfxContext, m_SunShadow, false );
             g_ShadowBuffer.EndRendering(gfxContext);
         }
 
@@ -746,10 +684,8 @@ void Engine::RenderScene( void )
             gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_READ);
             gfxContext.SetRenderTarget(g_SceneColorBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV_DepthReadOnly());
             gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-            RenderObjects( m_OriginalModel, gfxContext, m_ViewProjMatrix );
-            RenderObjects( m_NewModel, gfxContext, m_ViewProjMatrix );
-            RenderObjects( m_FloorModel, gfxContext, m_ViewProjMatrix );
-            RenderObjects( m_CylinderModel, gfxContext, m_ViewProjMatrix );
+            for (int i = 0; i < kModelCount; ++i)
+                RenderObjects( *models[i], m_MainVisibleMeshes[i], gfxContext, m_Camera, true );
         }
 
         {
@@ -762,7 +698,7 @@ void Engine::RenderScene( void )
             gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
             //gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
             gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
-            m_physicsEngine.draw( gfxContext, m_ViewProjMatrix ); // , m_Camera, m_SunShadow );
+            m_physicsEngine.draw( gfxContext, m_Camera.GetViewProjMatrix() ); // , m_Camera, m_SunShadow );
         }
 
 #if 0
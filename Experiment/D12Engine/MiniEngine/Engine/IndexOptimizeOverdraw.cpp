@@ -0,0 +1,195 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "IndexOptimizeOverdraw.h"
+
+
+namespace Graphics
+{
+	namespace
+	{
+		// a FIFO cache in constant time per lookup: a vertex is still cached if fewer than cacheSize misses have happened since it was loaded
+		class VertexCacheSimulation
+		{
+		public:
+			VertexCacheSimulation(uint32_t vertexCount, uint32_t cacheSize)
+				: m_loadTime(vertexCount, 0), m_time(cacheSize), m_cacheSize(cacheSize)
+			{
+			}
+
+			void Reset()
+			{
+				m_time += m_cacheSize;
+			}
+
+			uint32_t FaceMisses(uint32_t v0, uint32_t v1, uint32_t v2)
+			{
+				return Miss(v0) + Miss(v1) + Miss(v2);
+			}
+
+		private:
+			uint32_t Miss(uint32_t vertex)
+			{
+				if (m_time - m_loadTime[vertex] < m_cacheSize)
+					return 0;
+				m_loadTime[vertex] = ++m_time;
+				return 1;
+			}
+
+			std::vector<uint32_t> m_loadTime;
+			uint32_t m_time;
+			uint32_t m_cacheSize;
+		};
+
+		struct OverdrawCluster
+		{
+			uint32_t firstFace;
+			uint32_t faceCount;
+			float sortKey;
+		};
+	}
+
+	template <typename IndexType>
+	void OptimizeOverdraw(const IndexType* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, IndexType* newIndexList, float threshold, uint16_t cacheSize)
+	{
+		const uint32_t faceCount = indexCount / 3;
+		if (faceCount == 0)
+			return;
+
+		auto position = [&](uint32_t vertex) -> const float*
+		{
+			assert(vertex < vertexCount);
+			return (const float*)(positionData + vertex * vertexStride);
+		};
+
+		VertexCacheSimulation cache(vertexCount, cacheSize);
+
+		// hard boundaries: faces that miss on all three vertices, where the cache has nothing left worth keeping
+		std::vector<uint32_t> hardBoundaries;
+		for (uint32_t f = 0; f < faceCount; f++)
+		{
+			if (f == 0 || cache.FaceMisses(indexList[f * 3 + 0], indexList[f * 3 + 1], indexList[f * 3 + 2]) == 3)
+				hardBoundaries.push_back(f);
+		}
+		hardBoundaries.push_back(faceCount);
+
+		// soft boundaries: split a cluster again wherever the misses so far are within threshold of the whole cluster's ratio
+		std::vector<OverdrawCluster> clusters;
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+		{
+			const uint32_t start = hardBoundaries[h];
+			const uint32_t end = hardBoundaries[h + 1];
+
+			cache.Reset();
+			uint32_t clusterMisses = 0;
+			for (uint32_t f = start; f < end; f++)
+				clusterMisses += cache.FaceMisses(indexList[f * 3 + 0], indexList[f * 3 + 1], indexList[f * 3 + 2]);
+			const float clusterRatio = (float)clusterMisses / (float)(end - start);
+
+			cache.Reset();
+			uint32_t subStart = start;
+			uint32_t subMisses = 0;
+			for (uint32_t f = start; f < end; f++)
+			{
+				subMisses += cache.FaceMisses(indexList[f * 3 + 0], indexList[f * 3 + 1], indexList[f * 3 + 2]);
+				if (f + 1 < end && (float)subMisses <= threshold * clusterRatio * (float)(f + 1 - subStart))
+				{
+					OverdrawCluster cluster = { subStart, f + 1 - subStart, 0.0f };
+					clusters.push_back(cluster);
+					subStart = f + 1;
+					subMisses = 0;
+					cache.Reset();
+				}
+			}
+			OverdrawCluster cluster = { subStart, end - subStart, 0.0f };
+			clusters.push_back(cluster);
+		}
+
+		// area weighted centroids and normals, for each cluster and for the whole mesh
+		std::vector<float> clusterCentroidsAndNormals(clusters.size() * 6, 0.0f);
+		float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+		float meshArea = 0.0f;
+
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			float *centroid = &clusterCentroidsAndNormals[c * 6];
+			float *normal = centroid + 3;
+			float clusterArea = 0.0f;
+
+			for (uint32_t f = clusters[c].firstFace; f < clusters[c].firstFace + clusters[c].faceCount; f++)
+			{
+				const float *p0 = position(indexList[f * 3 + 0]);
+				const float *p1 = position(indexList[f * 3 + 1]);
+				const float *p2 = position(indexList[f * 3 + 2]);
+
+				float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				for (int k = 0; k < 3; k++)
+				{
+					float faceCentroid = (p0[k] + p1[k] + p2[k]) * (1.0f / 3.0f);
+					centroid[k] += faceCentroid * area;
+					meshCentroid[k] += faceCentroid * area;
+					normal[k] += n[k];
+				}
+				clusterArea += area;
+			}
+
+			meshArea += clusterArea;
+			float clusterScale = clusterArea > 0.0f ? 1.0f / clusterArea : 0.0f;
+			float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float normalScale = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+			for (int k = 0; k < 3; k++)
+			{
+				centroid[k] *= clusterScale;
+				normal[k] *= normalScale;
+			}
+		}
+
+		float meshScale = meshArea > 0.0f ? 1.0f / meshArea : 0.0f;
+		for (int k = 0; k < 3; k++)
+			meshCentroid[k] *= meshScale;
+
+		// clusters facing out from the middle of the mesh are the ones most likely to hide the rest
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			const float *centroid = &clusterCentroidsAndNormals[c * 6];
+			const float *normal = centroid + 3;
+			clusters[c].sortKey =
+				(centroid[0] - meshCentroid[0]) * normal[0] +
+				(centroid[1] - meshCentroid[1]) * normal[1] +
+				(centroid[2] - meshCentroid[2]) * normal[2];
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const OverdrawCluster &a, const OverdrawCluster &b)
+		{
+			return a.sortKey > b.sortKey;
+		});
+
+		IndexType *dst = newIndexList;
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			memcpy(dst, indexList + clusters[c].firstFace * 3, sizeof(IndexType) * 3 * clusters[c].faceCount);
+			dst += 3 * clusters[c].faceCount;
+		}
+
+		// any trailing indices that don't make a whole face stay where they were
+		memcpy(dst, indexList + faceCount * 3, sizeof(IndexType) * (indexCount - faceCount * 3));
+	}
+
+} // namespace Graphics
@@ -20,6 +20,10 @@
 #include <assert.h>
 #include <math.h>
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
 
 #include "IndexOptimizePostTransform.h"
 
@@ -83,6 +87,7 @@ namespace Graphics
 
 		enum {kMaxVertexCacheSize = 64};
 		enum {kMaxPrecomputedVertexValenceScores = 64};
+		enum {kMaxCandidateFacesPerVertex = 16};
 		float s_vertexCacheScores[kMaxVertexCacheSize+1][kMaxVertexCacheSize];
 		float s_vertexValenceScores[kMaxPrecomputedVertexValenceScores];
 
@@ -153,58 +158,12 @@ namespace Graphics
 			IndexType  cachePos1;
 			OptimizeVertexData() : score(0.f), activeFaceListStart(0), activeFaceListSize(0), cachePos0(0), cachePos1(0) { }
 		};
-	}
-
-	template <typename T, typename IndexType>
-	struct IndexSortCompareIndexed
-	{
-		const IndexType *_indexData;
-
-		IndexSortCompareIndexed(const IndexType *indexData)
-			: _indexData(indexData)
-		{
-		}
-
-		bool operator()(T a, T b) const
-		{
-			IndexType indexA = _indexData[a];
-			IndexType indexB = _indexData[b];
-
-			if (indexA < indexB)
-				return true;
-			return false;
-		}
-	};
-
-	template <typename T, typename IndexType>
-	struct FaceValenceSort
-	{
-		const OptimizeVertexData<IndexType> *_vertexData;
-
-		FaceValenceSort(const OptimizeVertexData<IndexType> *vertexData)
-			: _vertexData(vertexData)
-		{
-		}
 
-		bool operator()(T a, T b) const
-		{
-			const OptimizeVertexData<IndexType> *vA0 = _vertexData + a * 3 + 0;
-			const OptimizeVertexData<IndexType> *vA1 = _vertexData + a * 3 + 1;
-			const OptimizeVertexData<IndexType> *vA2 = _vertexData + a * 3 + 2;
-			const OptimizeVertexData<IndexType> *vB0 = _vertexData + b * 3 + 0;
-			const OptimizeVertexData<IndexType> *vB1 = _vertexData + b * 3 + 1;
-			const OptimizeVertexData<IndexType> *vB2 = _vertexData + b * 3 + 2;
-
-			int aValence = vA0->activeFaceListSize + vA1->activeFaceListSize + vA2->activeFaceListSize;
-			int bValence = vB0->activeFaceListSize + vB1->activeFaceListSize + vB2->activeFaceListSize;
-
-			// higher scoring faces are those with lower valence totals
-			// reverse sort (reverse of reverse)
-			if (aValence < bValence)
-				return true;
-			return false;
-		}
-	};
+		// A vertex with unprocessed faces, keyed by how many it had when it was pushed. A vertex is pushed again
+		// whenever it loses a face, so an entry whose count is no longer the vertex's is stale and skipped.
+		typedef std::pair<uint32_t, uint32_t> RestartCandidate;
+		typedef std::priority_queue<RestartCandidate, std::vector<RestartCandidate>, std::greater<RestartCandidate>> RestartQueue;
+	}
 
 	//-----------------------------------------------------------------------------
 	//  OptimizeFaces
@@ -214,71 +173,46 @@ namespace Graphics
 	//          input index list
 	//      indexCount
 	//          the number of indices in the list
-	//      vertexCount
-	//          the largest index value in indexList
 	//      newIndexList
 	//          a pointer to a preallocated buffer the same size as indexList to
 	//          hold the optimized index list
 	//      lruCacheSize
 	//          the size of the simulated post-transform cache (max:64)
 	//-----------------------------------------------------------------------------
+	//  The per-vertex face lists are flat arrays built with a prefix sum, holding
+	//  corners, each of which knows its slot so a processed face is swapped out in
+	//  constant time. Each step scores at most a few faces per cached vertex, and
+	//  new starting faces come from a heap of vertices by the faces they have left,
+	//  which gets one push per corner, so the whole pass is linear.
+	//-----------------------------------------------------------------------------
 	template <typename IndexType>
 	void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* newIndexList, uint16_t lruCacheSize)
 	{
-		OptimizeVertexData<IndexType> *vertexDataList = new OptimizeVertexData<IndexType> [indexCount]; // upper bounds on size is indexCount
-		IndexType *vertexRemap = new IndexType [indexCount];
-		uint32_t *activeFaceList = new uint32_t [indexCount];
-
-		uint32_t faceCount = indexCount / 3;
-		uint8_t *processedFaceList = new uint8_t [faceCount];
-		memset(processedFaceList, 0, sizeof(uint8_t) * faceCount);
-		unsigned int *faceSorted = new unsigned int [faceCount];
-		unsigned int *faceReverseLookup = new unsigned int [faceCount];
-
-		// build the vertex remap table
-		unsigned int uniqueVertexCount = 0;
-		{
-			typedef IndexSortCompareIndexed<unsigned int, IndexType> indexSorter;
-			unsigned int *indexSorted = new unsigned int [indexCount];
-
-			for (unsigned int i = 0; i < indexCount; i++)
-			{
-				indexSorted[i] = i;
-			}
-
-			indexSorter sortFunc(indexList);
-			std::sort(indexSorted, indexSorted + indexCount, sortFunc);
-
-			for (unsigned int i = 0; i < indexCount; i++)
-			{
-				if (i == 0
-					|| sortFunc(indexSorted[i - 1], indexSorted[i]))
-				{
-					// it's not a duplicate
-					vertexRemap[indexSorted[i]] = uniqueVertexCount;
-					uniqueVertexCount++;
-				}
-				else
-				{
-					vertexRemap[indexSorted[i]] = vertexRemap[indexSorted[i - 1]];
-				}
-			}
+		const uint32_t faceCount = indexCount / 3;
 
-			delete [] indexSorted;
+		// indices address the vertex data directly, there's no need to remap them
+		uint32_t vertexCount = 0;
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			vertexCount = std::max(vertexCount, (uint32_t)indexList[i] + 1);
 		}
 
+		std::vector<OptimizeVertexData<IndexType>> vertexDataList(vertexCount);
+		std::vector<uint32_t> activeFaceList(indexCount);
+		std::vector<uint32_t> activeFaceSlot(indexCount);
+
 		// compute face count per vertex
-		for (uint32_t i=0; i<indexCount; ++i)
+		for (uint32_t i = 0; i < indexCount; ++i)
 		{
-			OptimizeVertexData<IndexType>& vertexData = vertexDataList[vertexRemap[i]];
-			vertexData.activeFaceListSize++;
+			vertexDataList[indexList[i]].activeFaceListSize++;
 		}
 
 		const IndexType kEvictedCacheIndex = std::numeric_limits<IndexType>::max();
+		RestartQueue restartQueue;
 		{
 			// allocate face list per vertex
 			uint32_t curActiveFaceListPos = 0;
-			for (uint32_t i = 0; i < uniqueVertexCount; ++i)
+			for (uint32_t i = 0; i < vertexCount; ++i)
 			{
 				OptimizeVertexData<IndexType>& vertexData = vertexDataList[i];
 				vertexData.cachePos0 = kEvictedCacheIndex;
@@ -286,78 +220,69 @@ namespace Graphics
 				vertexData.activeFaceListStart = curActiveFaceListPos;
 				curActiveFaceListPos += vertexData.activeFaceListSize;
 				vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos0, lruCacheSize);
+				if (vertexData.activeFaceListSize > 0)
+				{
+					restartQueue.push(RestartCandidate(vertexData.activeFaceListSize, i));
+				}
 				vertexData.activeFaceListSize = 0;
 			}
-			assert(curActiveFaceListPos == indexCount);
+			assert(curActiveFaceListPos == faceCount * 3);
 		}
 
-		// sort unprocessed faces by highest score
-		for (uint32_t f = 0; f < faceCount; f++)
+		// fill out face list per vertex, with the corner of the face that uses the vertex
+		for (uint32_t i = 0; i < faceCount * 3; ++i)
 		{
-			faceSorted[f] = f;
-		}
-		FaceValenceSort<unsigned int, IndexType> faceValenceSort(vertexDataList);
-		std::sort(faceSorted, faceSorted + faceCount, faceValenceSort);
-		for (uint32_t f = 0; f < faceCount; f++)
-		{
-			faceReverseLookup[faceSorted[f]] = f;
-		}
-
-		// fill out face list per vertex
-		for (uint32_t i=0; i<indexCount; i+=3)
-		{
-			for (uint32_t j=0; j<3; ++j)
-			{
-				OptimizeVertexData<IndexType>& vertexData = vertexDataList[vertexRemap[i + j]];
-				activeFaceList[vertexData.activeFaceListStart + vertexData.activeFaceListSize] = i;
-				vertexData.activeFaceListSize++;
-			}
+			OptimizeVertexData<IndexType>& vertexData = vertexDataList[indexList[i]];
+			activeFaceSlot[i] = vertexData.activeFaceListSize;
+			activeFaceList[vertexData.activeFaceListStart + vertexData.activeFaceListSize] = i;
+			vertexData.activeFaceListSize++;
 		}
 
-		IndexType vertexCacheBuffer[(kMaxVertexCacheSize+3)*2];
-		IndexType* cache0 = vertexCacheBuffer;
-		IndexType* cache1 = vertexCacheBuffer+(kMaxVertexCacheSize+3);
+		uint32_t cacheVertices0[kMaxVertexCacheSize+3];
+		uint32_t cacheVertices1[kMaxVertexCacheSize+3];
+		uint32_t* cacheVertex0 = cacheVertices0;
+		uint32_t* cacheVertex1 = cacheVertices1;
 		IndexType entriesInCache0 = 0;
 
 		uint32_t bestFace = 0;
 		float bestScore = -1.f;
 
-		const float maxValenceScore = FindVertexScore(1, kEvictedCacheIndex, lruCacheSize) * 3.f;
-
-		unsigned int nextBestFace = 0;
-		for (uint32_t i = 0; i < indexCount; i += 3)
+		for (uint32_t i = 0; i < faceCount * 3; i += 3)
 		{
 			if (bestScore < 0.f)
 			{
-				// no verts in the cache are used by any unprocessed faces so
-				// search all unprocessed faces for a new starting point
-				for (; nextBestFace < faceCount; nextBestFace++)
+				// no verts in the cache are used by any unprocessed faces so start again from the vertex
+				// with the fewest left, at its face whose vertices have the fewest between them
+				const uint32_t kNoVertex = std::numeric_limits<uint32_t>::max();
+				uint32_t restartVertex = kNoVertex;
+				while (restartVertex == kNoVertex)
 				{
-					unsigned int faceIndex = faceSorted[nextBestFace];
-					if (processedFaceList[faceIndex] == 0)
-					{
-						uint32_t face = faceIndex * 3;
-						float faceScore = 0.f;
-						for (uint32_t k=0; k<3; ++k)
-						{
-							//assert(vertexData.activeFaceListSize > 0);
-							//assert(vertexData.cachePos0 >= lruCacheSize);
-
-							float vertexScore = vertexDataList[vertexRemap[face + k]].score;
-							faceScore += vertexScore; 
-						}
+					assert(!restartQueue.empty());
+					RestartCandidate candidate = restartQueue.top();
+					restartQueue.pop();
+					if (candidate.first == vertexDataList[candidate.second].activeFaceListSize)
+						restartVertex = candidate.second;
+				}
 
-						bestScore = faceScore;
+				const OptimizeVertexData<IndexType>& vertexData = vertexDataList[restartVertex];
+				uint32_t bestValence = std::numeric_limits<uint32_t>::max();
+				for (uint32_t j = 0; j < vertexData.activeFaceListSize; ++j)
+				{
+					uint32_t face = activeFaceList[vertexData.activeFaceListStart + j];
+					face -= face % 3;
+					uint32_t valence =
+						vertexDataList[indexList[face + 0]].activeFaceListSize +
+						vertexDataList[indexList[face + 1]].activeFaceListSize +
+						vertexDataList[indexList[face + 2]].activeFaceListSize;
+					if (valence < bestValence)
+					{
+						bestValence = valence;
 						bestFace = face;
-
-						nextBestFace++;
-						break; // we're searching a pre-sorted list, first one we find will be the best
 					}
 				}
-				assert(bestScore >= 0.f);
+				bestScore = 0.f;
 			}
 
-			processedFaceList[bestFace / 3] = 1;
 			uint16_t entriesInCache1 = 0;
 
 			// add bestFace to LRU cache and to newIndexList
@@ -366,12 +291,12 @@ namespace Graphics
 				IndexType index = indexList[bestFace+v];
 				newIndexList[i+v] = index;
 
-				OptimizeVertexData<IndexType>& vertexData = vertexDataList[vertexRemap[bestFace + v]];
+				OptimizeVertexData<IndexType>& vertexData = vertexDataList[index];
 
 				if (vertexData.cachePos1 >= entriesInCache1)
 				{
 					vertexData.cachePos1 = entriesInCache1;
-					cache1[entriesInCache1++] = vertexRemap[bestFace + v];
+					cacheVertex1[entriesInCache1++] = index;
 
 					if (vertexData.activeFaceListSize == 1)
 					{
@@ -380,50 +305,31 @@ namespace Graphics
 					}
 				}
 
+				// swap the last corner into this one's slot
 				assert(vertexData.activeFaceListSize > 0);
-				uint32_t* begin = activeFaceList + vertexData.activeFaceListStart;
-				uint32_t* end = activeFaceList + (vertexData.activeFaceListStart + vertexData.activeFaceListSize);
-				uint32_t* it = std::find(begin, end, bestFace);
-				assert(it != end);
-				std::swap(*it, *(end-1));
-				--vertexData.activeFaceListSize;
+				uint32_t* activeFaces = activeFaceList.data() + vertexData.activeFaceListStart;
+				uint32_t slot = activeFaceSlot[bestFace + v];
+				assert(activeFaces[slot] == bestFace + v);
+				uint32_t lastCorner = activeFaces[--vertexData.activeFaceListSize];
+				activeFaces[slot] = lastCorner;
+				activeFaceSlot[lastCorner] = slot;
 				vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos1, lruCacheSize);
 
-				// need to re-sort the faces that use this vertex, as their score will change due to activeFaceListSize shrinking
-				for (uint32_t *fi = begin; fi != end - 1; ++fi)
+				if (vertexData.activeFaceListSize > 0)
 				{
-					unsigned int faceIndex = *fi / 3;
-
-					unsigned int n = faceReverseLookup[faceIndex];
-					assert(faceSorted[n] == faceIndex);
-
-					// found it, now move it up
-					while (n > 0)
-					{
-						if (faceValenceSort(n, n - 1))
-						{
-							faceReverseLookup[faceSorted[n]] = n - 1;
-							faceReverseLookup[faceSorted[n - 1]] = n;
-							std::swap(faceSorted[n], faceSorted[n - 1]);
-							n--;
-						}
-						else
-						{
-							break;
-						}
-					}
+					restartQueue.push(RestartCandidate(vertexData.activeFaceListSize, index));
 				}
 			}
 
 			// move the rest of the old verts in the cache down and compute their new scores
 			for (uint32_t c0 = 0; c0 < entriesInCache0; ++c0)
 			{
-				OptimizeVertexData<IndexType>& vertexData = vertexDataList[cache0[c0]];
+				OptimizeVertexData<IndexType>& vertexData = vertexDataList[cacheVertex0[c0]];
 
 				if (vertexData.cachePos1 >= entriesInCache1)
 				{
 					vertexData.cachePos1 = entriesInCache1;
-					cache1[entriesInCache1++] = cache0[c0];
+					cacheVertex1[entriesInCache1++] = cacheVertex0[c0];
 					vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos1, lruCacheSize);
 					// don't need to re-sort this vertex... once it gets out of the cache, it'll have its original score
 				}
@@ -433,16 +339,20 @@ namespace Graphics
 			bestScore = -1.f;
 			for (uint32_t c1 = 0; c1 < entriesInCache1; ++c1)
 			{
-				OptimizeVertexData<IndexType>& vertexData = vertexDataList[cache1[c1]];
+				OptimizeVertexData<IndexType>& vertexData = vertexDataList[cacheVertex1[c1]];
 				vertexData.cachePos0 = vertexData.cachePos1;
 				vertexData.cachePos1 = kEvictedCacheIndex;
-				for (uint32_t j=0; j<vertexData.activeFaceListSize; ++j)
+				// only the first few faces of a vertex used by many, or each step would cost as much as its
+				// valence. Its other faces get found through their other vertices, or as a new start.
+				const uint32_t candidateFaceCount = std::min<uint32_t>(vertexData.activeFaceListSize, kMaxCandidateFacesPerVertex);
+				for (uint32_t j=0; j<candidateFaceCount; ++j)
 				{
 					uint32_t face = activeFaceList[vertexData.activeFaceListStart+j];
+					face -= face % 3;
 					float faceScore = 0.f;
 					for (uint32_t v=0; v<3; v++)
 					{
-						OptimizeVertexData<IndexType>& faceVertexData = vertexDataList[vertexRemap[face + v]];
+						OptimizeVertexData<IndexType>& faceVertexData = vertexDataList[indexList[face + v]];
 						faceScore += faceVertexData.score;
 					}
 					if (faceScore > bestScore)
@@ -453,16 +363,9 @@ namespace Graphics
 				}
 			}
 
-			std::swap(cache0, cache1);
+			std::swap(cacheVertex0, cacheVertex1);
 			entriesInCache0 = std::min(entriesInCache1, lruCacheSize);
 		}
-
-		delete [] vertexDataList;
-		delete [] vertexRemap;
-		delete [] activeFaceList;
-		delete [] processedFaceList;
-		delete [] faceSorted;
-		delete [] faceReverseLookup;
 	}
 
 } // namespace Graphics
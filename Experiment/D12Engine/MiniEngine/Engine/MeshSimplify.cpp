@@ -0,0 +1,279 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "MeshSimplify.h"
+
+
+namespace Graphics
+{
+	namespace
+	{
+		// the sum of squared distances to a set of planes, weighted by triangle area
+		struct Quadric
+		{
+			double a00, a11, a22, a01, a02, a12;
+			double b0, b1, b2;
+			double c;
+			double weight;
+		};
+
+		void QuadricAddPlane(Quadric &q, const double n[3], double d, double weight)
+		{
+			q.a00 += weight * n[0] * n[0];
+			q.a11 += weight * n[1] * n[1];
+			q.a22 += weight * n[2] * n[2];
+			q.a01 += weight * n[0] * n[1];
+			q.a02 += weight * n[0] * n[2];
+			q.a12 += weight * n[1] * n[2];
+			q.b0 += weight * n[0] * d;
+			q.b1 += weight * n[1] * d;
+			q.b2 += weight * n[2] * d;
+			q.c += weight * d * d;
+			q.weight += weight;
+		}
+
+		void QuadricAdd(Quadric &q, const Quadric &r)
+		{
+			q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+			q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+			q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+			q.c += r.c;
+			q.weight += r.weight;
+		}
+
+		// mean squared distance from p to the planes
+		double QuadricError(const Quadric &q, const float p[3])
+		{
+			double x = p[0], y = p[1], z = p[2];
+			double error =
+				q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+				2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+				2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) +
+				q.c;
+			return q.weight > 0.0 ? fabs(error) / q.weight : 0.0;
+		}
+
+		void TriangleNormal(const float *p0, const float *p1, const float *p2, double n[3])
+		{
+			double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		}
+
+		struct Collapse
+		{
+			double error;
+			uint32_t from;
+			uint32_t to;
+		};
+	}
+
+	template <typename IndexType>
+	uint32_t SimplifyMesh(const IndexType* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, IndexType* newIndexList, uint32_t targetIndexCount, float targetError, float* resultError)
+	{
+		auto position = [&](uint32_t vertex) -> const float*
+		{
+			return (const float*)(positionData + vertex * vertexStride);
+		};
+
+		const uint32_t faceCount = indexCount / 3;
+		std::vector<uint32_t> indices(indexList, indexList + faceCount * 3);
+
+		// a vertex sharing its position with another is on a seam, and stays put
+		std::vector<uint32_t> sortedVertices(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+			sortedVertices[v] = v;
+		std::sort(sortedVertices.begin(), sortedVertices.end(), [&](uint32_t a, uint32_t b)
+		{
+			return memcmp(position(a), position(b), sizeof(float) * 3) < 0;
+		});
+
+		std::vector<unsigned char> locked(vertexCount, 0);
+		for (uint32_t n = 1; n < vertexCount; n++)
+		{
+			if (0 == memcmp(position(sortedVertices[n - 1]), position(sortedVertices[n]), sizeof(float) * 3))
+				locked[sortedVertices[n - 1]] = locked[sortedVertices[n]] = 1;
+		}
+
+		// so does a vertex on an edge that only one triangle uses
+		std::vector<uint64_t> edges;
+		edges.reserve(faceCount * 3);
+		for (uint32_t f = 0; f < faceCount; f++)
+		{
+			for (uint32_t k = 0; k < 3; k++)
+				edges.push_back(((uint64_t)indices[f * 3 + k] << 32) | indices[f * 3 + (k + 1) % 3]);
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t e = 0; e < edges.size(); e++)
+		{
+			uint32_t a = (uint32_t)(edges[e] >> 32);
+			uint32_t b = (uint32_t)edges[e];
+			if (!std::binary_search(edges.begin(), edges.end(), ((uint64_t)b << 32) | a))
+				locked[a] = locked[b] = 1;
+		}
+
+		std::vector<Quadric> quadrics(vertexCount, Quadric());
+		for (uint32_t f = 0; f < faceCount; f++)
+		{
+			const uint32_t *face = &indices[f * 3];
+			double n[3];
+			TriangleNormal(position(face[0]), position(face[1]), position(face[2]), n);
+			double area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (area == 0.0)
+				continue;
+
+			n[0] /= area; n[1] /= area; n[2] /= area;
+			const float *p0 = position(face[0]);
+			double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+			for (uint32_t k = 0; k < 3; k++)
+				QuadricAddPlane(quadrics[face[k]], n, d, area * 0.5);
+		}
+
+		const double maxError = (double)targetError * (double)targetError;
+		double worstError = 0.0;
+
+		std::vector<uint32_t> collapseTarget(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+			collapseTarget[v] = v;
+
+		std::vector<uint32_t> faceStart(vertexCount + 1);
+		std::vector<uint32_t> vertexFaces;
+		std::vector<Collapse> collapses;
+		std::vector<unsigned char> touched(vertexCount);
+
+		// each pass makes the cheapest collapses that don't share a neighbourhood, then rebuilds the list
+		while (indices.size() > targetIndexCount)
+		{
+			const uint32_t currentFaceCount = (uint32_t)indices.size() / 3;
+
+			std::fill(faceStart.begin(), faceStart.end(), 0);
+			for (size_t n = 0; n < indices.size(); n++)
+				faceStart[indices[n] + 1]++;
+			for (uint32_t v = 0; v < vertexCount; v++)
+				faceStart[v + 1] += faceStart[v];
+			vertexFaces.resize(indices.size());
+			{
+				std::vector<uint32_t> fill(faceStart.begin(), faceStart.end() - 1);
+				for (uint32_t f = 0; f < currentFaceCount; f++)
+					for (uint32_t k = 0; k < 3; k++)
+						vertexFaces[fill[indices[f * 3 + k]]++] = f;
+			}
+
+			collapses.clear();
+			for (uint32_t f = 0; f < currentFaceCount; f++)
+			{
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					uint32_t v0 = indices[f * 3 + k];
+					uint32_t v1 = indices[f * 3 + (k + 1) % 3];
+					if (!locked[v0])
+					{
+						Collapse collapse = { QuadricError(quadrics[v0], position(v1)), v0, v1 };
+						collapses.push_back(collapse);
+					}
+					if (!locked[v1])
+					{
+						Collapse collapse = { QuadricError(quadrics[v1], position(v0)), v1, v0 };
+						collapses.push_back(collapse);
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b)
+			{
+				return a.error < b.error;
+			});
+
+			const uint32_t facesToRemove = (currentFaceCount * 3 - targetIndexCount) / 3;
+			uint32_t facesRemoved = 0;
+			uint32_t collapseCount = 0;
+			std::fill(touched.begin(), touched.end(), 0);
+
+			for (size_t c = 0; c < collapses.size() && facesRemoved < facesToRemove; c++)
+			{
+				const Collapse &collapse = collapses[c];
+				if (collapse.error > maxError)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				// moving the vertex mustn't turn any of its other triangles over
+				bool flips = false;
+				uint32_t sharedFaces = 0;
+				for (uint32_t n = faceStart[collapse.from]; n < faceStart[collapse.from + 1] && !flips; n++)
+				{
+					const uint32_t *face = &indices[vertexFaces[n] * 3];
+					if (face[0] == collapse.to || face[1] == collapse.to || face[2] == collapse.to)
+					{
+						sharedFaces++;
+						continue;
+					}
+
+					const float *p[3] = { position(face[0]), position(face[1]), position(face[2]) };
+					double before[3], after[3];
+					TriangleNormal(p[0], p[1], p[2], before);
+					for (uint32_t k = 0; k < 3; k++)
+						if (face[k] == collapse.from)
+							p[k] = position(collapse.to);
+					TriangleNormal(p[0], p[1], p[2], after);
+					flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+				}
+				if (flips)
+					continue;
+
+				collapseTarget[collapse.from] = collapse.to;
+				QuadricAdd(quadrics[collapse.to], quadrics[collapse.from]);
+				worstError = collapse.error > worstError ? collapse.error : worstError;
+				facesRemoved += sharedFaces;
+				collapseCount++;
+
+				// the neighbourhood's triangles are stale until the list is rebuilt
+				for (uint32_t n = faceStart[collapse.from]; n < faceStart[collapse.from + 1]; n++)
+				{
+					const uint32_t *face = &indices[vertexFaces[n] * 3];
+					touched[face[0]] = touched[face[1]] = touched[face[2]] = 1;
+				}
+			}
+
+			if (collapseCount == 0)
+				break;
+
+			size_t write = 0;
+			for (size_t n = 0; n < indices.size(); n += 3)
+			{
+				uint32_t a = collapseTarget[indices[n + 0]];
+				uint32_t b = collapseTarget[indices[n + 1]];
+				uint32_t c = collapseTarget[indices[n + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+		}
+
+		for (size_t n = 0; n < indices.size(); n++)
+			newIndexList[n] = (IndexType)indices[n];
+
+		if (resultError != nullptr)
+			*resultError = (float)sqrt(worstError);
+
+		return (uint32_t)indices.size();
+	}
+
+} // namespace Graphics
@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+namespace Graphics
+{
+	//-----------------------------------------------------------------------------
+	//  SimplifyMesh
+	//-----------------------------------------------------------------------------
+	//  Reduces an index list with Garland and Heckbert's quadric error metric,
+	//  collapsing edges onto one of their existing vertices so the result still
+	//  indexes the original vertex buffer. Vertices on open borders, and vertices
+	//  whose position is shared with another vertex (UV and normal seams), never
+	//  move, so the outline and the seams of the mesh are kept exactly.
+	//
+	//  Parameters:
+	//      indexList
+	//          input index list
+	//      indexCount
+	//          the number of indices in the list
+	//      positionData
+	//          the first vertex's position, three floats
+	//      vertexStride
+	//          bytes from one position to the next
+	//      vertexCount
+	//          the number of vertices indexList refers to
+	//      newIndexList
+	//          a pointer to a preallocated buffer the same size as indexList to
+	//          hold the simplified index list
+	//      targetIndexCount
+	//          stop once the list is this short
+	//      targetError
+	//          stop before any vertex would move further than this from the
+	//          surface, in the same units as the positions
+	//      resultError
+	//          if not null, receives the largest error of the collapses made
+	//
+	//  Returns the number of indices written to newIndexList.
+	//-----------------------------------------------------------------------------
+	template <typename IndexType>
+	uint32_t SimplifyMesh(const IndexType* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, IndexType* newIndexList, uint32_t targetIndexCount, float targetError, float* resultError);
+
+	template uint32_t SimplifyMesh<uint16_t>(const uint16_t* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, uint16_t* newIndexList, uint32_t targetIndexCount, float targetError, float* resultError);
+	template uint32_t SimplifyMesh<uint32_t>(const uint32_t* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, uint32_t* newIndexList, uint32_t targetIndexCount, float targetError, float* resultError);
+}
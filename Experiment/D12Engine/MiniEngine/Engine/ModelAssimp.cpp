@@ -151,6 +151,13 @@ bool Model::LoadAssimp(const char *filename)
 	m_Header.meshCount = scene->mNumMeshes;
 	m_pMesh = new Mesh [m_Header.meshCount];
 	memset(m_pMesh, 0, sizeof(Mesh) * m_Header.meshCount);
+	// one index width for the whole model, so it can share a single index buffer view
+	unsigned int indexStride = sizeof(uint16_t);
+	for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+	{
+		if (scene->mMeshes[meshIndex]->mNumVertices > 0x10000)
+			indexStride = sizeof(uint32_t);
+	}
 	// first pass, count everything
 	for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
 	{
@@ -211,9 +218,10 @@ bool Model::LoadAssimp(const char *filename)
 
 		dstMesh->indexDataByteOffset = m_Header.indexDataByteSize;
 		dstMesh->indexCount = srcMesh->mNumFaces * 3;
+		dstMesh->indexStride = indexStride;
 
 		m_Header.vertexDataByteSize += dstMesh->vertexStride * dstMesh->vertexCount;
-		m_Header.indexDataByteSize += sizeof(uint16_t) * dstMesh->indexCount;
+		m_Header.indexDataByteSize += dstMesh->indexStride * dstMesh->indexCount;
 
 		// depth-only rendering
 		dstMesh->vertexDataByteOffsetDepth = m_Header.vertexDataByteSizeDepth;
@@ -317,19 +325,17 @@ bool Model::LoadAssimp(const char *filename)
 			dstBitangent = (float*)((unsigned char*)dstBitangent + dstMesh->vertexStride);
 		}
 
-		uint16_t *dstIndex = (uint16_t*)(m_pIndexData + dstMesh->indexDataByteOffset);
-		uint16_t *dstIndexDepth = (uint16_t*)(m_pIndexDataDepth + dstMesh->indexDataByteOffset);
+		unsigned char *dstIndex = m_pIndexData + dstMesh->indexDataByteOffset;
+		unsigned char *dstIndexDepth = m_pIndexDataDepth + dstMesh->indexDataByteOffset;
 		for (unsigned int f = 0; f < srcMesh->mNumFaces; f++)
 		{
 			assert(srcMesh->mFaces[f].mNumIndices == 3);
 
-			*dstIndex++ = srcMesh->mFaces[f].mIndices[0];
-			*dstIndex++ = srcMesh->mFaces[f].mIndices[1];
-			*dstIndex++ = srcMesh->mFaces[f].mIndices[2];
-
-			*dstIndexDepth++ = srcMesh->mFaces[f].mIndices[0];
-			*dstIndexDepth++ = srcMesh->mFaces[f].mIndices[1];
-			*dstIndexDepth++ = srcMesh->mFaces[f].mIndices[2];
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				SetIndex(dstIndex, dstMesh->indexStride, f * 3 + i, srcMesh->mFaces[f].mIndices[i]);
+				SetIndex(dstIndexDepth, dstMesh->indexStride, f * 3 + i, srcMesh->mFaces[f].mIndices[i]);
+			}
 		}
 	}
 
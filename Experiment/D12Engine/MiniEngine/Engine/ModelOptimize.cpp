@@ -13,178 +13,801 @@
 
 #include "Model.h"
 #include "IndexOptimizePostTransform.h"
+#include "IndexOptimizeOverdraw.h"
+#include "MeshSimplify.h"
+#include "Hash.h"
+#include "DDSLayout.h"
 
+#include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <ppl.h>
 
 
 namespace Graphics
 {
 
-void Model::OptimizeRemoveDuplicateVertices(bool depth)
+namespace
 {
-	unsigned char *deduplicatedVertexData = new unsigned char [depth ? m_Header.vertexDataByteSizeDepth : m_Header.vertexDataByteSize];
-	uint32_t deduplicatedVertexDataSize = 0;
+	const uint32_t kEmptyWeldSlot = (uint32_t)-1;
 
+	// open addressing with linear probing, kept at most half full
+	uint32_t WeldTableSize(uint32_t vertexCount)
+	{
+		uint32_t tableSize = 16;
+		while (tableSize < vertexCount * 2)
+			tableSize <<= 1;
+		return tableSize;
+	}
+}
+
+float Model::s_OptimizeWeldEpsilon = 0.0f;
+float Model::s_OptimizeOverdrawThreshold = 1.05f;
+unsigned int Model::s_OptimizeLodCount = 4;
+unsigned int Model::s_OptimizeOccluderTriangles = 16384;
+const char *Model::s_OptimizeTextureRoot = "Textures/";
+
+namespace
+{
+	// working memory for the per-mesh passes, kept by each worker thread so it's reused from mesh to mesh
+	struct OptimizeScratch
+	{
+		std::vector<unsigned char> vertexData;
+		std::vector<unsigned char> indexData;
+		std::vector<uint32_t> vertexRemap;
+		std::vector<uint32_t> weldTable;
+		std::vector<uint32_t> vertexKey;
+		std::vector<uint32_t> vertexMeshlet;
+	};
+	thread_local OptimizeScratch t_OptimizeScratch;
+}
+
+void Model::OptimizeRemoveDuplicateVertices(Mesh *mesh, bool depth)
+{
+	OptimizeScratch &scratch = t_OptimizeScratch;
+
+	// when welding near-duplicates, positions are snapped to a grid of this spacing before hashing and comparing
+	const bool quantizePositions = s_OptimizeWeldEpsilon > 0.0f;
+	const float positionScale = quantizePositions ? 1.0f / s_OptimizeWeldEpsilon : 0.0f;
+
+	unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
+	unsigned int positionOffset = depth ? mesh->attribDepth[attrib_position].offset : mesh->attrib[attrib_position].offset;
+	unsigned char *meshVertexData = depth ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth) : (m_pVertexData + mesh->vertexDataByteOffset);
+	assert((vertexStride & 3) == 0); // HashRange works on whole words
+
+	unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
+	assert(vertexCount <= (uint32_t)-1);
+
+	scratch.vertexData.resize(vertexCount * vertexStride);
+	unsigned char *meshDeduplicatedVertexData = scratch.vertexData.data();
+	unsigned int deduplicatedCount = 0;
+
+	scratch.vertexRemap.resize(vertexCount);
+	uint32_t *vertexRemap = scratch.vertexRemap.data();
+
+	uint32_t tableSize = WeldTableSize(vertexCount);
+	scratch.weldTable.assign(tableSize, kEmptyWeldSlot);
+	uint32_t *weldTable = scratch.weldTable.data();
+
+	// the bytes that identify a vertex: either the vertex itself, or a copy with its position quantized
+	scratch.vertexKey.resize(vertexStride / 2);
+	uint32_t *keyScratch = scratch.vertexKey.data();
+	auto vertexKey = [&](const unsigned char *vertexData, uint32_t *key) -> const uint32_t*
+	{
+		if (!quantizePositions)
+			return (const uint32_t*)vertexData;
+
+		memcpy(key, vertexData, vertexStride);
+		const float *position = (const float*)(vertexData + positionOffset);
+		int32_t *quantizedPosition = (int32_t*)((unsigned char*)key + positionOffset);
+		// clamped first, as converting a float outside the int32 range (or a NaN) is undefined
+		for (int n = 0; n < 3; n++)
+			quantizedPosition[n] = (int32_t)fminf(fmaxf(floorf(position[n] * positionScale + 0.5f), -2147483648.0f), 2147483520.0f);
+		return key;
+	};
+
+	// vertices are visited in order and the first of each group is kept, so the output does not depend on hash order
+	for (unsigned int v1 = 0; v1 < vertexCount; v1++)
+	{
+		const unsigned char *v1Data = meshVertexData + v1 * vertexStride;
+		const uint32_t *v1Key = vertexKey(v1Data, keyScratch);
+
+		uint32_t slot = (uint32_t)Utility::HashRange(v1Key, v1Key + vertexStride / 4, 2166136261U) & (tableSize - 1);
+		for (;;)
+		{
+			uint32_t v2 = weldTable[slot];
+			if (v2 == kEmptyWeldSlot)
+			{
+				// this is a new unique vertex
+				uint32_t remappedSlot = deduplicatedCount++;
+				vertexRemap[v1] = remappedSlot;
+				memcpy(meshDeduplicatedVertexData + remappedSlot * vertexStride, v1Data, vertexStride);
+				weldTable[slot] = v1;
+				break;
+			}
+
+			const uint32_t *v2Key = vertexKey(meshVertexData + v2 * vertexStride, keyScratch + vertexStride / 4);
+			if (0 == memcmp(v1Key, v2Key, vertexStride))
+			{
+				vertexRemap[v1] = vertexRemap[v2];
+				break;
+			}
+
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+
+	unsigned int indexCount = mesh->indexCount;
+	unsigned char *indexArray = (depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset;
+	for (unsigned int n = 0; n < indexCount; n++)
+	{
+		SetIndex(indexArray, mesh->indexStride, n, vertexRemap[GetIndex(indexArray, mesh->indexStride, n)]);
+	}
+
+	// the unique vertices go back to the start of the mesh's own range, OptimizeCompactVertexData closes the gaps
+	memcpy(meshVertexData, meshDeduplicatedVertexData, deduplicatedCount * vertexStride);
+
+	if (depth)
+		mesh->vertexCountDepth = deduplicatedCount;
+	else
+		mesh->vertexCount = deduplicatedCount;
+}
+
+namespace
+{
+	enum {lruCacheSize = 64};
+}
+
+void Model::OptimizePostTransform(Mesh *mesh, bool depth)
+{
+	OptimizeScratch &scratch = t_OptimizeScratch;
+
+	unsigned char *dstIndices = (depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset;
+	scratch.indexData.assign(dstIndices, dstIndices + mesh->indexStride * mesh->indexCount);
+	unsigned char *srcIndices = scratch.indexData.data();
+
+	if (mesh->indexStride == sizeof(uint32_t))
+		OptimizeFaces<uint32_t>((uint32_t*)srcIndices, mesh->indexCount, (uint32_t*)dstIndices, lruCacheSize);
+	else
+		OptimizeFaces<uint16_t>((uint16_t*)srcIndices, mesh->indexCount, (uint16_t*)dstIndices, lruCacheSize);
+}
+
+void Model::OptimizeOverdraw(Mesh *mesh, bool depth)
+{
+	OptimizeScratch &scratch = t_OptimizeScratch;
+
+	unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
+	unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
+	const unsigned char *positionData = depth
+		? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth + mesh->attribDepth[attrib_position].offset)
+		: (m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset);
+
+	unsigned char *dstIndices = (depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset;
+	scratch.indexData.assign(dstIndices, dstIndices + mesh->indexStride * mesh->indexCount);
+	unsigned char *srcIndices = scratch.indexData.data();
+
+	if (mesh->indexStride == sizeof(uint32_t))
+		Graphics::OptimizeOverdraw<uint32_t>((uint32_t*)srcIndices, mesh->indexCount, positionData, vertexStride, vertexCount, (uint32_t*)dstIndices, s_OptimizeOverdrawThreshold, lruCacheSize);
+	else
+		Graphics::OptimizeOverdraw<uint16_t>((uint16_t*)srcIndices, mesh->indexCount, positionData, vertexStride, vertexCount, (uint16_t*)dstIndices, s_OptimizeOverdrawThreshold, lruCacheSize);
+}
+
+void Model::OptimizePreTransform(Mesh *mesh, bool depth)
+{
+	OptimizeScratch &scratch = t_OptimizeScratch;
+
+	unsigned int indexCount = mesh->indexCount;
+	unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
+	unsigned char *meshVertexData = depth ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth) : (m_pVertexData + mesh->vertexDataByteOffset);
+
+	unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
+	scratch.vertexData.resize(vertexCount * vertexStride);
+	unsigned char *meshReorderedVertexData = scratch.vertexData.data();
+	unsigned int reorderedCount = 0;
+
+	scratch.vertexRemap.assign(vertexCount, (uint32_t)-1);
+	uint32_t *vertexRemap = scratch.vertexRemap.data();
+	assert(vertexCount <= (uint32_t)-1);
+
+	unsigned char *indexArray = (depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset;
+	for (unsigned int n = 0; n < indexCount; n++)
+	{
+		uint32_t index = GetIndex(indexArray, mesh->indexStride, n);
+		if (vertexRemap[index] == (uint32_t)-1)
+		{
+			// not relocated yet
+			const unsigned char *vSrc = meshVertexData + index * vertexStride;
+			unsigned char *vDst = meshReorderedVertexData + reorderedCount * vertexStride;
+			memcpy(vDst, vSrc, vertexStride);
+
+			vertexRemap[index] = reorderedCount;
+			reorderedCount++;
+		}
+		SetIndex(indexArray, mesh->indexStride, n, vertexRemap[index]);
+	}
+
+	// vertices no index refers to are dropped
+	memcpy(meshVertexData, meshReorderedVertexData, reorderedCount * vertexStride);
+
+	if (depth)
+		mesh->vertexCountDepth = reorderedCount;
+	else
+		mesh->vertexCount = reorderedCount;
+}
+
+void Model::OptimizeCompactVertexData(bool depth)
+{
+	unsigned char *vertexData = depth ? m_pVertexDataDepth : m_pVertexData;
+	uint32_t compactedVertexDataSize = 0;
+
+	// meshes only ever move down, so each one can be moved in place in order
 	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
 	{
 		Mesh *mesh = m_pMesh + meshIndex;
-		unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
-		unsigned char *meshVertexData = depth ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth) : (m_pVertexData + mesh->vertexDataByteOffset);
+		unsigned int &vertexDataByteOffset = depth ? mesh->vertexDataByteOffsetDepth : mesh->vertexDataByteOffset;
+		unsigned int vertexDataByteSize = depth ? mesh->vertexCountDepth * mesh->vertexStrideDepth : mesh->vertexCount * mesh->vertexStride;
 
-		unsigned char *meshDeduplicatedVertexData = deduplicatedVertexData + deduplicatedVertexDataSize;
-		unsigned int deduplicatedCount = 0;
+		assert(compactedVertexDataSize <= vertexDataByteOffset);
+		memmove(vertexData + compactedVertexDataSize, vertexData + vertexDataByteOffset, vertexDataByteSize);
+		vertexDataByteOffset = compactedVertexDataSize;
+		compactedVertexDataSize += vertexDataByteSize;
+	}
 
-		unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
-		uint32_t *vertexRemap = new uint32_t [vertexCount];
-		memset(vertexRemap, (uint32_t)-1, sizeof(uint32_t) * vertexCount);
-		assert(vertexCount <= (uint32_t)-1);
+	if (depth)
+		m_Header.vertexDataByteSizeDepth = compactedVertexDataSize;
+	else
+		m_Header.vertexDataByteSize = compactedVertexDataSize;
+}
 
-		for (unsigned int v1 = 0; v1 < vertexCount; v1++)
-		{
-			if (vertexRemap[v1] != (uint32_t)-1)
-				continue; // this was already found to be a duplicate
+namespace
+{
+	struct MeshletVector
+	{
+		float x, y, z;
+	};
 
-			const unsigned char *v1Data = meshVertexData + v1 * vertexStride;
+	MeshletVector MeshletSub(const MeshletVector &a, const MeshletVector &b) { MeshletVector r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+	float MeshletDot(const MeshletVector &a, const MeshletVector &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	MeshletVector MeshletCross(const MeshletVector &a, const MeshletVector &b)
+	{
+		MeshletVector r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		return r;
+	}
+}
 
-			// this is a new unique vertex
-			uint32_t remappedSlot = deduplicatedCount++;
-			vertexRemap[v1] = remappedSlot;
-			memcpy(meshDeduplicatedVertexData + remappedSlot * vertexStride, v1Data, vertexStride);
+void Model::OptimizeBuildMeshlets(unsigned int meshIndex, std::vector<Meshlet> &meshlets) const
+{
+	OptimizeScratch &scratch = t_OptimizeScratch;
+	const Mesh *mesh = m_pMesh + meshIndex;
 
-			// scan for duplicates
-			for (unsigned int v2 = v1 + 1; v2 < vertexCount; v2++)
+	const unsigned char *indexArray = m_pIndexData + mesh->indexDataByteOffset;
+	const unsigned char *positionData = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+	auto position = [&](uint32_t n) -> MeshletVector
+	{
+		const float *p = (const float*)(positionData + GetIndex(indexArray, mesh->indexStride, n) * mesh->vertexStride);
+		MeshletVector r = { p[0], p[1], p[2] };
+		return r;
+	};
+
+	// which meshlet last used each vertex, so the unique vertices of the current one can be counted
+	scratch.vertexMeshlet.assign(mesh->vertexCount, (uint32_t)-1);
+	uint32_t *vertexMeshlet = scratch.vertexMeshlet.data();
+
+	// meshlets take runs of consecutive triangles rather than regrouping them, so the cache and overdraw
+	// ordering is kept and neighbouring visible meshlets can still be drawn with a single call
+	Meshlet meshlet = {};
+	uint32_t meshletVertices = 0;
+	auto finishMeshlet = [&]()
+	{
+		const uint32_t first = meshlet.indexOffset;
+		const uint32_t last = meshlet.indexOffset + meshlet.indexCount;
+
+		MeshletVector boxMin = position(first), boxMax = boxMin;
+		for (uint32_t n = first; n < last; n++)
+		{
+			MeshletVector p = position(n);
+			boxMin.x = p.x < boxMin.x ? p.x : boxMin.x; boxMax.x = p.x > boxMax.x ? p.x : boxMax.x;
+			boxMin.y = p.y < boxMin.y ? p.y : boxMin.y; boxMax.y = p.y > boxMax.y ? p.y : boxMax.y;
+			boxMin.z = p.z < boxMin.z ? p.z : boxMin.z; boxMax.z = p.z > boxMax.z ? p.z : boxMax.z;
+		}
+		MeshletVector center = { (boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f };
+		float radiusSq = 0.0f;
+		for (uint32_t n = first; n < last; n++)
+		{
+			MeshletVector d = MeshletSub(position(n), center);
+			float distanceSq = MeshletDot(d, d);
+			radiusSq = distanceSq > radiusSq ? distanceSq : radiusSq;
+		}
+
+		// the cone axis is the average facing, counter-clockwise triangles being front facing
+		MeshletVector axis = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t n = first; n < last; n += 3)
+		{
+			MeshletVector p0 = position(n);
+			MeshletVector normal = MeshletCross(MeshletSub(position(n + 1), p0), MeshletSub(position(n + 2), p0));
+			float length = sqrtf(MeshletDot(normal, normal));
+			if (length > 0.0f)
+			{
+				axis.x += normal.x / length; axis.y += normal.y / length; axis.z += normal.z / length;
+			}
+		}
+		float axisLength = sqrtf(MeshletDot(axis, axis));
+
+		float minDot = 1.0f;
+		float apexDistance = 0.0f;
+		if (axisLength > 0.0f)
+		{
+			axis.x /= axisLength; axis.y /= axisLength; axis.z /= axisLength;
+			for (uint32_t n = first; n < last && minDot > 0.0f; n += 3)
 			{
-				if (vertexRemap[v2] != (uint32_t)-1)
-					continue; // this was already found to be a duplicate of another vertex
+				MeshletVector p0 = position(n);
+				MeshletVector normal = MeshletCross(MeshletSub(position(n + 1), p0), MeshletSub(position(n + 2), p0));
+				float length = sqrtf(MeshletDot(normal, normal));
+				if (length == 0.0f)
+					continue;
 
-				const unsigned char *v2Data = meshVertexData + v2 * vertexStride;
+				float axisDot = MeshletDot(normal, axis) / length;
+				minDot = axisDot < minDot ? axisDot : minDot;
 
-				if (0 == memcmp(v1Data, v2Data, vertexStride))
+				// push the apex back along the axis until it's behind this triangle's plane
+				if (axisDot > 0.0f)
 				{
-					vertexRemap[v2] = remappedSlot;
+					float distance = MeshletDot(MeshletSub(center, p0), normal) / (axisDot * length);
+					apexDistance = distance > apexDistance ? distance : apexDistance;
 				}
 			}
 		}
 
-		unsigned int indexCount = mesh->indexCount;
-		uint16_t *indexArray = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
-		for (unsigned int n = 0; n < indexCount; n++)
+		meshlet.center[0] = center.x; meshlet.center[1] = center.y; meshlet.center[2] = center.z;
+		meshlet.radius = sqrtf(radiusSq);
+		meshlet.coneAxis[0] = axis.x; meshlet.coneAxis[1] = axis.y; meshlet.coneAxis[2] = axis.z;
+		meshlet.coneApex[0] = center.x - axis.x * apexDistance;
+		meshlet.coneApex[1] = center.y - axis.y * apexDistance;
+		meshlet.coneApex[2] = center.z - axis.z * apexDistance;
+		// if the normals spread over a hemisphere or more, some triangle always faces the viewer
+		meshlet.coneCutoff = (axisLength > 0.0f && minDot > 0.0f) ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+
+		meshlets.push_back(meshlet);
+	};
+
+	meshlet.meshIndex = meshIndex;
+	for (uint32_t n = 0; n + 3 <= mesh->indexCount; n += 3)
+	{
+		uint32_t newVertices = 0;
+		for (uint32_t k = 0; k < 3; k++)
 		{
-			indexArray[n] = vertexRemap[indexArray[n]];
+			uint32_t index = GetIndex(indexArray, mesh->indexStride, n + k);
+			if (vertexMeshlet[index] != (uint32_t)meshlets.size())
+				newVertices++;
 		}
 
-		delete [] vertexRemap;
-
-		if (depth)
+		if (meshletVertices + newVertices > maxMeshletVertices || meshlet.indexCount == maxMeshletTriangles * 3)
 		{
-			mesh->vertexCountDepth = deduplicatedCount;
-			mesh->vertexDataByteOffsetDepth = deduplicatedVertexDataSize;
+			finishMeshlet();
+			meshlet.indexOffset = n;
+			meshlet.indexCount = 0;
+			meshletVertices = 0;
 		}
-		else
+
+		for (uint32_t k = 0; k < 3; k++)
 		{
-			mesh->vertexCount = deduplicatedCount;
-			mesh->vertexDataByteOffset = deduplicatedVertexDataSize;
+			uint32_t index = GetIndex(indexArray, mesh->indexStride, n + k);
+			if (vertexMeshlet[index] != (uint32_t)meshlets.size())
+			{
+				vertexMeshlet[index] = (uint32_t)meshlets.size();
+				meshletVertices++;
+			}
 		}
-		deduplicatedVertexDataSize += deduplicatedCount * vertexStride;
+		meshlet.indexCount += 3;
 	}
 
-	if (depth)
-	{
-		delete [] m_pVertexDataDepth;
-		m_pVertexDataDepth = deduplicatedVertexData;
-		m_Header.vertexDataByteSizeDepth = deduplicatedVertexDataSize;
-	}
-	else
-	{
-		delete [] m_pVertexData;
-		m_pVertexData = deduplicatedVertexData;
-		m_Header.vertexDataByteSize = deduplicatedVertexDataSize;
-	}
+	if (meshlet.indexCount > 0)
+		finishMeshlet();
 }
 
-void Model::OptimizePostTransform(bool depth)
+namespace
 {
-	enum {lruCacheSize = 64};
+	// no lod may move the surface further than this fraction of the mesh's size
+	const float kLodMaxRelativeError = 0.05f;
+	// a lod that doesn't lose at least this fraction of the triangles isn't worth keeping
+	const float kLodMinReduction = 0.2f;
+}
 
-	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+void Model::OptimizeBuildLods(unsigned int meshIndex, std::vector<MeshLod> &lods, std::vector<unsigned char> &lodIndexData) const
+{
+	OptimizeScratch &scratch = t_OptimizeScratch;
+	const Mesh *mesh = m_pMesh + meshIndex;
+
+	const unsigned char *indexArray = m_pIndexData + mesh->indexDataByteOffset;
+	const unsigned char *positionData = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+	const float maxError = kLodMaxRelativeError * (float)Length(mesh->boundingBox.max - mesh->boundingBox.min);
+
+	// every lod is simplified from the full mesh, so its error is measured against what it stands in for
+	uint32_t previousIndexCount = mesh->indexCount;
+	for (unsigned int level = 1; level <= s_OptimizeLodCount; level++)
 	{
-		Mesh *mesh = m_pMesh + meshIndex;
+		const uint32_t targetIndexCount = (mesh->indexCount >> level) / 3 * 3;
+		if (targetIndexCount == 0)
+			break;
 
-		uint16_t *srcIndices = new uint16_t [mesh->indexCount];
-		uint16_t *dstIndices = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
-		memcpy(srcIndices, dstIndices, sizeof(uint16_t) * mesh->indexCount);
+		scratch.indexData.resize(mesh->indexCount * mesh->indexStride);
+		unsigned char *simplified = scratch.indexData.data();
 
-		OptimizeFaces<uint16_t>(srcIndices, mesh->indexCount, dstIndices, lruCacheSize);
+		MeshLod lod;
+		lod.meshIndex = meshIndex;
+		if (mesh->indexStride == sizeof(uint32_t))
+			lod.indexCount = SimplifyMesh<uint32_t>((const uint32_t*)indexArray, mesh->indexCount, positionData, mesh->vertexStride, mesh->vertexCount, (uint32_t*)simplified, targetIndexCount, maxError, &lod.error);
+		else
+			lod.indexCount = SimplifyMesh<uint16_t>((const uint16_t*)indexArray, mesh->indexCount, positionData, mesh->vertexStride, mesh->vertexCount, (uint16_t*)simplified, targetIndexCount, maxError, &lod.error);
 
-		delete [] srcIndices;
+		// stuck on locked seams and borders, or out of error budget
+		if (lod.indexCount == 0 || lod.indexCount > previousIndexCount * (1.0f - kLodMinReduction))
+			break;
+		previousIndexCount = lod.indexCount;
+
+		lod.indexDataByteOffset = (uint32_t)lodIndexData.size();
+		lodIndexData.resize(lodIndexData.size() + lod.indexCount * mesh->indexStride);
+		unsigned char *dstIndices = lodIndexData.data() + lod.indexDataByteOffset;
+
+		// the cache order doesn't survive simplification, so redo it
+		if (mesh->indexStride == sizeof(uint32_t))
+			OptimizeFaces<uint32_t>((const uint32_t*)simplified, lod.indexCount, (uint32_t*)dstIndices, lruCacheSize);
+		else
+			OptimizeFaces<uint16_t>((const uint16_t*)simplified, lod.indexCount, (uint16_t*)dstIndices, lruCacheSize);
+
+		lods.push_back(lod);
 	}
 }
 
-void Model::OptimizePreTransform(bool depth)
+void Model::OptimizeAppendLods(const std::vector<std::vector<MeshLod>> &meshLods, const std::vector<std::vector<unsigned char>> &meshLodIndexData)
 {
-	unsigned char *reorderedVertexData = new unsigned char [depth ? m_Header.vertexDataByteSizeDepth : m_Header.vertexDataByteSize];
-
+	delete [] m_pLod;
+	m_LodCount = 0;
+	uint32_t lodIndexDataByteSize = 0;
 	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
 	{
-		Mesh *mesh = m_pMesh + meshIndex;
-		unsigned int indexCount = mesh->indexCount;
-		unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
-		unsigned char *meshVertexData = depth ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth) : (m_pVertexData + mesh->vertexDataByteOffset);
+		m_LodCount += (uint32_t)meshLods[meshIndex].size();
+		lodIndexDataByteSize += (uint32_t)meshLodIndexData[meshIndex].size();
+	}
+	m_pLod = new MeshLod [m_LodCount];
+
+	// the lod indices follow the meshes' own in the render index buffer only. They index the render vertices,
+	// and the depth vertices are welded and ordered separately, so lods are always drawn from the render streams
+	const uint32_t indexDataByteSize = m_Header.indexDataByteSize + lodIndexDataByteSize;
+	unsigned char *indexData = new unsigned char [indexDataByteSize];
+	memcpy(indexData, m_pIndexData, m_Header.indexDataByteSize);
+	if (m_pIndexDataDepth == m_pIndexData)
+		m_pIndexDataDepth = indexData;
+	if (!IsMapped(m_pIndexData))
+		delete [] m_pIndexData;
+
+	MeshLod *lod = m_pLod;
+	uint32_t lodIndexDataByteOffset = m_Header.indexDataByteSize;
+	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+	{
+		const std::vector<unsigned char> &lodIndexData = meshLodIndexData[meshIndex];
+		if (!lodIndexData.empty())
+			memcpy(indexData + lodIndexDataByteOffset, lodIndexData.data(), lodIndexData.size());
 
-		unsigned char *meshReorderedVertexData = reorderedVertexData + (depth ? mesh->vertexDataByteOffsetDepth : mesh->vertexDataByteOffset);
-		unsigned int reorderedCount = 0;
+		for (size_t n = 0; n < meshLods[meshIndex].size(); n++, lod++)
+		{
+			*lod = meshLods[meshIndex][n];
+			lod->indexDataByteOffset += lodIndexDataByteOffset;
+		}
+		lodIndexDataByteOffset += (uint32_t)lodIndexData.size();
+	}
+
+	m_pIndexData = indexData;
+	m_Header.indexDataByteSize = indexDataByteSize;
+}
+
+namespace
+{
+	// meshes smaller than this fraction of the model's size rarely hide anything worth the triangles
+	const float kOccluderMinRelativeSize = 0.1f;
+	// an occluder may not have more triangles than this, so one big mesh can't take the whole budget
+	const uint32_t kOccluderMaxTriangles = 4096;
+	// the depth and color shaders discard texels whose diffuse alpha is under a half
+	const unsigned int kAlphaTestThreshold = 128;
+
+	std::vector<unsigned char> ReadWholeFile(const std::string &path)
+	{
+		std::vector<unsigned char> data;
+		FILE *file = nullptr;
+		if (0 != fopen_s(&file, path.c_str(), "rb"))
+			return data;
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		if (size > 0)
+		{
+			data.resize((size_t)size);
+			if (1 != fread(data.data(), data.size(), 1, file))
+				data.clear();
+		}
+		fclose(file);
+		return data;
+	}
+
+	bool BC1BlockHasCutout(const unsigned char *block)
+	{
+		// only blocks in three color mode have a transparent index
+		const unsigned int color0 = block[0] | (block[1] << 8);
+		const unsigned int color1 = block[2] | (block[3] << 8);
+		if (color0 > color1)
+			return false;
+
+		uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+		for (int texel = 0; texel < 16; texel++, indices >>= 2)
+		{
+			if ((indices & 3) == 3)
+				return true;
+		}
+		return false;
+	}
 
-		unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
-		uint32_t *vertexRemap = new uint32_t [vertexCount];
-		memset(vertexRemap, (uint32_t)-1, sizeof(uint32_t) * vertexCount);
-		assert(vertexCount <= (uint32_t)-1);
+	bool BC2BlockHasCutout(const unsigned char *block)
+	{
+		for (int n = 0; n < 8; n++)
+		{
+			if ((block[n] & 0xf) * 17 < kAlphaTestThreshold || (block[n] >> 4) * 17 < kAlphaTestThreshold)
+				return true;
+		}
+		return false;
+	}
 
-		uint16_t *indexArray = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
-		for (unsigned int n = 0; n < indexCount; n++)
+	bool BC3BlockHasCutout(const unsigned char *block)
+	{
+		const unsigned int alpha0 = block[0];
+		const unsigned int alpha1 = block[1];
+		unsigned int palette[8] = { alpha0, alpha1 };
+		if (alpha0 > alpha1)
+		{
+			for (unsigned int n = 1; n < 7; n++)
+				palette[n + 1] = ((7 - n) * alpha0 + n * alpha1) / 7;
+		}
+		else
 		{
-			uint16_t index = indexArray[n];
-			if (vertexRemap[index] == (uint32_t)-1)
+			for (unsigned int n = 1; n < 5; n++)
+				palette[n + 1] = ((5 - n) * alpha0 + n * alpha1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (int n = 0; n < 6; n++)
+			indices |= (uint64_t)block[2 + n] << (8 * n);
+		for (int texel = 0; texel < 16; texel++, indices >>= 3)
+		{
+			if (palette[indices & 7] < kAlphaTestThreshold)
+				return true;
+		}
+		return false;
+	}
+
+	// looks at every texel of the top mip, formats it can't read count as cut out
+	bool DDSHasCutout(const std::vector<unsigned char> &file)
+	{
+		DDS::TextureLayout layout;
+		if (DDS::ParseDDS(file.data(), file.size(), layout) != DDS::Result::Ok || layout.Subresources.empty())
+			return true;
+		if (layout.AlphaMode == DDS_ALPHA_MODE_OPAQUE)
+			return false;
+
+		const DDS::Subresource &top = layout.Subresources[0];
+		const unsigned char *data = file.data() + top.Offset;
+		bool (*blockHasCutout)(const unsigned char *) = nullptr;
+		size_t blockSize = 16;
+
+		switch (layout.Format)
+		{
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC6H_SF16:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		case DXGI_FORMAT_B5G6R5_UNORM:
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+			return false;
+
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			for (uint32_t row = 0; row < top.NumRows; row++)
 			{
-				// not relocated yet
-				const unsigned char *vSrc = meshVertexData + index * vertexStride;
-				unsigned char *vDst = meshReorderedVertexData + reorderedCount * vertexStride;
-				memcpy(vDst, vSrc, vertexStride);
+				const unsigned char *texel = data + (size_t)row * top.RowPitch;
+				for (uint32_t x = 0; x < top.Width; x++, texel += 4)
+				{
+					if (texel[3] < kAlphaTestThreshold)
+						return true;
+				}
+			}
+			return false;
+
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			blockHasCutout = BC1BlockHasCutout;
+			blockSize = 8;
+			break;
+
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+			blockHasCutout = BC2BlockHasCutout;
+			break;
+
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			blockHasCutout = BC3BlockHasCutout;
+			break;
+
+		default:
+			return true;
+		}
 
-				vertexRemap[index] = reorderedCount;
-				reorderedCount++;
+		const uint32_t blocksPerRow = (top.Width + 3) / 4;
+		for (uint32_t row = 0; row < top.NumRows; row++)
+		{
+			const unsigned char *block = data + (size_t)row * top.RowPitch;
+			for (uint32_t x = 0; x < blocksPerRow; x++, block += blockSize)
+			{
+				if (blockHasCutout(block))
+					return true;
 			}
-			indexArray[n] = vertexRemap[index];
 		}
+		return false;
+	}
 
-		delete [] vertexRemap;
+	// whether the alpha test could discard any of the material's diffuse texture, found the way
+	// TextureManager::LoadFromFile finds it. A texture that can't be found or read counts as cut out.
+	bool IsCutoutMaterial(const Model::Material &material)
+	{
+		const std::string path = std::string(Model::s_OptimizeTextureRoot) + (material.texDiffusePath[0] ? material.texDiffusePath : "default");
+
+		std::vector<unsigned char> file = ReadWholeFile(path + ".dds");
+		if (!file.empty())
+			return DDSHasCutout(file);
+
+		// only 24 bit targas are sure to be opaque without decoding them
+		file = ReadWholeFile(path + ".tga");
+		return file.size() < 18 || file[16] != 24;
 	}
+}
 
-	if (depth)
+// the biggest meshes that are solid all over, drawn with their own indices. A lod could bulge past the real
+// surface and hide things that are visible, so a mesh with too many triangles isn't used at all.
+void Model::OptimizeSelectOccluders()
+{
+	delete [] m_pOccluder;
+	m_pOccluder = nullptr;
+	m_OccluderCount = 0;
+
+	struct Candidate
 	{
-		delete [] m_pVertexDataDepth;
-		m_pVertexDataDepth = reorderedVertexData;
+		float size;
+		uint32_t triangleCount;
+		MeshOccluder occluder;
+	};
+	std::vector<Candidate> candidates;
+
+	// 0 = not looked at yet, 1 = opaque, 2 = cut out or translucent
+	std::vector<unsigned char> materialCutout(m_Header.materialCount, 0);
+
+	const float modelSize = (float)Length(m_Header.boundingBox.max - m_Header.boundingBox.min);
+	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+	{
+		const Mesh *mesh = m_pMesh + meshIndex;
+		const Attrib &position = mesh->attrib[attrib_position];
+		const uint32_t triangleCount = mesh->indexCount / 3;
+		if (position.format != attrib_format_float || position.components < 3 || triangleCount == 0 || triangleCount > kOccluderMaxTriangles)
+			continue;
+
+		const float size = (float)Length(mesh->boundingBox.max - mesh->boundingBox.min);
+		if (size < kOccluderMinRelativeSize * modelSize)
+			continue;
+
+		unsigned char &cutout = materialCutout[mesh->materialIndex];
+		if (cutout == 0)
+		{
+			const Material &material = m_pMaterial[mesh->materialIndex];
+			cutout = (material.opacity < 1.0f || IsCutoutMaterial(material)) ? 2 : 1;
+		}
+		if (cutout == 2)
+			continue;
+
+		Candidate candidate = { size, triangleCount, { meshIndex } };
+		candidates.push_back(candidate);
 	}
-	else
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) { return a.size > b.size; });
+
+	std::vector<MeshOccluder> occluders;
+	uint32_t triangleCount = 0;
+	for (const Candidate &candidate : candidates)
 	{
-		delete [] m_pVertexData;
-		m_pVertexData = reorderedVertexData;
+		if (triangleCount + candidate.triangleCount > s_OptimizeOccluderTriangles)
+			continue;
+		triangleCount += candidate.triangleCount;
+		occluders.push_back(candidate.occluder);
 	}
+
+	std::sort(occluders.begin(), occluders.end(), [](const MeshOccluder &a, const MeshOccluder &b) { return a.meshIndex < b.meshIndex; });
+
+	m_OccluderCount = (uint32_t)occluders.size();
+	m_pOccluder = new MeshOccluder [m_OccluderCount];
+	std::copy(occluders.begin(), occluders.end(), m_pOccluder);
 }
 
 void Model::Optimize()
 {
 	// TODO: quantize/compress vertex data
 
-	OptimizeRemoveDuplicateVertices(false);
-	OptimizeRemoveDuplicateVertices(true);
+	// lods from an earlier run are at the end of the index data and index the old vertex order
+	if (m_LodCount > 0)
+		m_Header.indexDataByteSize = m_pLod[0].indexDataByteOffset;
+
+	std::vector<std::vector<Meshlet>> meshMeshlets(m_Header.meshCount);
+	std::vector<std::vector<MeshLod>> meshLods(m_Header.meshCount);
+	std::vector<std::vector<unsigned char>> meshLodIndexData(m_Header.meshCount);
+
+	// every pass stays within the mesh's own vertex and index ranges, so the meshes are independent
+	concurrency::parallel_for(0u, m_Header.meshCount, [&](unsigned int meshIndex)
+	{
+		Mesh *mesh = m_pMesh + meshIndex;
+
+		OptimizeRemoveDuplicateVertices(mesh, false);
+		OptimizeRemoveDuplicateVertices(mesh, true);
+
+		// re-order indices for post transform cache
+		OptimizePostTransform(mesh, false);
+		OptimizePostTransform(mesh, true);
+
+		// then trade a little of that for drawing likely occluders first
+		if (s_OptimizeOverdrawThreshold > 0.0f)
+		{
+			OptimizeOverdraw(mesh, false);
+			OptimizeOverdraw(mesh, true);
+		}
+
+		// re-order vertices for linear memory access
+		OptimizePreTransform(mesh, false);
+		OptimizePreTransform(mesh, true);
+
+		// split the final triangle order into culling clusters
+		OptimizeBuildMeshlets(meshIndex, meshMeshlets[meshIndex]);
+
+		OptimizeBuildLods(meshIndex, meshLods[meshIndex], meshLodIndexData[meshIndex]);
+	});
+
+	OptimizeCompactVertexData(false);
+	OptimizeCompactVertexData(true);
+
+	delete [] m_pMeshlet;
+	m_MeshletCount = 0;
+	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+		m_MeshletCount += (uint32_t)meshMeshlets[meshIndex].size();
+	m_pMeshlet = new Meshlet [m_MeshletCount];
+
+	Meshlet *meshlet = m_pMeshlet;
+	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+	{
+		std::copy(meshMeshlets[meshIndex].begin(), meshMeshlets[meshIndex].end(), meshlet);
+		meshlet += meshMeshlets[meshIndex].size();
+	}
 
-	// re-order indices for post transform cache
-	OptimizePostTransform(false);
-	OptimizePostTransform(true);
+	OptimizeAppendLods(meshLods, meshLodIndexData);
+	IndexMeshRanges();
 
-	// re-order vertices for linear memory access
-	OptimizePreTransform(false);
-	OptimizePreTransform(true);
+	OptimizeSelectOccluders();
 }
 
 } // namespace Graphics
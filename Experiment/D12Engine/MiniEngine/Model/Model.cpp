@@ -15,6 +15,7 @@
 #include "Model.h"
 #include <string.h>
 #include <float.h>
+#include <ppl.h>
 
 
 namespace Graphics
@@ -46,12 +47,28 @@ int Model::FormatFromFilename(const char *filename)
 
 Model::Model( )
 	: m_pMesh(nullptr)
+	, m_pMeshBoundingSphere(nullptr)
+	, m_pMeshSphereSoA(nullptr)
+	, m_MeshSphereStride(0)
 	, m_pMaterial(nullptr)
 	, m_pVertexData(nullptr)
 	, m_pIndexData(nullptr)
 	, m_pVertexDataDepth(nullptr)
 	, m_pIndexDataDepth(nullptr)
+	, m_pMeshlet(nullptr)
+	, m_MeshletCount(0)
+	, m_pMeshFirstMeshlet(nullptr)
+	, m_pLod(nullptr)
+	, m_LodCount(0)
+	, m_pMeshFirstLod(nullptr)
+	, m_pOccluder(nullptr)
+	, m_OccluderCount(0)
+	, m_pOccluderGeometry(nullptr)
+	, m_pOccluderPositions(nullptr)
+	, m_pOccluderIndices(nullptr)
 	, m_SRVs(nullptr)
+	, m_pMappedFile(nullptr)
+	, m_MappedFileSize(0)
     , m_transformation()
 {
 	Clear();
@@ -59,12 +76,28 @@ Model::Model( )
 
 Model::Model( const Matrix4& transformation )
 	: m_pMesh(nullptr)
+	, m_pMeshBoundingSphere(nullptr)
+	, m_pMeshSphereSoA(nullptr)
+	, m_MeshSphereStride(0)
 	, m_pMaterial(nullptr)
 	, m_pVertexData(nullptr)
 	, m_pIndexData(nullptr)
 	, m_pVertexDataDepth(nullptr)
 	, m_pIndexDataDepth(nullptr)
+	, m_pMeshlet(nullptr)
+	, m_MeshletCount(0)
+	, m_pMeshFirstMeshlet(nullptr)
+	, m_pLod(nullptr)
+	, m_LodCount(0)
+	, m_pMeshFirstLod(nullptr)
+	, m_pOccluder(nullptr)
+	, m_OccluderCount(0)
+	, m_pOccluderGeometry(nullptr)
+	, m_pOccluderPositions(nullptr)
+	, m_pOccluderIndices(nullptr)
 	, m_SRVs(nullptr)
+	, m_pMappedFile(nullptr)
+	, m_MappedFileSize(0)
     , m_transformation( transformation )
 {
 	Clear();
@@ -82,18 +115,57 @@ void Model::Clear()
 	m_VertexBufferDepth.Destroy();
 	m_IndexBufferDepth.Destroy();
 
-	delete [] m_pMesh;
+	if (!IsMapped(m_pMesh))
+		delete [] m_pMesh;
 	m_pMesh = nullptr;
 	m_Header.meshCount = 0;
 
-	delete [] m_pMaterial;
+	if (!IsMapped(m_pMaterial))
+		delete [] m_pMaterial;
 	m_pMaterial = nullptr;
 	m_Header.materialCount = 0;
 
-	delete [] m_pVertexData;
-	delete [] m_pIndexData;
-	delete [] m_pVertexDataDepth;
-	delete [] m_pIndexDataDepth;
+	if (!IsMapped(m_pVertexData))
+		delete [] m_pVertexData;
+	if (!IsMapped(m_pIndexData))
+		delete [] m_pIndexData;
+	if (!IsMapped(m_pVertexDataDepth))
+		delete [] m_pVertexDataDepth;
+	if (m_pIndexDataDepth != m_pIndexData && !IsMapped(m_pIndexDataDepth))
+		delete [] m_pIndexDataDepth;
+
+	if (!IsMapped(m_pMeshlet))
+		delete [] m_pMeshlet;
+	m_pMeshlet = nullptr;
+	m_MeshletCount = 0;
+	delete [] m_pMeshFirstMeshlet;
+	m_pMeshFirstMeshlet = nullptr;
+	if (!IsMapped(m_pLod))
+		delete [] m_pLod;
+	m_pLod = nullptr;
+	m_LodCount = 0;
+	delete [] m_pMeshFirstLod;
+	m_pMeshFirstLod = nullptr;
+	if (!IsMapped(m_pOccluder))
+		delete [] m_pOccluder;
+	m_pOccluder = nullptr;
+	m_OccluderCount = 0;
+	delete [] m_pOccluderGeometry;
+	m_pOccluderGeometry = nullptr;
+	delete [] m_pOccluderPositions;
+	m_pOccluderPositions = nullptr;
+	delete [] m_pOccluderIndices;
+	m_pOccluderIndices = nullptr;
+	delete [] m_pMeshBoundingSphere;
+	m_pMeshBoundingSphere = nullptr;
+	delete [] m_pMeshSphereSoA;
+	m_pMeshSphereSoA = nullptr;
+	m_MeshSphereStride = 0;
+
+	if (m_pMappedFile != nullptr)
+		UnmapViewOfFile(m_pMappedFile);
+	m_pMappedFile = nullptr;
+	m_MappedFileSize = 0;
 
 	m_pVertexData = nullptr;
 	m_Header.vertexDataByteSize = 0;
@@ -165,22 +237,40 @@ void Model::ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) co
 
 	if (mesh->vertexCount > 0)
 	{
-		unsigned int vertexStride = mesh->vertexStride;
+		const unsigned int vertexStride = mesh->vertexStride;
 
-		const float *p = (float*)(m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset);
-		const float *pEnd = (float*)(m_pVertexData + mesh->vertexDataByteOffset + mesh->vertexCount * mesh->vertexStride + mesh->attrib[attrib_position].offset);
-		bbox.min = Scalar(FLT_MAX);
-		bbox.max = Scalar(-FLT_MAX);
+		const unsigned char *p = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+		const unsigned char *pLast = p + (mesh->vertexCount - 1) * vertexStride;
 
-		while (p < pEnd)
-		{
-			Vector3 pos(*(p + 0), *(p + 1), *(p + 2));
+		// every position but the last is read as four floats, the fourth belonging to whatever follows it.
+		// Four vertices go through four separate min/max chains so the loads don't wait on each other
+		XMVECTOR min0 = XMLoadFloat3((const XMFLOAT3*)pLast);
+		XMVECTOR max0 = min0;
+		XMVECTOR min1 = min0, min2 = min0, min3 = min0;
+		XMVECTOR max1 = max0, max2 = max0, max3 = max0;
 
-			bbox.min = Min(bbox.min, pos);
-			bbox.max = Max(bbox.max, pos);
+		for (; p + 3 * vertexStride < pLast; p += 4 * vertexStride)
+		{
+			XMVECTOR v0 = XMLoadFloat4((const XMFLOAT4*)(p));
+			XMVECTOR v1 = XMLoadFloat4((const XMFLOAT4*)(p + vertexStride));
+			XMVECTOR v2 = XMLoadFloat4((const XMFLOAT4*)(p + 2 * vertexStride));
+			XMVECTOR v3 = XMLoadFloat4((const XMFLOAT4*)(p + 3 * vertexStride));
+
+			min0 = XMVectorMin(min0, v0); max0 = XMVectorMax(max0, v0);
+			min1 = XMVectorMin(min1, v1); max1 = XMVectorMax(max1, v1);
+			min2 = XMVectorMin(min2, v2); max2 = XMVectorMax(max2, v2);
+			min3 = XMVectorMin(min3, v3); max3 = XMVectorMax(max3, v3);
+		}
 
-			(*(uint8_t**)&p) += vertexStride;
+		for (; p < pLast; p += vertexStride)
+		{
+			XMVECTOR v = XMLoadFloat4((const XMFLOAT4*)p);
+			min0 = XMVectorMin(min0, v);
+			max0 = XMVectorMax(max0, v);
 		}
+
+		bbox.min = Vector3(XMVectorSetW(XMVectorMin(XMVectorMin(min0, min1), XMVectorMin(min2, min3)), 0.0f));
+		bbox.max = Vector3(XMVectorSetW(XMVectorMax(XMVectorMax(max0, max1), XMVectorMax(max2, max3)), 0.0f));
 	}
 	else
 	{
@@ -189,6 +279,69 @@ void Model::ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) co
 	}
 }
 
+// Ritter's sphere: start from the most separated pair of extremes along the axes, then grow it to take in
+// any vertex left outside. Usually within a few percent of the smallest sphere, and much tighter than the box's.
+void Model::ComputeMeshBoundingSphere(unsigned int meshIndex, BoundingSphere &sphere) const
+{
+	const Mesh *mesh = m_pMesh + meshIndex;
+
+	if (mesh->vertexCount == 0)
+	{
+		sphere = BoundingSphere(Vector3(kZero), Scalar(0.0f));
+		return;
+	}
+
+	const unsigned int vertexStride = mesh->vertexStride;
+	const unsigned char *pFirst = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+	const unsigned char *pEnd = pFirst + mesh->vertexCount * vertexStride;
+
+	const float *extremeMin[3] = { (const float*)pFirst, (const float*)pFirst, (const float*)pFirst };
+	const float *extremeMax[3] = { (const float*)pFirst, (const float*)pFirst, (const float*)pFirst };
+	for (const unsigned char *p = pFirst; p < pEnd; p += vertexStride)
+	{
+		const float *position = (const float*)p;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (position[axis] < extremeMin[axis][axis])
+				extremeMin[axis] = position;
+			if (position[axis] > extremeMax[axis][axis])
+				extremeMax[axis] = position;
+		}
+	}
+
+	int widestAxis = 0;
+	float widestDistanceSquared = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		Vector3 extent = Vector3(XMLoadFloat3((const XMFLOAT3*)extremeMax[axis])) - Vector3(XMLoadFloat3((const XMFLOAT3*)extremeMin[axis]));
+		float distanceSquared = LengthSquare(extent);
+		if (distanceSquared > widestDistanceSquared)
+		{
+			widestAxis = axis;
+			widestDistanceSquared = distanceSquared;
+		}
+	}
+
+	const Vector3 widestMin(XMLoadFloat3((const XMFLOAT3*)extremeMin[widestAxis]));
+	const Vector3 widestMax(XMLoadFloat3((const XMFLOAT3*)extremeMax[widestAxis]));
+	Vector3 center = (widestMin + widestMax) * 0.5f;
+	float radius = Length(widestMax - center);
+
+	for (const unsigned char *p = pFirst; p < pEnd; p += vertexStride)
+	{
+		Vector3 position(XMLoadFloat3((const XMFLOAT3*)p));
+		float distance = Length(position - center);
+		if (distance > radius)
+		{
+			float newRadius = (radius + distance) * 0.5f;
+			center = center + (position - center) * ((newRadius - radius) / distance);
+			radius = newRadius;
+		}
+	}
+
+	sphere = BoundingSphere(center, Scalar(radius));
+}
+
 void Model::ComputeGlobalBoundingBox(BoundingBox &bbox) const
 {
 	if (m_Header.meshCount > 0)
@@ -212,14 +365,148 @@ void Model::ComputeGlobalBoundingBox(BoundingBox &bbox) const
 
 void Model::ComputeAllBoundingBoxes()
 {
-	for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+	concurrency::parallel_for(0u, m_Header.meshCount, [this](unsigned int meshIndex)
 	{
 		Mesh *mesh = m_pMesh + meshIndex;
 		ComputeMeshBoundingBox(meshIndex, mesh->boundingBox);
-	}
+	});
 	ComputeGlobalBoundingBox(m_Header.boundingBox);
 }
 
+void Model::ComputeAllBoundingSpheres()
+{
+	delete [] m_pMeshBoundingSphere;
+	m_pMeshBoundingSphere = new BoundingSphere [m_Header.meshCount];
+
+	concurrency::parallel_for(0u, m_Header.meshCount, [this](unsigned int meshIndex)
+	{
+		ComputeMeshBoundingSphere(meshIndex, m_pMeshBoundingSphere[meshIndex]);
+	});
+
+	// padded so the culling loop can always load whole groups of spheres
+	delete [] m_pMeshSphereSoA;
+	m_MeshSphereStride = AlignUp(m_Header.meshCount, Frustum::kSphereBatch);
+	m_pMeshSphereSoA = new float [4 * m_MeshSphereStride];
+	for (uint32_t i = 0; i < m_MeshSphereStride; i++)
+	{
+		const bool isMesh = i < m_Header.meshCount;
+		const Vector3 center = isMesh ? m_pMeshBoundingSphere[i].GetCenter() : Vector3(kZero);
+		m_pMeshSphereSoA[i] = center.GetX();
+		m_pMeshSphereSoA[i + m_MeshSphereStride] = center.GetY();
+		m_pMeshSphereSoA[i + 2 * m_MeshSphereStride] = center.GetZ();
+		m_pMeshSphereSoA[i + 3 * m_MeshSphereStride] = isMesh ? (float)m_pMeshBoundingSphere[i].GetRadius() : 0.0f;
+	}
+}
+
+namespace
+{
+	// items sorted by meshIndex, returns where each mesh's items start plus the end
+	template <typename T>
+	uint32_t *IndexByMesh(const T *items, uint32_t itemCount, uint32_t meshCount)
+	{
+		uint32_t *first = new uint32_t [meshCount + 1];
+
+		uint32_t itemIndex = 0;
+		for (uint32_t meshIndex = 0; meshIndex <= meshCount; meshIndex++)
+		{
+			while (itemIndex < itemCount && items[itemIndex].meshIndex < meshIndex)
+				itemIndex++;
+			first[meshIndex] = itemIndex;
+		}
+		return first;
+	}
+}
+
+void Model::IndexMeshRanges()
+{
+	delete [] m_pMeshFirstMeshlet;
+	m_pMeshFirstMeshlet = IndexByMesh(m_pMeshlet, m_MeshletCount, m_Header.meshCount);
+	delete [] m_pMeshFirstLod;
+	m_pMeshFirstLod = IndexByMesh(m_pLod, m_LodCount, m_Header.meshCount);
+}
+
+// the occlusion buffer is drawn on the cpu, so each occluder gets only the positions it uses, packed together
+void Model::BuildOccluderGeometry()
+{
+	delete [] m_pOccluderGeometry;
+	delete [] m_pOccluderPositions;
+	delete [] m_pOccluderIndices;
+	m_pOccluderGeometry = new OccluderGeometry [m_OccluderCount];
+
+	uint32_t positionCount = 0;
+	uint32_t indexCount = 0;
+	for (uint32_t occluderIndex = 0; occluderIndex < m_OccluderCount; occluderIndex++)
+	{
+		const Mesh &mesh = m_pMesh[m_pOccluder[occluderIndex].meshIndex];
+		positionCount += mesh.indexCount < mesh.vertexCount ? mesh.indexCount : mesh.vertexCount;
+		indexCount += mesh.indexCount;
+	}
+	m_pOccluderPositions = new XMFLOAT3 [positionCount];
+	m_pOccluderIndices = new uint32_t [indexCount];
+
+	std::vector<uint32_t> remap;
+	positionCount = 0;
+	indexCount = 0;
+	for (uint32_t occluderIndex = 0; occluderIndex < m_OccluderCount; occluderIndex++)
+	{
+		const Mesh &mesh = m_pMesh[m_pOccluder[occluderIndex].meshIndex];
+		const unsigned char *positionData = m_pVertexData + mesh.vertexDataByteOffset + mesh.attrib[attrib_position].offset;
+		const unsigned char *indexData = m_pIndexData + mesh.indexDataByteOffset;
+
+		OccluderGeometry &geometry = m_pOccluderGeometry[occluderIndex];
+		geometry.firstPosition = positionCount;
+		geometry.firstIndex = indexCount;
+		geometry.indexCount = mesh.indexCount;
+
+		remap.assign(mesh.vertexCount, ~0u);
+		for (uint32_t n = 0; n < geometry.indexCount; n++)
+		{
+			uint32_t vertex = GetIndex(indexData, mesh.indexStride, n);
+			if (remap[vertex] == ~0u)
+			{
+				remap[vertex] = positionCount - geometry.firstPosition;
+				memcpy(m_pOccluderPositions + positionCount++, positionData + vertex * mesh.vertexStride, sizeof(XMFLOAT3));
+			}
+			m_pOccluderIndices[indexCount++] = remap[vertex];
+		}
+		geometry.positionCount = positionCount - geometry.firstPosition;
+	}
+}
+
+const Model::MeshLod *Model::SelectLod(unsigned int meshIndex, float maxError) const
+{
+	if (m_LodCount == 0)
+		return nullptr;
+
+	// errors only grow along the chain
+	const MeshLod *selected = nullptr;
+	for (uint32_t lodIndex = m_pMeshFirstLod[meshIndex]; lodIndex < m_pMeshFirstLod[meshIndex + 1]; lodIndex++)
+	{
+		if (m_pLod[lodIndex].error > maxError)
+			break;
+		selected = m_pLod + lodIndex;
+	}
+	return selected;
+}
+
+bool Model::IsMeshletVisible(const Meshlet &meshlet, const Frustum &frustum, const Vector3 *viewerPosition)
+{
+	Vector3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+	if (!frustum.IntersectSphere(BoundingSphere(center, Scalar(meshlet.radius))))
+		return false;
+
+	if (viewerPosition != nullptr && meshlet.coneCutoff < 1.0f)
+	{
+		Vector3 apex(meshlet.coneApex[0], meshlet.coneApex[1], meshlet.coneApex[2]);
+		Vector3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+		Vector3 toApex = apex - *viewerPosition;
+		if ((float)Dot(toApex, axis) >= meshlet.coneCutoff * (float)Length(toApex))
+			return false;
+	}
+
+	return true;
+}
+
 void Model::LoadPostProcess(bool needToOptimize)
 {
 	if (needToOptimize)
@@ -230,6 +517,10 @@ void Model::LoadPostProcess(bool needToOptimize)
 		assert(0);
 #endif
 	}
+
+	// h3d files don't store spheres, and they have to follow the vertices the optimizer moved
+	ComputeAllBoundingSpheres();
+	BuildOccluderGeometry();
 }
 
 void Model::setTransformation( const Matrix4& transformation )
@@ -15,9 +15,12 @@
 #pragma once
 
 #include "VectorMath.h"
+#include "Math/Frustum.h"
 #include "TextureManager.h"
 #include "GpuBuffer.h"
 
+#include <vector>
+
 namespace Graphics
 {
 	using namespace Math;
@@ -169,9 +172,104 @@ public:
 
 		unsigned int vertexDataByteOffsetDepth;
 		unsigned int vertexCountDepth;
+
+		unsigned int indexStride; // 2 or 4, for both index buffers (v1 h3d files leave this as padding)
 	};
 	Mesh *m_pMesh;
 
+	// tighter than the mesh's box for culling, computed on load rather than stored in the file
+	BoundingSphere *m_pMeshBoundingSphere;
+
+	// the same spheres as separate center x, y, z and radius arrays, m_MeshSphereStride floats apart, for Frustum::IntersectSpheres
+	float *m_pMeshSphereSoA;
+	uint32_t m_MeshSphereStride;
+
+	// writes the indices of the meshes whose bounding spheres intersect the model space frustum, returns how many
+	uint32_t CullMeshes(const Frustum &frustum, uint32_t *visibleMeshes) const
+	{
+		const float *soa = m_pMeshSphereSoA;
+		return frustum.IntersectSpheres(soa, soa + m_MeshSphereStride, soa + 2 * m_MeshSphereStride, soa + 3 * m_MeshSphereStride, m_Header.meshCount, visibleMeshes);
+	}
+
+	static uint32_t GetIndex(const unsigned char *indexData, unsigned int indexStride, uint32_t n)
+	{
+		return indexStride == sizeof(uint32_t) ? ((const uint32_t*)indexData)[n] : ((const uint16_t*)indexData)[n];
+	}
+	static void SetIndex(unsigned char *indexData, unsigned int indexStride, uint32_t n, uint32_t index)
+	{
+		if (indexStride == sizeof(uint32_t))
+			((uint32_t*)indexData)[n] = index;
+		else
+			((uint16_t*)indexData)[n] = (uint16_t)index;
+	}
+
+	enum
+	{
+		maxMeshletVertices = 64,
+		maxMeshletTriangles = 124,
+	};
+
+	// a run of consecutive triangles from one mesh, small enough to cull on its own
+	struct Meshlet
+	{
+		float center[3]; // bounding sphere, in model space
+		float radius;
+		float coneApex[3]; // every triangle faces away from viewers inside the cone behind the apex
+		float coneCutoff; // cosine of the cone's half angle, 1 if the meshlet can't be cone culled
+		float coneAxis[3];
+		uint32_t meshIndex;
+		uint32_t indexOffset; // into the mesh's render indices, counted from the start of the mesh
+		uint32_t indexCount;
+		uint32_t reserved[2];
+	};
+	Meshlet *m_pMeshlet; // sorted by mesh, empty if the model was never optimized
+	uint32_t m_MeshletCount;
+	uint32_t *m_pMeshFirstMeshlet; // meshCount + 1 entries, so a mesh's meshlets end where the next one's start
+
+	// viewerPosition is in model space, or null to skip back facing cone culling (e.g. for shadows)
+	static bool IsMeshletVisible(const Meshlet &meshlet, const Frustum &frustum, const Vector3 *viewerPosition);
+
+	// a simplified copy of a mesh's indices, drawn with the mesh's own vertices
+	struct MeshLod
+	{
+		uint32_t meshIndex;
+		uint32_t indexDataByteOffset; // after all the meshes' own render indices, at the mesh's index stride
+		uint32_t indexCount;
+		float error; // how far the surface may have moved from the full mesh, in model units
+	};
+	MeshLod *m_pLod; // sorted by mesh and then from finest to coarsest, empty if the model was never optimized
+	uint32_t m_LodCount;
+	uint32_t *m_pMeshFirstLod; // meshCount + 1 entries, like m_pMeshFirstMeshlet
+
+	// the coarsest lod of the mesh whose error is within maxError, or null to draw the mesh itself
+	const MeshLod *SelectLod(unsigned int meshIndex, float maxError) const;
+
+	// lods only index the render vertices, so the depth index data ends where their indices start
+	uint32_t GetIndexDataByteSizeDepth() const
+	{
+		return m_LodCount > 0 ? m_pLod[0].indexDataByteOffset : m_Header.indexDataByteSize;
+	}
+
+	// a large opaque mesh chosen by the optimizer to be drawn, with its own indices, into a cpu occlusion buffer
+	struct MeshOccluder
+	{
+		uint32_t meshIndex;
+	};
+	MeshOccluder *m_pOccluder; // sorted by mesh, empty if the model was never optimized
+	uint32_t m_OccluderCount;
+
+	// each occluder's triangles and the model space positions they use, copied out of the vertex data on load
+	struct OccluderGeometry
+	{
+		uint32_t firstPosition;
+		uint32_t positionCount;
+		uint32_t firstIndex; // indices count from the occluder's first position
+		uint32_t indexCount;
+	};
+	OccluderGeometry *m_pOccluderGeometry;
+	XMFLOAT3 *m_pOccluderPositions;
+	uint32_t *m_pOccluderIndices;
+
 	struct Material
 	{
 		Vector3 diffuse;
@@ -215,9 +313,25 @@ public:
 		return m_SRVs + materialIdx * 6;
 	}
 
+#ifdef MODEL_ENABLE_OPTIMIZER
+	// vertices whose positions round to the same multiple of this are welded (0 = exact duplicates only)
+	static float s_OptimizeWeldEpsilon;
+	// how much vertex cache efficiency the overdraw pass may give up, as a ratio of cache misses (0 = skip the pass)
+	static float s_OptimizeOverdrawThreshold;
+	// how many simplified lods to build below each mesh, each with half the triangles of the one before
+	static unsigned int s_OptimizeLodCount;
+	// the most triangles all of a model's occluders may have together (0 = no occluders)
+	static unsigned int s_OptimizeOccluderTriangles;
+	// where diffuse textures are looked for, like TextureManager's root, so alpha tested meshes never become occluders
+	static const char *s_OptimizeTextureRoot;
+#endif
+
 private:
 
 	bool LoadH3D(const char *filename);
+	bool MapH3D(const char *filename);
+	bool ReadH3D(const char *filename);
+	bool LoadH3D2(const unsigned char *data, size_t dataSize);
 #ifdef MODEL_ENABLE_ASSIMP
 	bool LoadAssimp(const char *filename);
 #endif
@@ -230,17 +344,42 @@ private:
 	// requires all mesh bounding boxes to be computed
 	void ComputeGlobalBoundingBox(BoundingBox &bbox) const;
 	void ComputeAllBoundingBoxes();
+	void ComputeMeshBoundingSphere(unsigned int meshIndex, BoundingSphere &sphere) const;
+	void ComputeAllBoundingSpheres();
+
+	// fills m_pMeshFirstMeshlet and m_pMeshFirstLod from m_pMeshlet and m_pLod
+	void IndexMeshRanges();
+	// fills m_pOccluderGeometry, m_pOccluderPositions and m_pOccluderIndices from m_pOccluder
+	void BuildOccluderGeometry();
 
 #ifdef MODEL_ENABLE_OPTIMIZER
 	void Optimize();
-	void OptimizeRemoveDuplicateVertices(bool depth);
-	void OptimizePostTransform(bool depth);
-	void OptimizePreTransform(bool depth);
+	// these only touch the given mesh's vertex and index ranges, so Optimize runs them for every mesh in parallel
+	void OptimizeRemoveDuplicateVertices(Mesh *mesh, bool depth);
+	void OptimizePostTransform(Mesh *mesh, bool depth);
+	void OptimizeOverdraw(Mesh *mesh, bool depth);
+	void OptimizePreTransform(Mesh *mesh, bool depth);
+	void OptimizeBuildMeshlets(unsigned int meshIndex, std::vector<Meshlet> &meshlets) const;
+	// lod offsets are into lodIndexData until OptimizeAppendLods moves them into the index buffers
+	void OptimizeBuildLods(unsigned int meshIndex, std::vector<MeshLod> &lods, std::vector<unsigned char> &lodIndexData) const;
+	void OptimizeAppendLods(const std::vector<std::vector<MeshLod>> &meshLods, const std::vector<std::vector<unsigned char>> &meshLodIndexData);
+	void OptimizeCompactVertexData(bool depth);
+	void OptimizeSelectOccluders();
 #endif
 
 	void ReleaseTextures();
 	void LoadTextures();
 	D3D12_CPU_DESCRIPTOR_HANDLE* m_SRVs;
+	std::vector<TextureManager::TextureRef> m_TextureRefs; // keeps the textures behind m_SRVs loaded
+
+	// h3d files are mapped rather than read. v1's mesh, material and data arrays point into the view, and so do
+	// v2's mesh, material, meshlet, lod and occluder arrays, but not its compressed vertices and indices.
+	bool IsMapped(const void *p) const
+	{
+		return p >= m_pMappedFile && p < m_pMappedFile + m_MappedFileSize;
+	}
+	unsigned char *m_pMappedFile;
+	size_t m_MappedFileSize;
 
     Matrix4 m_transformation;
 };
@@ -0,0 +1,391 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "ModelCodec.h"
+
+#include <string.h>
+
+
+namespace Graphics
+{
+namespace ModelCodec
+{
+
+namespace
+{
+	const size_t kVertexBlockSize = 256; // vertices per block
+	const size_t kVertexMaxSize = 256; // bytes per vertex
+	const size_t kByteGroupSize = 16;
+
+	const int kGroupBits[4] = { 0, 2, 4, 8 };
+
+	const uint32_t kIndexFifoSize = 16;
+	const uint32_t kIndexFifoCodes = 14;
+	const uint32_t kIndexCodeNext = 0;
+	const uint32_t kIndexCodeEscape = 15;
+
+	unsigned char ZigZag8(unsigned char delta)
+	{
+		return (unsigned char)((delta << 1) ^ (unsigned char)((signed char)delta >> 7));
+	}
+
+	unsigned char UnZigZag8(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (unsigned char)-(int)(value & 1));
+	}
+
+	// bytes needed for a group at the given width, escapes included
+	size_t EncodedGroupSize(const unsigned char *values, int bits)
+	{
+		if (bits == 0)
+		{
+			for (size_t n = 0; n < kByteGroupSize; n++)
+				if (values[n] != 0)
+					return (size_t)-1;
+			return 0;
+		}
+
+		if (bits == 8)
+			return kByteGroupSize;
+
+		const unsigned int escape = (1u << bits) - 1;
+		size_t size = kByteGroupSize * bits / 8;
+		for (size_t n = 0; n < kByteGroupSize; n++)
+			if (values[n] >= escape)
+				size++;
+		return size;
+	}
+
+	void EncodeGroup(std::vector<unsigned char> &buffer, const unsigned char *values, int bits)
+	{
+		if (bits == 0)
+			return;
+
+		if (bits == 8)
+		{
+			buffer.insert(buffer.end(), values, values + kByteGroupSize);
+			return;
+		}
+
+		const unsigned int escape = (1u << bits) - 1;
+		const size_t valuesPerByte = 8 / bits;
+		for (size_t n = 0; n < kByteGroupSize; n += valuesPerByte)
+		{
+			unsigned char packed = 0;
+			for (size_t i = 0; i < valuesPerByte; i++)
+			{
+				unsigned int value = values[n + i] >= escape ? escape : values[n + i];
+				packed = (unsigned char)((packed << bits) | value);
+			}
+			buffer.push_back(packed);
+		}
+
+		for (size_t n = 0; n < kByteGroupSize; n++)
+			if (values[n] >= escape)
+				buffer.push_back(values[n]);
+	}
+
+	const unsigned char *DecodeGroup(unsigned char *values, int bits, const unsigned char *data, const unsigned char *dataEnd)
+	{
+		if (bits == 0)
+		{
+			memset(values, 0, kByteGroupSize);
+			return data;
+		}
+
+		if (bits == 8)
+		{
+			if ((size_t)(dataEnd - data) < kByteGroupSize)
+				return nullptr;
+			memcpy(values, data, kByteGroupSize);
+			return data + kByteGroupSize;
+		}
+
+		const unsigned int escape = (1u << bits) - 1;
+		const size_t valuesPerByte = 8 / bits;
+		if ((size_t)(dataEnd - data) < kByteGroupSize / valuesPerByte)
+			return nullptr;
+
+		for (size_t n = 0; n < kByteGroupSize; n += valuesPerByte)
+		{
+			unsigned char packed = *data++;
+			for (size_t i = valuesPerByte; i-- > 0; )
+			{
+				values[n + i] = (unsigned char)(packed & escape);
+				packed >>= bits;
+			}
+		}
+
+		for (size_t n = 0; n < kByteGroupSize; n++)
+		{
+			if (values[n] == escape)
+			{
+				if (data == dataEnd)
+					return nullptr;
+				values[n] = *data++;
+			}
+		}
+
+		return data;
+	}
+
+	void EncodeVarint(std::vector<unsigned char> &buffer, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((unsigned char)value);
+	}
+
+	const unsigned char *DecodeVarint(uint32_t &value, const unsigned char *data, const unsigned char *dataEnd)
+	{
+		value = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			if (data == dataEnd)
+				return nullptr;
+			unsigned char byte = *data++;
+			value |= (uint32_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return data;
+		}
+		return nullptr;
+	}
+
+	// the decoder rebuilds the same fifo from the indices it has already decoded
+	struct IndexFifo
+	{
+		uint32_t entries[kIndexFifoSize];
+		uint32_t count;
+
+		IndexFifo() : count(0) {}
+
+		void Push(uint32_t index)
+		{
+			entries[count++ % kIndexFifoSize] = index;
+		}
+
+		// how many entries back the index was pushed, or kIndexFifoCodes if it's not recent enough
+		uint32_t Find(uint32_t index) const
+		{
+			uint32_t available = count < kIndexFifoCodes ? count : kIndexFifoCodes;
+			for (uint32_t n = 0; n < available; n++)
+				if (entries[(count - 1 - n) % kIndexFifoSize] == index)
+					return n;
+			return kIndexFifoCodes;
+		}
+
+		uint32_t Get(uint32_t distance) const
+		{
+			return entries[(count - 1 - distance) % kIndexFifoSize];
+		}
+	};
+}
+
+void EncodeVertexBuffer(std::vector<unsigned char> &buffer, const void *vertices, size_t vertexCount, size_t vertexSize)
+{
+	assert(vertexSize > 0 && vertexSize <= kVertexMaxSize);
+
+	const unsigned char *vertexData = (const unsigned char *)vertices;
+	unsigned char lastVertex[kVertexMaxSize] = {};
+	unsigned char deltas[kVertexBlockSize];
+
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += kVertexBlockSize)
+	{
+		const size_t blockCount = (vertexCount - blockStart) < kVertexBlockSize ? (vertexCount - blockStart) : kVertexBlockSize;
+		const size_t groupCount = (blockCount + kByteGroupSize - 1) / kByteGroupSize;
+
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			// deltas down the lane, padded out to whole groups with zeros
+			unsigned char previous = lastVertex[k];
+			for (size_t n = 0; n < blockCount; n++)
+			{
+				unsigned char value = vertexData[(blockStart + n) * vertexSize + k];
+				deltas[n] = ZigZag8((unsigned char)(value - previous));
+				previous = value;
+			}
+			memset(deltas + blockCount, 0, groupCount * kByteGroupSize - blockCount);
+
+			// two bit headers for every group, then the groups
+			size_t headerStart = buffer.size();
+			buffer.resize(headerStart + (groupCount + 3) / 4, 0);
+
+			for (size_t group = 0; group < groupCount; group++)
+			{
+				const unsigned char *values = deltas + group * kByteGroupSize;
+
+				int bestMode = 3;
+				size_t bestSize = kByteGroupSize;
+				for (int mode = 0; mode < 3; mode++)
+				{
+					size_t size = EncodedGroupSize(values, kGroupBits[mode]);
+					if (size < bestSize)
+					{
+						bestMode = mode;
+						bestSize = size;
+					}
+				}
+
+				buffer[headerStart + group / 4] |= (unsigned char)(bestMode << ((group % 4) * 2));
+				EncodeGroup(buffer, values, kGroupBits[bestMode]);
+			}
+		}
+
+		memcpy(lastVertex, vertexData + (blockStart + blockCount - 1) * vertexSize, vertexSize);
+	}
+}
+
+size_t DecodeVertexBuffer(void *vertices, size_t vertexCount, size_t vertexSize, const unsigned char *buffer, size_t bufferSize)
+{
+	if (vertexSize == 0 || vertexSize > kVertexMaxSize)
+		return 0;
+
+	unsigned char *vertexData = (unsigned char *)vertices;
+	const unsigned char *data = buffer;
+	const unsigned char *dataEnd = buffer + bufferSize;
+
+	unsigned char lastVertex[kVertexMaxSize] = {};
+	unsigned char deltas[kVertexBlockSize];
+
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += kVertexBlockSize)
+	{
+		const size_t blockCount = (vertexCount - blockStart) < kVertexBlockSize ? (vertexCount - blockStart) : kVertexBlockSize;
+		const size_t groupCount = (blockCount + kByteGroupSize - 1) / kByteGroupSize;
+
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			const size_t headerSize = (groupCount + 3) / 4;
+			if ((size_t)(dataEnd - data) < headerSize)
+				return 0;
+
+			const unsigned char *header = data;
+			data += headerSize;
+
+			for (size_t group = 0; group < groupCount; group++)
+			{
+				int mode = (header[group / 4] >> ((group % 4) * 2)) & 3;
+				data = DecodeGroup(deltas + group * kByteGroupSize, kGroupBits[mode], data, dataEnd);
+				if (data == nullptr)
+					return 0;
+			}
+
+			unsigned char previous = lastVertex[k];
+			for (size_t n = 0; n < blockCount; n++)
+			{
+				previous = (unsigned char)(previous + UnZigZag8(deltas[n]));
+				vertexData[(blockStart + n) * vertexSize + k] = previous;
+			}
+		}
+
+		memcpy(lastVertex, vertexData + (blockStart + blockCount - 1) * vertexSize, vertexSize);
+	}
+
+	return data - buffer;
+}
+
+void EncodeIndexBuffer(std::vector<unsigned char> &buffer, const uint32_t *indices, size_t indexCount)
+{
+	// all the codes come first, so the escapes can be appended as they're found
+	size_t codeStart = buffer.size();
+	buffer.resize(codeStart + (indexCount + 1) / 2, 0);
+
+	IndexFifo fifo;
+	uint32_t next = 0;
+	uint32_t last = 0;
+
+	for (size_t n = 0; n < indexCount; n++)
+	{
+		uint32_t index = indices[n];
+		uint32_t code;
+
+		if (index == next)
+		{
+			code = kIndexCodeNext;
+			fifo.Push(index);
+			next++;
+		}
+		else
+		{
+			uint32_t distance = fifo.Find(index);
+			if (distance < kIndexFifoCodes)
+			{
+				code = 1 + distance;
+			}
+			else
+			{
+				code = kIndexCodeEscape;
+				int32_t delta = (int32_t)(index - last);
+				EncodeVarint(buffer, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+				fifo.Push(index);
+				if (index >= next)
+					next = index + 1;
+			}
+		}
+
+		buffer[codeStart + n / 2] |= (unsigned char)(code << ((n % 2) * 4));
+		last = index;
+	}
+}
+
+size_t DecodeIndexBuffer(uint32_t *indices, size_t indexCount, const unsigned char *buffer, size_t bufferSize)
+{
+	const size_t codeSize = (indexCount + 1) / 2;
+	if (bufferSize < codeSize)
+		return 0;
+
+	const unsigned char *codes = buffer;
+	const unsigned char *data = buffer + codeSize;
+	const unsigned char *dataEnd = buffer + bufferSize;
+
+	IndexFifo fifo;
+	uint32_t next = 0;
+	uint32_t last = 0;
+
+	for (size_t n = 0; n < indexCount; n++)
+	{
+		uint32_t code = (codes[n / 2] >> ((n % 2) * 4)) & 15;
+		uint32_t index;
+
+		if (code == kIndexCodeNext)
+		{
+			index = next++;
+			fifo.Push(index);
+		}
+		else if (code == kIndexCodeEscape)
+		{
+			uint32_t zigzag;
+			data = DecodeVarint(zigzag, data, dataEnd);
+			if (data == nullptr)
+				return 0;
+
+			index = last + (uint32_t)((int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1));
+			fifo.Push(index);
+			if (index >= next)
+				next = index + 1;
+		}
+		else
+		{
+			if (code - 1 >= fifo.count)
+				return 0;
+			index = fifo.Get(code - 1);
+		}
+
+		indices[n] = index;
+		last = index;
+	}
+
+	return data - buffer;
+}
+
+} // namespace ModelCodec
+} // namespace Graphics
@@ -0,0 +1,41 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace Graphics
+{
+namespace ModelCodec
+{
+	//-----------------------------------------------------------------------------
+	//  Lossless vertex and index stream compression for h3d v2, after meshoptimizer's codecs.
+	//  Both work best on meshes that have been through Model::Optimize, where
+	//  neighbouring vertices are similar and indices mostly count upwards.
+	//-----------------------------------------------------------------------------
+
+	//  Vertices are split into blocks and each byte of the vertex is stored as a lane of
+	//  zigzagged deltas from the previous vertex. Lanes are packed in groups of 16 values
+	//  with 0, 2, 4 or 8 bits each, out of range values escaping to a trailing byte.
+	void EncodeVertexBuffer(std::vector<unsigned char> &buffer, const void *vertices, size_t vertexCount, size_t vertexSize);
+
+	//  Returns the number of bytes consumed, or 0 if the data is malformed.
+	size_t DecodeVertexBuffer(void *vertices, size_t vertexCount, size_t vertexSize, const unsigned char *buffer, size_t bufferSize);
+
+	//  Each index is a 4 bit code: the next unused vertex, one of the 14 most recently
+	//  introduced vertices, or an escape to a zigzagged varint delta from the previous index.
+	void EncodeIndexBuffer(std::vector<unsigned char> &buffer, const uint32_t *indices, size_t indexCount);
+
+	//  Returns the number of bytes consumed, or 0 if the data is malformed.
+	size_t DecodeIndexBuffer(uint32_t *indices, size_t indexCount, const unsigned char *buffer, size_t bufferSize);
+}
+}
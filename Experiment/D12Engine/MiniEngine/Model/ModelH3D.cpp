@@ -14,32 +14,304 @@
 #include "pch.h"
 #include "Model.h"
 #include "Utility.h"
+#include "AssetPack.h"
 #include "TextureManager.h"
 #include "GraphicsCore.h"
 #include "DescriptorHeap.h"
 #include "CommandContext.h"
+#include "ModelCodec.h"
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+#include <vector>
 
 using namespace Graphics;
 
-bool Model::LoadH3D(const char *filename)
+// h3d v1 is a raw dump of the header, meshes, materials and data blocks, with no magic or version.
+// h3d v2 is a list of chunks, with the vertex and index data quantized and compressed.
+namespace
 {
-	FILE *file = nullptr;
-	if (0 != fopen_s(&file, filename, "rb"))
-		return false;
+	constexpr uint32_t H3DChunkId(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
 
-	bool ok = false;
+	const uint32_t kH3D2Magic = H3DChunkId('H', '3', 'D', '2');
+	const uint32_t kH3D2Version = 2;
+
+	const uint32_t kChunkHeader = H3DChunkId('H', 'E', 'A', 'D'); // Model::Header
+	const uint32_t kChunkMeshes = H3DChunkId('M', 'E', 'S', 'H'); // Model::Mesh per mesh, describing the decoded layout
+	const uint32_t kChunkMaterials = H3DChunkId('M', 'A', 'T', 'L'); // Model::Material per material
+	const uint32_t kChunkQuantization = H3DChunkId('Q', 'U', 'A', 'N'); // H3D2Quantization per mesh
+	const uint32_t kChunkVertices = H3DChunkId('V', 'E', 'R', 'T'); // quantized vertices, encoded per mesh
+	const uint32_t kChunkIndices = H3DChunkId('I', 'N', 'D', 'X'); // indices, encoded per mesh
+	const uint32_t kChunkVerticesDepth = H3DChunkId('D', 'V', 'R', 'T'); // depth vertices, encoded per mesh
+	const uint32_t kChunkIndicesDepth = H3DChunkId('D', 'I', 'D', 'X'); // only present when different to the render indices
+	const uint32_t kChunkMeshlets = H3DChunkId('M', 'S', 'H', 'L'); // Model::Meshlet per meshlet, absent if the model has none
+	const uint32_t kChunkLods = H3DChunkId('L', 'O', 'D', 'S'); // Model::MeshLod per lod, absent if the model has none
+	const uint32_t kChunkLodIndices = H3DChunkId('L', 'I', 'D', 'X'); // lod indices, encoded per lod
+	const uint32_t kChunkOccluders = H3DChunkId('O', 'C', 'C', 'L'); // Model::MeshOccluder per occluder, absent if the model has none
+
+	struct H3D2FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t chunkCount;
+		uint32_t reserved;
+	};
+
+	// chunk data follows, padded to 16 bytes. Unknown chunks are skipped.
+	struct H3D2ChunkHeader
+	{
+		uint32_t id;
+		uint32_t byteSize;
+		uint32_t reserved[2];
+	};
 
-	if (1 != fread(&m_Header, sizeof(Header), 1, file)) goto h3d_load_fail;
+	struct H3D2Quantization
+	{
+		float texcoordMin[2];
+		float texcoordScale[2];
+	};
 
-	m_pMesh = new Mesh [m_Header.meshCount];
-	m_pMaterial = new Material [m_Header.materialCount];
+	size_t H3D2Align(size_t size)
+	{
+		return (size + 15) & ~(size_t)15;
+	}
 
-	if (m_Header.meshCount > 0)
-		if (1 != fread(m_pMesh, sizeof(Mesh) * m_Header.meshCount, 1, file)) goto h3d_load_fail;
-	if (m_Header.materialCount > 0)
-		if (1 != fread(m_pMaterial, sizeof(Material) * m_Header.materialCount, 1, file)) goto h3d_load_fail;
+	enum
+	{
+		quantize_raw,
+		quantize_texcoord, // 2 x 16 bit unorm across the mesh's texcoord range
+		quantize_direction, // octahedral 2 x 16 bit snorm
+	};
+
+	int AttribQuantization(unsigned int attribIndex, const Model::Attrib &attrib)
+	{
+		if (attrib.format != Model::attrib_format_float)
+			return quantize_raw;
+		if (attribIndex == Model::attrib_texcoord0 && attrib.components == 2)
+			return quantize_texcoord;
+		if ((attribIndex == Model::attrib_normal || attribIndex == Model::attrib_tangent || attribIndex == Model::attrib_bitangent) && attrib.components == 3)
+			return quantize_direction;
+		return quantize_raw;
+	}
+
+	unsigned int AttribByteSize(const Model::Attrib &attrib)
+	{
+		static const unsigned int formatSize[Model::attrib_formats] = { 0, 1, 1, 2, 2, 4 };
+		return attrib.format < Model::attrib_formats ? formatSize[attrib.format] * attrib.components : 0;
+	}
+
+	unsigned int QuantizedVertexStride(const Model::Mesh &mesh)
+	{
+		unsigned int stride = 0;
+		for (unsigned int n = 0; n < Model::maxAttribs; n++)
+		{
+			if (mesh.attrib[n].format == Model::attrib_format_none)
+				continue;
+			stride += AttribQuantization(n, mesh.attrib[n]) == quantize_raw ? AttribByteSize(mesh.attrib[n]) : 2 * sizeof(uint16_t);
+		}
+		return stride;
+	}
+
+	// every enabled attribute must have a known format and lie inside the vertex, as the decoder writes it there
+	bool AttribsFitVertex(const Model::Mesh &mesh)
+	{
+		for (unsigned int n = 0; n < Model::maxAttribs; n++)
+		{
+			const Model::Attrib &attrib = mesh.attrib[n];
+			if (attrib.format == Model::attrib_format_none)
+				continue;
+			if (attrib.format >= Model::attrib_formats || (uint32_t)attrib.offset + AttribByteSize(attrib) > mesh.vertexStride)
+				return false;
+		}
+		return true;
+	}
 
+	int16_t QuantizeSnorm16(float v)
+	{
+		v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+		return (int16_t)floorf(v * 32767.0f + 0.5f);
+	}
+
+	void EncodeDirection(const float *direction, int16_t *encoded)
+	{
+		float x = direction[0], y = direction[1], z = direction[2];
+		float length = fabsf(x) + fabsf(y) + fabsf(z);
+		if (length == 0.0f)
+		{
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+		x /= length;
+		y /= length;
+		if (z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		encoded[0] = QuantizeSnorm16(x);
+		encoded[1] = QuantizeSnorm16(y);
+	}
+
+	void DecodeDirection(const int16_t *encoded, float *direction)
+	{
+		float x = (float)encoded[0] / 32767.0f;
+		float y = (float)encoded[1] / 32767.0f;
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		if (z < 0.0f)
+		{
+			float unfoldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float unfoldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+		float length = sqrtf(x * x + y * y + z * z);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		direction[0] = x * scale;
+		direction[1] = y * scale;
+		direction[2] = z * scale;
+	}
+
+	void QuantizeVertices(const Model::Mesh &mesh, const unsigned char *vertices, unsigned char *quantized, H3D2Quantization &quantization)
+	{
+		const Model::Attrib &texcoord = mesh.attrib[Model::attrib_texcoord0];
+		const bool hasTexcoord = AttribQuantization(Model::attrib_texcoord0, texcoord) == quantize_texcoord;
+
+		float texcoordMax[2] = { 0.0f, 0.0f };
+		quantization.texcoordMin[0] = quantization.texcoordMin[1] = 0.0f;
+		for (unsigned int v = 0; hasTexcoord && v < mesh.vertexCount; v++)
+		{
+			const float *uv = (const float *)(vertices + v * mesh.vertexStride + texcoord.offset);
+			for (int c = 0; c < 2; c++)
+			{
+				quantization.texcoordMin[c] = v == 0 || uv[c] < quantization.texcoordMin[c] ? uv[c] : quantization.texcoordMin[c];
+				texcoordMax[c] = v == 0 || uv[c] > texcoordMax[c] ? uv[c] : texcoordMax[c];
+			}
+		}
+		for (int c = 0; c < 2; c++)
+			quantization.texcoordScale[c] = (texcoordMax[c] - quantization.texcoordMin[c]) / 65535.0f;
+
+		unsigned char *dst = quantized;
+		for (unsigned int v = 0; v < mesh.vertexCount; v++)
+		{
+			const unsigned char *vertex = vertices + v * mesh.vertexStride;
+			for (unsigned int n = 0; n < Model::maxAttribs; n++)
+			{
+				const Model::Attrib &attrib = mesh.attrib[n];
+				if (attrib.format == Model::attrib_format_none)
+					continue;
+
+				const float *src = (const float *)(vertex + attrib.offset);
+				switch (AttribQuantization(n, attrib))
+				{
+				case quantize_texcoord:
+					for (int c = 0; c < 2; c++)
+					{
+						float t = quantization.texcoordScale[c] > 0.0f ? (src[c] - quantization.texcoordMin[c]) / quantization.texcoordScale[c] : 0.0f;
+						t = t < 0.0f ? 0.0f : (t > 65535.0f ? 65535.0f : t);
+						uint16_t q = (uint16_t)(t + 0.5f);
+						memcpy(dst + c * sizeof(uint16_t), &q, sizeof(uint16_t));
+					}
+					dst += 2 * sizeof(uint16_t);
+					break;
+
+				case quantize_direction:
+				{
+					int16_t encoded[2];
+					EncodeDirection(src, encoded);
+					memcpy(dst, encoded, sizeof(encoded));
+					dst += sizeof(encoded);
+					break;
+				}
+
+				default:
+					memcpy(dst, vertex + attrib.offset, AttribByteSize(attrib));
+					dst += AttribByteSize(attrib);
+					break;
+				}
+			}
+		}
+	}
+
+	void DequantizeVertices(const Model::Mesh &mesh, const unsigned char *quantized, unsigned char *vertices, const H3D2Quantization &quantization)
+	{
+		const unsigned char *src = quantized;
+		for (unsigned int v = 0; v < mesh.vertexCount; v++)
+		{
+			unsigned char *vertex = vertices + v * mesh.vertexStride;
+			for (unsigned int n = 0; n < Model::maxAttribs; n++)
+			{
+				const Model::Attrib &attrib = mesh.attrib[n];
+				if (attrib.format == Model::attrib_format_none)
+					continue;
+
+				float *dst = (float *)(vertex + attrib.offset);
+				switch (AttribQuantization(n, attrib))
+				{
+				case quantize_texcoord:
+					for (int c = 0; c < 2; c++)
+					{
+						uint16_t q;
+						memcpy(&q, src + c * sizeof(uint16_t), sizeof(uint16_t));
+						dst[c] = quantization.texcoordMin[c] + (float)q * quantization.texcoordScale[c];
+					}
+					src += 2 * sizeof(uint16_t);
+					break;
+
+				case quantize_direction:
+				{
+					int16_t encoded[2];
+					memcpy(encoded, src, sizeof(encoded));
+					DecodeDirection(encoded, dst);
+					src += sizeof(encoded);
+					break;
+				}
+
+				default:
+					memcpy(vertex + attrib.offset, src, AttribByteSize(attrib));
+					src += AttribByteSize(attrib);
+					break;
+				}
+			}
+		}
+	}
+}
+
+// v1 files leave indexStride as struct padding, so the mesh must not grow
+static_assert(sizeof(Model::Mesh) == 336, "h3d v1 meshes are 336 bytes");
+
+bool Model::LoadH3D(const char *filename)
+{
+	Utility::PackedFile packed;
+	if (Utility::FindPackedFile(MakeWStr(filename), packed))
+	{
+		// AssetPacker only takes v2 files, which are decoded into heap memory, so the pack isn't referenced after this
+		if (!LoadH3D2(packed.Data, packed.Size))
+			return false;
+	}
+	else if (!Utility::LooseFilesEnabled())
+	{
+		return false;
+	}
+	else if (!MapH3D(filename))
+	{
+		Clear();
+		if (!ReadH3D(filename))
+			return false;
+	}
+
+	// the depth pass shares the render indices unless the optimizer reordered them, so keep one copy
+	if (m_pIndexDataDepth != m_pIndexData && 0 == memcmp(m_pIndexDataDepth, m_pIndexData, GetIndexDataByteSizeDepth()))
+	{
+		if (!IsMapped(m_pIndexDataDepth))
+			delete [] m_pIndexDataDepth;
+		m_pIndexDataDepth = m_pIndexData;
+	}
 	m_VertexStride = m_pMesh[0].vertexStride;
 	m_VertexStrideDepth = m_pMesh[0].vertexStrideDepth;
 #if _DEBUG
@@ -48,6 +320,7 @@ bool Model::LoadH3D(const char *filename)
 		const Mesh& mesh = m_pMesh[meshIndex];
 		ASSERT(mesh.vertexStride == m_VertexStride);
 		ASSERT(mesh.vertexStrideDepth == m_VertexStrideDepth);
+		ASSERT(mesh.indexStride == m_pMesh[0].indexStride);
 	}
 	for (uint32_t meshIndex = 0; meshIndex < m_Header.meshCount; ++meshIndex)
 	{
@@ -67,30 +340,16 @@ bool Model::LoadH3D(const char *filename)
 	}
 #endif
 
-	m_pVertexData = new unsigned char[ m_Header.vertexDataByteSize ];
-	m_pIndexData = new unsigned char[ m_Header.indexDataByteSize ];
-	m_pVertexDataDepth = new unsigned char[ m_Header.vertexDataByteSizeDepth ];
-	m_pIndexDataDepth = new unsigned char[ m_Header.indexDataByteSize ];
-
-	if (m_Header.vertexDataByteSize > 0)
-		if (1 != fread(m_pVertexData, m_Header.vertexDataByteSize, 1, file)) goto h3d_load_fail;
-	if (m_Header.indexDataByteSize > 0)
-		if (1 != fread(m_pIndexData, m_Header.indexDataByteSize, 1, file)) goto h3d_load_fail;
-
-	if (m_Header.vertexDataByteSizeDepth > 0)
-		if (1 != fread(m_pVertexDataDepth, m_Header.vertexDataByteSizeDepth, 1, file)) goto h3d_load_fail;
-	if (m_Header.indexDataByteSize > 0)
-		if (1 != fread(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_load_fail;
-
 	m_VertexBuffer.Create(L"VertexBuffer", m_Header.vertexDataByteSize / m_VertexStride, m_VertexStride, m_pVertexData);
-	m_IndexBuffer.Create(L"IndexBuffer", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexData);
+	const uint32_t indexStride = m_pMesh[0].indexStride;
+	m_IndexBuffer.Create(L"IndexBuffer", m_Header.indexDataByteSize / indexStride, indexStride, m_pIndexData);
 	//delete [] m_pVertexData;
 	//m_pVertexData = nullptr;
 	//delete [] m_pIndexData;
 	//m_pIndexData = nullptr;
 
 	m_VertexBufferDepth.Create(L"VertexBufferDepth", m_Header.vertexDataByteSizeDepth / m_VertexStrideDepth, m_VertexStrideDepth, m_pVertexDataDepth);
-	m_IndexBufferDepth.Create(L"IndexBufferDepth", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexDataDepth);
+	m_IndexBufferDepth.Create(L"IndexBufferDepth", GetIndexDataByteSizeDepth() / indexStride, indexStride, m_pIndexDataDepth);
 	//delete [] m_pVertexDataDepth;
 	//m_pVertexDataDepth = nullptr;
 	//delete [] m_pIndexDataDepth;
@@ -98,44 +357,147 @@ bool Model::LoadH3D(const char *filename)
 
 	LoadTextures();
 
-	ok = true;
+	return true;
+}
 
-h3d_load_fail:
+// v1's mesh and material arrays start on 16 byte boundaries in the file, so they can be used in place
+static_assert(sizeof(Model::Header) % __alignof(Model::Mesh) == 0, "meshes would be misaligned in a mapped h3d");
+static_assert(sizeof(Model::Mesh) % __alignof(Model::Material) == 0, "materials would be misaligned in a mapped h3d");
 
-	if (EOF == fclose(file))
-		ok = false;
+bool Model::MapH3D(const char *filename)
+{
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
 
-	return ok;
+	// copy-on-write, so the pages are shared with every other process mapping the file until something writes to them
+	LARGE_INTEGER fileSize = {};
+	unsigned char *view = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(Header) && fileSize.HighPart == 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if (mapping != nullptr)
+		{
+			view = (unsigned char *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+
+	if (view == nullptr)
+		return false;
+
+	m_pMappedFile = view;
+	m_MappedFileSize = (size_t)fileSize.QuadPart;
+
+	if (*(const uint32_t *)view == kH3D2Magic)
+	{
+		// v2's vertices and indices are compressed, so they're decoded into heap memory either way, but the
+		// meshes, materials, meshlets, lods and occluders are stored raw and point into the view
+		return LoadH3D2(view, m_MappedFileSize);
+	}
+
+	memcpy(&m_Header, view, sizeof(Header));
+	size_t offset = sizeof(Header);
+
+	// points block at count elements in place, or at a heap copy when the previous block leaves them misaligned.
+	// The copy is an array of the block's own type, so Clear() frees it with the right delete [].
+	auto mapBlock = [&](auto *&block, size_t count, size_t alignment)
+	{
+		typedef typename std::remove_reference<decltype(*block)>::type Element;
+
+		block = nullptr;
+		size_t byteSize = sizeof(Element) * count;
+		if (byteSize > m_MappedFileSize - offset)
+			return;
+
+		unsigned char *data = view + offset;
+		offset += byteSize;
+
+		if ((size_t)data % alignment != 0)
+		{
+			block = new Element [count];
+			memcpy(block, data, byteSize);
+		}
+		else
+		{
+			block = (Element *)data;
+		}
+	};
+
+	mapBlock(m_pMesh, m_Header.meshCount, __alignof(Mesh));
+	mapBlock(m_pMaterial, m_Header.materialCount, __alignof(Material));
+	mapBlock(m_pVertexData, m_Header.vertexDataByteSize, sizeof(float));
+	mapBlock(m_pIndexData, m_Header.indexDataByteSize, sizeof(uint16_t));
+	mapBlock(m_pVertexDataDepth, m_Header.vertexDataByteSizeDepth, sizeof(float));
+	mapBlock(m_pIndexDataDepth, m_Header.indexDataByteSize, sizeof(uint16_t));
+
+	if (!m_pMesh || !m_pMaterial || !m_pVertexData || !m_pIndexData || !m_pVertexDataDepth || !m_pIndexDataDepth)
+		return false;
+
+	// v1 indices are always 16 bit. This writes a private copy of the first page or two of the view.
+	for (uint32_t meshIndex = 0; meshIndex < m_Header.meshCount; ++meshIndex)
+		m_pMesh[meshIndex].indexStride = sizeof(uint16_t);
+
+	return true;
 }
 
-bool Model::SaveH3D(const char *filename) const
+bool Model::ReadH3D(const char *filename)
 {
 	FILE *file = nullptr;
-	if (0 != fopen_s(&file, filename, "wb"))
+	if (0 != fopen_s(&file, filename, "rb"))
 		return false;
 
 	bool ok = false;
+	uint32_t magic = 0;
+	std::vector<unsigned char> fileData;
+
+	if (1 != fread(&magic, sizeof(magic), 1, file)) goto h3d_load_fail;
+	if (magic == kH3D2Magic)
+	{
+		if (0 != fseek(file, 0, SEEK_END)) goto h3d_load_fail;
+		long fileSize = ftell(file);
+		if (fileSize <= 0 || 0 != fseek(file, 0, SEEK_SET)) goto h3d_load_fail;
 
-	if (1 != fwrite(&m_Header, sizeof(Header), 1, file)) goto h3d_save_fail;
+		fileData.resize((size_t)fileSize);
+		if (1 != fread(fileData.data(), fileData.size(), 1, file)) goto h3d_load_fail;
+
+		ok = LoadH3D2(fileData.data(), fileData.size());
+		goto h3d_load_fail;
+	}
+	if (0 != fseek(file, 0, SEEK_SET)) goto h3d_load_fail;
+
+	if (1 != fread(&m_Header, sizeof(Header), 1, file)) goto h3d_load_fail;
+
+	m_pMesh = new Mesh [m_Header.meshCount];
+	m_pMaterial = new Material [m_Header.materialCount];
 
 	if (m_Header.meshCount > 0)
-		if (1 != fwrite(m_pMesh, sizeof(Mesh) * m_Header.meshCount, 1, file)) goto h3d_save_fail;
+		if (1 != fread(m_pMesh, sizeof(Mesh) * m_Header.meshCount, 1, file)) goto h3d_load_fail;
 	if (m_Header.materialCount > 0)
-		if (1 != fwrite(m_pMaterial, sizeof(Material) * m_Header.materialCount, 1, file)) goto h3d_save_fail;
+		if (1 != fread(m_pMaterial, sizeof(Material) * m_Header.materialCount, 1, file)) goto h3d_load_fail;
+
+	for (uint32_t meshIndex = 0; meshIndex < m_Header.meshCount; ++meshIndex)
+		m_pMesh[meshIndex].indexStride = sizeof(uint16_t);
+
+	m_pVertexData = new unsigned char[ m_Header.vertexDataByteSize ];
+	m_pIndexData = new unsigned char[ m_Header.indexDataByteSize ];
+	m_pVertexDataDepth = new unsigned char[ m_Header.vertexDataByteSizeDepth ];
+	m_pIndexDataDepth = new unsigned char[ m_Header.indexDataByteSize ];
 
 	if (m_Header.vertexDataByteSize > 0)
-		if (1 != fwrite(m_pVertexData, m_Header.vertexDataByteSize, 1, file)) goto h3d_save_fail;
+		if (1 != fread(m_pVertexData, m_Header.vertexDataByteSize, 1, file)) goto h3d_load_fail;
 	if (m_Header.indexDataByteSize > 0)
-		if (1 != fwrite(m_pIndexData, m_Header.indexDataByteSize, 1, file)) goto h3d_save_fail;
+		if (1 != fread(m_pIndexData, m_Header.indexDataByteSize, 1, file)) goto h3d_load_fail;
 
 	if (m_Header.vertexDataByteSizeDepth > 0)
-		if (1 != fwrite(m_pVertexDataDepth, m_Header.vertexDataByteSizeDepth, 1, file)) goto h3d_save_fail;
+		if (1 != fread(m_pVertexDataDepth, m_Header.vertexDataByteSizeDepth, 1, file)) goto h3d_load_fail;
 	if (m_Header.indexDataByteSize > 0)
-		if (1 != fwrite(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_save_fail;
+		if (1 != fread(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_load_fail;
 
 	ok = true;
 
-h3d_save_fail:
+h3d_load_fail:
 
 	if (EOF == fclose(file))
 		ok = false;
@@ -143,23 +505,309 @@ h3d_save_fail:
 	return ok;
 }
 
-void Model::ReleaseTextures()
+bool Model::LoadH3D2(const unsigned char *data, size_t dataSize)
 {
-	/*
-	if (m_Textures != nullptr)
+	H3D2FileHeader fileHeader;
+	if (dataSize < sizeof(fileHeader))
+		return false;
+	memcpy(&fileHeader, data, sizeof(fileHeader));
+	if (fileHeader.magic != kH3D2Magic || fileHeader.version != kH3D2Version)
+		return false;
+
+	struct Chunk
+	{
+		const unsigned char *data;
+		size_t size;
+	};
+	Chunk header = {}, meshes = {}, materials = {}, quantization = {}, vertices = {}, indices = {}, verticesDepth = {}, indicesDepth = {}, meshlets = {}, lods = {}, lodIndices = {}, occluders = {};
+
+	size_t offset = sizeof(fileHeader);
+	for (uint32_t chunkIndex = 0; chunkIndex < fileHeader.chunkCount; chunkIndex++)
 	{
-		for (uint32_t materialIdx = 0; materialIdx < m_Header.materialCount; ++materialIdx)
+		H3D2ChunkHeader chunkHeader;
+		if (dataSize - offset < sizeof(chunkHeader))
+			return false;
+		memcpy(&chunkHeader, data + offset, sizeof(chunkHeader));
+		offset += sizeof(chunkHeader);
+		if (dataSize - offset < chunkHeader.byteSize)
+			return false;
+
+		Chunk chunk = { data + offset, chunkHeader.byteSize };
+		offset += chunkHeader.byteSize;
+		offset = H3D2Align(offset) < dataSize ? H3D2Align(offset) : dataSize;
+
+		switch (chunkHeader.id)
 		{
-			for (int n = 0; n < Material::texCount; n++)
-			{
-				if (m_Textures[materialIdx * Material::texCount + n])
-					m_Textures[materialIdx * Material::texCount + n]->Release();
-				m_Textures[materialIdx * Material::texCount + n] = nullptr;
-			}
+		case kChunkHeader: header = chunk; break;
+		case kChunkMeshes: meshes = chunk; break;
+		case kChunkMaterials: materials = chunk; break;
+		case kChunkQuantization: quantization = chunk; break;
+		case kChunkVertices: vertices = chunk; break;
+		case kChunkIndices: indices = chunk; break;
+		case kChunkVerticesDepth: verticesDepth = chunk; break;
+		case kChunkIndicesDepth: indicesDepth = chunk; break;
+		case kChunkMeshlets: meshlets = chunk; break;
+		case kChunkLods: lods = chunk; break;
+		case kChunkLodIndices: lodIndices = chunk; break;
+		case kChunkOccluders: occluders = chunk; break;
+		}
+	}
+
+	if (header.size != sizeof(Header))
+		return false;
+	memcpy(&m_Header, header.data, sizeof(Header));
+
+	if (meshes.size != sizeof(Mesh) * m_Header.meshCount || materials.size != sizeof(Material) * m_Header.materialCount
+		|| quantization.size != sizeof(H3D2Quantization) * m_Header.meshCount || meshlets.size % sizeof(Meshlet) != 0 || lods.size % sizeof(MeshLod) != 0
+		|| occluders.size % sizeof(MeshOccluder) != 0)
+		return false;
+
+	// points block at a raw chunk in place when the data is the mapped file, which lives as long as the model,
+	// and at a heap copy otherwise. Chunk data starts on a 16 byte boundary, so mapped chunks are aligned.
+	auto placeChunk = [&](auto *&block, size_t count, const Chunk &chunk)
+	{
+		typedef typename std::remove_reference<decltype(*block)>::type Element;
+
+		if (count > 0 && IsMapped(chunk.data) && (size_t)chunk.data % __alignof(Element) == 0)
+		{
+			block = (Element *)chunk.data;
+		}
+		else
+		{
+			block = new Element [count];
+			if (count > 0)
+				memcpy(block, chunk.data, chunk.size);
+		}
+	};
+
+	placeChunk(m_pMesh, m_Header.meshCount, meshes);
+	placeChunk(m_pMaterial, m_Header.materialCount, materials);
+
+	m_pVertexData = new unsigned char[ m_Header.vertexDataByteSize ];
+	m_pIndexData = new unsigned char[ m_Header.indexDataByteSize ];
+	m_pVertexDataDepth = new unsigned char[ m_Header.vertexDataByteSizeDepth ];
+
+	// lods only index the render vertices, so the depth indices stop where the first lod's start
+	uint32_t indexDataByteSizeDepth = m_Header.indexDataByteSize;
+	if (lods.size > 0)
+	{
+		MeshLod firstLod;
+		memcpy(&firstLod, lods.data, sizeof(MeshLod));
+		if (firstLod.indexDataByteOffset > m_Header.indexDataByteSize)
+			return false;
+		indexDataByteSizeDepth = firstLod.indexDataByteOffset;
+	}
+	m_pIndexDataDepth = indicesDepth.data ? new unsigned char[ indexDataByteSizeDepth ] : m_pIndexData;
+
+	std::vector<unsigned char> quantized;
+	std::vector<uint32_t> meshIndices;
+
+	// each mesh was encoded separately, one after the other
+	auto decodeIndices = [&](const Mesh &mesh, Chunk &chunk, unsigned char *indexData) -> bool
+	{
+		meshIndices.resize(mesh.indexCount);
+		size_t used = ModelCodec::DecodeIndexBuffer(meshIndices.data(), mesh.indexCount, chunk.data, chunk.size);
+		if (used == 0 && mesh.indexCount > 0)
+			return false;
+		chunk.data += used;
+		chunk.size -= used;
+
+		for (uint32_t n = 0; n < mesh.indexCount; n++)
+		{
+			if (meshIndices[n] >= mesh.vertexCount)
+				return false;
+			SetIndex(indexData + mesh.indexDataByteOffset, mesh.indexStride, n, meshIndices[n]);
 		}
-		delete [] m_Textures;
+		return true;
+	};
+
+	for (uint32_t meshIndex = 0; meshIndex < m_Header.meshCount; ++meshIndex)
+	{
+		const Mesh &mesh = m_pMesh[meshIndex];
+		if ((mesh.indexStride != sizeof(uint16_t) && mesh.indexStride != sizeof(uint32_t))
+			|| (uint64_t)mesh.vertexDataByteOffset + (uint64_t)mesh.vertexCount * mesh.vertexStride > m_Header.vertexDataByteSize
+			|| (uint64_t)mesh.vertexDataByteOffsetDepth + (uint64_t)mesh.vertexCountDepth * mesh.vertexStrideDepth > m_Header.vertexDataByteSizeDepth
+			|| (uint64_t)mesh.indexDataByteOffset + (uint64_t)mesh.indexCount * mesh.indexStride > indexDataByteSizeDepth
+			|| !AttribsFitVertex(mesh))
+			return false;
+
+		H3D2Quantization meshQuantization;
+		memcpy(&meshQuantization, quantization.data + meshIndex * sizeof(H3D2Quantization), sizeof(H3D2Quantization));
+
+		const unsigned int quantizedStride = QuantizedVertexStride(mesh);
+		quantized.resize(mesh.vertexCount * quantizedStride);
+		size_t used = ModelCodec::DecodeVertexBuffer(quantized.data(), mesh.vertexCount, quantizedStride, vertices.data, vertices.size);
+		if (used == 0 && mesh.vertexCount > 0)
+			return false;
+		vertices.data += used;
+		vertices.size -= used;
+		DequantizeVertices(mesh, quantized.data(), m_pVertexData + mesh.vertexDataByteOffset, meshQuantization);
+
+		used = ModelCodec::DecodeVertexBuffer(m_pVertexDataDepth + mesh.vertexDataByteOffsetDepth, mesh.vertexCountDepth, mesh.vertexStrideDepth, verticesDepth.data, verticesDepth.size);
+		if (used == 0 && mesh.vertexCountDepth > 0)
+			return false;
+		verticesDepth.data += used;
+		verticesDepth.size -= used;
+
+		if (!decodeIndices(mesh, indices, m_pIndexData))
+			return false;
+		if (indicesDepth.data && !decodeIndices(mesh, indicesDepth, m_pIndexDataDepth))
+			return false;
+	}
+
+	m_MeshletCount = (uint32_t)(meshlets.size / sizeof(Meshlet));
+	placeChunk(m_pMeshlet, m_MeshletCount, meshlets);
+
+	for (uint32_t meshletIndex = 0; meshletIndex < m_MeshletCount; meshletIndex++)
+	{
+		const Meshlet &meshlet = m_pMeshlet[meshletIndex];
+		if (meshlet.meshIndex >= m_Header.meshCount
+			|| (meshletIndex > 0 && meshlet.meshIndex < m_pMeshlet[meshletIndex - 1].meshIndex)
+			|| (uint64_t)meshlet.indexOffset + meshlet.indexCount > m_pMesh[meshlet.meshIndex].indexCount)
+			return false;
+	}
+
+	// lods are encoded like meshes, into the index data after the meshes' own indices
+	m_LodCount = (uint32_t)(lods.size / sizeof(MeshLod));
+	placeChunk(m_pLod, m_LodCount, lods);
+
+	for (uint32_t lodIndex = 0; lodIndex < m_LodCount; lodIndex++)
+	{
+		const MeshLod &lod = m_pLod[lodIndex];
+		if (lod.meshIndex >= m_Header.meshCount || (lodIndex > 0 && lod.meshIndex < m_pLod[lodIndex - 1].meshIndex)
+			|| lod.indexDataByteOffset < indexDataByteSizeDepth)
+			return false;
+
+		Mesh lodMesh = m_pMesh[lod.meshIndex];
+		lodMesh.indexDataByteOffset = lod.indexDataByteOffset;
+		lodMesh.indexCount = lod.indexCount;
+		if ((uint64_t)lodMesh.indexDataByteOffset + (uint64_t)lodMesh.indexCount * lodMesh.indexStride > m_Header.indexDataByteSize)
+			return false;
+		if (!decodeIndices(lodMesh, lodIndices, m_pIndexData))
+			return false;
 	}
-	*/
+
+	m_OccluderCount = (uint32_t)(occluders.size / sizeof(MeshOccluder));
+	placeChunk(m_pOccluder, m_OccluderCount, occluders);
+
+	for (uint32_t occluderIndex = 0; occluderIndex < m_OccluderCount; occluderIndex++)
+	{
+		const MeshOccluder &occluder = m_pOccluder[occluderIndex];
+		if (occluder.meshIndex >= m_Header.meshCount
+			|| (occluderIndex > 0 && occluder.meshIndex <= m_pOccluder[occluderIndex - 1].meshIndex))
+			return false;
+	}
+
+	IndexMeshRanges();
+
+	return true;
+}
+
+bool Model::SaveH3D(const char *filename) const
+{
+	std::vector<H3D2Quantization> quantization(m_Header.meshCount);
+	std::vector<unsigned char> vertices, indices, verticesDepth, indicesDepth;
+	std::vector<unsigned char> quantized;
+	std::vector<uint32_t> meshIndices;
+
+	const bool separateDepthIndices = m_pIndexDataDepth != m_pIndexData
+		&& 0 != memcmp(m_pIndexDataDepth, m_pIndexData, GetIndexDataByteSizeDepth());
+
+	auto encodeIndices = [&](const Mesh &mesh, const unsigned char *indexData, std::vector<unsigned char> &buffer)
+	{
+		meshIndices.resize(mesh.indexCount);
+		for (uint32_t n = 0; n < mesh.indexCount; n++)
+			meshIndices[n] = GetIndex(indexData + mesh.indexDataByteOffset, mesh.indexStride, n);
+		ModelCodec::EncodeIndexBuffer(buffer, meshIndices.data(), mesh.indexCount);
+	};
+
+	for (uint32_t meshIndex = 0; meshIndex < m_Header.meshCount; ++meshIndex)
+	{
+		const Mesh &mesh = m_pMesh[meshIndex];
+
+		const unsigned int quantizedStride = QuantizedVertexStride(mesh);
+		quantized.resize(mesh.vertexCount * quantizedStride);
+		QuantizeVertices(mesh, m_pVertexData + mesh.vertexDataByteOffset, quantized.data(), quantization[meshIndex]);
+		ModelCodec::EncodeVertexBuffer(vertices, quantized.data(), mesh.vertexCount, quantizedStride);
+
+		ModelCodec::EncodeVertexBuffer(verticesDepth, m_pVertexDataDepth + mesh.vertexDataByteOffsetDepth, mesh.vertexCountDepth, mesh.vertexStrideDepth);
+
+		encodeIndices(mesh, m_pIndexData, indices);
+		if (separateDepthIndices)
+			encodeIndices(mesh, m_pIndexDataDepth, indicesDepth);
+	}
+
+	std::vector<unsigned char> lodIndices;
+	for (uint32_t lodIndex = 0; lodIndex < m_LodCount; lodIndex++)
+	{
+		Mesh lodMesh = m_pMesh[m_pLod[lodIndex].meshIndex];
+		lodMesh.indexDataByteOffset = m_pLod[lodIndex].indexDataByteOffset;
+		lodMesh.indexCount = m_pLod[lodIndex].indexCount;
+		encodeIndices(lodMesh, m_pIndexData, lodIndices);
+	}
+
+	struct Chunk
+	{
+		uint32_t id;
+		const void *data;
+		size_t size;
+	};
+	const Chunk chunks[] =
+	{
+		{ kChunkHeader, &m_Header, sizeof(Header) },
+		{ kChunkMeshes, m_pMesh, sizeof(Mesh) * m_Header.meshCount },
+		{ kChunkMaterials, m_pMaterial, sizeof(Material) * m_Header.materialCount },
+		{ kChunkQuantization, quantization.data(), sizeof(H3D2Quantization) * quantization.size() },
+		{ kChunkVertices, vertices.data(), vertices.size() },
+		{ kChunkIndices, indices.data(), indices.size() },
+		{ kChunkVerticesDepth, verticesDepth.data(), verticesDepth.size() },
+		{ kChunkMeshlets, m_pMeshlet, sizeof(Meshlet) * m_MeshletCount },
+		{ kChunkLods, m_pLod, sizeof(MeshLod) * m_LodCount },
+		{ kChunkLodIndices, lodIndices.data(), lodIndices.size() },
+		{ kChunkOccluders, m_pOccluder, sizeof(MeshOccluder) * m_OccluderCount },
+		{ kChunkIndicesDepth, indicesDepth.data(), indicesDepth.size() },
+	};
+	const uint32_t chunkCount = separateDepthIndices ? _countof(chunks) : _countof(chunks) - 1;
+
+	FILE *file = nullptr;
+	if (0 != fopen_s(&file, filename, "wb"))
+		return false;
+
+	bool ok = false;
+	const unsigned char padding[16] = {};
+
+	H3D2FileHeader fileHeader = { kH3D2Magic, kH3D2Version, chunkCount, 0 };
+	if (1 != fwrite(&fileHeader, sizeof(fileHeader), 1, file)) goto h3d_save_fail;
+
+	for (uint32_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		const Chunk &chunk = chunks[chunkIndex];
+
+		H3D2ChunkHeader chunkHeader = { chunk.id, (uint32_t)chunk.size, { 0, 0 } };
+		if (1 != fwrite(&chunkHeader, sizeof(chunkHeader), 1, file)) goto h3d_save_fail;
+		if (chunk.size > 0)
+			if (1 != fwrite(chunk.data, chunk.size, 1, file)) goto h3d_save_fail;
+		if (H3D2Align(chunk.size) != chunk.size)
+			if (1 != fwrite(padding, H3D2Align(chunk.size) - chunk.size, 1, file)) goto h3d_save_fail;
+	}
+
+	ok = true;
+
+h3d_save_fail:
+
+	if (EOF == fclose(file))
+		ok = false;
+
+	return ok;
+}
+
+void Model::ReleaseTextures()
+{
+	// the cache may evict the textures once nothing else uses them
+	m_TextureRefs.clear();
+
+	delete [] m_SRVs;
+	m_SRVs = nullptr;
 }
 
 void Model::LoadTextures(void)
@@ -167,8 +815,18 @@ void Model::LoadTextures(void)
 	ReleaseTextures();
 
 	m_SRVs = new D3D12_CPU_DESCRIPTOR_HANDLE[m_Header.materialCount * 6];
+	m_TextureRefs.reserve(m_Header.materialCount * 3);
 
-	const ManagedTexture* MatTextures[6] = {};
+	TextureManager::TextureRef MatTextures[6];
+
+	// get every texture file read in parallel, the loads below then mostly wait on reads already under way
+	for (uint32_t materialIdx = 0; materialIdx < m_Header.materialCount; ++materialIdx)
+	{
+		const Material& pMaterial = m_pMaterial[materialIdx];
+		TextureManager::PrefetchFromFile(pMaterial.texDiffusePath);
+		TextureManager::PrefetchFromFile(pMaterial.texSpecularPath);
+		TextureManager::PrefetchFromFile(pMaterial.texNormalPath);
+	}
 
 	for (uint32_t materialIdx = 0; materialIdx < m_Header.materialCount; ++materialIdx)
 	{
@@ -212,5 +870,9 @@ void Model::LoadTextures(void)
 		m_SRVs[materialIdx * 6 + 3] = MatTextures[3]->GetSRV();
 		m_SRVs[materialIdx * 6 + 4] = MatTextures[0]->GetSRV();
 		m_SRVs[materialIdx * 6 + 5] = MatTextures[0]->GetSRV();
+
+		m_TextureRefs.push_back(MatTextures[0]);
+		m_TextureRefs.push_back(MatTextures[1]);
+		m_TextureRefs.push_back(MatTextures[3]);
 	}
 }
@@ -0,0 +1,50 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+namespace Graphics
+{
+	//-----------------------------------------------------------------------------
+	//  OptimizeOverdraw
+	//-----------------------------------------------------------------------------
+	//  Reorders an index list that has already been through OptimizeFaces so that
+	//  the triangles likely to occlude others come first, after Sander, Nehab and
+	//  Barczak's "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+	//  The list is cut into clusters wherever the vertex cache empties, and then
+	//  wherever a cluster's running cache miss ratio is within threshold of the
+	//  ratio for the whole cluster. Clusters are sorted by how far out from the
+	//  middle of the mesh they face, which doesn't depend on the view.
+	//
+	//  Parameters:
+	//      indexList
+	//          input index list, already optimized for the vertex cache
+	//      indexCount
+	//          the number of indices in the list
+	//      positionData
+	//          the first vertex's position, three floats
+	//      vertexStride
+	//          bytes from one position to the next
+	//      vertexCount
+	//          the number of vertices indexList refers to
+	//      newIndexList
+	//          a pointer to a preallocated buffer the same size as indexList to
+	//          hold the reordered index list
+	//      threshold
+	//          how much worse than the cluster's own cache miss ratio a split is
+	//          allowed to be. 1.0 keeps the cache behaviour, 1.05 is a good start
+	//      cacheSize
+	//          the size of the simulated post-transform cache
+	//-----------------------------------------------------------------------------
+	template <typename IndexType>
+	void OptimizeOverdraw(const IndexType* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, IndexType* newIndexList, float threshold, uint16_t cacheSize);
+
+	template void OptimizeOverdraw<uint16_t>(const uint16_t* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, uint16_t* newIndexList, float threshold, uint16_t cacheSize);
+	template void OptimizeOverdraw<uint32_t>(const uint32_t* indexList, uint32_t indexCount, const unsigned char* positionData, uint32_t vertexStride, uint32_t vertexCount, uint32_t* newIndexList, float threshold, uint16_t cacheSize);
+}
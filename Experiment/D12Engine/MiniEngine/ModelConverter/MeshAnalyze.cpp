@@ -0,0 +1,220 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "Model.h"
+#include "MeshAnalyze.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+
+namespace Graphics
+{
+
+namespace
+{
+	const int kOverdrawResolution = 256;
+
+	const uint32_t kFetchLineSize = 64;
+	const uint32_t kFetchCacheLines = 16 * 1024 / kFetchLineSize;
+
+	// Each view looks along one axis. right x up is minus the view direction, as for a right handed camera.
+	struct OverdrawView
+	{
+		float right[3];
+		float up[3];
+		float forward[3];
+	};
+
+	const OverdrawView kOverdrawViews[6] =
+	{
+		{ {  0.0f, 0.0f,  1.0f }, { 0.0f, 1.0f,  0.0f }, {  1.0f,  0.0f,  0.0f } },
+		{ {  0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f,  0.0f }, { -1.0f,  0.0f,  0.0f } },
+		{ {  1.0f, 0.0f,  0.0f }, { 0.0f, 0.0f,  1.0f }, {  0.0f,  1.0f,  0.0f } },
+		{ {  1.0f, 0.0f,  0.0f }, { 0.0f, 0.0f, -1.0f }, {  0.0f, -1.0f,  0.0f } },
+		{ { -1.0f, 0.0f,  0.0f }, { 0.0f, 1.0f,  0.0f }, {  0.0f,  0.0f,  1.0f } },
+		{ {  1.0f, 0.0f,  0.0f }, { 0.0f, 1.0f,  0.0f }, {  0.0f,  0.0f, -1.0f } },
+	};
+
+	float Dot(const float *a, const float *b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+}
+
+VertexCacheStats AnalyzeVertexCache(const unsigned char *indexData, unsigned int indexStride, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats = {};
+
+	// a vertex is still cached if fewer than cacheSize vertices have been loaded since it was
+	std::vector<uint32_t> loadTime(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t time = cacheSize;
+	uint32_t referencedCount = 0;
+
+	for (uint32_t n = 0; n < indexCount; n++)
+	{
+		uint32_t index = Model::GetIndex(indexData, indexStride, n);
+		if (index >= vertexCount)
+			continue;
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			referencedCount++;
+		}
+
+		if (time - loadTime[index] >= cacheSize)
+		{
+			loadTime[index] = ++time;
+			stats.verticesTransformed++;
+		}
+	}
+
+	stats.acmr = indexCount >= 3 ? (float)stats.verticesTransformed / (float)(indexCount / 3) : 0.0f;
+	stats.atvr = referencedCount > 0 ? (float)stats.verticesTransformed / (float)referencedCount : 0.0f;
+	return stats;
+}
+
+OverdrawStats AnalyzeOverdraw(const unsigned char *indexData, unsigned int indexStride, uint32_t indexCount, const unsigned char *positionData, uint32_t vertexStride, uint32_t vertexCount)
+{
+	OverdrawStats stats = {};
+
+	auto position = [&](uint32_t vertex) -> const float*
+	{
+		return (const float*)(positionData + vertex * vertexStride);
+	};
+
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			boundsMin[k] = std::min(boundsMin[k], position(v)[k]);
+			boundsMax[k] = std::max(boundsMax[k], position(v)[k]);
+		}
+	}
+
+	// the same scale on every axis, so nothing is stretched
+	float extent = std::max(boundsMax[0] - boundsMin[0], std::max(boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2]));
+	if (!(extent > 0.0f))
+		return stats;
+	const float scale = (float)(kOverdrawResolution - 1) / extent;
+
+	std::vector<float> depthBuffer(kOverdrawResolution * kOverdrawResolution);
+	std::vector<float> screen(vertexCount * 3);
+
+	for (const OverdrawView &view : kOverdrawViews)
+	{
+		std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+		const float originX = Dot(boundsMin, view.right) < Dot(boundsMax, view.right) ? Dot(boundsMin, view.right) : Dot(boundsMax, view.right);
+		const float originY = Dot(boundsMin, view.up) < Dot(boundsMax, view.up) ? Dot(boundsMin, view.up) : Dot(boundsMax, view.up);
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			screen[v * 3 + 0] = (Dot(position(v), view.right) - originX) * scale;
+			screen[v * 3 + 1] = (Dot(position(v), view.up) - originY) * scale;
+			screen[v * 3 + 2] = Dot(position(v), view.forward);
+		}
+
+		for (uint32_t n = 0; n + 2 < indexCount; n += 3)
+		{
+			uint32_t i0 = Model::GetIndex(indexData, indexStride, n + 0);
+			uint32_t i1 = Model::GetIndex(indexData, indexStride, n + 1);
+			uint32_t i2 = Model::GetIndex(indexData, indexStride, n + 2);
+			if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+				continue;
+
+			const float *p0 = &screen[i0 * 3];
+			const float *p1 = &screen[i1 * 3];
+			const float *p2 = &screen[i2 * 3];
+
+			// counter-clockwise as seen by the viewer is positive
+			float area = (p1[0] - p0[0]) * (p2[1] - p0[1]) - (p1[1] - p0[1]) * (p2[0] - p0[0]);
+			if (area <= 0.0f)
+				continue;
+
+			int minX = std::max(0, (int)floorf(std::min(p0[0], std::min(p1[0], p2[0]))));
+			int minY = std::max(0, (int)floorf(std::min(p0[1], std::min(p1[1], p2[1]))));
+			int maxX = std::min(kOverdrawResolution - 1, (int)ceilf(std::max(p0[0], std::max(p1[0], p2[0]))));
+			int maxY = std::min(kOverdrawResolution - 1, (int)ceilf(std::max(p0[1], std::max(p1[1], p2[1]))));
+
+			const float invArea = 1.0f / area;
+			for (int y = minY; y <= maxY; y++)
+			{
+				for (int x = minX; x <= maxX; x++)
+				{
+					float px = (float)x + 0.5f;
+					float py = (float)y + 0.5f;
+
+					// each edge function is the weight of the vertex opposite the edge
+					float w0 = (p2[0] - p1[0]) * (py - p1[1]) - (p2[1] - p1[1]) * (px - p1[0]);
+					float w1 = (p0[0] - p2[0]) * (py - p2[1]) - (p0[1] - p2[1]) * (px - p2[0]);
+					float w2 = (p1[0] - p0[0]) * (py - p0[1]) - (p1[1] - p0[1]) * (px - p0[0]);
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+
+					float depth = (w0 * p0[2] + w1 * p1[2] + w2 * p2[2]) * invArea;
+					float &stored = depthBuffer[y * kOverdrawResolution + x];
+					if (depth < stored)
+					{
+						stored = depth;
+						stats.pixelsShaded++;
+					}
+				}
+			}
+		}
+
+		for (float depth : depthBuffer)
+		{
+			if (depth != FLT_MAX)
+				stats.pixelsCovered++;
+		}
+	}
+
+	stats.overdraw = stats.pixelsCovered > 0 ? (float)stats.pixelsShaded / (float)stats.pixelsCovered : 0.0f;
+	return stats;
+}
+
+VertexFetchStats AnalyzeVertexFetch(const unsigned char *indexData, unsigned int indexStride, uint32_t indexCount, uint32_t vertexCount, uint32_t vertexStride)
+{
+	VertexFetchStats stats = {};
+
+	std::vector<uint32_t> cachedLine(kFetchCacheLines, (uint32_t)-1);
+
+	for (uint32_t n = 0; n < indexCount; n++)
+	{
+		uint32_t index = Model::GetIndex(indexData, indexStride, n);
+		if (index >= vertexCount)
+			continue;
+
+		// a vertex can straddle lines
+		uint32_t firstLine = index * vertexStride / kFetchLineSize;
+		uint32_t lastLine = (index * vertexStride + vertexStride - 1) / kFetchLineSize;
+		for (uint32_t line = firstLine; line <= lastLine; line++)
+		{
+			uint32_t &slot = cachedLine[line % kFetchCacheLines];
+			if (slot != line)
+			{
+				slot = line;
+				stats.bytesFetched += kFetchLineSize;
+			}
+		}
+	}
+
+	uint64_t vertexDataSize = (uint64_t)vertexCount * vertexStride;
+	stats.overfetch = vertexDataSize > 0 ? (float)stats.bytesFetched / (float)vertexDataSize : 0.0f;
+	return stats;
+}
+
+} // namespace Graphics
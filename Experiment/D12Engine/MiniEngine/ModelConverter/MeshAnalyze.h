@@ -0,0 +1,51 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+namespace Graphics
+{
+	//-----------------------------------------------------------------------------
+	//  Offline estimates of what a mesh costs the GPU to draw, for comparing the
+	//  vertex cache and overdraw trade-off made by Model::Optimize.
+	//  Indices are read with Model::GetIndex, so either index width works.
+	//-----------------------------------------------------------------------------
+
+	struct VertexCacheStats
+	{
+		uint32_t verticesTransformed;
+		float acmr; // vertices transformed per triangle, 0.5 at best and 3 at worst
+		float atvr; // vertices transformed per vertex referenced, 1 at best
+	};
+
+	//  Through a FIFO post-transform cache of cacheSize entries
+	VertexCacheStats AnalyzeVertexCache(const unsigned char *indexData, unsigned int indexStride, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize);
+
+	struct OverdrawStats
+	{
+		uint64_t pixelsCovered;
+		uint64_t pixelsShaded;
+		float overdraw; // pixels shaded per pixel covered, 1 at best
+	};
+
+	//  Rasterizes the mesh at a low resolution from along each axis in both directions, with
+	//  back face culling for counter-clockwise front faces and a less-than depth test
+	OverdrawStats AnalyzeOverdraw(const unsigned char *indexData, unsigned int indexStride, uint32_t indexCount, const unsigned char *positionData, uint32_t vertexStride, uint32_t vertexCount);
+
+	struct VertexFetchStats
+	{
+		uint64_t bytesFetched;
+		float overfetch; // bytes fetched per byte of vertex data, 1 at best
+	};
+
+	//  Through a 16KB direct mapped cache of 64 byte lines, assuming the vertex data starts on a line
+	VertexFetchStats AnalyzeVertexFetch(const unsigned char *indexData, unsigned int indexStride, uint32_t indexCount, uint32_t vertexCount, uint32_t vertexStride);
+}
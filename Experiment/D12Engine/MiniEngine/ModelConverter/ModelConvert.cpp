@@ -12,8 +12,13 @@
 //
 
 #include "Model.h"
+#include "MeshAnalyze.h"
+#include "Physics/Hull/physicsHull.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
 
 using namespace Graphics;
 
@@ -22,7 +27,7 @@ void PrintHelp()
 	printf("model_convert\n");
 
 	printf("usage:\n");
-	printf("model_convert input_file output_file\n");
+	printf("model_convert input_file output_file [weld_epsilon [overdraw_threshold [lod_count [occluder_triangles [texture_root]]]]]\n");
 }
 
 void PrintModelStats(const Model *model)
@@ -39,10 +44,20 @@ void PrintModelStats(const Model *model)
 	printf("vertex data size depth-only: %u\n", model->m_Header.vertexDataByteSizeDepth);
 	printf("\n");
 
+	// a typical post-transform cache, smaller than the one the optimizer assumes
+	const uint32_t analyzeCacheSize = 16;
+	uint64_t totalVerticesTransformed = 0;
+	uint64_t totalFaces = 0;
+	uint64_t totalPixelsCovered = 0;
+	uint64_t totalPixelsShaded = 0;
+	uint64_t totalBytesFetched = 0;
+
 	printf("mesh count: %u\n", model->m_Header.meshCount);
 	for (unsigned int meshIndex = 0; meshIndex < model->m_Header.meshCount; meshIndex++)
 	{
 		const Model::Mesh *mesh = model->m_pMesh + meshIndex;
+		const unsigned char *indexData = model->m_pIndexData + mesh->indexDataByteOffset;
+		const unsigned char *vertexData = model->m_pVertexData + mesh->vertexDataByteOffset;
 
 		auto printAttribFormat = [](unsigned int format) -> void
 		{
@@ -73,6 +88,33 @@ void PrintModelStats(const Model *model)
 		printf("mesh %u\n", meshIndex);
 		printf("vertices: %u\n", mesh->vertexCount);
 		printf("indices: %u\n", mesh->indexCount);
+		printf("index stride: %u\n", mesh->indexStride);
+		if (model->m_MeshletCount > 0)
+			printf("meshlets: %u\n", model->m_pMeshFirstMeshlet[meshIndex + 1] - model->m_pMeshFirstMeshlet[meshIndex]);
+		if (model->m_LodCount > 0)
+		{
+			for (uint32_t lodIndex = model->m_pMeshFirstLod[meshIndex]; lodIndex < model->m_pMeshFirstLod[meshIndex + 1]; lodIndex++)
+			{
+				const Model::MeshLod *lod = model->m_pLod + lodIndex;
+				printf("lod %u: indices %u, error %f\n", lodIndex - model->m_pMeshFirstLod[meshIndex] + 1, lod->indexCount, lod->error);
+			}
+		}
+
+		VertexCacheStats cacheStats = AnalyzeVertexCache(indexData, mesh->indexStride, mesh->indexCount, mesh->vertexCount, analyzeCacheSize);
+		OverdrawStats overdrawStats = AnalyzeOverdraw(indexData, mesh->indexStride, mesh->indexCount
+			, vertexData + mesh->attrib[Model::attrib_position].offset, mesh->vertexStride, mesh->vertexCount);
+		VertexFetchStats fetchStats = AnalyzeVertexFetch(indexData, mesh->indexStride, mesh->indexCount, mesh->vertexCount, mesh->vertexStride);
+
+		printf("acmr: %f, atvr: %f (%u entry cache)\n", cacheStats.acmr, cacheStats.atvr, analyzeCacheSize);
+		printf("overdraw: %f\n", overdrawStats.overdraw);
+		printf("vertex fetch: %llu bytes, overfetch %f\n", (unsigned long long)fetchStats.bytesFetched, fetchStats.overfetch);
+
+		totalVerticesTransformed += cacheStats.verticesTransformed;
+		totalFaces += mesh->indexCount / 3;
+		totalPixelsCovered += overdrawStats.pixelsCovered;
+		totalPixelsShaded += overdrawStats.pixelsShaded;
+		totalBytesFetched += fetchStats.bytesFetched;
+
 		printf("vertex stride: %u\n", mesh->vertexStride);
 		for (int n = 0; n < Model::maxAttribs; n++)
 		{
@@ -102,6 +144,14 @@ void PrintModelStats(const Model *model)
 	}
 	printf("\n");
 
+	printf("total acmr: %f\n", totalFaces > 0 ? (float)totalVerticesTransformed / (float)totalFaces : 0.0f);
+	printf("total overdraw: %f\n", totalPixelsCovered > 0 ? (float)totalPixelsShaded / (float)totalPixelsCovered : 0.0f);
+	printf("total vertex fetch: %llu bytes\n", (unsigned long long)totalBytesFetched);
+	printf("total meshlets: %u\n", model->m_MeshletCount);
+	printf("total lods: %u\n", model->m_LodCount);
+	printf("occluders: %u\n", model->m_OccluderCount);
+	printf("\n");
+
 	printf("material count: %u\n", model->m_Header.materialCount);
 	for (unsigned int materialIndex = 0; materialIndex < model->m_Header.materialCount; materialIndex++)
 	{
@@ -112,9 +162,43 @@ void PrintModelStats(const Model *model)
 	printf("\n");
 }
 
+// The physics engine can only handle small convex objects, so each model gets a budgeted hull and
+// convex decomposition cached next to it, saving the engine from building them at startup.
+bool SaveConvexDecomposition(const Model *model, const char *filename)
+{
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+
+	for (unsigned int meshIndex = 0; meshIndex < model->m_Header.meshCount; meshIndex++)
+	{
+		const Model::Mesh *mesh = model->m_pMesh + meshIndex;
+		const Model::Attrib &position = mesh->attrib[Model::attrib_position];
+		if (position.format != Model::attrib_format_float || position.components < 3)
+			continue;
+
+		const uint32_t baseVertex = (uint32_t)positions.size();
+		const unsigned char *vertex = model->m_pVertexData + mesh->vertexDataByteOffset + position.offset;
+		for (unsigned int n = 0; n < mesh->vertexCount; n++, vertex += mesh->vertexStride)
+			positions.push_back(*(const DirectX::XMFLOAT3 *)vertex);
+
+		const unsigned char *indexData = model->m_pIndexData + mesh->indexDataByteOffset;
+		for (unsigned int n = 0; n < mesh->indexCount; n++)
+			indices.push_back(baseVertex + Model::GetIndex(indexData, mesh->indexStride, n));
+	}
+
+	Physics::ConvexDecomposition decomposition;
+	decomposition.build(positions.data(), (int)positions.size(), indices.data(), (int)indices.size()
+		, PHYSICS_HULL_DEFAULT_MAX_VERTICES, PHYSICS_HULL_DEFAULT_MAX_PIECES, PHYSICS_HULL_DEFAULT_MAX_CONCAVITY);
+
+	printf("hull vertices: %u\n", (unsigned int)decomposition.hull().positions().size());
+	printf("convex pieces: %u\n", (unsigned int)decomposition.pieces().size());
+
+	return decomposition.save(filename);
+}
+
 int main(int argc, char **argv)
 {
-	if (argc != 3)
+	if (argc < 3 || argc > 8)
 	{
 		PrintHelp();
 		return -1;
@@ -126,6 +210,36 @@ int main(int argc, char **argv)
 	printf("input file %s\n", input_file);
 	printf("output file %s\n", output_file);
 
+	if (argc >= 4)
+	{
+		Model::s_OptimizeWeldEpsilon = (float)atof(argv[3]);
+		printf("weld epsilon %f\n", Model::s_OptimizeWeldEpsilon);
+	}
+
+	if (argc >= 5)
+	{
+		Model::s_OptimizeOverdrawThreshold = (float)atof(argv[4]);
+		printf("overdraw threshold %f\n", Model::s_OptimizeOverdrawThreshold);
+	}
+
+	if (argc >= 6)
+	{
+		Model::s_OptimizeLodCount = (unsigned int)atoi(argv[5]);
+		printf("lod count %u\n", Model::s_OptimizeLodCount);
+	}
+
+	if (argc >= 7)
+	{
+		Model::s_OptimizeOccluderTriangles = (unsigned int)atoi(argv[6]);
+		printf("occluder triangles %u\n", Model::s_OptimizeOccluderTriangles);
+	}
+
+	if (argc == 8)
+	{
+		Model::s_OptimizeTextureRoot = argv[7];
+		printf("texture root %s\n", Model::s_OptimizeTextureRoot);
+	}
+
 	Model model;
 
 	printf("loading...\n");
@@ -142,6 +256,16 @@ int main(int argc, char **argv)
 		return -1;
 	}
 
+	std::string hull_file = output_file;
+	hull_file = hull_file.substr(0, hull_file.find_last_of('.')) + ".hull";
+
+	printf("building convex hulls...\n");
+	if (!SaveConvexDecomposition(&model, hull_file.c_str()))
+	{
+		printf("failed to save convex hulls: %s\n", hull_file.c_str());
+		return -1;
+	}
+
 	printf("done\n");
 
 	PrintModelStats(&model);
@@ -0,0 +1,101 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Replays the same random allocations and frees on BuddyRange and on the free list buddy allocator it
+// replaced, and times each.
+//
+
+#include "FreeListBuddy.h"
+#include "TestCommon.h"
+#include <random>
+#include <utility>
+#include <vector>
+
+static const int kSteps = 100000;
+
+// Small orders are the most common, like the upload buffers that use the allocator. A free names one of the
+// live blocks by its index, taken modulo their count when it's replayed.
+static std::vector<std::pair<bool, uint32_t>> MakeWorkload( uint32_t maxOrder )
+{
+	std::mt19937 Random(maxOrder);
+	std::vector<std::pair<bool, uint32_t>> Workload(kSteps);
+	for (std::pair<bool, uint32_t>& Step : Workload)
+	{
+		Step.first = Random() % 5 < 3;
+		uint32_t Order = Random() % 8;
+		Step.second = Step.first ? (Order < maxOrder ? Order : maxOrder) : Random();
+	}
+	return Workload;
+}
+
+template <typename Allocator>
+static uint64_t Replay( Allocator& allocator, const std::vector<std::pair<bool, uint32_t>>& workload, std::vector<std::pair<size_t, uint32_t>>& live )
+{
+	uint64_t Sum = 0;
+	live.clear();
+	for (const std::pair<bool, uint32_t>& Step : workload)
+	{
+		if (Step.first || live.empty())
+		{
+			uint32_t Order = Step.first ? Step.second : 0;
+			size_t Offset = allocator.Allocate(Order);
+			if (Offset != BuddyRange::kInvalidOffset)
+			{
+				live.push_back(std::make_pair(Offset, Order));
+				Sum += Offset;
+			}
+		}
+		else
+		{
+			size_t Index = Step.second % live.size();
+			allocator.Free(live[Index].first, live[Index].second);
+			live[Index] = live.back();
+			live.pop_back();
+		}
+	}
+	for (const std::pair<size_t, uint32_t>& Block : live)
+		allocator.Free(Block.first, Block.second);
+	return Sum;
+}
+
+static void Bench( uint32_t maxOrder )
+{
+	const std::vector<std::pair<bool, uint32_t>> Workload = MakeWorkload(maxOrder);
+	std::vector<std::pair<size_t, uint32_t>> Live;
+	Live.reserve(kSteps);
+
+	// Every replay frees what it allocated, so each starts from one free block without a reset
+	BuddyRange Range;
+	Range.Create(maxOrder);
+	double RangeTime = NanosecondsPerCall([&]
+	{
+		return Replay(Range, Workload, Live);
+	});
+
+	FreeListBuddy Reference(maxOrder);
+	double FreeListTime = NanosecondsPerCall([&]
+	{
+		return Replay(Reference, Workload, Live);
+	});
+
+	// Both give the same offsets, so the sums of them must match
+	CHECK(Replay(Range, Workload, Live) == Replay(Reference, Workload, Live));
+	CHECK(Range.IsFree(0, maxOrder) && Reference.IsFree(0, maxOrder));
+
+	printf("max order %2u: BuddyRange %6.1f ns, free lists %6.1f ns per allocate or free\n",
+		maxOrder, RangeTime / kSteps, FreeListTime / kSteps);
+}
+
+int main()
+{
+	const uint32_t MaxOrders[] = { 10, 16, 24 };
+	for (uint32_t MaxOrder : MaxOrders)
+		Bench(MaxOrder);
+
+	return TestResult("BuddyRangeBench");
+}
@@ -0,0 +1,111 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Allocates and frees at random from BuddyRange and from a plain buddy allocator with a sorted free list per
+// order, which must agree on every offset handed out and on which blocks are free.
+//
+
+#include "FreeListBuddy.h"
+#include "TestCommon.h"
+#include <math.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+static void CheckUnitSizeToOrder( void )
+{
+	const size_t Sizes[] = { 1, 2, 3, 4, 5, 7, 8, 9, 1000, 1024, 1025, (size_t)1 << 35 };
+	for (size_t Size : Sizes)
+	{
+		uint32_t Expected = Size <= 1 ? 0 : (uint32_t)ceil(log2((double)Size));
+		CHECK(BuddyRange::UnitSizeToOrder(Size) == Expected);
+	}
+}
+
+// Compares every block of every order, which is slow, so only every so often
+static bool SameFreeBlocks( const BuddyRange& range, const FreeListBuddy& reference, uint32_t maxOrder )
+{
+	for (uint32_t Order = 0; Order <= maxOrder; ++Order)
+	{
+		for (size_t Block = 0; Block < ((size_t)1 << (maxOrder - Order)); ++Block)
+		{
+			size_t Offset = Block << Order;
+			if (range.IsFree(Offset, Order) != reference.IsFree(Offset, Order))
+			{
+				printf("order %u block at %zu differs with max order %u\n", Order, Offset, maxOrder);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void Fuzz( uint32_t maxOrder, int steps )
+{
+	std::mt19937 Random(maxOrder * 7 + 1);
+	BuddyRange Range;
+	Range.Create(maxOrder);
+	FreeListBuddy Reference(maxOrder);
+
+	std::vector<std::pair<size_t, uint32_t>> Live;
+	for (int Step = 0; Step < steps; ++Step)
+	{
+		// Twice as many allocations as frees, including orders that don't fit, until the range is full
+		if (Live.empty() || Random() % 3 != 0)
+		{
+			uint32_t Order = Random() % (maxOrder + 2);
+			size_t Offset = Range.Allocate(Order);
+			size_t Expected = Reference.Allocate(Order);
+			if (Offset != Expected)
+			{
+				printf("order %u allocated at %zx instead of %zx with max order %u\n", Order, Offset, Expected, maxOrder);
+				++s_Failures;
+				return;
+			}
+			if (Offset != BuddyRange::kInvalidOffset)
+				Live.push_back(std::make_pair(Offset, Order));
+		}
+		else
+		{
+			size_t Index = Random() % Live.size();
+			std::pair<size_t, uint32_t> Block = Live[Index];
+			Live[Index] = Live.back();
+			Live.pop_back();
+			Range.Free(Block.first, Block.second);
+			Reference.Free(Block.first, Block.second);
+		}
+
+		if (Step % 9973 == 0 && !SameFreeBlocks(Range, Reference, maxOrder))
+		{
+			++s_Failures;
+			return;
+		}
+	}
+
+	// Everything merges back into the one block
+	for (const std::pair<size_t, uint32_t>& Block : Live)
+		Range.Free(Block.first, Block.second);
+	CHECK(Range.IsFree(0, maxOrder));
+	CHECK(Range.Allocate(maxOrder) == 0);
+	CHECK(Range.Allocate(0) == BuddyRange::kInvalidOffset);
+
+	Range.Reset();
+	CHECK(Range.IsFree(0, maxOrder));
+}
+
+int main()
+{
+	CheckUnitSizeToOrder();
+
+	// Single word bitmaps, exactly one word, and two and three summary levels
+	const uint32_t MaxOrders[] = { 0, 3, 6, 7, 12, 14 };
+	for (uint32_t MaxOrder : MaxOrders)
+		Fuzz(MaxOrder, 200000);
+
+	return TestResult("BuddyRangeTest");
+}
@@ -0,0 +1,66 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Times ParseDDS on a few typical files, with the table reused as the texture manager does and built fresh,
+// beside the per mip walk it replaced.
+//
+
+#include "DDSTestFile.h"
+#include "TestCommon.h"
+#include <vector>
+
+using namespace DDS;
+using namespace DDSTest;
+
+static void Report( const char* name, double nanoseconds )
+{
+	printf("%-36s %9.1f ns %10.0f per ms\n", name, nanoseconds, 1e6 / nanoseconds);
+}
+
+static void Bench( const char* name, const FileDesc& desc, size_t dataSize )
+{
+	const std::vector<uint8_t> File = MakeFile(desc, dataSize);
+
+	TextureLayout Reused;
+	CHECK(ParseDDS(File.data(), File.size(), Reused) == Result::Ok);
+
+	printf("%s, %zu subresources\n", name, Reused.Subresources.size());
+
+	Report("  ParseDDS, reused table", NanosecondsPerCall([&]
+	{
+		ParseDDS(File.data(), File.size(), Reused);
+		return (uint64_t)Reused.DataSize;
+	}));
+
+	Report("  ParseDDS, new table", NanosecondsPerCall([&]
+	{
+		TextureLayout Layout;
+		ParseDDS(File.data(), File.size(), Layout);
+		return (uint64_t)Layout.DataSize;
+	}));
+
+	std::vector<std::pair<uint64_t, uint64_t>> Walked;
+	Report("  Walk over the mips", NanosecondsPerCall([&]
+	{
+		return WalkMips(Reused, Walked);
+	}));
+}
+
+int main()
+{
+	const FileDesc DXT1 = { 256, 256, 1, 9, DXGI_FORMAT_UNKNOWN, MAKEFOURCC('D', 'X', 'T', '1'), 0, 1, false, false };
+	Bench("DXT1 256x256", DXT1, 1 << 16);
+
+	const FileDesc Cubes = { 1024, 1024, 1, 11, DXGI_FORMAT_BC7_UNORM, 0, 3, 2, true, false };
+	Bench("BC7 1024x1024 array of two cubes", Cubes, 32 << 20);
+
+	const FileDesc Volume = { 128, 128, 64, 8, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 4, 1, false, true };
+	Bench("RGBA8 128x128x64 volume", Volume, 8 << 20);
+
+	return TestResult("DDSLayoutBench");
+}
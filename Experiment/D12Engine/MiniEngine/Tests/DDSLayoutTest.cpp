@@ -0,0 +1,110 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Checks the subresource table from ParseDDS against a plain walk over the mips, the way the loader found
+// them before the table existed, and that broken headers are turned away with the right result.
+//
+
+#include "DDSTestFile.h"
+#include "TestCommon.h"
+#include <vector>
+
+using namespace DirectX;
+using namespace DDS;
+using namespace DDSTest;
+
+static void CheckFile( const std::vector<uint8_t>& file, Result expected, size_t subresourceCount, TextureLayout& layout )
+{
+	Result r = ParseDDS(file.data(), file.size(), layout);
+	CHECK(r == expected);
+	if (r != Result::Ok || expected != Result::Ok)
+		return;
+
+	CHECK(layout.Subresources.size() == subresourceCount);
+
+	std::vector<std::pair<uint64_t, uint64_t>> Walked;
+	CHECK(WalkMips(layout, Walked) == layout.DataSize);
+	CHECK(Walked.size() == layout.Subresources.size());
+	for (size_t i = 0; i < Walked.size() && i < layout.Subresources.size(); ++i)
+	{
+		CHECK(layout.Subresources[i].Offset == Walked[i].first);
+		CHECK(layout.Subresources[i].RowPitch == Walked[i].second);
+	}
+}
+
+int main()
+{
+	// One table reused throughout, like the texture manager does
+	TextureLayout Layout;
+
+	// A legacy DXT1 file with a full mip chain, and exactly enough data for it
+	size_t DXT1Size = 0;
+	for (size_t Size = 256; ; Size >>= 1)
+	{
+		size_t Blocks = std::max<size_t>(1, (Size + 3) / 4);
+		DXT1Size += Blocks * Blocks * 8;
+		if (Size == 1)
+			break;
+	}
+	FileDesc DXT1 = { 256, 256, 1, 9, DXGI_FORMAT_UNKNOWN, MAKEFOURCC('D', 'X', 'T', '1'), 0, 1, false, false };
+	std::vector<uint8_t> DXT1File = MakeFile(DXT1, DXT1Size);
+	CheckFile(DXT1File, Result::Ok, 9, Layout);
+	CHECK(Layout.Format == DXGI_FORMAT_BC1_UNORM);
+	CHECK(Layout.Subresources[2].Width == 64);
+	CHECK(Layout.Subresources[8].Width == 1);
+	CHECK(GetSkippedMips(Layout, 64) == 2);
+	CHECK(GetSkippedMips(Layout, 0) == 0);
+
+	// One byte short of the last mip
+	CheckFile(MakeFile(DXT1, DXT1Size - 1), Result::Truncated, 0, Layout);
+
+	// Two BC7 cube maps, which are twelve faces of eight mips each
+	FileDesc Cubes = { 128, 128, 1, 8, DXGI_FORMAT_BC7_UNORM, 0, 3, 2, true, false };
+	CheckFile(MakeFile(Cubes, 1 << 20), Result::Ok, 8 * 12, Layout);
+	CHECK(Layout.IsCubeMap && Layout.ArraySize == 12);
+	CHECK(Layout.AlphaMode == DDS_ALPHA_MODE_PREMULTIPLIED);
+	CHECK(Layout.DataOffset == 148);
+
+	// A volume, where each mip halves the depth too
+	FileDesc Volume = { 64, 32, 16, 7, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 4, 1, false, true };
+	CheckFile(MakeFile(Volume, 1 << 20), Result::Ok, 7, Layout);
+
+	// A 1D array with no mip count, which means one mip
+	FileDesc Array1D = { 300, 1, 1, 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 2, 4, false, false };
+	CheckFile(MakeFile(Array1D, 1 << 20), Result::Ok, 4, Layout);
+
+	// A planar format, whose odd size rounds up
+	FileDesc Planar = { 100, 60, 1, 1, DXGI_FORMAT_NV12, 0, 3, 1, false, false };
+	CheckFile(MakeFile(Planar, 1 << 20), Result::Ok, 1, Layout);
+
+	// Files D3D12 couldn't create
+	FileDesc HugeCubeArray = { 16, 16, 1, 1, DXGI_FORMAT_BC1_UNORM, 0, 3, 0x2AAAAAAB, true, false };
+	CheckFile(MakeFile(HugeCubeArray, 1 << 10), Result::NotSupported, 0, Layout);
+	FileDesc Palette = { 16, 16, 1, 1, DXGI_FORMAT_P8, 0, 3, 1, false, false };
+	CheckFile(MakeFile(Palette, 1 << 10), Result::NotSupported, 0, Layout);
+	FileDesc TooManyMips = { 16, 16, 1, 16, DXGI_FORMAT_BC1_UNORM, 0, 3, 1, false, false };
+	CheckFile(MakeFile(TooManyMips, 1 << 10), Result::NotSupported, 0, Layout);
+
+	// Headers that don't make sense
+	std::vector<uint8_t> NoMagic = DXT1File;
+	NoMagic[0] = 'X';
+	CheckFile(NoMagic, Result::NotDDS, 0, Layout);
+
+	FileDesc Small = { 16, 16, 1, 1, DXGI_FORMAT_BC1_UNORM, 0, 3, 1, false, false };
+	std::vector<uint8_t> ShortHeaders = MakeFile(Small, 0);
+	ShortHeaders.resize(130);
+	CheckFile(ShortHeaders, Result::NotDDS, 0, Layout);
+
+	FileDesc UnflaggedVolume = { 16, 16, 4, 1, DXGI_FORMAT_BC1_UNORM, 0, 4, 1, false, false };
+	CheckFile(MakeFile(UnflaggedVolume, 1 << 10), Result::InvalidData, 0, Layout);
+
+	// The table is rebuilt after failures
+	CheckFile(DXT1File, Result::Ok, 9, Layout);
+
+	return TestResult("DDSLayoutTest");
+}
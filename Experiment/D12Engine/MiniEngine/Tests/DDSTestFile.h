@@ -0,0 +1,101 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Builds DDS files in memory for the DDS layout test and benchmark, and walks their mips the way the loader
+// did before the subresource table existed.
+//
+
+#pragma once
+
+#include "DDSLayout.h"
+#include "dds.h"
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace DDSTest
+{
+	using namespace DirectX;
+	using namespace DDS;
+
+	struct FileDesc
+	{
+		uint32_t Width, Height, Depth, MipCount;
+		DXGI_FORMAT Format;          // written to the DX10 header, when FourCC is 0
+		uint32_t FourCC;             // a legacy format instead of a DX10 header
+		uint32_t Dimension;
+		uint32_t ArraySize;
+		bool IsCubeMap;
+		bool IsVolume;
+	};
+
+	// Builds the headers for desc and follows them with dataSize bytes of pixel data
+	inline std::vector<uint8_t> MakeFile( const FileDesc& desc, size_t dataSize )
+	{
+		bool IsDX10 = desc.FourCC == 0;
+		std::vector<uint8_t> File(sizeof(uint32_t) + sizeof(DDS_HEADER) + (IsDX10 ? sizeof(DDS_HEADER_DXT10) : 0));
+
+		uint32_t Magic = DDS_MAGIC;
+		memcpy(File.data(), &Magic, sizeof(Magic));
+
+		DDS_HEADER Header = {};
+		Header.size = sizeof(DDS_HEADER);
+		Header.flags = DDS_HEIGHT | (desc.IsVolume ? DDS_HEADER_FLAGS_VOLUME : 0);
+		Header.width = desc.Width;
+		Header.height = desc.Height;
+		Header.depth = desc.Depth;
+		Header.mipMapCount = desc.MipCount;
+		Header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+		Header.ddspf.flags = DDS_FOURCC;
+		if (IsDX10)
+		{
+			Header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+
+			DDS_HEADER_DXT10 Extension = {};
+			Extension.dxgiFormat = desc.Format;
+			Extension.resourceDimension = desc.Dimension;
+			Extension.arraySize = desc.ArraySize;
+			Extension.miscFlag = desc.IsCubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+			Extension.miscFlags2 = DDS_ALPHA_MODE_PREMULTIPLIED;
+			memcpy(File.data() + sizeof(uint32_t) + sizeof(DDS_HEADER), &Extension, sizeof(Extension));
+		}
+		else
+		{
+			Header.ddspf.fourCC = desc.FourCC;
+			if (desc.IsCubeMap)
+				Header.caps2 = DDS_CUBEMAP | DDS_CUBEMAP_ALLFACES;
+		}
+		memcpy(File.data() + sizeof(uint32_t), &Header, sizeof(Header));
+
+		File.resize(File.size() + dataSize, 0xAB);
+		return File;
+	}
+
+	// Offset and row pitch of every subresource, found by stepping over each mip of each slice in turn
+	inline uint64_t WalkMips( const TextureLayout& layout, std::vector<std::pair<uint64_t, uint64_t>>& subresources )
+	{
+		uint64_t Offset = layout.DataOffset;
+		subresources.clear();
+		for (uint32_t Slice = 0; Slice < layout.ArraySize; ++Slice)
+		{
+			size_t Width = layout.Width, Height = layout.Height, Depth = layout.Depth;
+			for (uint32_t Mip = 0; Mip < layout.MipCount; ++Mip)
+			{
+				size_t NumBytes, RowBytes;
+				GetSurfaceInfo(Width, Height, layout.Format, &NumBytes, &RowBytes, nullptr);
+				subresources.push_back(std::make_pair(Offset, (uint64_t)RowBytes));
+				Offset += NumBytes * Depth;
+				Width = std::max<size_t>(Width >> 1, 1);
+				Height = std::max<size_t>(Height >> 1, 1);
+				Depth = std::max<size_t>(Depth >> 1, 1);
+			}
+		}
+		return Offset - layout.DataOffset;
+	}
+}
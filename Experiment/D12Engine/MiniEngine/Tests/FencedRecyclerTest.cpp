@@ -0,0 +1,184 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Several threads request and retire objects through one FencedRecycler while another completes fences, with
+// more objects than the ring holds so the overflow queue gets used too. No object may come back before its
+// fence completes or be handed to two threads at once, and every object must come back once all fences are done.
+//
+
+#include "FencedRecycler.h"
+#include "TestCommon.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Completes fences when told to, like a GPU that's always a little behind
+class FakeFence : public FenceQuery
+{
+public:
+	FakeFence() : m_Issued(0), m_Completed(0) {}
+
+	uint64_t Issue( void ) { return m_Issued.fetch_add(1) + 1; }
+	uint64_t GetIssued( void ) const { return m_Issued.load(); }
+	uint64_t GetCompleted( void ) const { return m_Completed.load(); }
+	void Complete( uint64_t FenceValue ) { m_Completed.store(FenceValue); }
+
+	virtual bool IsFenceComplete( uint64_t FenceValue ) override
+	{
+		return FenceValue <= m_Completed.load();
+	}
+
+private:
+	std::atomic<uint64_t> m_Issued;
+	std::atomic<uint64_t> m_Completed;
+};
+
+struct Page
+{
+	std::atomic<int> InUse;
+	uint64_t FenceValue; // written by whoever retires the page, before it's retired
+	std::atomic<int> TimesDrained;
+};
+
+static const uint32_t kThreadCount = 4;
+static const uint32_t kPageCount = FencedRecycler<Page>::kCapacity * 2;
+
+// Checks a page that just came out of the recycler and marks it taken
+static void Take( FakeFence& Fence, Page* P )
+{
+	if (P->InUse.exchange(1) != 0)
+	{
+		printf("a page was handed out twice\n");
+		++s_Failures;
+	}
+	if (P->FenceValue > Fence.GetCompleted())
+	{
+		printf("a page came back at fence %llu, before fence %llu\n", (unsigned long long)Fence.GetCompleted(), (unsigned long long)P->FenceValue);
+		++s_Failures;
+	}
+}
+
+static void Stress( FakeFence& Fence, FencedRecycler<Page>& Recycler, uint32_t iterations )
+{
+	std::vector<Page> Pages(kPageCount);
+	for (Page& P : Pages)
+	{
+		P.InUse = 0;
+		P.FenceValue = 0;
+		P.TimesDrained = 0;
+		Recycler.Retire(0, &P);
+	}
+
+	std::atomic<uint32_t> DoneRetiring(0);
+	std::atomic<bool> Drain(false);
+
+	std::vector<std::thread> Threads;
+	for (uint32_t t = 0; t < kThreadCount; ++t)
+	{
+		Threads.emplace_back([&, t]
+		{
+			// Hold a few pages at a time, like a command list does until it's executed
+			std::vector<Page*> Held;
+			for (uint32_t i = 0; i < iterations; ++i)
+			{
+				Page* P = Recycler.Request();
+				if (P != nullptr)
+				{
+					Take(Fence, P);
+					Held.push_back(P);
+				}
+				if (Held.size() > (i + t) % 8 || (P == nullptr && !Held.empty()))
+				{
+					uint64_t FenceValue = Fence.Issue();
+					for (Page* R : Held)
+					{
+						R->FenceValue = FenceValue;
+						R->InUse.store(0);
+						Recycler.Retire(FenceValue, R);
+					}
+					Held.clear();
+				}
+			}
+
+			uint64_t FenceValue = Fence.Issue();
+			for (Page* R : Held)
+			{
+				R->FenceValue = FenceValue;
+				R->InUse.store(0);
+				Recycler.Retire(FenceValue, R);
+			}
+
+			// Once every fence is done, this thread's cache and the shared queues must give back everything
+			++DoneRetiring;
+			while (!Drain.load())
+				std::this_thread::yield();
+			while (Page* P = Recycler.Request())
+			{
+				Take(Fence, P);
+				++P->TimesDrained;
+			}
+		});
+	}
+
+	// Complete fences a little behind the threads, until they're all done retiring
+	while (DoneRetiring.load() < kThreadCount)
+	{
+		uint64_t Issued = Fence.GetIssued();
+		if (Issued > 4)
+			Fence.Complete(Issued - 4);
+		std::this_thread::yield();
+	}
+	Fence.Complete(Fence.GetIssued());
+	Drain.store(true);
+
+	for (std::thread& T : Threads)
+		T.join();
+
+	for (Page& P : Pages)
+		CHECK(P.TimesDrained.load() == 1);
+}
+
+// Nothing comes back early, and ReleaseAll forgets everything
+static void Basics( FakeFence& Fence, FencedRecycler<Page>& Recycler )
+{
+	Page P[3] = {};
+	uint64_t First = Fence.Issue();
+	uint64_t Second = Fence.Issue();
+	Recycler.Retire(First, &P[0]);
+	Recycler.Retire(Second, &P[1]);
+	CHECK(Recycler.Request() == nullptr);
+
+	Fence.Complete(First);
+	CHECK(Recycler.Request() == &P[0]);
+	CHECK(Recycler.Request() == nullptr);
+
+	Fence.Complete(Second);
+	Recycler.Retire(Second, &P[2]);
+	CHECK(Recycler.Request() != nullptr);
+	Recycler.ReleaseAll();
+	CHECK(Recycler.Request() == nullptr);
+}
+
+int main()
+{
+	FakeFence Fence;
+
+	// The first few recyclers of a type get per-thread caches and the rest don't, so test one of each
+	FencedRecycler<Page> Cached(Fence);
+	FencedRecycler<Page> Unused1(Fence), Unused2(Fence), Unused3(Fence);
+	FencedRecycler<Page> Uncached(Fence);
+	static_assert(FencedRecycler<Page>::kMaxRecyclersPerType == 4, "Uncached should be the first recycler without caches");
+
+	Basics(Fence, Cached);
+	Basics(Fence, Uncached);
+	Stress(Fence, Cached, 200000);
+	Stress(Fence, Uncached, 200000);
+
+	return TestResult("FencedRecyclerTest");
+}
@@ -0,0 +1,64 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The buddy allocator BuddyRange replaced, kept as the reference for its test and benchmark.
+//
+
+#pragma once
+
+#include "BuddyRange.h"
+#include <algorithm>
+#include <set>
+#include <vector>
+
+// The free lists BuddyRange replaced, smallest offset first
+class FreeListBuddy
+{
+public:
+	explicit FreeListBuddy( uint32_t maxOrder ) : m_MaxOrder(maxOrder), m_FreeLists(maxOrder + 1)
+	{
+		m_FreeLists[maxOrder].insert(0);
+	}
+
+	size_t Allocate( uint32_t order )
+	{
+		if (order > m_MaxOrder)
+			return BuddyRange::kInvalidOffset;
+
+		std::set<size_t>& FreeList = m_FreeLists[order];
+		if (FreeList.empty())
+		{
+			size_t Offset = Allocate(order + 1);
+			if (Offset != BuddyRange::kInvalidOffset)
+				FreeList.insert(Offset + ((size_t)1 << order));
+			return Offset;
+		}
+
+		size_t Offset = *FreeList.begin();
+		FreeList.erase(FreeList.begin());
+		return Offset;
+	}
+
+	void Free( size_t offset, uint32_t order )
+	{
+		size_t Buddy = offset ^ ((size_t)1 << order);
+		if (order < m_MaxOrder && m_FreeLists[order].erase(Buddy) != 0)
+			Free(std::min(offset, Buddy), order + 1);
+		else
+			m_FreeLists[order].insert(offset);
+	}
+
+	bool IsFree( size_t offset, uint32_t order ) const
+	{
+		return m_FreeLists[order].count(offset) != 0;
+	}
+
+private:
+	uint32_t m_MaxOrder;
+	std::vector<std::set<size_t>> m_FreeLists;
+};
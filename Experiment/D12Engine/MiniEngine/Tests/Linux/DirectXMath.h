@@ -0,0 +1,199 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Stand-in for the Windows SDK header when the tests are built anywhere else. Just the types and functions
+// the code under test uses, written out one lane at a time, with the same results as the real thing.
+//
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace DirectX
+{
+	struct XMVECTOR
+	{
+		float v[4];
+	};
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+
+	typedef const XMVECTOR FXMVECTOR;
+	typedef const XMMATRIX& FXMMATRIX;
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+
+		XMFLOAT3() = default;
+		XMFLOAT3( float _x, float _y, float _z ) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+
+		XMFLOAT4() = default;
+		XMFLOAT4( float _x, float _y, float _z, float _w ) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct XMUINT4
+	{
+		uint32_t x, y, z, w;
+	};
+
+	struct XMVECTORU32
+	{
+		union
+		{
+			uint32_t u[4];
+			XMVECTOR v;
+		};
+
+		operator XMVECTOR() const { return v; }
+	};
+
+	inline XMVECTOR XMVectorSet( float x, float y, float z, float w )
+	{
+		XMVECTOR R = { { x, y, z, w } };
+		return R;
+	}
+
+	inline XMVECTOR XMVectorReplicate( float f ) { return XMVectorSet(f, f, f, f); }
+	inline XMVECTOR XMVectorZero() { return XMVectorReplicate(0.0f); }
+
+	inline XMVECTOR XMLoadFloat3( const XMFLOAT3* p ) { return XMVectorSet(p->x, p->y, p->z, 0.0f); }
+	inline XMVECTOR XMLoadFloat4( const XMFLOAT4* p ) { return XMVectorSet(p->x, p->y, p->z, p->w); }
+
+	inline void XMStoreFloat3( XMFLOAT3* p, FXMVECTOR v )
+	{
+		p->x = v.v[0];
+		p->y = v.v[1];
+		p->z = v.v[2];
+	}
+
+	inline void XMStoreFloat4( XMFLOAT4* p, FXMVECTOR v )
+	{
+		p->x = v.v[0];
+		p->y = v.v[1];
+		p->z = v.v[2];
+		p->w = v.v[3];
+	}
+
+	inline void XMStoreUInt4( XMUINT4* p, FXMVECTOR v )
+	{
+		memcpy(p, v.v, sizeof(*p));
+	}
+
+#define XM_PER_LANE(Expression) \
+	XMVECTOR R; \
+	for (int i = 0; i < 4; ++i) \
+		R.v[i] = Expression; \
+	return R
+
+	inline float XMVectorGetX( FXMVECTOR v ) { return v.v[0]; }
+
+	inline XMVECTOR XMVectorAdd( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(a.v[i] + b.v[i]); }
+	inline XMVECTOR XMVectorSubtract( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(a.v[i] - b.v[i]); }
+	inline XMVECTOR XMVectorMultiply( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(a.v[i] * b.v[i]); }
+	inline XMVECTOR XMVectorScale( FXMVECTOR a, float s ) { XM_PER_LANE(a.v[i] * s); }
+	inline XMVECTOR XMVectorMultiplyAdd( FXMVECTOR a, FXMVECTOR b, FXMVECTOR c ) { XM_PER_LANE(a.v[i] * b.v[i] + c.v[i]); }
+	inline XMVECTOR XMVectorMin( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+	inline XMVECTOR XMVectorMax( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+	inline XMVECTOR XMVectorLerp( FXMVECTOR a, FXMVECTOR b, float t ) { XM_PER_LANE(a.v[i] + (b.v[i] - a.v[i]) * t); }
+
+	// Comparisons give lanes of all ones or all zeros, like SSE
+	inline float XMLaneMask( bool b )
+	{
+		uint32_t Bits = b ? 0xFFFFFFFFu : 0u;
+		float f;
+		memcpy(&f, &Bits, sizeof(f));
+		return f;
+	}
+
+	inline uint32_t XMLaneBits( float f )
+	{
+		uint32_t Bits;
+		memcpy(&Bits, &f, sizeof(Bits));
+		return Bits;
+	}
+
+	inline float XMLaneFromBits( uint32_t Bits )
+	{
+		float f;
+		memcpy(&f, &Bits, sizeof(f));
+		return f;
+	}
+
+	inline XMVECTOR XMVectorGreaterOrEqual( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(XMLaneMask(a.v[i] >= b.v[i])); }
+	inline XMVECTOR XMVectorLessOrEqual( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(XMLaneMask(a.v[i] <= b.v[i])); }
+	inline XMVECTOR XMVectorAndInt( FXMVECTOR a, FXMVECTOR b ) { XM_PER_LANE(XMLaneFromBits(XMLaneBits(a.v[i]) & XMLaneBits(b.v[i]))); }
+
+	// Takes each bit from b where the control bit is set, and from a where it isn't
+	inline XMVECTOR XMVectorSelect( FXMVECTOR a, FXMVECTOR b, FXMVECTOR control )
+	{
+		XM_PER_LANE(XMLaneFromBits((XMLaneBits(a.v[i]) & ~XMLaneBits(control.v[i])) | (XMLaneBits(b.v[i]) & XMLaneBits(control.v[i]))));
+	}
+
+#undef XM_PER_LANE
+
+	// The record says whether every lane's bits were equal, or none were
+	const uint32_t XM_CRMASK_CR6TRUE = 0x00000080;
+	const uint32_t XM_CRMASK_CR6FALSE = 0x00000020;
+
+	inline XMVECTOR XMVectorEqualIntR( uint32_t* pCR, FXMVECTOR a, FXMVECTOR b )
+	{
+		XMVECTOR R;
+		int Equal = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			bool Same = XMLaneBits(a.v[i]) == XMLaneBits(b.v[i]);
+			R.v[i] = XMLaneMask(Same);
+			Equal += Same;
+		}
+		*pCR = Equal == 4 ? XM_CRMASK_CR6TRUE : (Equal == 0 ? XM_CRMASK_CR6FALSE : 0);
+		return R;
+	}
+
+	inline bool XMComparisonAllTrue( uint32_t CR ) { return (CR & XM_CRMASK_CR6TRUE) == XM_CRMASK_CR6TRUE; }
+
+	// The 3D products give the result in every lane
+	inline XMVECTOR XMVector3Dot( FXMVECTOR a, FXMVECTOR b )
+	{
+		return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]);
+	}
+
+	inline XMVECTOR XMVector3LengthSq( FXMVECTOR v ) { return XMVector3Dot(v, v); }
+	inline XMVECTOR XMVector3Length( FXMVECTOR v ) { return XMVectorReplicate(sqrtf(XMVectorGetX(XMVector3LengthSq(v)))); }
+
+	// A zero vector stays zero
+	inline XMVECTOR XMVector3Normalize( FXMVECTOR v )
+	{
+		float Length = XMVectorGetX(XMVector3Length(v));
+		return Length > 0.0f ? XMVectorScale(v, 1.0f / Length) : v;
+	}
+
+	// Row vectors times the matrix, as DirectXMath does
+	inline XMVECTOR XMVector4Transform( FXMVECTOR v, FXMMATRIX m )
+	{
+		XMVECTOR R;
+		for (int i = 0; i < 4; ++i)
+			R.v[i] = v.v[0] * m.r[0].v[i] + v.v[1] * m.r[1].v[i] + v.v[2] * m.r[2].v[i] + v.v[3] * m.r[3].v[i];
+		return R;
+	}
+
+	inline XMVECTOR XMVector3Transform( FXMVECTOR v, FXMMATRIX m )
+	{
+		return XMVector4Transform(XMVectorSet(v.v[0], v.v[1], v.v[2], 1.0f), m);
+	}
+}
@@ -0,0 +1,15 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Stand-in for the engine's precompiled header, which pulls in D3D12. Code built for the tests includes
+// what it needs itself, apart from assert, which the root modules take from the real one.
+//
+
+#pragma once
+
+#include <assert.h>
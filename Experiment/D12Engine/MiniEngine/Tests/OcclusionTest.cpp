@@ -0,0 +1,144 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Rasterizes a wall and a floor into Dav::OcclusionBuffer, compares every pixel with a ray cast against the
+// same two quads, and checks which boxes around the wall IsVisible lets through.
+//
+
+#include "Dav/occlusion/occlusion.h"
+#include "TestCommon.h"
+#include <stdio.h>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+using namespace Dav;
+
+static const int kWidth = 320;
+static const int kHeight = 192;
+static const float kNear = 0.1f;
+static const float kFocal = 1.0f / tanf(0.5f);
+static const float kAspect = (float)kWidth / kHeight;
+
+// The wall is 6x6 and 10 units in front of the camera, and the floor is 4 below it and passes under the camera
+static const float kWallHalfSize = 3.0f;
+static const float kWallDistance = 10.0f;
+static const float kFloorHeight = -4.0f;
+static const float kFloorHalfWidth = 50.0f;
+static const float kFloorFar = 100.0f;
+
+// A right handed perspective projection with the camera at the origin looking down -z, so w is -z
+static XMMATRIX MakeViewProjection( void )
+{
+	XMMATRIX M;
+	M.r[0] = XMVectorSet(kFocal / kAspect, 0.0f, 0.0f, 0.0f);
+	M.r[1] = XMVectorSet(0.0f, kFocal, 0.0f, 0.0f);
+	M.r[2] = XMVectorSet(0.0f, 0.0f, 0.0f, -1.0f);
+	M.r[3] = XMVectorSet(0.0f, 0.0f, kNear, 0.0f);
+	return M;
+}
+
+// 1/w of the nearest occluder through the pixel's center, or 0 when it misses both
+static float CastRay( int x, int y )
+{
+	float DirX = ((x + 0.5f) / kWidth * 2.0f - 1.0f) * kAspect / kFocal;
+	float DirY = (1.0f - (y + 0.5f) / kHeight * 2.0f) / kFocal;
+
+	float Nearest = 0.0f;
+	if (fabsf(DirX * kWallDistance) <= kWallHalfSize && fabsf(DirY * kWallDistance) <= kWallHalfSize)
+		Nearest = 1.0f / kWallDistance;
+
+	if (DirY < 0.0f)
+	{
+		float FloorDistance = kFloorHeight / DirY;
+		if (FloorDistance <= kFloorFar && fabsf(DirX * FloorDistance) <= kFloorHalfWidth)
+			Nearest = fmaxf(Nearest, 1.0f / FloorDistance);
+	}
+	return Nearest;
+}
+
+int main()
+{
+	const XMMATRIX ViewProj = MakeViewProjection();
+	OcclusionBuffer Buffer(kWidth, kHeight);
+
+	const XMFLOAT3 Wall[] =
+	{
+		XMFLOAT3(-kWallHalfSize, -kWallHalfSize, -kWallDistance), XMFLOAT3(kWallHalfSize, -kWallHalfSize, -kWallDistance),
+		XMFLOAT3(kWallHalfSize, kWallHalfSize, -kWallDistance), XMFLOAT3(-kWallHalfSize, kWallHalfSize, -kWallDistance),
+	};
+	const uint32_t WallIndices[] = { 0, 1, 2, 0, 2, 3 };
+
+	// Starts behind the camera, so it's clipped against the near plane
+	const XMFLOAT3 Floor[] =
+	{
+		XMFLOAT3(-kFloorHalfWidth, kFloorHeight, 5.0f), XMFLOAT3(kFloorHalfWidth, kFloorHeight, 5.0f),
+		XMFLOAT3(kFloorHalfWidth, kFloorHeight, -kFloorFar), XMFLOAT3(-kFloorHalfWidth, kFloorHeight, -kFloorFar),
+	};
+	const uint32_t FloorIndices[] = { 0, 2, 1, 0, 3, 2 };
+
+	// Nothing drawn yet hides nothing
+	Buffer.begin(kNear);
+	Buffer.rasterize();
+	CHECK(Buffer.isVisible(ViewProj, XMFLOAT3(-1.0f, -1.0f, -20.0f), XMFLOAT3(1.0f, 1.0f, -18.0f)));
+
+	Buffer.begin(kNear);
+	Buffer.addOccluder(ViewProj, Wall, 4, WallIndices, 6);
+	Buffer.addOccluder(ViewProj, Floor, 4, FloorIndices, 6);
+
+	// Tiles on different threads, as the engine does them
+	std::vector<std::thread> Threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		Threads.emplace_back([&Buffer, t]
+		{
+			for (int Tile = t; Tile < Buffer.tileCount(); Tile += 4)
+				Buffer.rasterizeTile(Tile);
+		});
+	}
+	for (std::thread& T : Threads)
+		T.join();
+
+	int Mismatches = 0;
+	const float* Depth = Buffer.depth();
+	for (int y = 0; y < kHeight; ++y)
+	{
+		for (int x = 0; x < kWidth; ++x)
+		{
+			float Expected = CastRay(x, y);
+			float Actual = Depth[y * kWidth + x];
+			if (fabsf(Expected - Actual) > 1e-3f * (Expected + 1e-3f) + 1e-5f)
+			{
+				if (Mismatches++ < 5)
+					printf("pixel %d, %d has depth %g instead of %g\n", x, y, Actual, Expected);
+			}
+		}
+	}
+	CHECK(Mismatches == 0);
+
+	// Behind the wall, and below the floor
+	CHECK(!Buffer.isVisible(ViewProj, XMFLOAT3(-1.0f, -1.0f, -20.0f), XMFLOAT3(1.0f, 1.0f, -18.0f)));
+	CHECK(!Buffer.isVisible(ViewProj, XMFLOAT3(-1.0f, -8.0f, -30.0f), XMFLOAT3(1.0f, -6.0f, -28.0f)));
+
+	// In front of the wall, and beside it
+	CHECK(Buffer.isVisible(ViewProj, XMFLOAT3(-1.0f, -1.0f, -8.0f), XMFLOAT3(1.0f, 1.0f, -6.0f)));
+	CHECK(Buffer.isVisible(ViewProj, XMFLOAT3(5.0f, 0.0f, -20.0f), XMFLOAT3(6.0f, 1.0f, -18.0f)));
+
+	// Straddling the wall's edge, and straddling the wall itself
+	CHECK(Buffer.isVisible(ViewProj, XMFLOAT3(2.0f, -1.0f, -20.0f), XMFLOAT3(8.0f, 1.0f, -18.0f)));
+	CHECK(Buffer.isVisible(ViewProj, XMFLOAT3(-1.0f, -1.0f, -12.0f), XMFLOAT3(1.0f, 1.0f, -8.0f)));
+
+	// Crossing the near plane
+	CHECK(Buffer.isVisible(ViewProj, XMFLOAT3(-1.0f, -1.0f, -0.05f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+
+	// Off to the side of the view altogether
+	CHECK(!Buffer.isVisible(ViewProj, XMFLOAT3(40.0f, -1.0f, -20.0f), XMFLOAT3(41.0f, 1.0f, -18.0f)));
+
+	return TestResult("OcclusionTest");
+}
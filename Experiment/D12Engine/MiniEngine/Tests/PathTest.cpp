@@ -0,0 +1,173 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Samples Misc::Path along its length and checks the points and directions against the polyline, then checks
+// closestDistanceAlong, with and without a cursor following a moving point, against testing every segment.
+//
+
+#include "Misc/Path/miscPath.h"
+#include "TestCommon.h"
+#include <float.h>
+#include <math.h>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+using namespace Misc;
+
+static bool Near( float a, float b, float tolerance = 1e-3f )
+{
+	return fabsf(a - b) <= tolerance * (1.0f + fabsf(b));
+}
+
+static bool Near( FXMVECTOR v, float x, float y, float z )
+{
+	return Near(XMVectorGetX(v), x) && Near(v.v[1], y) && Near(v.v[2], z);
+}
+
+// The distance along the path to the closest point, by testing every segment
+static float ClosestByBruteForce( const std::vector<XMFLOAT3>& points, const XMFLOAT3& position, float& closestDistanceSquared )
+{
+	float Along = 0.0f;
+	float Best = 0.0f;
+	closestDistanceSquared = FLT_MAX;
+	for (size_t i = 0; i + 1 < points.size(); ++i)
+	{
+		const XMFLOAT3& A = points[i];
+		const XMFLOAT3& B = points[i + 1];
+		float Dx = B.x - A.x, Dy = B.y - A.y, Dz = B.z - A.z;
+		float Px = position.x - A.x, Py = position.y - A.y, Pz = position.z - A.z;
+		float LengthSquared = Dx * Dx + Dy * Dy + Dz * Dz;
+		float T = LengthSquared > 1e-6f ? (Px * Dx + Py * Dy + Pz * Dz) / LengthSquared : 0.0f;
+		T = T < 0.0f ? 0.0f : (T > 1.0f ? 1.0f : T);
+		float Ex = Px - T * Dx, Ey = Py - T * Dy, Ez = Pz - T * Dz;
+		float DistanceSquared = Ex * Ex + Ey * Ey + Ez * Ez;
+		if (DistanceSquared < closestDistanceSquared)
+		{
+			closestDistanceSquared = DistanceSquared;
+			Best = Along + T * sqrtf(LengthSquared);
+		}
+		Along += sqrtf(LengthSquared);
+	}
+	return Best;
+}
+
+// An L of a 3 long segment along x, a repeated point, and a 4 long segment along z
+static void TestSampling( void )
+{
+	const XMFLOAT3 Points[] =
+	{
+		XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(3.0f, 1.0f, 0.0f), XMFLOAT3(3.0f, 1.0f, 0.0f), XMFLOAT3(3.0f, 1.0f, 4.0f),
+	};
+	Path L(Points, 4);
+	CHECK(L.pointCount() == 4 && L.segmentCount() == 3);
+	CHECK(Near(L.length(), 7.0f));
+
+	CHECK(Near(L.positionAt(0.0f), 0.0f, 1.0f, 0.0f));
+	CHECK(Near(L.positionAt(1.5f), 1.5f, 1.0f, 0.0f));
+	CHECK(Near(L.positionAt(3.0f), 3.0f, 1.0f, 0.0f));
+	CHECK(Near(L.positionAt(5.0f), 3.0f, 1.0f, 2.0f));
+	CHECK(Near(L.positionAt(7.0f), 3.0f, 1.0f, 4.0f));
+
+	// Clamped to the ends
+	CHECK(Near(L.positionAt(-2.0f), 0.0f, 1.0f, 0.0f));
+	CHECK(Near(L.positionAt(100.0f), 3.0f, 1.0f, 4.0f));
+
+	CHECK(Near(L.directionAt(1.0f), 1.0f, 0.0f, 0.0f));
+	CHECK(Near(L.directionAt(6.0f), 0.0f, 0.0f, 1.0f));
+	CHECK(Near(L.directionAt(-1.0f), 1.0f, 0.0f, 0.0f));
+	CHECK(Near(L.directionAt(8.0f), 0.0f, 0.0f, 1.0f));
+
+	// A cursor walking forwards, backwards and jumping gives the same samples as none
+	PathCursor Cursor;
+	const float Distances[] = { 0.0f, 0.5f, 2.9f, 3.0f, 3.1f, 6.5f, 7.0f, 4.0f, 0.2f, 6.9f, -1.0f, 9.0f, 1.0f };
+	for (float Distance : Distances)
+	{
+		XMVECTOR WithCursor = L.positionAt(Distance, Cursor);
+		XMVECTOR Without = L.positionAt(Distance);
+		CHECK(Near(WithCursor, XMVectorGetX(Without), Without.v[1], Without.v[2]));
+		CHECK(Cursor.m_segment < L.segmentCount());
+
+		XMVECTOR Direction = L.directionAt(Distance, Cursor);
+		CHECK(Near(XMVectorGetX(XMVector3Length(Direction)), 1.0f));
+	}
+
+	// Small steps along a long curve, where the cursor's segment is nearly always the right one
+	std::vector<XMFLOAT3> Spiral;
+	for (int i = 0; i <= 500; ++i)
+		Spiral.push_back(XMFLOAT3(10.0f * cosf(i * 0.05f), i * 0.02f, 10.0f * sinf(i * 0.05f)));
+	Path Curve(Spiral.data(), Spiral.size());
+	Cursor.reset();
+	for (float Distance = 0.0f; Distance <= Curve.length(); Distance += 0.37f)
+	{
+		XMVECTOR WithCursor = Curve.positionAt(Distance, Cursor);
+		XMVECTOR Without = Curve.positionAt(Distance);
+		CHECK(Near(WithCursor, XMVectorGetX(Without), Without.v[1], Without.v[2]));
+	}
+}
+
+static void TestClosest( void )
+{
+	std::mt19937 Random(46);
+	std::uniform_real_distribution<float> Step(-1.0f, 1.0f);
+
+	// A random walk, long enough for a deep tree, that comes back near itself
+	std::vector<XMFLOAT3> Points(1, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	for (int i = 0; i < 2000; ++i)
+	{
+		const XMFLOAT3& Last = Points.back();
+		Points.push_back(XMFLOAT3(Last.x + Step(Random), Last.y + 0.1f * Step(Random), Last.z + Step(Random)));
+	}
+	Path Walk(Points.data(), Points.size());
+
+	std::uniform_real_distribution<float> Place(-30.0f, 30.0f);
+	for (int i = 0; i < 500; ++i)
+	{
+		XMFLOAT3 Position(Place(Random), Place(Random) * 0.1f, Place(Random));
+		float ExpectedDistanceSquared;
+		ClosestByBruteForce(Points, Position, ExpectedDistanceSquared);
+
+		// Ties between segments can pick either, so compare how far the found point is rather than where
+		float Along = Walk.closestDistanceAlong(XMLoadFloat3(&Position));
+		XMVECTOR Found = XMVectorSubtract(Walk.positionAt(Along), XMLoadFloat3(&Position));
+		CHECK(Near(XMVectorGetX(XMVector3LengthSq(Found)), ExpectedDistanceSquared));
+	}
+
+	// A follower moving along near the path, with the odd jump, gets the same answers through a cursor
+	PathCursor Cursor;
+	for (int i = 0; i < 3000; ++i)
+	{
+		float Target = (i % 500 == 499) ? Walk.length() * 0.5f : fmodf(i * 0.7f, Walk.length());
+		XMVECTOR OnPath = Walk.positionAt(Target);
+		XMFLOAT3 Position(XMVectorGetX(OnPath) + 0.3f * Step(Random), OnPath.v[1], OnPath.v[2] + 0.3f * Step(Random));
+
+		float WithCursor = Walk.closestDistanceAlong(XMLoadFloat3(&Position), Cursor);
+		float Without = Walk.closestDistanceAlong(XMLoadFloat3(&Position));
+		XMVECTOR A = XMVectorSubtract(Walk.positionAt(WithCursor), XMLoadFloat3(&Position));
+		XMVECTOR B = XMVectorSubtract(Walk.positionAt(Without), XMLoadFloat3(&Position));
+		CHECK(Near(XMVectorGetX(XMVector3LengthSq(A)), XMVectorGetX(XMVector3LengthSq(B))));
+		CHECK(Cursor.m_first <= Cursor.m_segment && Cursor.m_segment <= Cursor.m_last && Cursor.m_last < Walk.segmentCount());
+	}
+
+	// With every segment near the cursor there's nothing outside it, and a two point path has one segment
+	const XMFLOAT3 Line[] = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(10.0f, 0.0f, 0.0f) };
+	Path Short(Line, 2);
+	Cursor.reset();
+	CHECK(Near(Short.closestDistanceAlong(XMVectorSet(4.0f, 3.0f, 0.0f, 0.0f), Cursor), 4.0f));
+	CHECK(Cursor.m_clearance == FLT_MAX);
+	CHECK(Near(Short.closestDistanceAlong(XMVectorSet(-5.0f, 0.0f, 0.0f, 0.0f), Cursor), 0.0f));
+	CHECK(Near(Short.closestDistanceAlong(XMVectorSet(50.0f, 0.0f, 1.0f, 0.0f), Cursor), 10.0f));
+}
+
+int main()
+{
+	TestSampling();
+	TestClosest();
+
+	return TestResult("PathTest");
+}
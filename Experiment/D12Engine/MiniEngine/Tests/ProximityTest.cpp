@@ -0,0 +1,241 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Checks Misc::ProximityGrid's radius queries and sphere pairs against testing every agent, with queries that
+// span cells, sit on cell boundaries and lie outside the grid, and with agents removed between builds.
+//
+
+#include "Misc/Proximity/miscProximity.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+using namespace Misc;
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> PairList;
+
+static std::vector<uint32_t> QueryByBruteForce( const std::vector<XMFLOAT3>& positions, const XMFLOAT3& centre, float radius )
+{
+	std::vector<uint32_t> Results;
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		float Dx = positions[i].x - centre.x;
+		float Dz = positions[i].z - centre.z;
+		if (Dx * Dx + Dz * Dz <= radius * radius)
+			Results.push_back((uint32_t)i);
+	}
+	return Results;
+}
+
+static PairList PairsByBruteForce( const std::vector<XMFLOAT3>& positions, const std::vector<float>& radii )
+{
+	PairList Pairs;
+	for (uint32_t i = 0; i < positions.size(); ++i)
+	{
+		for (uint32_t j = i + 1; j < positions.size(); ++j)
+		{
+			float Dx = positions[i].x - positions[j].x;
+			float Dy = positions[i].y - positions[j].y;
+			float Dz = positions[i].z - positions[j].z;
+			float Touching = radii[i] + radii[j];
+			if (Dx * Dx + Dy * Dy + Dz * Dz <= Touching * Touching)
+				Pairs.push_back(std::make_pair(i, j));
+		}
+	}
+	return Pairs;
+}
+
+static std::vector<uint32_t> Query( const ProximityGrid& grid, const XMFLOAT3& centre, float radius )
+{
+	std::vector<uint32_t> Results;
+	grid.queryRadius(centre, radius, Results);
+	std::sort(Results.begin(), Results.end());
+	return Results;
+}
+
+// Each pair with the lower index first, in order, so any duplicate sits next to its twin
+static PairList Pairs( const ProximityGrid& grid )
+{
+	PairList Found;
+	grid.intersectingPairs(Found);
+	for (std::pair<uint32_t, uint32_t>& Pair : Found)
+	{
+		if (Pair.first > Pair.second)
+			std::swap(Pair.first, Pair.second);
+	}
+	std::sort(Found.begin(), Found.end());
+	return Found;
+}
+
+static void TestEmpty( void )
+{
+	ProximityGrid Grid;
+	Grid.build(nullptr, nullptr, 0, 1.0f);
+	CHECK(Grid.size() == 0);
+	CHECK(Query(Grid, XMFLOAT3(0.0f, 0.0f, 0.0f), 10.0f).empty());
+	CHECK(Pairs(Grid).empty());
+}
+
+// Agents on whole numbers with a cell size of 1, so they sit exactly on cell boundaries and the distances
+// between them are exact
+static void TestCellBoundaries( void )
+{
+	std::vector<XMFLOAT3> Lattice;
+	for (int z = 0; z <= 6; ++z)
+		for (int x = 0; x <= 6; ++x)
+			Lattice.push_back(XMFLOAT3((float)x, 0.0f, (float)z));
+
+	ProximityGrid Grid;
+	Grid.build(Lattice.data(), nullptr, Lattice.size(), 1.0f);
+	CHECK(Grid.size() == Lattice.size());
+
+	// A point on a corner of four cells reaches its four neighbours in the cells either side, and no further
+	const XMFLOAT3 Corner(3.0f, 5.0f, 3.0f);
+	std::vector<uint32_t> Neighbours = Query(Grid, Corner, 1.0f);
+	CHECK(Neighbours.size() == 5);
+	CHECK(Neighbours == QueryByBruteForce(Lattice, Corner, 1.0f));
+
+	// Radius 0 finds only agents exactly at the centre, and none between them
+	CHECK(Query(Grid, Corner, 0.0f) == std::vector<uint32_t>(1, 3 * 7 + 3));
+	CHECK(Query(Grid, XMFLOAT3(2.5f, 0.0f, 2.5f), 0.0f).empty());
+
+	// On the grid's far edges, where the last cells hold the agents on the maximum
+	CHECK(Query(Grid, XMFLOAT3(6.0f, 0.0f, 6.0f), 1.0f) == QueryByBruteForce(Lattice, XMFLOAT3(6.0f, 0.0f, 6.0f), 1.0f));
+	CHECK(Query(Grid, XMFLOAT3(6.0f, 0.0f, 0.0f), 2.0f) == QueryByBruteForce(Lattice, XMFLOAT3(6.0f, 0.0f, 0.0f), 2.0f));
+
+	// Centres outside the grid still reach the agents within range, and a radius spanning it finds them all
+	CHECK(Query(Grid, XMFLOAT3(-1.0f, 0.0f, 3.0f), 1.5f) == QueryByBruteForce(Lattice, XMFLOAT3(-1.0f, 0.0f, 3.0f), 1.5f));
+	CHECK(Query(Grid, XMFLOAT3(7.5f, 0.0f, 8.0f), 2.5f) == QueryByBruteForce(Lattice, XMFLOAT3(7.5f, 0.0f, 8.0f), 2.5f));
+	CHECK(Query(Grid, XMFLOAT3(-20.0f, 0.0f, -20.0f), 5.0f).empty());
+	CHECK(Query(Grid, XMFLOAT3(3.0f, 0.0f, 3.0f), 100.0f).size() == Lattice.size());
+
+	// Touching spheres of radius 0.5 pair each agent with the four around it
+	std::vector<float> Radii(Lattice.size(), 0.5f);
+	Grid.build(Lattice.data(), Radii.data(), Lattice.size(), 1.0f);
+	PairList Found = Pairs(Grid);
+	CHECK(Found.size() == 2 * 6 * 7);
+	CHECK(Found == PairsByBruteForce(Lattice, Radii));
+}
+
+static void TestRandom( void )
+{
+	std::mt19937 Random(47);
+	std::uniform_real_distribution<float> Place(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> Size(0.0f, 1.5f);
+
+	std::vector<XMFLOAT3> Positions;
+	std::vector<float> Radii;
+	for (int i = 0; i < 600; ++i)
+	{
+		Positions.push_back(XMFLOAT3(Place(Random), Place(Random) * 0.2f, Place(Random)));
+		Radii.push_back(Size(Random));
+	}
+	// One big agent, so pairs have to reach across several cells for it
+	Radii[17] = 6.0f;
+
+	// The tiny cell size makes too many cells, so build() has to grow them
+	const float CellSizes[] = { 0.01f, 0.5f, 2.0f, 7.0f, 100.0f };
+	for (float CellSize : CellSizes)
+	{
+		ProximityGrid Grid;
+		Grid.build(Positions.data(), Radii.data(), Positions.size(), CellSize);
+
+		std::vector<XMFLOAT3> Centres;
+		std::vector<float> QueryRadii;
+		for (int i = 0; i < 200; ++i)
+		{
+			// Out to half as far again as the agents, so some queries start outside the grid
+			Centres.push_back(XMFLOAT3(Place(Random) * 1.5f, 0.0f, Place(Random) * 1.5f));
+			QueryRadii.push_back(Size(Random) * 5.0f);
+			CHECK(Query(Grid, Centres.back(), QueryRadii.back()) == QueryByBruteForce(Positions, Centres.back(), QueryRadii.back()));
+		}
+
+		// The batched query gives the same agents, in the same order, between its offsets
+		std::vector<uint32_t> Offsets, Batched;
+		Grid.queryRadius(Centres.data(), QueryRadii.data(), Centres.size(), Offsets, Batched);
+		CHECK(Offsets.size() == Centres.size() + 1 && Offsets.back() == Batched.size());
+		for (size_t i = 0; i < Centres.size(); ++i)
+		{
+			std::vector<uint32_t> Single;
+			Grid.queryRadius(Centres[i], QueryRadii[i], Single);
+			CHECK(std::vector<uint32_t>(Batched.begin() + Offsets[i], Batched.begin() + Offsets[i + 1]) == Single);
+		}
+
+		PairList Found = Pairs(Grid);
+		CHECK(std::adjacent_find(Found.begin(), Found.end()) == Found.end());
+		CHECK(Found == PairsByBruteForce(Positions, Radii));
+	}
+}
+
+// The caller removes agents by building again without them, so nothing from the last build may survive,
+// including the padding past the end of the shorter arrays
+static void TestRemoval( void )
+{
+	std::mt19937 Random(4700);
+	std::uniform_real_distribution<float> Place(-10.0f, 10.0f);
+
+	std::vector<XMFLOAT3> Positions;
+	std::vector<float> Radii;
+	for (int i = 0; i < 100; ++i)
+	{
+		Positions.push_back(XMFLOAT3(Place(Random), 0.0f, Place(Random)));
+		Radii.push_back(0.8f);
+	}
+
+	ProximityGrid Grid;
+	Grid.build(Positions.data(), Radii.data(), Positions.size(), 2.0f);
+	CHECK(Grid.size() == 100);
+
+	// Drop every third agent, keeping the others in order, as a swarm compacts its arrays
+	std::vector<XMFLOAT3> Kept;
+	std::vector<float> KeptRadii;
+	std::vector<XMFLOAT3> Removed;
+	for (size_t i = 0; i < Positions.size(); ++i)
+	{
+		if (i % 3 == 0)
+		{
+			Removed.push_back(Positions[i]);
+		}
+		else
+		{
+			Kept.push_back(Positions[i]);
+			KeptRadii.push_back(Radii[i]);
+		}
+	}
+
+	Grid.build(Kept.data(), KeptRadii.data(), Kept.size(), 2.0f);
+	CHECK(Grid.size() == Kept.size());
+	for (const XMFLOAT3& Position : Removed)
+		CHECK(Query(Grid, Position, 3.0f) == QueryByBruteForce(Kept, Position, 3.0f));
+	for (uint32_t Index : Query(Grid, XMFLOAT3(0.0f, 0.0f, 0.0f), 100.0f))
+		CHECK(Index < Kept.size());
+	CHECK(Pairs(Grid) == PairsByBruteForce(Kept, KeptRadii));
+
+	// Down to fewer agents than a group of four, with stale entries from the bigger builds behind them
+	for (size_t Count = 3; Count-- > 0; )
+	{
+		Grid.build(Kept.data(), KeptRadii.data(), Count, 2.0f);
+		CHECK(Grid.size() == Count);
+		CHECK(Query(Grid, XMFLOAT3(0.0f, 0.0f, 0.0f), 100.0f).size() == Count);
+		CHECK(Query(Grid, Kept[0], 0.0f) == QueryByBruteForce(std::vector<XMFLOAT3>(Kept.begin(), Kept.begin() + Count), Kept[0], 0.0f));
+		CHECK(Pairs(Grid) == PairsByBruteForce(std::vector<XMFLOAT3>(Kept.begin(), Kept.begin() + Count), KeptRadii));
+	}
+}
+
+int main()
+{
+	TestEmpty();
+	TestCellBoundaries();
+	TestRandom();
+	TestRemoval();
+
+	return TestResult("ProximityTest");
+}
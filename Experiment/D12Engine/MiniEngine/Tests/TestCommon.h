@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// What every test and benchmark here shares: CHECK, which counts failures from any thread, the result at the
+// end of main, and a timer for benchmarks.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+static std::atomic<int> s_Failures(0);
+
+#define CHECK(x) do { if (!(x)) { printf("%s(%d): failed %s\n", __FILE__, __LINE__, #x); ++s_Failures; } } while (0)
+
+// Prints whether the test passed and gives main's exit code
+inline int TestResult( const char* name )
+{
+	if (s_Failures == 0)
+		printf("%s passed\n", name);
+	return s_Failures == 0 ? 0 : 1;
+}
+
+// Nanoseconds per call of fn, which returns something to keep the work from being optimized away. The calls
+// double until they take a tenth of a second, after one run to warm up.
+template <typename Fn>
+double NanosecondsPerCall( Fn fn )
+{
+	typedef std::chrono::steady_clock Clock;
+	static volatile uint64_t s_Sink;
+
+	s_Sink = s_Sink + fn();
+	for (uint64_t Calls = 1; ; Calls *= 2)
+	{
+		uint64_t Sum = 0;
+		Clock::time_point Start = Clock::now();
+		for (uint64_t i = 0; i < Calls; ++i)
+			Sum += fn();
+		double Elapsed = std::chrono::duration<double, std::nano>(Clock::now() - Start).count();
+		s_Sink = s_Sink + Sum;
+
+		if (Elapsed >= 1e8)
+			return Elapsed / Calls;
+	}
+}
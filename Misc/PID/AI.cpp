@@ -4,6 +4,7 @@
 #include "Game/AI/AI.h"
 #include "Modules/Maths/AdditionalMaths.h"
 #include <limits.h>
+#include <atomic>
 
 
 
@@ -161,15 +162,87 @@ float	SafeACos( float fCosine )
 	return maACos( fCosine );
 }
 
+//-----------------------------------------------------------------------
+// xoshiro128** state, one stream per thread. Each thread reseeds its
+// stream when SeedUnitRandom has been called since it last drew, and
+// seeds from the time while SeedUnitRandom never has been.
+//-----------------------------------------------------------------------
+static unsigned int const UNIT_RANDOM_MIX_STEP = 0x9E3779B9;
+
+static std::atomic< unsigned int > s_unitRandomSeed( 0 );
+static std::atomic< unsigned int > s_unitRandomGeneration( 0 );
+static std::atomic< unsigned int > s_unitRandomNextStream( 0 );
+
+struct UnitRandomThreadStateStruct
+{
+	unsigned int state[ 4 ];
+	unsigned int stream;
+	unsigned int generation;
+
+	UnitRandomThreadStateStruct( )
+		: stream( s_unitRandomNextStream++ )
+		, generation( ~0u )
+	{
+	}
+};
+
+static thread_local UnitRandomThreadStateStruct s_unitRandomThreadState;
+
+static unsigned int unitRandomMix( unsigned int & state )
+{
+	state += UNIT_RANDOM_MIX_STEP;
+	unsigned int z = state;
+	z = ( z ^ ( z >> 16 ) ) * 0x85EBCA6B;
+	z = ( z ^ ( z >> 13 ) ) * 0xC2B2AE35;
+	return z ^ ( z >> 16 );
+}
+
+static unsigned int unitRandomRotate( unsigned int const value, int const bits )
+{
+	return ( value << bits ) | ( value >> ( 32 - bits ) );
+}
+
+//-----------------------------------------------------------------------
+// seeds GetUnitRandom on every thread, for repeatable runs. Each thread
+// takes its own stream of the seed the next time it draws.
+//-----------------------------------------------------------------------
+void SeedUnitRandom( unsigned int seed )
+{
+	s_unitRandomSeed.store( seed, std::memory_order_relaxed );
+	s_unitRandomGeneration.fetch_add( 1, std::memory_order_release );
+}
+
 //-----------------------------------------------------------------------
 // returns a random number between 0.0f and 1.0f
 //-----------------------------------------------------------------------
 float GetUnitRandom()					
 {
-	unsigned int const   iRandom = ( unsigned int )OSGetTime( );
-	static float fInvMax = ( 1.0f / ( float )UCHAR_MAX );
-	float const  fRandom = ( ( float )( iRandom % UCHAR_MAX ) ) * fInvMax; // 0 <-> 1
-	return fRandom;
+	UnitRandomThreadStateStruct & threadState = s_unitRandomThreadState;
+
+	unsigned int const generation = s_unitRandomGeneration.load( std::memory_order_acquire );
+	if( threadState.generation != generation )
+	{
+		unsigned int seed = ( generation == 0 ) ? ( unsigned int )OSGetTime( ) : s_unitRandomSeed.load( std::memory_order_relaxed );
+		unsigned int stream = threadState.stream;
+		seed ^= unitRandomMix( stream );
+		for( int i = 0; i < 4; ++i )
+		{
+			threadState.state[ i ] = unitRandomMix( seed );
+		}
+		threadState.generation = generation;
+	}
+
+	unsigned int * const state = threadState.state;
+	unsigned int const result = unitRandomRotate( state[ 1 ] * 5, 7 ) * 9;
+	unsigned int const shifted = state[ 1 ] << 9;
+	state[ 2 ] ^= state[ 0 ];
+	state[ 3 ] ^= state[ 1 ];
+	state[ 1 ] ^= state[ 2 ];
+	state[ 0 ] ^= state[ 3 ];
+	state[ 2 ] ^= shifted;
+	state[ 3 ] = unitRandomRotate( state[ 3 ], 11 );
+
+	return ( float )( result >> 8 ) * ( 1.0f / 16777216.0f ); // 0 <-> 1, 1 excluded
 }
 
 //-----------------------------------------------------------------------
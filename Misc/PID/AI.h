@@ -39,6 +39,7 @@ MAv2 directionUnit(
 bool	PlayerHitVictim( MAv4* pPreColInfo );
 float	SafeACos( float fCosine );
 float 	GetUnitRandom();
+void	SeedUnitRandom( unsigned int seed );
 float	XZSeparation( MAv4 const & vPosA, MAv4 const & vPosB );
 float	XZSeparationSq( MAv4 const & vPosA, MAv4 const & vPosB );
 bool	SpheresIntersect(MAv4 const& vPos0, float fRad0, MAv4 const& vPos1, float fRad1 );
@@ -407,149 +407,250 @@ void GameVehicleHighDetailClass::step(
 	bool const donateGroundPlane,
 	bool const stunned )
 {
-	RI_ASSERT( m_iVehiclePtr != 0 );
-
-	CAutoPtr< IVehicleHandling > const handlingPtr = m_iVehiclePtr->GetHandling( );
-	RI_ASSERT( handlingPtr != 0 );
-
-	m_manipulateDeltaTime += deltaTime;
-	m_physicsAssistDeltaTime += deltaTime;
-					
-	MAm4 const cpWhere = m_iVehiclePtr->GetMatrix( );
-	MAm4 transformation = cpWhere;
-	transformation[ 3 ] -= ( transformation[ 1 ] * restHeight );
+	GameVehicleHighDetailStepStruct step;
+	step.gameVehiclePtr = &gameVehicle;
+	step.pathPtr = &path;
+	step.offsetFromPath = offsetFromPath;
+	step.targetSpeed = targetSpeed;
+	step.basicManipulation = basicManipulation;
+	step.applyPhysicsAssists = applyPhysicsAssists;
+	step.horn = horn;
+	step.applyManualOverride = applyManualOverride;
+	step.manualOverridePtr = &manualOverride;
+	step.applyPathAlign = applyPathAlign;
+	step.useLowSpeedForwardProjection = useLowSpeedForwardProjection;
+	step.restHeight = restHeight;
+	step.vehicleLength = vehicleLength;
+	step.donateGroundPlane = donateGroundPlane;
+	step.stunned = stunned;
+
+	GameVehicleHighDetailClass * const vehicle = this;
+	stepFleet( &vehicle, &step, 0, 1, deltaTime );
+}
 
-	if( m_manipulatedPreviousStep )
+void GameVehicleHighDetailClass::stepFleet(
+	GameVehicleHighDetailClass * const * const vehicles,
+	GameVehicleHighDetailStepStruct const * const steps,
+	unsigned int const first,
+	unsigned int const count,
+	float const deltaTime )
+{
+	unsigned int const end = first + count;
+	for( unsigned int batchFirst = first; batchFirst < end; batchFirst += GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE )
 	{
-		if( applyPhysicsAssists && !applyManualOverride && /*!applyPathAlign &&*/ !stunned && !dead( ) )
+		unsigned int const batchCount = ( ( end - batchFirst ) < GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE ) ? ( end - batchFirst ) : GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE;
+
+		// Gather. Each vehicle's matrix is read from IVehicle once.
+		MAm4 cpWhere[ GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE ];
+		MAv4 position[ GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE ];
+		bool assist[ GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE ];
+		for( unsigned int i = 0; i != batchCount; ++i )
 		{
-			m_distanceAlongPath = path.closestDistanceAlong( transformation[ 3 ] ); // IF I'M GOING TO DO THIS OPTIMISE ME.
-
-			physicsAssist( 
-				gameVehicle,
-				m_physicsAssistDeltaTime, 
-				m_iVehiclePtr,
-				path,
-				offsetFromPath,	
-				m_distanceAlongPath,
-				targetSpeed );
+			GameVehicleHighDetailClass & vehicle = *vehicles[ batchFirst + i ];
+			GameVehicleHighDetailStepStruct const & step = steps[ batchFirst + i ];
+			RI_ASSERT( vehicle.m_iVehiclePtr != 0 );
+
+			vehicle.m_manipulateDeltaTime += deltaTime;
+			vehicle.m_physicsAssistDeltaTime += deltaTime;
+
+			cpWhere[ i ] = vehicle.m_iVehiclePtr->GetMatrix( );
+			position[ i ] = cpWhere[ i ][ 3 ] - ( cpWhere[ i ][ 1 ] * step.restHeight );
+			assist[ i ] = vehicle.m_manipulatedPreviousStep && step.applyPhysicsAssists && !step.applyManualOverride && /*!step.applyPathAlign &&*/ !step.stunned && !vehicle.dead( );
 		}
 
-		m_physicsAssistDeltaTime = 0.0f;
-		m_manipulatedPreviousStep = false;
-	}
+		// Path projection for assist. Manipulation wants the distance along the path from the same position, so it
+		// reuses this one.
+		for( unsigned int i = 0; i != batchCount; ++i )
+		{
+			if( assist[ i ] )
+			{
+				GameVehicleHighDetailClass & vehicle = *vehicles[ batchFirst + i ];
+				vehicle.m_distanceAlongPath = steps[ batchFirst + i ].pathPtr->closestDistanceAlong( position[ i ] );
+			}
+		}
 
-	////needs fresh controls (only) if the handling will update in the next frame (best practice for manipulation packets)
-	////if( ( rTimeSinceLastUpdate + GAME_STEPTIME ) > HANDLING_UPDATE_TIME )
-	////...or only immediately after a handling update (best practice for impulses)
-	////ok, somewhat better but still drifting a bit
-	if( willManipulateNextStep( ) )
-	{	
-		m_iVehiclePtr->UseAIOverrideHandling( IAIHandlingOverride::eTypeDefault );		
+		// Physics assist, for the vehicles that were manipulated last step
+		for( unsigned int i = 0; i != batchCount; ++i )
+		{
+			GameVehicleHighDetailClass & vehicle = *vehicles[ batchFirst + i ];
+			GameVehicleHighDetailStepStruct const & step = steps[ batchFirst + i ];
 
-		m_distanceAlongPath = path.closestDistanceAlong( transformation[ 3 ] ); // IF I'M GOING TO DO THIS OPTIMISE ME.
-	
-		SVehicleManipulationPacket vehicleManipulationPacket;			
+			if( assist[ i ] )
+			{
+				vehicle.physicsAssist( 
+					*step.gameVehiclePtr,
+					vehicle.m_physicsAssistDeltaTime, 
+					vehicle.m_iVehiclePtr,
+					*step.pathPtr,
+					step.offsetFromPath,	
+					vehicle.m_distanceAlongPath,
+					step.targetSpeed );
+			}
 
-		if( basicManipulation )
-		{	
-			basicManipulate(
-				m_manipulateDeltaTime, 
-				path, 
-				offsetFromPath,
-				targetSpeed, 
-				applyManualOverride,
-				manualOverride,
-				vehicleLength,
-				restHeight,
-				vehicleManipulationPacket );
-		}
-		else
-		{	
-			manipulate(
-				m_manipulateDeltaTime, 
-				path, 
-				offsetFromPath,
-				targetSpeed, 
-				applyManualOverride,
-				manualOverride,
-				applyPathAlign,
-				useLowSpeedForwardProjection,
-				restHeight,
-				vehicleLength,
-				vehicleManipulationPacket );
+			if( vehicle.m_manipulatedPreviousStep )
+			{
+				vehicle.m_physicsAssistDeltaTime = 0.0f;
+				vehicle.m_manipulatedPreviousStep = false;
+			}
 		}
-		
-		if( donateGroundPlane )
+
+		// Manipulation. Handling timing is read after physics assist, as step( ) always has.
+		bool manipulateNow[ GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE ];
+		SVehicleManipulationPacket packets[ GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE ];
+		for( unsigned int i = 0; i != batchCount; ++i )
 		{
-			MAm4 const pathTransformation = path.transformation( m_distanceAlongPath );	
-			
-			MAv4 wheelSurfacePositions[ g_nMaxWheels ];
-			MAv4 wheelNormals[ g_nMaxWheels ];
-			int32 wheelSurfaces[ g_nMaxWheels ];
-			for( unsigned int wheelIndex = 0; wheelIndex != g_nMaxWheels; ++wheelIndex )
+			GameVehicleHighDetailClass & vehicle = *vehicles[ batchFirst + i ];
+			GameVehicleHighDetailStepStruct const & step = steps[ batchFirst + i ];
+
+			////needs fresh controls (only) if the handling will update in the next frame (best practice for manipulation packets)
+			////if( ( rTimeSinceLastUpdate + GAME_STEPTIME ) > HANDLING_UPDATE_TIME )
+			////...or only immediately after a handling update (best practice for impulses)
+			////ok, somewhat better but still drifting a bit
+			manipulateNow[ i ] = vehicle.willManipulateNextStep( );
+			if( manipulateNow[ i ] )
 			{
-				wheelSurfacePositions[ wheelIndex ] = MAv4::construct( 0.0f, 0.0f, 0.0f, 1.0f );
-
-				RI_ASSERT( m_iVehiclePtr->GetSpecification( ) != 0 );
-				if( m_iVehiclePtr->GetSpecification( )->IsWheelPresent( (eWheelIndex)wheelIndex ) )
+				if( !assist[ i ] )
 				{
-					MAv4 const wheelRaycastPosCarSpace = m_iVehiclePtr->GetWheelContactPosition( ( eWheelIndex )wheelIndex );
-					MAv4 const wheelRaycastPosWorldSpace = cpWhere * wheelRaycastPosCarSpace;
-
-					MAv4 const carY = -cpWhere[ 1 ];
-					MAv4 const tpoint = wheelRaycastPosWorldSpace;
+					vehicle.m_distanceAlongPath = step.pathPtr->closestDistanceAlong( position[ i ] );
+				}
 
-					float const d = pathTransformation[ 1 ].dot( carY );
+				vehicle.manipulateStep( step, cpWhere[ i ], packets[ i ] );
+			}
+		}
 
-					float t = 100.0f;
-					if( maAbs( d ) > ZERO )
-					{
-						t = ( pathTransformation[ 1 ].dot( pathTransformation[ 3 ] - tpoint ) ) / d;
-					}
+		// Finish the packets together, then send them
+		for( unsigned int i = 0; i != batchCount; ++i )
+		{
+			GameVehicleHighDetailClass & vehicle = *vehicles[ batchFirst + i ];
+			GameVehicleHighDetailStepStruct const & step = steps[ batchFirst + i ];
+			SVehicleManipulationPacket & vehicleManipulationPacket = packets[ i ];
 
-					wheelSurfacePositions[ wheelIndex ] = tpoint + ( t * carY );
-				}
+			if( !manipulateNow[ i ] )
+			{
+				continue;
+			}
 
-				wheelNormals[ wheelIndex ] = pathTransformation[ 1 ];
-				wheelSurfaces[ wheelIndex ] = 0;
+			if( step.stunned )
+			{
+				vehicleManipulationPacket.fThrust = vehicle.m_stunnedThrust;		
+				vehicleManipulationPacket.fSteerValue = vehicle.m_stunnedSteer;		
+				vehicleManipulationPacket.bHandbrake = true;
+			}
+			else
+			{
+				vehicle.m_stunnedThrust = ( ( vehicleManipulationPacket.fThrust > 0.0f ) ? 0.2f : -0.2f );
+				vehicle.m_stunnedSteer = ( ( vehicleManipulationPacket.fSteerValue > 0.0f ) ? 1.0f : -1.0f );
 			}
 
-			m_iVehiclePtr->GetHandling( )->DonateWheelSuspensionCompressions( wheelSurfacePositions, wheelNormals, wheelSurfaces );
-		}
+			vehicleManipulationPacket.fHornVolume = ( step.horn ? 1.0f : 0.0f );
 
-		if( stunned )
-		{
-			vehicleManipulationPacket.fThrust = m_stunnedThrust;		
-			vehicleManipulationPacket.fSteerValue = m_stunnedSteer;		
-			vehicleManipulationPacket.bHandbrake = true;
+			if( vehicle.dead( ) )
+			{
+				vehicleManipulationPacket.fThrust = 0.0f;		
+				vehicleManipulationPacket.fSteerValue = 0.0f;
+				vehicleManipulationPacket.bHandbrake = true;
+				vehicleManipulationPacket.fHornVolume = 0.0f;
+			}
 		}
-		else
+
+		for( unsigned int i = 0; i != batchCount; ++i )
 		{
-			m_stunnedThrust = ( ( vehicleManipulationPacket.fThrust > 0.0f ) ? 0.2f : -0.2f );
-			m_stunnedSteer = ( ( vehicleManipulationPacket.fSteerValue > 0.0f ) ? 1.0f : -1.0f );
+			GameVehicleHighDetailClass & vehicle = *vehicles[ batchFirst + i ];
+
+			if( manipulateNow[ i ] )
+			{
+				vehicle.m_iVehiclePtr->SendManipulationPacket( packets[ i ] );
+
+				#if defined( GAME_VEHICLE_HIGH_DETAIL_SHOW_VEHICLE_MANIPULATION )
+				vehicle.m_PrevManipulationPacket = packets[ i ];
+				#endif		
+
+				vehicle.m_manipulateDeltaTime = 0.0f;
+				vehicle.m_manipulatedPreviousStep = true;
+			}
+
+			vehicle.debugDraw( steps[ batchFirst + i ].restHeight );
 		}
+	}
+}
 
-		vehicleManipulationPacket.fHornVolume = ( horn ? 1.0f : 0.0f );
+void GameVehicleHighDetailClass::manipulateStep(
+	GameVehicleHighDetailStepStruct const & step,
+	MAm4 const & cpWhere,
+	SVehicleManipulationPacket & vehicleManipulationPacket )
+{
+	m_iVehiclePtr->UseAIOverrideHandling( IAIHandlingOverride::eTypeDefault );		
 
-		if( dead( ) )
+	if( step.basicManipulation )
+	{	
+		basicManipulate(
+			m_manipulateDeltaTime, 
+			*step.pathPtr, 
+			step.offsetFromPath,
+			step.targetSpeed, 
+			step.applyManualOverride,
+			*step.manualOverridePtr,
+			step.vehicleLength,
+			step.restHeight,
+			vehicleManipulationPacket );
+	}
+	else
+	{	
+		manipulate(
+			m_manipulateDeltaTime, 
+			*step.pathPtr, 
+			step.offsetFromPath,
+			step.targetSpeed, 
+			step.applyManualOverride,
+			*step.manualOverridePtr,
+			step.applyPathAlign,
+			step.useLowSpeedForwardProjection,
+			step.restHeight,
+			step.vehicleLength,
+			vehicleManipulationPacket );
+	}
+	
+	if( step.donateGroundPlane )
+	{
+		MAm4 const pathTransformation = step.pathPtr->transformation( m_distanceAlongPath );	
+		
+		MAv4 wheelSurfacePositions[ g_nMaxWheels ];
+		MAv4 wheelNormals[ g_nMaxWheels ];
+		int32 wheelSurfaces[ g_nMaxWheels ];
+		for( unsigned int wheelIndex = 0; wheelIndex != g_nMaxWheels; ++wheelIndex )
 		{
-			vehicleManipulationPacket.fThrust = 0.0f;		
-			vehicleManipulationPacket.fSteerValue = 0.0f;
-			vehicleManipulationPacket.bHandbrake = true;
-			vehicleManipulationPacket.fHornVolume = 0.0f;
-		}
+			wheelSurfacePositions[ wheelIndex ] = MAv4::construct( 0.0f, 0.0f, 0.0f, 1.0f );
 
-		m_iVehiclePtr->SendManipulationPacket( vehicleManipulationPacket );
-			
-		#if defined( GAME_VEHICLE_HIGH_DETAIL_SHOW_VEHICLE_MANIPULATION )
-		m_PrevManipulationPacket = vehicleManipulationPacket;
-		#endif		
+			RI_ASSERT( m_iVehiclePtr->GetSpecification( ) != 0 );
+			if( m_iVehiclePtr->GetSpecification( )->IsWheelPresent( (eWheelIndex)wheelIndex ) )
+			{
+				MAv4 const wheelRaycastPosCarSpace = m_iVehiclePtr->GetWheelContactPosition( ( eWheelIndex )wheelIndex );
+				MAv4 const wheelRaycastPosWorldSpace = cpWhere * wheelRaycastPosCarSpace;
 
-		m_manipulateDeltaTime = 0.0f;
-		m_manipulatedPreviousStep = true;
+				MAv4 const carY = -cpWhere[ 1 ];
+				MAv4 const tpoint = wheelRaycastPosWorldSpace;
+
+				float const d = pathTransformation[ 1 ].dot( carY );
+
+				float t = 100.0f;
+				if( maAbs( d ) > ZERO )
+				{
+					t = ( pathTransformation[ 1 ].dot( pathTransformation[ 3 ] - tpoint ) ) / d;
+				}
+
+				wheelSurfacePositions[ wheelIndex ] = tpoint + ( t * carY );
+			}
+
+			wheelNormals[ wheelIndex ] = pathTransformation[ 1 ];
+			wheelSurfaces[ wheelIndex ] = 0;
+		}
+
+		m_iVehiclePtr->GetHandling( )->DonateWheelSuspensionCompressions( wheelSurfacePositions, wheelNormals, wheelSurfaces );
 	}
+}
 
+void GameVehicleHighDetailClass::debugDraw( float const restHeight )
+{
 	/*** debugging code - Vehicle Manipulation packet ***/
 	#if defined( GAME_VEHICLE_HIGH_DETAIL_SHOW_VEHICLE_MANIPULATION )
 	{			
@@ -18,6 +18,29 @@
 #include "Game/AI/Graphic/AIGraphic.h"
 #endif
 
+// What step( ) takes for one vehicle, so a fleet can be stepped in one call
+struct GameVehicleHighDetailStepStruct
+{
+	GameVehicleClass const * gameVehiclePtr;
+	IGameVehiclePath const * pathPtr;
+	MAm4 offsetFromPath;
+	float targetSpeed;
+	bool basicManipulation;
+	bool applyPhysicsAssists;
+	bool horn;
+	bool applyManualOverride;
+	GameVehicleManualOverrideClass const * manualOverridePtr;
+	bool applyPathAlign;
+	bool useLowSpeedForwardProjection;
+	float restHeight;
+	float vehicleLength;
+	bool donateGroundPlane;
+	bool stunned;
+};
+
+// Vehicles stepFleet( ) works on at once, its gathered state lives on the stack
+#define GAME_VEHICLE_HIGH_DETAIL_FLEET_BATCH_SIZE ( 32 )
+
 class GameVehicleHighDetailClass
 {
 	friend class GameVehicleClass;
@@ -146,6 +169,17 @@ public:
 		bool donateGroundPlane,
 		bool stunned );
 
+	// Steps vehicles [ first, first + count ) of a fleet, vehicles[ i ] with steps[ i ]. Same as calling step( ) on each,
+	// but vehicle state is gathered a batch at a time, each vehicle is projected onto its path once, and the
+	// manipulation packets are finished together before being sent. Ranges that don't overlap touch separate
+	// vehicles only, so a fleet can be split across threads by range, as far as IVehicle allows.
+	static void stepFleet(
+		GameVehicleHighDetailClass * const * vehicles,
+		GameVehicleHighDetailStepStruct const * steps,
+		unsigned int first,
+		unsigned int count,
+		float deltaTime );
+
 	void setPath( float distanceAlongPath );
 
 	IVehicle * iVehiclePtr( ) const
@@ -330,6 +364,13 @@ private:
 		float distanceAlongPath,
 		float targetSpeed );
 
+	void manipulateStep(
+		GameVehicleHighDetailStepStruct const & step,
+		MAm4 const & cpWhere,
+		SVehicleManipulationPacket & vehicleManipulationPacket );
+
+	void debugDraw( float restHeight );
+
 	void stun( bool bStunSteer );
 	void unstun( );
 
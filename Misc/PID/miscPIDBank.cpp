@@ -0,0 +1,177 @@
+// Andrew Davies
+
+#include "pch.h"
+#include "Misc/PID/miscPIDBank.h"
+#include <float.h>
+#include <stdint.h>
+#include <math.h>
+#include "Misc/misc.h"
+
+using namespace DirectX;
+
+namespace Misc
+{
+
+PIDBank::PIDBank()
+    : m_count( 0 )
+{
+}
+
+int PIDBank::add( const PIDParameters& parameters, const PIDAntiWindupEnum antiWindup )
+{
+    const int index = ( int )m_count++;
+    if( ( size_t )index == m_pGain.size() * 4 )
+    {
+        // Padding lanes have zero gains and limits, so they compute zero
+        Lanes* const lanes[] =
+        {
+            &m_pGain, &m_iGain, &m_dGain, &m_velFF, &m_bias, &m_min, &m_max, &m_slew,
+            &m_integralMin, &m_integralMax, &m_conditional, &m_integral, &m_lastError, &m_lastOutput,
+        };
+        for( Lanes* const pLanes : lanes )
+        {
+            pLanes->push_back( XMVectorZero() );
+        }
+    }
+
+    set( index, parameters, antiWindup );
+    return index;
+}
+
+void PIDBank::set( const int index, const PIDParameters& parameters, const PIDAntiWindupEnum antiWindup )
+{
+    assert( ( size_t )index < m_count );
+
+    lane( m_pGain, index ) = parameters.p_gain;
+    lane( m_iGain, index ) = parameters.i_gain;
+    lane( m_dGain, index ) = parameters.d_gain;
+    lane( m_velFF, index ) = parameters.vel_ff;
+    lane( m_bias, index ) = parameters.bias;
+    lane( m_min, index ) = parameters.min;
+    lane( m_max, index ) = parameters.max;
+    lane( m_slew, index ) = ( fabsf( parameters.slew ) > FLT_ZERO ) ? fabsf( parameters.slew ) : FLT_MAX;
+
+    float integralMin = -FLT_MAX;
+    float integralMax = FLT_MAX;
+    if( ( antiWindup == PIDAntiWindupClamp ) && ( fabsf( parameters.i_gain ) > FLT_ZERO ) )
+    {
+        integralMin = parameters.min / parameters.i_gain;
+        integralMax = parameters.max / parameters.i_gain;
+        if( integralMin > integralMax )
+        {
+            std::swap( integralMin, integralMax );
+        }
+    }
+    lane( m_integralMin, index ) = integralMin;
+    lane( m_integralMax, index ) = integralMax;
+
+    const uint32_t conditional = ( antiWindup == PIDAntiWindupConditional ) ? 0xFFFFFFFFu : 0u;
+    reinterpret_cast< uint32_t* >( m_conditional.data() )[ index ] = conditional;
+
+    clear( index );
+}
+
+void PIDBank::clear( const int index )
+{
+    assert( ( size_t )index < m_count );
+
+    lane( m_integral, index ) = 0.0f;
+    lane( m_lastError, index ) = 0.0f;
+    lane( m_lastOutput, index ) = 0.0f;
+}
+
+void PIDBank::clear()
+{
+    for( size_t group = 0; group != m_integral.size(); ++group )
+    {
+        m_integral[ group ] = XMVectorZero();
+        m_lastError[ group ] = XMVectorZero();
+        m_lastOutput[ group ] = XMVectorZero();
+    }
+}
+
+void PIDBank::reset()
+{
+    Lanes* const lanes[] =
+    {
+        &m_pGain, &m_iGain, &m_dGain, &m_velFF, &m_bias, &m_min, &m_max, &m_slew,
+        &m_integralMin, &m_integralMax, &m_conditional, &m_integral, &m_lastError, &m_lastOutput,
+    };
+    for( Lanes* const pLanes : lanes )
+    {
+        pLanes->clear();
+    }
+    m_count = 0;
+}
+
+// The same steps as PID::compute, four controllers at once
+XMVECTOR PIDBank::computeGroup( const size_t group, FXMVECTOR current, FXMVECTOR target )
+{
+    const XMVECTOR thisError = XMVectorSubtract( target, current );
+    const XMVECTOR deriv = XMVectorSubtract( thisError, m_lastError[ group ] );
+
+    const XMVECTOR min = m_min[ group ];
+    const XMVECTOR max = m_max[ group ];
+    const XMVECTOR lastOutput = m_lastOutput[ group ];
+
+    // Conditional anti-windup holds the integral while the last output sat at a limit the error pushes against
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR pushingPastMax = XMVectorAndInt( XMVectorGreaterOrEqual( lastOutput, max ), XMVectorGreater( thisError, zero ) );
+    const XMVECTOR pushingPastMin = XMVectorAndInt( XMVectorLessOrEqual( lastOutput, min ), XMVectorLess( thisError, zero ) );
+    const XMVECTOR hold = XMVectorAndInt( m_conditional[ group ], XMVectorOrInt( pushingPastMax, pushingPastMin ) );
+
+    XMVECTOR integral = XMVectorSelect( XMVectorAdd( m_integral[ group ], thisError ), m_integral[ group ], hold );
+    integral = XMVectorMin( XMVectorMax( integral, m_integralMin[ group ] ), m_integralMax[ group ] );
+    m_integral[ group ] = integral;
+
+    XMVECTOR thisOutput = XMVectorMultiply( m_pGain[ group ], thisError );
+    thisOutput = XMVectorAdd( thisOutput, XMVectorMultiply( m_iGain[ group ], integral ) );
+    thisOutput = XMVectorAdd( thisOutput, XMVectorMultiply( m_dGain[ group ], deriv ) );
+    thisOutput = XMVectorAdd( thisOutput, XMVectorMultiply( m_velFF[ group ], target ) );
+    thisOutput = XMVectorAdd( thisOutput, m_bias[ group ] );
+
+    m_lastError[ group ] = thisError;
+
+    // Slew limit, then the absolute limits
+    const XMVECTOR slew = m_slew[ group ];
+    thisOutput = XMVectorMin( XMVectorMax( thisOutput, XMVectorSubtract( lastOutput, slew ) ), XMVectorAdd( lastOutput, slew ) );
+    thisOutput = XMVectorMin( XMVectorMax( thisOutput, min ), max );
+
+    m_lastOutput[ group ] = thisOutput;
+    return thisOutput;
+}
+
+void PIDBank::compute( const float* const current, const float* const target, float* const output )
+{
+    const size_t fullGroups = m_count / 4;
+    for( size_t group = 0; group != fullGroups; ++group )
+    {
+        const XMVECTOR thisOutput = computeGroup(
+            group,
+            XMLoadFloat4( ( const XMFLOAT4* )( current + group * 4 ) ),
+            XMLoadFloat4( ( const XMFLOAT4* )( target + group * 4 ) ) );
+        XMStoreFloat4( ( XMFLOAT4* )( output + group * 4 ), thisOutput );
+    }
+
+    // The last few controllers go through a padded copy so nothing is read or written past the arrays
+    const size_t remaining = m_count - fullGroups * 4;
+    if( remaining )
+    {
+        XMFLOAT4 tailCurrent( 0.0f, 0.0f, 0.0f, 0.0f );
+        XMFLOAT4 tailTarget( 0.0f, 0.0f, 0.0f, 0.0f );
+        XMFLOAT4 tailOutput;
+        for( size_t i = 0; i != remaining; ++i )
+        {
+            ( &tailCurrent.x )[ i ] = current[ fullGroups * 4 + i ];
+            ( &tailTarget.x )[ i ] = target[ fullGroups * 4 + i ];
+        }
+
+        XMStoreFloat4( &tailOutput, computeGroup( fullGroups, XMLoadFloat4( &tailCurrent ), XMLoadFloat4( &tailTarget ) ) );
+        for( size_t i = 0; i != remaining; ++i )
+        {
+            output[ fullGroups * 4 + i ] = ( &tailOutput.x )[ i ];
+        }
+    }
+}
+
+}
@@ -0,0 +1,101 @@
+// Andrew Davies
+
+#if !defined( MISC_PID_BANK_H )
+#define MISC_PID_BANK_H
+
+#include "Misc/PID/miscPIDFwd.h"
+#include "Misc/PID/miscPID.h"
+#include <DirectXMath.h>
+#include <stddef.h>
+#include <vector>
+
+namespace Misc
+{
+
+enum PIDAntiWindupEnum
+{
+    PIDAntiWindupNone,        // integrate every error, like PID
+    PIDAntiWindupClamp,       // keep the integral term within the output limits
+    PIDAntiWindupConditional, // don't integrate while the last output was at a limit and the error pushes further past it
+};
+
+// Many controllers that each work like PID, stepped together. Every field is kept in its own array, four
+// controllers to a vector, so compute() runs four controllers at a time with min/max and selects in place
+// of PID's branches. The slew rate is a magnitude here, and a slew of zero still means no limit.
+class PIDBank
+{
+private:
+    typedef std::vector< DirectX::XMVECTOR > Lanes;
+
+    size_t m_count;
+
+    Lanes m_pGain;
+    Lanes m_iGain;
+    Lanes m_dGain;
+    Lanes m_velFF;
+    Lanes m_bias;
+    Lanes m_min;
+    Lanes m_max;
+    Lanes m_slew;          // FLT_MAX where there's no slew limit
+    Lanes m_integralMin;   // -FLT_MAX unless clamping
+    Lanes m_integralMax;   // FLT_MAX unless clamping
+    Lanes m_conditional;   // all bits set for conditional integration
+
+    Lanes m_integral;
+    Lanes m_lastError;
+    Lanes m_lastOutput;
+
+    static float& lane( Lanes& lanes, size_t index )
+    {
+        return reinterpret_cast< float* >( lanes.data() )[ index ];
+    }
+
+    static float lane( const Lanes& lanes, size_t index )
+    {
+        return reinterpret_cast< const float* >( lanes.data() )[ index ];
+    }
+
+    DirectX::XMVECTOR computeGroup( size_t group, DirectX::FXMVECTOR current, DirectX::FXMVECTOR target );
+
+public:
+    PIDBank();
+
+    // Returns the new controller's index
+    int add( const PIDParameters& parameters, PIDAntiWindupEnum antiWindup = PIDAntiWindupNone );
+
+    void set( int index, const PIDParameters& parameters, PIDAntiWindupEnum antiWindup = PIDAntiWindupNone );
+
+    void clear( int index );
+
+    void clear();
+
+    // Removes every controller
+    void reset();
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+    float integral( const int index ) const
+    {
+        return lane( m_integral, index );
+    }
+
+    float last_error( const int index ) const
+    {
+        return lane( m_lastError, index );
+    }
+
+    float last_output( const int index ) const
+    {
+        return lane( m_lastOutput, index );
+    }
+
+    // Steps every controller once. current, target and output hold size() values, indexed like the controllers.
+    void compute( const float* current, const float* target, float* output );
+};
+
+}
+
+#endif
@@ -7,6 +7,7 @@ namespace Misc
 {
 
 class PID;
+class PIDBank;
 
 }
 
@@ -0,0 +1,262 @@
+// Andrew Davies
+
+#include "pch.h"
+#include "Misc/Path/miscPath.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include "Misc/misc.h"
+
+using namespace DirectX;
+
+namespace Misc
+{
+
+Path::Path()
+{
+}
+
+Path::Path( const XMFLOAT3* const points, const size_t count )
+{
+    set( points, count );
+}
+
+void Path::set( const XMFLOAT3* const points, const size_t count )
+{
+    assert( count >= 2 );
+
+    m_points.assign( points, points + count );
+
+    m_lengths.resize( count );
+    m_lengths[ 0 ] = 0.0f;
+    for( size_t i = 1; i != count; ++i )
+    {
+        const XMVECTOR segment = XMVectorSubtract( XMLoadFloat3( &points[ i ] ), XMLoadFloat3( &points[ i - 1 ] ) );
+        m_lengths[ i ] = m_lengths[ i - 1 ] + XMVectorGetX( XMVector3Length( segment ) );
+    }
+
+    // Consecutive segments are close together, so splitting by index makes boxes about as tight as splitting by
+    // position would
+    m_nodes.clear();
+    m_nodes.reserve( 2 * ( ( count - 1 ) / kLeafSegments + 1 ) );
+    build( 0, ( uint32_t )( count - 1 ) );
+}
+
+uint32_t Path::build( const uint32_t first, const uint32_t count )
+{
+    const uint32_t index = ( uint32_t )m_nodes.size();
+    m_nodes.push_back( Node() );
+
+    XMVECTOR min = XMLoadFloat3( &m_points[ first ] );
+    XMVECTOR max = min;
+    for( uint32_t i = first + 1; i <= first + count; ++i )
+    {
+        const XMVECTOR point = XMLoadFloat3( &m_points[ i ] );
+        min = XMVectorMin( min, point );
+        max = XMVectorMax( max, point );
+    }
+    XMStoreFloat3( &m_nodes[ index ].m_min, min );
+    XMStoreFloat3( &m_nodes[ index ].m_max, max );
+
+    if( count <= kLeafSegments )
+    {
+        m_nodes[ index ].m_first = first;
+        m_nodes[ index ].m_count = count;
+        m_nodes[ index ].m_right = 0;
+    }
+    else
+    {
+        const uint32_t half = count / 2;
+        build( first, half );
+        const uint32_t right = build( first + half, count - half );
+        m_nodes[ index ].m_first = first;
+        m_nodes[ index ].m_count = 0;
+        m_nodes[ index ].m_right = right;
+    }
+    return index;
+}
+
+float Path::segmentDistanceSquared( const size_t segment, FXMVECTOR position, float& t ) const
+{
+    const XMVECTOR start = XMLoadFloat3( &m_points[ segment ] );
+    const XMVECTOR along = XMVectorSubtract( XMLoadFloat3( &m_points[ segment + 1 ] ), start );
+    const XMVECTOR toPosition = XMVectorSubtract( position, start );
+
+    const float lengthSquared = XMVectorGetX( XMVector3LengthSq( along ) );
+    t = ( lengthSquared > FLT_ZERO ) ? clamp( XMVectorGetX( XMVector3Dot( toPosition, along ) ) / lengthSquared, 0.0f, 1.0f ) : 0.0f;
+
+    return XMVectorGetX( XMVector3LengthSq( XMVectorSubtract( toPosition, XMVectorScale( along, t ) ) ) );
+}
+
+void Path::searchTree( FXMVECTOR position, const size_t excludeFirst, const size_t excludeLast, Closest& closest ) const
+{
+    // Deep enough for any path that fits in 32 bit segment indices
+    uint32_t stack[ 64 ];
+    int top = 0;
+    stack[ top++ ] = 0;
+
+    const XMVECTOR zero = XMVectorZero();
+    while( top )
+    {
+        const Node& node = m_nodes[ stack[ --top ] ];
+
+        const XMVECTOR outside = XMVectorMax(
+            XMVectorMax( XMVectorSubtract( XMLoadFloat3( &node.m_min ), position ), zero ),
+            XMVectorSubtract( position, XMLoadFloat3( &node.m_max ) ) );
+        if( XMVectorGetX( XMVector3LengthSq( outside ) ) >= closest.m_distanceSquared )
+        {
+            continue;
+        }
+
+        if( node.m_count )
+        {
+            for( size_t segment = node.m_first; segment != node.m_first + node.m_count; ++segment )
+            {
+                if( ( segment >= excludeFirst ) && ( segment <= excludeLast ) )
+                {
+                    continue;
+                }
+
+                float t;
+                const float distanceSquared = segmentDistanceSquared( segment, position, t );
+                if( distanceSquared < closest.m_distanceSquared )
+                {
+                    closest.m_segment = segment;
+                    closest.m_t = t;
+                    closest.m_distanceSquared = distanceSquared;
+                }
+            }
+        }
+        else
+        {
+            // The first child is searched first, as it comes next in the array
+            stack[ top++ ] = node.m_right;
+            stack[ top++ ] = ( uint32_t )( &node - &m_nodes[ 0 ] ) + 1;
+        }
+    }
+}
+
+float Path::distanceAlong( const Closest& closest ) const
+{
+    const float start = m_lengths[ closest.m_segment ];
+    return start + closest.m_t * ( m_lengths[ closest.m_segment + 1 ] - start );
+}
+
+float Path::closestDistanceAlong( FXMVECTOR position ) const
+{
+    Closest closest = { 0, 0.0f, FLT_MAX };
+    searchTree( position, 1, 0, closest );
+    return distanceAlong( closest );
+}
+
+float Path::closestDistanceAlong( FXMVECTOR position, PathCursor& cursor ) const
+{
+    Closest closest = { 0, 0.0f, FLT_MAX };
+
+    if( cursor.m_clearance >= 0.0f )
+    {
+        for( size_t segment = cursor.m_first; segment <= cursor.m_last; ++segment )
+        {
+            float t;
+            const float distanceSquared = segmentDistanceSquared( segment, position, t );
+            if( distanceSquared < closest.m_distanceSquared )
+            {
+                closest.m_segment = segment;
+                closest.m_t = t;
+                closest.m_distanceSquared = distanceSquared;
+            }
+        }
+
+        // Every other segment is at least the clearance, less how far the follower has moved, from here
+        const float moved = XMVectorGetX( XMVector3Length( XMVectorSubtract( position, XMLoadFloat3( &cursor.m_anchor ) ) ) );
+        const float outside = cursor.m_clearance - moved;
+        if( ( outside > 0.0f ) && ( closest.m_distanceSquared <= outside * outside ) )
+        {
+            cursor.m_segment = closest.m_segment;
+            return distanceAlong( closest );
+        }
+    }
+
+    // Search everything, then again without the segments around the answer to find the clearance
+    closest.m_distanceSquared = FLT_MAX;
+    searchTree( position, 1, 0, closest );
+
+    const size_t lastSegment = segmentCount() - 1;
+    cursor.m_segment = closest.m_segment;
+    cursor.m_first = ( closest.m_segment > kCursorSegments ) ? closest.m_segment - kCursorSegments : 0;
+    cursor.m_last = ( std::min )( closest.m_segment + kCursorSegments, lastSegment );
+    XMStoreFloat3( &cursor.m_anchor, position );
+
+    if( ( cursor.m_first == 0 ) && ( cursor.m_last == lastSegment ) )
+    {
+        cursor.m_clearance = FLT_MAX;
+    }
+    else
+    {
+        Closest nearestOutside = { 0, 0.0f, FLT_MAX };
+        searchTree( position, cursor.m_first, cursor.m_last, nearestOutside );
+        cursor.m_clearance = sqrtf( nearestOutside.m_distanceSquared );
+    }
+
+    return distanceAlong( closest );
+}
+
+size_t Path::segmentAt( const float distance, const size_t hint ) const
+{
+    const size_t count = segmentCount();
+
+    // Followers usually stay on the same segment, or move on to the next
+    if( hint < count )
+    {
+        for( size_t segment = ( hint > 0 ) ? hint - 1 : 0; segment <= hint + 1 && segment < count; ++segment )
+        {
+            if( ( distance >= m_lengths[ segment ] ) && ( distance <= m_lengths[ segment + 1 ] ) )
+            {
+                return segment;
+            }
+        }
+    }
+
+    if( distance <= 0.0f )
+    {
+        return 0;
+    }
+
+    const std::vector< float >::const_iterator end = std::upper_bound( m_lengths.begin(), m_lengths.end(), distance );
+    const size_t segment = ( size_t )( end - m_lengths.begin() );
+    return ( segment > count ) ? count - 1 : segment - 1;
+}
+
+XMVECTOR Path::positionAt( const float distance ) const
+{
+    PathCursor cursor;
+    return positionAt( distance, cursor );
+}
+
+XMVECTOR Path::positionAt( const float distance, PathCursor& cursor ) const
+{
+    const size_t segment = segmentAt( distance, cursor.m_segment );
+    cursor.m_segment = segment;
+
+    const float start = m_lengths[ segment ];
+    const float segmentLength = m_lengths[ segment + 1 ] - start;
+    const float t = ( segmentLength > FLT_ZERO ) ? clamp( ( distance - start ) / segmentLength, 0.0f, 1.0f ) : 0.0f;
+
+    return XMVectorLerp( XMLoadFloat3( &m_points[ segment ] ), XMLoadFloat3( &m_points[ segment + 1 ] ), t );
+}
+
+XMVECTOR Path::directionAt( const float distance ) const
+{
+    PathCursor cursor;
+    return directionAt( distance, cursor );
+}
+
+XMVECTOR Path::directionAt( const float distance, PathCursor& cursor ) const
+{
+    const size_t segment = segmentAt( distance, cursor.m_segment );
+    cursor.m_segment = segment;
+
+    return XMVector3Normalize( XMVectorSubtract( XMLoadFloat3( &m_points[ segment + 1 ] ), XMLoadFloat3( &m_points[ segment ] ) ) );
+}
+
+}
@@ -0,0 +1,122 @@
+// Andrew Davies
+
+#if !defined( MISC_PATH_H )
+#define MISC_PATH_H
+
+#include "Misc/Path/miscPathFwd.h"
+#include <DirectXMath.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace Misc
+{
+
+// What a follower remembers about its last query on a Path, so the next one can start where it left off.
+// closestDistanceAlong() keeps the segments around the last full query, and how far it is from there to the
+// nearest segment outside them. While a follower stays well inside that distance only those few segments are
+// tested, and the tree is only searched again once it has moved on.
+struct PathCursor
+{
+    size_t m_segment;              // last segment found, by either query
+    size_t m_first;                // the segments near m_anchor
+    size_t m_last;
+    DirectX::XMFLOAT3 m_anchor;    // where the last full query was made from
+    float m_clearance;             // distance from m_anchor to the nearest segment outside m_first..m_last, negative when unset
+
+    PathCursor()
+        : m_segment( 0 )
+        , m_first( 0 )
+        , m_last( 0 )
+        , m_anchor( 0.0f, 0.0f, 0.0f )
+        , m_clearance( -1.0f )
+    {
+    }
+
+    // Call when the follower jumps, or is put on another path
+    void reset()
+    {
+        m_segment = 0;
+        m_clearance = -1.0f;
+    }
+};
+
+// A polyline parameterised by distance along it. The cumulative length at each point turns a distance into a
+// segment with a binary search, or a step or two from a cursor's segment, and a bounding box tree over the
+// segments finds the closest point without testing every segment.
+class Path
+{
+private:
+    struct Node
+    {
+        DirectX::XMFLOAT3 m_min;
+        uint32_t m_first;    // first segment, for a leaf
+        DirectX::XMFLOAT3 m_max;
+        uint32_t m_count;    // segments in a leaf, zero for an inner node
+        uint32_t m_right;    // an inner node's second child; the first follows it
+    };
+
+    struct Closest
+    {
+        size_t m_segment;
+        float m_t;
+        float m_distanceSquared;
+    };
+
+    std::vector< DirectX::XMFLOAT3 > m_points;
+    std::vector< float > m_lengths;    // distance along the path to each point
+    std::vector< Node > m_nodes;
+
+    uint32_t build( uint32_t first, uint32_t count );
+
+    float segmentDistanceSquared( size_t segment, DirectX::FXMVECTOR position, float& t ) const;
+
+    // Tightens closest with every segment outside excludeFirst..excludeLast that's nearer than it
+    void searchTree( DirectX::FXMVECTOR position, size_t excludeFirst, size_t excludeLast, Closest& closest ) const;
+
+    size_t segmentAt( float distance, size_t hint ) const;
+
+    float distanceAlong( const Closest& closest ) const;
+
+public:
+    static const uint32_t kLeafSegments = 4;
+
+    // Segments either side of a cursor's that are tested before searching the tree
+    static const size_t kCursorSegments = 4;
+
+    Path();
+
+    Path( const DirectX::XMFLOAT3* points, size_t count );
+
+    // Replaces the points, which need at least two, and rebuilds the tables
+    void set( const DirectX::XMFLOAT3* points, size_t count );
+
+    size_t pointCount() const
+    {
+        return m_points.size();
+    }
+
+    size_t segmentCount() const
+    {
+        return m_points.empty() ? 0 : m_points.size() - 1;
+    }
+
+    float length() const
+    {
+        return m_lengths.empty() ? 0.0f : m_lengths.back();
+    }
+
+    // The distance along the path of the point on it closest to position
+    float closestDistanceAlong( DirectX::FXMVECTOR position ) const;
+    float closestDistanceAlong( DirectX::FXMVECTOR position, PathCursor& cursor ) const;
+
+    // The point and unit direction at a distance along the path, which is clamped to the ends
+    DirectX::XMVECTOR positionAt( float distance ) const;
+    DirectX::XMVECTOR positionAt( float distance, PathCursor& cursor ) const;
+    DirectX::XMVECTOR directionAt( float distance ) const;
+    DirectX::XMVECTOR directionAt( float distance, PathCursor& cursor ) const;
+};
+
+}
+
+#endif
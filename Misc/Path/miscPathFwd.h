@@ -0,0 +1,14 @@
+// Andrew Davies
+
+#if !defined( MISC_PATH_FWD_H )
+#define MISC_PATH_FWD_H
+
+namespace Misc
+{
+
+class Path;
+struct PathCursor;
+
+}
+
+#endif
@@ -0,0 +1,253 @@
+// Andrew Davies
+
+#include "pch.h"
+#include "Misc/Proximity/miscProximity.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+using namespace DirectX;
+
+namespace Misc
+{
+
+namespace
+{
+
+// Lanes to keep when only the first n of four are agents in range
+const XMVECTORU32 g_laneMask[ 5 ] =
+{
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0x00000000 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF },
+};
+
+XMVECTOR laneMask( const size_t remaining )
+{
+    return g_laneMask[ ( remaining < 4 ) ? remaining : 4 ];
+}
+
+bool anyLane( FXMVECTOR mask )
+{
+    uint32_t comparison;
+    XMVectorEqualIntR( &comparison, mask, XMVectorZero() );
+    return !XMComparisonAllTrue( comparison );
+}
+
+}
+
+ProximityGrid::ProximityGrid()
+    : m_cellSize( 1.0f )
+    , m_inverseCellSize( 1.0f )
+    , m_minX( 0.0f )
+    , m_minZ( 0.0f )
+    , m_columns( 0 )
+    , m_rows( 0 )
+    , m_maxRadius( 0.0f )
+{
+}
+
+int ProximityGrid::column( const float x ) const
+{
+    const int cell = ( int )( ( x - m_minX ) * m_inverseCellSize );
+    return ( std::min )( ( std::max )( cell, 0 ), m_columns - 1 );
+}
+
+int ProximityGrid::row( const float z ) const
+{
+    const int cell = ( int )( ( z - m_minZ ) * m_inverseCellSize );
+    return ( std::min )( ( std::max )( cell, 0 ), m_rows - 1 );
+}
+
+void ProximityGrid::build( const XMFLOAT3* const positions, const float* const radii, const size_t count, const float cellSize )
+{
+    assert( cellSize > 0.0f );
+
+    m_index.resize( count );
+    m_x.resize( count + 3 );
+    m_y.resize( count + 3 );
+    m_z.resize( count + 3 );
+    m_radius.resize( count + 3 );
+    m_agentCell.resize( count );
+    m_maxRadius = 0.0f;
+
+    float minX = FLT_MAX;
+    float minZ = FLT_MAX;
+    float maxX = -FLT_MAX;
+    float maxZ = -FLT_MAX;
+    for( size_t i = 0; i != count; ++i )
+    {
+        minX = ( std::min )( minX, positions[ i ].x );
+        minZ = ( std::min )( minZ, positions[ i ].z );
+        maxX = ( std::max )( maxX, positions[ i ].x );
+        maxZ = ( std::max )( maxZ, positions[ i ].z );
+    }
+    if( !count )
+    {
+        minX = minZ = maxX = maxZ = 0.0f;
+    }
+
+    // Bigger cells where the agents are too spread out for the grid to stay small
+    const double maxCells = ( double )( kCellsPerAgent * count + 1 );
+    m_cellSize = cellSize;
+    for( ;; )
+    {
+        const double columns = floor( ( maxX - minX ) / m_cellSize ) + 1.0;
+        const double rows = floor( ( maxZ - minZ ) / m_cellSize ) + 1.0;
+        if( columns * rows <= maxCells )
+        {
+            m_columns = ( int )columns;
+            m_rows = ( int )rows;
+            break;
+        }
+        m_cellSize *= 2.0f;
+    }
+    m_inverseCellSize = 1.0f / m_cellSize;
+    m_minX = minX;
+    m_minZ = minZ;
+
+    // Counting sort by cell
+    const size_t cellCount = ( size_t )m_columns * m_rows;
+    m_cellStart.assign( cellCount + 1, 0 );
+    for( size_t i = 0; i != count; ++i )
+    {
+        const uint32_t cell = ( uint32_t )( row( positions[ i ].z ) * m_columns + column( positions[ i ].x ) );
+        m_agentCell[ i ] = cell;
+        ++m_cellStart[ cell + 1 ];
+    }
+    for( size_t cell = 0; cell != cellCount; ++cell )
+    {
+        m_cellStart[ cell + 1 ] += m_cellStart[ cell ];
+    }
+
+    // Fill forwards from each cell's start, which leaves m_cellStart[ cell ] at the next cell's start
+    for( size_t i = 0; i != count; ++i )
+    {
+        const uint32_t sorted = m_cellStart[ m_agentCell[ i ] ]++;
+        const float radius = radii ? radii[ i ] : 0.0f;
+        m_x[ sorted ] = positions[ i ].x;
+        m_y[ sorted ] = positions[ i ].y;
+        m_z[ sorted ] = positions[ i ].z;
+        m_radius[ sorted ] = radius;
+        m_index[ sorted ] = ( uint32_t )i;
+        m_maxRadius = ( std::max )( m_maxRadius, radius );
+    }
+    for( size_t cell = cellCount; cell != 0; --cell )
+    {
+        m_cellStart[ cell ] = m_cellStart[ cell - 1 ];
+    }
+    m_cellStart[ 0 ] = 0;
+
+    for( size_t i = count; i != count + 3; ++i )
+    {
+        m_x[ i ] = m_y[ i ] = m_z[ i ] = m_radius[ i ] = 0.0f;
+    }
+}
+
+void ProximityGrid::gatherXZ( const size_t first, const size_t last, FXMVECTOR x, FXMVECTOR z, FXMVECTOR radiusSquared, std::vector< uint32_t >& results ) const
+{
+    for( size_t i = first; i < last; i += 4 )
+    {
+        const XMVECTOR dx = XMVectorSubtract( XMLoadFloat4( ( const XMFLOAT4* )&m_x[ i ] ), x );
+        const XMVECTOR dz = XMVectorSubtract( XMLoadFloat4( ( const XMFLOAT4* )&m_z[ i ] ), z );
+        const XMVECTOR separationSquared = XMVectorMultiplyAdd( dx, dx, XMVectorMultiply( dz, dz ) );
+
+        const XMVECTOR inside = XMVectorAndInt( XMVectorLessOrEqual( separationSquared, radiusSquared ), laneMask( last - i ) );
+        if( anyLane( inside ) )
+        {
+            XMUINT4 lanes;
+            XMStoreUInt4( &lanes, inside );
+            const uint32_t* const lane = &lanes.x;
+            for( size_t j = 0; j != 4; ++j )
+            {
+                if( lane[ j ] )
+                {
+                    results.push_back( m_index[ i + j ] );
+                }
+            }
+        }
+    }
+}
+
+void ProximityGrid::queryRadius( const XMFLOAT3& centre, const float radius, std::vector< uint32_t >& results ) const
+{
+    if( m_index.empty() )
+    {
+        return;
+    }
+
+    const XMVECTOR x = XMVectorReplicate( centre.x );
+    const XMVECTOR z = XMVectorReplicate( centre.z );
+    const XMVECTOR radiusSquared = XMVectorReplicate( radius * radius );
+
+    // A row's cells are next to each other in the sorted arrays, so each row is one run of agents
+    const int firstColumn = column( centre.x - radius );
+    const int lastColumn = column( centre.x + radius );
+    const int lastRow = row( centre.z + radius );
+    for( int cellRow = row( centre.z - radius ); cellRow <= lastRow; ++cellRow )
+    {
+        const size_t rowCell = ( size_t )cellRow * m_columns;
+        gatherXZ( m_cellStart[ rowCell + firstColumn ], m_cellStart[ rowCell + lastColumn + 1 ], x, z, radiusSquared, results );
+    }
+}
+
+void ProximityGrid::queryRadius( const XMFLOAT3* const centres, const float* const radii, const size_t count, std::vector< uint32_t >& offsets, std::vector< uint32_t >& results ) const
+{
+    offsets.resize( count + 1 );
+    for( size_t i = 0; i != count; ++i )
+    {
+        offsets[ i ] = ( uint32_t )results.size();
+        queryRadius( centres[ i ], radii[ i ], results );
+    }
+    offsets[ count ] = ( uint32_t )results.size();
+}
+
+void ProximityGrid::intersectingPairs( std::vector< std::pair< uint32_t, uint32_t > >& pairs ) const
+{
+    const size_t count = m_index.size();
+    for( size_t agent = 0; agent != count; ++agent )
+    {
+        const float reach = m_radius[ agent ] + m_maxRadius;
+        const XMVECTOR x = XMVectorReplicate( m_x[ agent ] );
+        const XMVECTOR y = XMVectorReplicate( m_y[ agent ] );
+        const XMVECTOR z = XMVectorReplicate( m_z[ agent ] );
+        const XMVECTOR radius = XMVectorReplicate( m_radius[ agent ] );
+
+        const int firstColumn = column( m_x[ agent ] - reach );
+        const int lastColumn = column( m_x[ agent ] + reach );
+        const int lastRow = row( m_z[ agent ] + reach );
+        for( int cellRow = row( m_z[ agent ] - reach ); cellRow <= lastRow; ++cellRow )
+        {
+            // Only agents after this one in the sorted arrays, so each pair is found once
+            const size_t rowCell = ( size_t )cellRow * m_columns;
+            const size_t last = m_cellStart[ rowCell + lastColumn + 1 ];
+            for( size_t i = ( std::max )( ( size_t )m_cellStart[ rowCell + firstColumn ], agent + 1 ); i < last; i += 4 )
+            {
+                const XMVECTOR dx = XMVectorSubtract( XMLoadFloat4( ( const XMFLOAT4* )&m_x[ i ] ), x );
+                const XMVECTOR dy = XMVectorSubtract( XMLoadFloat4( ( const XMFLOAT4* )&m_y[ i ] ), y );
+                const XMVECTOR dz = XMVectorSubtract( XMLoadFloat4( ( const XMFLOAT4* )&m_z[ i ] ), z );
+                const XMVECTOR separationSquared = XMVectorMultiplyAdd( dx, dx, XMVectorMultiplyAdd( dy, dy, XMVectorMultiply( dz, dz ) ) );
+                const XMVECTOR touching = XMVectorAdd( XMLoadFloat4( ( const XMFLOAT4* )&m_radius[ i ] ), radius );
+
+                const XMVECTOR inside = XMVectorAndInt( XMVectorLessOrEqual( separationSquared, XMVectorMultiply( touching, touching ) ), laneMask( last - i ) );
+                if( anyLane( inside ) )
+                {
+                    XMUINT4 lanes;
+                    XMStoreUInt4( &lanes, inside );
+                    const uint32_t* const lane = &lanes.x;
+                    for( size_t j = 0; j != 4; ++j )
+                    {
+                        if( lane[ j ] )
+                        {
+                            pairs.push_back( std::make_pair( m_index[ agent ], m_index[ i + j ] ) );
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
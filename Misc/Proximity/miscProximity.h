@@ -0,0 +1,74 @@
+// Andrew Davies
+
+#if !defined( MISC_PROXIMITY_H )
+#define MISC_PROXIMITY_H
+
+#include "Misc/Proximity/miscProximityFwd.h"
+#include <DirectXMath.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace Misc
+{
+
+// Uniform grid over agents in the XZ plane, for finding who's near whom without testing every pair. build()
+// counting sorts the agents by cell each frame, so each cell's agents sit together in arrays of x, y, z and
+// radius, and queries test them four at a time.
+//
+// Radius queries are by XZ separation, like AI::XZSeparation. Sphere pairs use all three axes, like
+// AI::SpheresIntersect. Results are the agents' indices as given to build().
+class ProximityGrid
+{
+private:
+    float m_cellSize;
+    float m_inverseCellSize;
+    float m_minX;
+    float m_minZ;
+    int m_columns;
+    int m_rows;
+    float m_maxRadius;
+
+    std::vector< uint32_t > m_cellStart;    // where each cell's agents start, and one past the last cell
+    std::vector< uint32_t > m_agentCell;
+
+    // Agents in cell order, with a few entries past the end so four can always be loaded
+    std::vector< float > m_x;
+    std::vector< float > m_y;
+    std::vector< float > m_z;
+    std::vector< float > m_radius;
+    std::vector< uint32_t > m_index;
+
+    int column( float x ) const;
+    int row( float z ) const;
+
+    void gatherXZ( size_t first, size_t last, DirectX::FXMVECTOR x, DirectX::FXMVECTOR z, DirectX::FXMVECTOR radiusSquared, std::vector< uint32_t >& results ) const;
+
+public:
+    // Cells at most this many times the agents, so spread out crowds don't make huge grids
+    static const int kCellsPerAgent = 4;
+
+    ProximityGrid();
+
+    // radii can be null, for agents that are points. The cell size should be about the usual query radius.
+    void build( const DirectX::XMFLOAT3* positions, const float* radii, size_t count, float cellSize );
+
+    size_t size() const
+    {
+        return m_index.size();
+    }
+
+    // Appends every agent whose position is within radius of centre in XZ
+    void queryRadius( const DirectX::XMFLOAT3& centre, float radius, std::vector< uint32_t >& results ) const;
+
+    // The same for many centres. Centre i's agents are results[ offsets[ i ] ] up to results[ offsets[ i + 1 ] ].
+    void queryRadius( const DirectX::XMFLOAT3* centres, const float* radii, size_t count, std::vector< uint32_t >& offsets, std::vector< uint32_t >& results ) const;
+
+    // Appends each pair of agents whose spheres touch, once
+    void intersectingPairs( std::vector< std::pair< uint32_t, uint32_t > >& pairs ) const;
+};
+
+}
+
+#endif
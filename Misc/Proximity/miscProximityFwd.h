@@ -0,0 +1,13 @@
+// Andrew Davies
+
+#if !defined( MISC_PROXIMITY_FWD_H )
+#define MISC_PROXIMITY_FWD_H
+
+namespace Misc
+{
+
+class ProximityGrid;
+
+}
+
+#endif
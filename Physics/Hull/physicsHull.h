@@ -0,0 +1,103 @@
+// Andrew Davies
+
+#if !defined( PHYSICS_HULL_H )
+#define PHYSICS_HULL_H
+
+#include "Physics/Hull/physicsHullFwd.h"
+#include <DirectXMath.h>
+#include <stdint.h>
+#include <vector>
+
+// A closed hull of V vertices has 3V - 6 edges and 2V - 4 triangles, so 12 vertices is the most that fits Object::MAX_EDGES.
+#define PHYSICS_HULL_DEFAULT_MAX_VERTICES 12
+#define PHYSICS_HULL_DEFAULT_MAX_PIECES 8
+#define PHYSICS_HULL_DEFAULT_MAX_CONCAVITY 0.05f // Fraction of the bounding box diagonal
+
+namespace Physics
+{
+
+// Convex hull of a point set, built by quickhull.
+// The hull grows by adding the point furthest outside it first, so stopping at a vertex budget
+// leaves a simplified hull made of the most significant points, lying inside the full hull.
+class ConvexHull
+{
+public:
+    typedef std::vector< DirectX::XMFLOAT3 > Positions;
+    typedef std::vector< uint16_t > Indices;
+
+private:
+    Positions m_positions;
+    Indices m_triangleVertexIndices; // Wound so cross( v1 - v0, v2 - v1 ) points outwards, as MeshBuilder expects
+
+public:
+    ConvexHull();
+
+    // Returns false, leaving the hull empty, if the points don't span a volume.
+    bool build(
+        const DirectX::XMFLOAT3* points,
+        int pointCount,
+        int maxVertices );
+
+    void clear();
+
+    const Positions& positions() const
+    {
+        return m_positions;
+    }
+
+    const Indices& triangleVertexIndices() const
+    {
+        return m_triangleVertexIndices;
+    }
+
+    bool empty() const
+    {
+        return m_triangleVertexIndices.empty();
+    }
+
+    friend class ConvexDecomposition;
+};
+
+// Approximate convex decomposition of a triangle mesh.
+// Pieces are split in half along their longest axis until each is within the concavity limit of its own hull,
+// then each piece is replaced by its hull simplified to the vertex budget.
+// Built offline and cached next to the model, since it's far too slow for startup.
+class ConvexDecomposition
+{
+public:
+    typedef std::vector< ConvexHull > Hulls;
+
+private:
+    ConvexHull m_hull; // Of the whole mesh
+    Hulls m_pieces;
+
+public:
+    ConvexDecomposition();
+
+    void build(
+        const DirectX::XMFLOAT3* positions,
+        int positionCount,
+        const uint32_t* triangleVertexIndices,
+        int indexCount,
+        int maxHullVertices,
+        int maxPieces,
+        float maxConcavity );
+
+    bool load( const char* filename );
+
+    bool save( const char* filename ) const;
+
+    const ConvexHull& hull() const
+    {
+        return m_hull;
+    }
+
+    const Hulls& pieces() const
+    {
+        return m_pieces;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,14 @@
+// Andrew Davies
+
+#if !defined( PHYSICS_HULL_FWD_H )
+#define PHYSICS_HULL_FWD_H
+
+namespace Physics
+{
+
+class ConvexHull;
+class ConvexDecomposition;
+
+}
+
+#endif
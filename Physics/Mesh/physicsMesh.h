@@ -0,0 +1,85 @@
+// Andrew Davies
+
+#if !defined( PHYSICS_MESH_H )
+#define PHYSICS_MESH_H
+
+#include "Physics/Mesh/physicsMeshFwd.h"
+#include "Physics/Object/physicsObject.h"
+#include <DirectXMath.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace Physics
+{
+
+// Builds an object's vertices, edges and triangles from one or more indexed triangle meshes.
+// Positions within the weld distance of each other become a single physics vertex, across meshes too.
+class MeshBuilder
+{
+public:
+    typedef std::vector< DirectX::XMVECTOR > Positions;
+    typedef std::vector< int > Indices;
+
+private:
+    float m_weldDistance;
+
+    Positions m_positions;
+    Indices m_triangleVertexIndices;
+
+    // Spatial hash over m_positions. Cells are m_weldDistance wide, each one a chain through m_nextInCell.
+    std::unordered_map< uint64_t, int > m_cellFirstPositionIndex;
+    Indices m_nextInCell;
+
+public:
+    explicit MeshBuilder( float weldDistance );
+
+    void addMesh(
+        const uint8_t* positionData,
+        uint32_t vertexStride,
+        uint32_t vertexCount,
+        const uint16_t* indexData,
+        uint32_t indexCount );
+
+    void addMesh(
+        const uint8_t* positionData,
+        uint32_t vertexStride,
+        uint32_t vertexCount,
+        const uint32_t* indexData,
+        uint32_t indexCount );
+
+    void build(
+        Object::Vertices& vertices,
+        Object::Edges& edges,
+        Object::Triangles& triangles ) const;
+
+    float weldDistance() const
+    {
+        return m_weldDistance;
+    }
+
+    const Positions& positions() const
+    {
+        return m_positions;
+    }
+
+    const Indices& triangleVertexIndices() const
+    {
+        return m_triangleVertexIndices;
+    }
+
+private:
+    template< typename IndexType >
+    void addIndexedMesh(
+        const uint8_t* positionData,
+        uint32_t vertexStride,
+        uint32_t vertexCount,
+        const IndexType* indexData,
+        uint32_t indexCount );
+
+    int weld( const DirectX::XMVECTOR& position );
+};
+
+}
+
+#endif
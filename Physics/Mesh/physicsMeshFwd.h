@@ -0,0 +1,13 @@
+// Andrew Davies
+
+#if !defined( PHYSICS_MESH_FWD_H )
+#define PHYSICS_MESH_FWD_H
+
+namespace Physics
+{
+
+class MeshBuilder;
+
+}
+
+#endif
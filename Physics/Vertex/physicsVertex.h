@@ -13,7 +13,8 @@ namespace Physics
 class Vertex
 {
 public:
-    typedef Dav::Vector< int, 8 > Indices;
+    // Wide enough for any vertex of a hull built to PHYSICS_HULL_DEFAULT_MAX_VERTICES
+    typedef Dav::Vector< int, 16 > Indices;
 
 private:
     DirectX::XMVECTOR m_position;